@@ -20,6 +20,8 @@
 // 1x 24 ring
 // 1x 16 ring
 // 1x jewel
+// Defaults only - the real LED count and grid come from settings.json
+// (see lights/LEDGeometry.h)
 #define DIMS_PANELS 32
 #define NUM_LEDS 32 * 32
 
@@ -5,6 +5,11 @@
 #include "GlobalState.h"
 #include <ArduinoJson.h>
 #include "controllers/BrightnessController.h"
+#include "hal/network/CommandDocPool.h"
+#include "hal/network/CommandTrace.h"
+#include "hal/network/PacketAssembler.h"
+#include "freertos/TaskManager.h"
+#include "freertos/PreferencesWriterTask.h"
 #include <vector>
 #if SUPPORTS_SD_CARD
 #include "hal/SDCardController.h"
@@ -13,10 +18,7 @@
 // Global LED manager instance
 LEDManager* g_ledManager = nullptr;
 
-// Global variables that other parts of the system expect
-Light LightArr[NUM_LEDS];
-Light BlendLightArr[NUM_LEDS];
-// Light FinalLeds[NUM_LEDS];
+// LightArr and BlendLightArr are allocated at boot by AllocateLEDBuffers()
 
 // Effect list management (static to PatternManager)
 static std::vector<String> effectOrderJsonStrings;
@@ -52,6 +54,13 @@ void SaveUserPreferences(const DeviceState& state) {
     //     return;
     // }
     
+    // Once the writer task runs this only snapshots the state; the flash write
+    // happens later on core 0, after the burst of changes settles
+    if (auto* writer = TaskManager::getInstance().getPreferencesWriterTask()) {
+        writer->requestSave(state);
+        return;
+    }
+    
     // Use the global preferences manager to save
     prefsManager.begin();
     prefsManager.save(state);
@@ -146,43 +155,72 @@ void Pattern_Setup() {
 // }
 
 void HandleJSONCommand(const String& jsonCommand) {
+    HandleCommandMessage((const uint8_t*) jsonCommand.c_str(), jsonCommand.length(), CommandEncoding::Json);
+}
+
+// Multi-part commands over BLE and serial (source 0); the WebSocket server has its own
+static PacketAssembler bleAssembler;
+
+// True if the message was a fragment and has been dealt with
+static bool HandleCommandFragment(const JsonObject& message) {
+    if (!PacketAssembler::isFragment(message)) {
+        return false;
+    }
+    PacketFragment part;
+    if (!PacketAssembler::readFragment(message, part)) {
+        LOG_WARN_COMPONENT("PatternManager", "Invalid command fragment");
+        return true;
+    }
+    const FragmentResult result = bleAssembler.accept(0, part, millis());
+    if (result == FragmentResult::Complete) {
+        LOG_DEBUGF_COMPONENT("PatternManager", "Multi-part command complete: %d bytes", bleAssembler.length());
+        // Parsed once from the assembly buffer; the pooled document copies what it keeps.
+        // Always JSON: fragments carry text (see PacketAssembler.h).
+        HandleCommandMessage(bleAssembler.data(), bleAssembler.length(), CommandEncoding::Json);
+        bleAssembler.reset();
+    } else if (result != FragmentResult::Accepted && result != FragmentResult::Duplicate) {
+        LOG_WARNF_COMPONENT("PatternManager", "Command fragment %d rejected: %s",
+            part.sequence, PacketAssembler::resultName(result));
+    }
+    return true;
+}
+
+void HandleCommandMessage(const uint8_t* data, size_t length, CommandEncoding encoding) {
     if (!g_ledManager) {
         LOG_ERROR_COMPONENT("PatternManager", "LED manager not initialized");
 		return;
 	}
 
-    // Parse JSON - ArduinoJson needs 2.5-3x the string length for complex structures
-    // Use a minimum of 2KB to handle small commands, and cap at 32KB to avoid excessive memory usage
-    size_t jsonSize = jsonCommand.length();
-    size_t docSize = jsonSize * 3;  // 3x multiplier for safety with complex nested structures
-    if (docSize < 2048) {
-        docSize = 2048;  // Minimum 2KB for small commands
-    }
-    if (docSize > 32768) {
-        docSize = 32768;  // Cap at 32KB
-    }
-    
-    DynamicJsonDocument doc(docSize);
-    DeserializationError error = deserializeJson(doc, jsonCommand);
+    CommandTrace trace;
+    SR_TRACE_STAMP(trace, TraceHop::Received);
+
+    // Decode straight into a pooled document; the same document is what gets queued
+    DeserializationError error;
+    std::shared_ptr<DynamicJsonDocument> doc = g_commandDocPool.parse(data, length, encoding, error);
     
-    if (error) {
-        LOG_ERRORF_COMPONENT("PatternManager", "JSON parse failed: %s (Code: %d). String length: %d, Doc size: %d", 
-                            error.c_str(), error.code(), jsonSize, docSize);
+    if (!doc) {
+        LOG_ERRORF_COMPONENT("PatternManager", "%s parse failed: %s (Code: %d). Message length: %d, Doc size: %d", 
+                            CommandCodec::encodingName(encoding), error.c_str(), error.code(), length,
+                            CommandDocPool::docSizeFor(length, encoding));
+        return;
+    }
+
+    if (HandleCommandFragment(doc->as<JsonObject>())) {
         return;
     }
+    SR_TRACE_STAMP(trace, TraceHop::Parsed);
 
-    LOG_DEBUGF_COMPONENT("PatternManager", "Handling JSON command (string: %d bytes, doc: %d bytes)", jsonSize, docSize);
+    LOG_DEBUGF_COMPONENT("PatternManager", "Handling %s command (message: %d bytes, doc: %d bytes)",
+                         CommandCodec::encodingName(encoding), length, doc->capacity());
     // Use queued command if handler supports it (for thread-safe processing)
     // This prevents race conditions when commands come from WebSocket while LED update task is rendering
     if (g_ledManager->supportsQueuing()) {
-        // Create a shared_ptr to the document so it can be safely queued
-        // Use the same size as the parsed document to ensure copy succeeds
-        auto sharedDoc = std::make_shared<DynamicJsonDocument>(docSize);
-        *sharedDoc = doc;  // Copy the parsed document
-        g_ledManager->handleQueuedCommand(sharedDoc);
+        g_ledManager->handleQueuedCommand(std::move(doc), trace);
+    } else if (doc->is<JsonArray>()) {
+        g_ledManager->handleCommandBatch(doc->as<JsonArray>());
     } else {
         // Fall back to direct command handling for handlers that don't support queuing
-        g_ledManager->handleCommand(doc.as<JsonObject>());
+        g_ledManager->handleCommand(doc->as<JsonObject>());
     }
 }
 
@@ -254,35 +292,17 @@ void TriggerChoreography() {
         return;
     }
     
-    // Load choreography from file
-    String timelineJsonString = g_sdCardController->readFile("/data/music/test_timeline.json");
-    if (timelineJsonString.length() == 0) {
-        LOG_WARN_COMPONENT("PatternManager", "Timeline file not found or empty: /data/music/test_timeline.json");
-        return;
-    }
-    
-    // Calculate required JSON document size (similar to LoadEffectsFromStorage)
-    size_t fileSize = timelineJsonString.length();
-    size_t docSize = (fileSize * 3);
-    if (docSize < 2048) {
-        docSize = 2048;  // Minimum 2KB
-    }
-    if (docSize > 64000) {
-        docSize = 64000;  // Cap at 64KB
-    }
-    
-    LOG_DEBUGF_COMPONENT("PatternManager", "Loading timeline file: %d bytes, allocating JSON document: %d bytes", 
-                        fileSize, docSize);
-    
-    DynamicJsonDocument doc(docSize);
-    DeserializationError error = deserializeJson(doc, timelineJsonString);
-    
-    if (error) {
-        LOG_ERRORF_COMPONENT("PatternManager", "Failed to deserialize timeline JSON: %s (Code: %d)", 
-                            error.c_str(), error.code());
+    // Stream the show from SD rather than reading it into one document,
+    // so long shows aren't limited by the JSON document size
+    const char* timelinePath = "/data/music/test_timeline.json";
+    if (!g_sdCardController->exists(timelinePath)) {
+        LOG_WARNF_COMPONENT("PatternManager", "Timeline file not found: %s", timelinePath);
         return;
     }
     
+    StaticJsonDocument<256> doc;
+    doc["t"] = "choreography";
+    doc["file"] = timelinePath;
     JsonObject command = doc.as<JsonObject>();
     
     LOG_DEBUG_COMPONENT("PatternManager", "Triggering choreography from file");
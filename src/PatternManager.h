@@ -3,10 +3,12 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include "../lights/Light.h"
+#include "../lights/LEDGeometry.h"
 #include "Globals.h"
 #include "DeviceState.h"
 #include <ArduinoBLE.h>
 #include "../lights/WavePlayer.h"
+#include "hal/network/CommandCodec.h"
 
 // Forward declarations
 class LEDManager;
@@ -20,6 +22,8 @@ void Pattern_Loop();
 
 // JSON command interface
 void HandleJSONCommand(const String& jsonCommand);
+// Same, for a raw JSON or MessagePack message straight from a transport buffer
+void HandleCommandMessage(const uint8_t* data, size_t length, CommandEncoding encoding);
 
 // Effect list management
 void InitializeEffectList(const std::vector<String>& builtInEffects);
@@ -48,7 +52,4 @@ void UpdateColorFromCharacteristic(BLEStringCharacteristic& characteristic, CRGB
 void UpdateSeriesCoefficientsFromCharacteristic(BLEStringCharacteristic& characteristic, WavePlayer& wp);
 void ParseAndExecuteCommand(const String& command);
 
-// Global variables that other parts of the system expect
-extern Light LightArr[NUM_LEDS];
-extern Light BlendLightArr[NUM_LEDS];
-extern Light FinalLeds[NUM_LEDS];
\ No newline at end of file
+// LightArr and BlendLightArr are declared in lights/LEDGeometry.h and sized at boot
\ No newline at end of file
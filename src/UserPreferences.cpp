@@ -1,5 +1,6 @@
 #include "UserPreferences.h"
 #if SUPPORTS_PREFERENCES
+#include "freertos/LogManager.h"
 
 PreferencesManager::PreferencesManager() {}
 
@@ -7,13 +8,143 @@ void PreferencesManager::begin() {
     prefs.begin("userprefs", false); // namespace, read/write
 }
 
-void PreferencesManager::load(DeviceState& settings) {
-    Serial.println("Loading preferences...");
-    Serial.println("Available keys in preferences:");
-    // List all available keys (this is a debug feature)
-    prefs.begin("userprefs", false); // read/write mode
-    Serial.println("Preferences opened for reading");
-    
+// Blob field tags. Never reuse or renumber one; add new tags at the end
+enum StateTag : uint8_t {
+    TAG_BRIGHTNESS = 1,
+    TAG_PATTERN_INDEX = 2,
+    TAG_HIGH_COLOR = 3,
+    TAG_LOW_COLOR = 4,
+    TAG_SPEED_MULTIPLIER = 5,
+    TAG_USE_BACKGROUND_COLOR = 6,
+    TAG_BACKGROUND_COLOR = 7,
+    TAG_WIFI_SSID = 8,
+    TAG_WIFI_PASSWORD = 9,
+    TAG_EFFECT_TYPE = 10,
+    TAG_EFFECT_PARAMS = 11
+};
+
+static const char* STATE_KEY = "state";
+
+static void putColor(StateBlobWriter& writer, uint8_t tag, const Light& color) {
+    const uint8_t rgb[3] = {color.r, color.g, color.b};
+    writer.put(tag, rgb, sizeof(rgb));
+}
+
+static void putString(StateBlobWriter& writer, uint8_t tag, const String& value) {
+    writer.putString(tag, value.c_str(), value.length());
+}
+
+static void readColor(const uint8_t* data, uint16_t length, Light& out) {
+    if (length == 3) {
+        out = Light(data[0], data[1], data[2]);
+    }
+}
+
+static void readString(const uint8_t* data, uint16_t length, String& out) {
+    out = "";
+    out.concat((const char*) data, length);
+}
+
+size_t PreferencesManager::encode(const DeviceState& settings, std::vector<uint8_t>& out) {
+    // Counting pass, then the real one into a buffer of exactly that size
+    for (int pass = 0; pass < 2; pass++) {
+        StateBlobWriter writer(pass == 0 ? nullptr : out.data(), out.size());
+        writer.putI32(TAG_BRIGHTNESS, settings.brightness);
+        writer.putI32(TAG_PATTERN_INDEX, settings.patternIndex);
+        putColor(writer, TAG_HIGH_COLOR, settings.highColor);
+        putColor(writer, TAG_LOW_COLOR, settings.lowColor);
+        writer.putF32(TAG_SPEED_MULTIPLIER, settings.speedMultiplier);
+        writer.putU8(TAG_USE_BACKGROUND_COLOR, settings.useBackgroundColor ? 1 : 0);
+        putColor(writer, TAG_BACKGROUND_COLOR, settings.backgroundColor);
+        putString(writer, TAG_WIFI_SSID, settings.wifiSSID);
+        putString(writer, TAG_WIFI_PASSWORD, settings.wifiPassword);
+        putString(writer, TAG_EFFECT_TYPE, settings.currentEffectType);
+        putString(writer, TAG_EFFECT_PARAMS, settings.currentEffectParams);
+        const size_t size = writer.finish();
+        if (size == 0) {
+            return 0;
+        }
+        out.resize(size);
+    }
+    return out.size();
+}
+
+void PreferencesManager::apply(StateBlobReader& reader, DeviceState& settings) {
+    // Version 1 is the first blob format: nothing to migrate yet. A future
+    // version that changes a field's meaning converts it here by reader.version().
+    uint8_t tag;
+    const uint8_t* data;
+    uint16_t length;
+    int32_t i32;
+    float f32;
+    uint8_t u8;
+    while (reader.next(tag, data, length)) {
+        switch (tag) {
+            case TAG_BRIGHTNESS:
+                if (StateBlobReader::readI32(data, length, i32)) settings.brightness = i32;
+                break;
+            case TAG_PATTERN_INDEX:
+                if (StateBlobReader::readI32(data, length, i32)) settings.patternIndex = i32;
+                break;
+            case TAG_HIGH_COLOR: readColor(data, length, settings.highColor); break;
+            case TAG_LOW_COLOR: readColor(data, length, settings.lowColor); break;
+            case TAG_SPEED_MULTIPLIER:
+                if (StateBlobReader::readF32(data, length, f32)) settings.speedMultiplier = f32;
+                break;
+            case TAG_USE_BACKGROUND_COLOR:
+                if (StateBlobReader::readU8(data, length, u8)) settings.useBackgroundColor = u8 != 0;
+                break;
+            case TAG_BACKGROUND_COLOR: readColor(data, length, settings.backgroundColor); break;
+            case TAG_WIFI_SSID: readString(data, length, settings.wifiSSID); break;
+            case TAG_WIFI_PASSWORD: readString(data, length, settings.wifiPassword); break;
+            case TAG_EFFECT_TYPE: readString(data, length, settings.currentEffectType); break;
+            case TAG_EFFECT_PARAMS: readString(data, length, settings.currentEffectParams); break;
+            default: break;  // Written by newer firmware
+        }
+    }
+}
+
+bool PreferencesManager::load(DeviceState& settings) {
+    prefs.begin("userprefs", false); // read/write mode: a migration writes the blob
+
+    // One NVS read for the whole state
+    std::vector<uint8_t> blob(prefs.getBytesLength(STATE_KEY));
+    if (!blob.empty()) {
+        prefs.getBytes(STATE_KEY, blob.data(), blob.size());
+    }
+    StateBlobReader reader;
+    const StateBlobStatus status = reader.open(blob.data(), blob.size());
+    if (status == StateBlobStatus::Ok) {
+        if (reader.version() > StateBlob::VERSION) {
+            LOG_WARNF_COMPONENT("Preferences", "State blob version %d is newer than %d - reading known fields",
+                reader.version(), StateBlob::VERSION);
+        }
+        apply(reader, settings);
+        prefs.end();
+        _loadedFromBlob = true;
+        return true;
+    }
+
+    // First boot with this firmware, or a damaged blob: read the per-key
+    // layout once and store it as a blob so the next boot takes the fast path
+    if (status != StateBlobStatus::Empty) {
+        LOG_WARNF_COMPONENT("Preferences", "State blob unusable (%s) - falling back to legacy keys",
+            StateBlob::statusName(status));
+    }
+    loadLegacy(settings);
+    std::vector<uint8_t> migrated;
+    if (encode(settings, migrated) > 0 && prefs.putBytes(STATE_KEY, migrated.data(), migrated.size()) == migrated.size()) {
+        LOG_INFOF_COMPONENT("Preferences", "Migrated legacy preferences to a %d byte state blob", migrated.size());
+    } else {
+        LOG_ERROR_COMPONENT("Preferences", "Failed to write state blob");
+    }
+    prefs.end();
+    _loadedFromBlob = false;
+    return false;
+}
+
+void PreferencesManager::loadLegacy(DeviceState& settings) {
+    // Pre-blob layout: one key per field
     if (prefs.isKey("brightness")) {
         settings.brightness = prefs.getInt("brightness", settings.brightness);
     }
@@ -59,69 +190,39 @@ void PreferencesManager::load(DeviceState& settings) {
     if (prefs.isKey("wifiPassword")) {
         settings.wifiPassword = prefs.getString("wifiPassword", settings.wifiPassword);
     }
-    Serial.println("Checking for effect_type key...");
     if (prefs.isKey("effect_type")) {
         settings.currentEffectType = prefs.getString("effect_type", settings.currentEffectType);
-        Serial.println("Loaded currentEffectType: " + settings.currentEffectType);
-    } else {
-        Serial.println("effect_type key not found in preferences");
     }
-    Serial.println("Checking for effect_params key...");
     if (prefs.isKey("effect_params")) {
         settings.currentEffectParams = prefs.getString("effect_params", settings.currentEffectParams);
-        Serial.println("Loaded currentEffectParams: " + settings.currentEffectParams);
-    } else {
-        Serial.println("effect_params key not found in preferences");
     }
-    prefs.end();
 }
 
 void PreferencesManager::save(const DeviceState& settings) {
-    // Serial.println("Saving user preferences");
-    // Serial.println("brightness: " + String(settings.brightness));
-    prefs.begin("userprefs", false);
-    prefs.putInt("brightness", settings.brightness);
-    // Serial.println("patternIndex: " + String(settings.patternIndex));
-    prefs.putInt("patternIdx", settings.patternIndex);
-    prefs.putInt("hiR", settings.highColor.r);
-    prefs.putInt("hiG", settings.highColor.g);
-    prefs.putInt("hiB", settings.highColor.b);
-    prefs.putInt("loR", settings.lowColor.r);
-    prefs.putInt("loG", settings.lowColor.g);
-    prefs.putInt("loB", settings.lowColor.b);
-    prefs.putFloat("speedMultiplier", settings.speedMultiplier);
-    prefs.putBool("useBackgroundColor", settings.useBackgroundColor);
-    prefs.putInt("bgR", settings.backgroundColor.r);
-    prefs.putInt("bgG", settings.backgroundColor.g);
-    prefs.putInt("bgB", settings.backgroundColor.b);
-    prefs.putString("wifiSSID", settings.wifiSSID);
-    prefs.putString("wifiPassword", settings.wifiPassword);
-    // Serial.println("currentEffectType: " + settings.currentEffectType);
-    // Serial.println("currentEffectParams: " + settings.currentEffectParams);
-    // Serial.println("Saving currentEffectType to preferences..." + settings.currentEffectType);
-    prefs.putString("effect_type", settings.currentEffectType);
-    // Serial.println("Saving currentEffectParams to preferences..." + settings.currentEffectParams);
-    prefs.putString("effect_params", settings.currentEffectParams);
-    // Serial.println("Preferences save completed");
-    // Add a small delay to ensure preferences are committed to flash
-    // delay(100);
-    prefs.end();
-
-
+    saveChanged(settings, nullptr);
+}
 
+size_t PreferencesManager::saveChanged(const DeviceState& settings, const DeviceState* previous) {
+    std::vector<uint8_t> blob;
+    if (encode(settings, blob) == 0) {
+        LOG_ERROR_COMPONENT("Preferences", "State too large for a state blob - not saved");
+        return 0;
+    }
+    if (previous) {
+        std::vector<uint8_t> saved;
+        if (encode(*previous, saved) == blob.size() && saved == blob) {
+            return 0;  // Nothing persisted changed (e.g. only panel configs)
+        }
+    }
+    // One NVS write for the whole state
     prefs.begin("userprefs", false);
-    // Check if the preferences are saved
-    // Serial.println("Checking if the preferences are saved...");
-    // Serial.println("effect_type: " + prefs.getString("effect_type"));
-    // Serial.println("effect_params: " + prefs.getString("effect_params"));
-    // Serial.println("wifiSSID: " + prefs.getString("wifiSSID"));
-    // Serial.println("wifiPassword: " + prefs.getString("wifiPassword"));
-    // Serial.println("brightness: " + String(prefs.getInt("brightness")));
-    // Serial.println("patternIndex: " + String(prefs.getInt("patternIdx")));
-    // Serial.println("hiR: " + String(prefs.getInt("hiR")));
-    // Serial.println("hiG: " + String(prefs.getInt("hiG")));
-    // Serial.println("hiB: " + String(prefs.getInt("hiB")));
+    const size_t written = prefs.putBytes(STATE_KEY, blob.data(), blob.size());
     prefs.end();
+    if (written != blob.size()) {
+        LOG_ERRORF_COMPONENT("Preferences", "State blob write failed (%d of %d bytes)", written, blob.size());
+        return 0;
+    }
+    return written;
 }
 
 void PreferencesManager::end() {
@@ -6,17 +6,46 @@
 
 
 #include <Preferences.h>
+#include <vector>
 #include "DeviceState.h"
+#include "utility/StateBlob.h"
 
+/**
+ * DeviceState is stored as one StateBlob under the "state" key, read and
+ * written with a single NVS call. Devices still on the old one-key-per-field
+ * layout are migrated on their first boot with this firmware; the old keys
+ * are left in place for a firmware rollback.
+ */
 class PreferencesManager {
 public:
     PreferencesManager();
     void begin();
-    void load(DeviceState& settings);
+    /**
+     * Returns true when the state came from the blob, false when it came
+     * from the legacy keys (and was migrated) or defaults.
+     */
+    bool load(DeviceState& settings);
     void save(const DeviceState& settings);
+    /**
+     * Write the state blob unless nothing in it differs from previous
+     * (always written when null). Returns the bytes written, 0 if skipped.
+     */
+    size_t saveChanged(const DeviceState& settings, const DeviceState* previous);
     void end();
+
+    bool loadedFromBlob() const { return _loadedFromBlob; }
+
+    /**
+     * Serialize the persisted fields of settings into out. Returns the
+     * blob size, 0 if a field is too large.
+     */
+    static size_t encode(const DeviceState& settings, std::vector<uint8_t>& out);
 private:
+    static void apply(StateBlobReader& reader, DeviceState& settings);
+    void loadLegacy(DeviceState& settings);
+
     Preferences prefs;
+    bool _loadedFromBlob = false;
 };
 
 #endif
@@ -1,6 +1,7 @@
 #include "controllers/BrightnessController.h"
 #include "hal/ble/BLEManager.h"
 #include "freertos/LogManager.h"
+#include "lights/ShowClock.h"
 #include "Utils.hpp"
 #include <FastLED.h>
 
@@ -119,7 +120,7 @@ void BrightnessController::startPulse(int target, unsigned long duration) {
     targetBrightness = constrain(target, 0, 255);
     pulseStartBrightness = currentBrightness;  // Save starting point for interpolation
     pulseDuration = duration;
-    pulseStartTime = millis();
+    pulseStartTime = ShowClock::nowMs();
     isPulsing = true;
     isFadeMode = false;
 }
@@ -128,7 +129,7 @@ void BrightnessController::startFade(int target, unsigned long duration) {
     targetBrightness = constrain(target, 0, 255);
     pulseStartBrightness = currentBrightness;  // Save starting point for interpolation
     pulseDuration = duration;
-    pulseStartTime = millis();
+    pulseStartTime = ShowClock::nowMs();
     isPulsing = true;
     isFadeMode = true;
 }
@@ -153,7 +154,7 @@ void BrightnessController::startPulseCycle(int baseBrightness, int peakBrightnes
     setBrightness(baseBrightness);
     
     // Start the cycle - update() will handle the full cycle with a single sine wave
-    pulseStartTime = millis();
+    pulseStartTime = ShowClock::nowMs();
     pulseStartBrightness = baseBrightness;  // Start from base for consistent pulses
     targetBrightness = peakBrightness;  // Peak value (we'll animate base -> peak -> base)
     isPulsing = true;
@@ -179,7 +180,7 @@ void BrightnessController::update() {
         return;
     }
     
-    unsigned long currentTime = millis();
+    unsigned long currentTime = ShowClock::nowMs();
     unsigned long elapsed = currentTime - pulseStartTime;
     
     if (elapsed >= pulseDuration) {
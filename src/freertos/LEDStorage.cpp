@@ -2,9 +2,11 @@
 
 #if SUPPORTS_LEDS
 #include "Globals.h"
+#include "lights/LEDGeometry.h"
+#include "freertos/LogManager.h"
 
 // FastLED array - this is what gets sent to hardware
-CRGB leds[NUM_LEDS];
+CRGB* leds = nullptr;
 
 #if FASTLED_EXPERIMENTAL_ESP32_RGBW_ENABLED
 // RGBW support
@@ -18,16 +20,22 @@ typedef WS2812<LED_PIN, RGB> ControllerT;  // RGB mode must be RGB, no re-orderi
 static RGBWEmulatedController<ControllerT, GRB> rgbwEmu(rgbw);  // ordering goes here
 #endif
 
-bool initializeFastLED() {
-    // Black out LEDs first
-    for (int i = 0; i < NUM_LEDS; i++) {
-        leds[i] = CRGB::Black;
+bool initializeFastLED(int numLEDs) {
+    if (leds) {
+        return true;  // Already initialized
+    }
+
+    // AllocateLightBuffer() zeroes the buffer, so LEDs start blacked out
+    leds = AllocateLightBuffer(numLEDs);
+    if (!leds) {
+        LOG_ERRORF_COMPONENT("LEDStorage", "Failed to allocate FastLED array for %d LEDs", numLEDs);
+        return false;
     }
     
 #if FASTLED_EXPERIMENTAL_ESP32_RGBW_ENABLED
-    FastLED.addLeds(&rgbwEmu, leds, NUM_LEDS);
+    FastLED.addLeds(&rgbwEmu, leds, numLEDs);
 #else
-    FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS)
+    FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, numLEDs)
            .setCorrection(TypicalLEDStrip);
 #endif
     
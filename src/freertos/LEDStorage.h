@@ -21,7 +21,8 @@ template<typename T1, typename T2> class RGBWEmulatedController;
  */
 
 // FastLED array - this is what gets sent to hardware
-extern CRGB leds[NUM_LEDS];
+// Sized to g_ledGeometry.numLEDs by initializeFastLED()
+extern CRGB* leds;
 
 #if FASTLED_EXPERIMENTAL_ESP32_RGBW_ENABLED
 // RGBW support (forward declarations only in header)
@@ -31,10 +32,12 @@ extern Rgbw rgbw;
 
 /**
  * Initialize FastLED hardware
- * This sets up the LED strip and blacks out all LEDs
+ * This allocates the hardware array for numLEDs, sets up the LED strip and
+ * blacks out all LEDs. FastLED controllers can only be added once, so this
+ * must be called once at boot after the LED count is known.
  * Returns true if initialization successful, false otherwise
  */
-bool initializeFastLED();
+bool initializeFastLED(int numLEDs);
 
 #endif // SUPPORTS_LEDS
 
@@ -37,12 +37,9 @@ void LEDUpdateTask::run()
         uint32_t patternStart = micros();
         FastLED.clear();
 
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            LightArr[i] = Light(0, 0, 0);
-            BlendLightArr[i] = Light(0, 0, 0);
-            // FinalLeds[i] = Light(0, 0, 0);
-        }
+        const int bufferSize = g_ledGeometry.bufferSize;
+        memset(LightArr, 0, sizeof(Light) * bufferSize);
+        memset(BlendLightArr, 0, sizeof(Light) * bufferSize);
 
         const auto now = micros();
         const auto dt = now - lastUpdateTime;
@@ -65,11 +62,7 @@ void LEDUpdateTask::run()
         // Pattern_Loop();
 
         // Copy LED data from LightArr to FastLED array
-        extern Light LightArr[];
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            leds[i] = LightArr[i];
-        }
+        memcpy(leds, LightArr, sizeof(CRGB) * g_ledGeometry.numLEDs);
 
         uint32_t patternEnd = micros();
         uint32_t patternTime = patternEnd - patternStart;
@@ -88,6 +81,35 @@ void LEDUpdateTask::run()
         }
         
         FastLED.show();
+        if (g_ledManager)
+        {
+            g_ledManager->onFrameShown();
+        }
+
+        // Frame-time spikes (flash writes, effect builds) show up here rather than in the FPS
+        _frameCount++;
+        if (_frameCount == 1)
+        {
+            LOG_INFOF_COMPONENT("LEDUpdate", "First frame shown %lu ms after boot", millis());
+        }
+        const uint32_t frameTime = micros() - patternStart;
+        if (frameTime > _maxPatternTime)
+        {
+            _maxPatternTime = frameTime;
+        }
+        if (frameTime > _updateIntervalMs * 1000)
+        {
+            _framesOverBudget++;
+        }
+        if (millis() - _lastFpsLog >= FRAME_STATS_INTERVAL_MS)
+        {
+            LOG_DEBUGF_COMPONENT("LEDUpdate", "Frame time max %lu us, %lu frame(s) over %lu ms in the last %lu ms",
+                _maxPatternTime, _framesOverBudget, _updateIntervalMs, millis() - _lastFpsLog);
+            _lastMaxFrameTime = _maxPatternTime;
+            _maxPatternTime = 0;
+            _framesOverBudget = 0;
+            _lastFpsLog = millis();
+        }
 
         // Sleep until next frame
         SRTask::sleepUntil(&lastWakeTime, _updateIntervalMs);
@@ -8,15 +8,10 @@
 
 #if SUPPORTS_LEDS
 #include <FastLED.h>
-#include "Globals.h"  // For NUM_LEDS
+#include "Globals.h"
 #include "LEDStorage.h"  // For leds array
 #endif
 
-// Forward declarations
-#if SUPPORTS_LEDS
-extern CRGB leds[];
-#endif
-
 /**
  * LEDUpdateTask - FreeRTOS task for LED pattern updates and rendering
  * 
@@ -42,6 +37,11 @@ public:
      * Get current frame count
      */
     uint32_t getFrameCount() const { return _frameCount; }
+
+    /**
+     * Longest frame (work plus show) in the last complete stats interval, in us
+     */
+    uint32_t getMaxFrameTimeUs() const { return _lastMaxFrameTime; }
     
     /**
      * Get update interval
@@ -68,9 +68,9 @@ public:
      * This sets up the LED strip and blacks out all LEDs
      * Returns true if initialization successful, false otherwise
      */
-    static bool initializeLEDs() {
+    static bool initializeLEDs(int numLEDs) {
 #if SUPPORTS_LEDS
-        return initializeFastLED();
+        return initializeFastLED(numLEDs);
 #else
         return false;  // LEDs not supported
 #endif
@@ -87,7 +87,10 @@ private:
     uint32_t _frameCount;
     uint32_t _lastFpsLog;
     uint32_t _maxPatternTime;
-    int _numConfiguredLEDs = NUM_LEDS;
+    uint32_t _lastMaxFrameTime = 0;
+    uint32_t _framesOverBudget = 0;
+    static const uint32_t FRAME_STATS_INTERVAL_MS = 5000;
+    int _numConfiguredLEDs = g_ledGeometry.numLEDs;
     
     // Functions are now included from PatternManager.h
     // void UpdatePattern(Button::Event buttonEvent);
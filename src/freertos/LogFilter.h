@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Log levels
+ */
+enum class LogLevel {
+    DEBUG = 0,
+    INFO = 1,
+    WARN = 2,
+    ERROR = 3
+};
+
+/**
+ * Compile-time log floor
+ *
+ * Calls below the floor are compiled out: the LOG_* macros test it with
+ * if constexpr, so the call, its arguments and its format string never
+ * reach the binary. 0 DEBUG, 1 INFO, 2 WARN, 3 ERROR. Builds with NDEBUG
+ * get INFO, others DEBUG; set it per environment in platformio.ini, e.g.
+ *
+ *   build_flags = -D SR_LOG_MIN_LEVEL=1
+ *
+ * SR_LOG_COMPONENT_LEVELS overrides the floor for single components, as
+ * {name, level} pairs:
+ *
+ *   -D 'SR_LOG_COMPONENT_LEVELS={"LEDManager",2},{"WiFiManager",0}'
+ */
+#ifndef SR_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define SR_LOG_MIN_LEVEL 1
+#else
+#define SR_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#ifndef SR_LOG_COMPONENT_LEVELS
+#define SR_LOG_COMPONENT_LEVELS
+#endif
+
+struct LogComponentLevel {
+    const char* component;
+    int level;
+};
+
+namespace LogLevels {
+
+// First entry only keeps the array non-empty when there are no overrides
+constexpr LogComponentLevel COMPONENT_LEVELS[] = { { nullptr, 0 }, SR_LOG_COMPONENT_LEVELS };
+
+constexpr bool sameName(const char* a, const char* b) {
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+constexpr int floorFor(const char* component) {
+    for (const LogComponentLevel& entry : COMPONENT_LEVELS) {
+        if (entry.component && sameName(entry.component, component)) {
+            return entry.level;
+        }
+    }
+    return SR_LOG_MIN_LEVEL;
+}
+
+constexpr const char* name(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO:  return "INFO";
+        case LogLevel::WARN:  return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * Whether a call at this level from this component is built at all.
+ * The component must be a string literal ("" for calls without one).
+ */
+constexpr bool compiledIn(LogLevel level, const char* component) {
+    return static_cast<int>(level) >= floorFor(component);
+}
+
+}  // namespace LogLevels
+
+/**
+ * LogComponents - Component names interned to small ids
+ *
+ * Each LOG_*_COMPONENT call site interns its name once, into a static, so
+ * filtering a message is a bit test instead of string compares. Id 0 is
+ * the empty name (legacy calls without a component). Names are cut to 31
+ * characters, as in LogMessage. Past MAX_COMPONENTS names, the rest share
+ * the last id and are filtered together.
+ *
+ * Lookups are lock-free; only adding a name takes the mutex.
+ */
+class LogComponents {
+public:
+    static constexpr size_t MAX_COMPONENTS = 64;
+    static constexpr size_t NAME_LENGTH = 32;
+    static constexpr uint8_t NONE = 0;
+
+    static uint8_t intern(const char* name) {
+        if (!name || name[0] == '\0') {
+            return NONE;
+        }
+        Table& table = getTable();
+        int id = find(table, name, table.count.load(std::memory_order_acquire));
+        if (id >= 0) {
+            return static_cast<uint8_t>(id);
+        }
+        std::lock_guard<std::mutex> lock(table.mutex);
+        const size_t count = table.count.load(std::memory_order_relaxed);
+        id = find(table, name, count);  // Another task may have added it meanwhile
+        if (id >= 0) {
+            return static_cast<uint8_t>(id);
+        }
+        if (count == MAX_COMPONENTS) {
+            return MAX_COMPONENTS - 1;
+        }
+        // Longer names are cut to NAME_LENGTH - 1 characters
+        char* stored = table.names[count];
+        size_t length = 0;
+        for (; length < NAME_LENGTH - 1 && name[length] != '\0'; length++) {
+            stored[length] = name[length];
+        }
+        stored[length] = '\0';
+        table.count.store(count + 1, std::memory_order_release);
+        return static_cast<uint8_t>(count);
+    }
+
+    /**
+     * intern() for callers that cannot keep a static per call site
+     * (LogManager's debugComponent() and friends). A small direct-mapped
+     * cache on the name pointer remembers the last id; a hit is checked
+     * against the interned name, so a reused buffer or a torn entry only
+     * costs a miss.
+     */
+    static uint8_t internCached(const char* name) {
+        if (!name || name[0] == '\0') {
+            return NONE;
+        }
+        CacheEntry& entry = getCache()[(reinterpret_cast<uintptr_t>(name) >> 2) & (CACHE_SIZE - 1)];
+        if (entry.name.load(std::memory_order_acquire) == name) {
+            const uint8_t id = entry.id.load(std::memory_order_relaxed);
+            if (strncmp(LogComponents::name(id), name, NAME_LENGTH - 1) == 0) {
+                return id;
+            }
+        }
+        const uint8_t id = intern(name);
+        entry.id.store(id, std::memory_order_relaxed);
+        entry.name.store(name, std::memory_order_release);
+        return id;
+    }
+
+    static const char* name(uint8_t id) {
+        Table& table = getTable();
+        return id < table.count.load(std::memory_order_acquire) ? table.names[id] : "";
+    }
+
+    static size_t count() { return getTable().count.load(std::memory_order_acquire); }
+
+private:
+    struct Table {
+        char names[MAX_COMPONENTS][NAME_LENGTH] = {};  // names[0] stays ""
+        std::atomic<size_t> count{1};
+        std::mutex mutex;
+    };
+
+    static Table& getTable() {
+        static Table table;
+        return table;
+    }
+
+    static constexpr size_t CACHE_SIZE = 16;
+    struct CacheEntry {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint8_t> id{NONE};
+    };
+
+    static CacheEntry* getCache() {
+        static CacheEntry cache[CACHE_SIZE];
+        return cache;
+    }
+
+    static int find(const Table& table, const char* name, size_t count) {
+        for (size_t i = 1; i < count; i++) {
+            if (strncmp(table.names[i], name, NAME_LENGTH - 1) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+};
+
+/**
+ * LogFilter - Runtime level and component filters as bitmasks
+ *
+ * allows() is what every log call checks before formatting anything: one
+ * bit for the level, one for the component id. Any task may change the
+ * filters while others log.
+ */
+class LogFilter {
+public:
+    static constexpr uint8_t ALL_LEVELS = 0x0F;
+
+    bool allows(LogLevel level, uint8_t componentId) const {
+        if ((_levels.load(std::memory_order_relaxed) & levelBit(level)) == 0) {
+            return false;
+        }
+        if (!_componentFiltering.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        return (_components[componentId >> 5].load(std::memory_order_relaxed) & (1u << (componentId & 31))) != 0;
+    }
+
+    // Components: once filtering is on, only the allowed ids pass
+    void setComponentFiltering(bool enabled) { _componentFiltering.store(enabled, std::memory_order_relaxed); }
+    bool isComponentFiltering() const { return _componentFiltering.load(std::memory_order_relaxed); }
+    void allowComponent(uint8_t id) { _components[id >> 5].fetch_or(1u << (id & 31), std::memory_order_relaxed); }
+    void disallowComponent(uint8_t id) { _components[id >> 5].fetch_and(~(1u << (id & 31)), std::memory_order_relaxed); }
+    void clearComponents() {
+        for (std::atomic<uint32_t>& word : _components) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Levels: ALL_LEVELS when not filtering
+    void setLevels(uint8_t mask) { _levels.store(mask, std::memory_order_relaxed); }
+    uint8_t getLevels() const { return _levels.load(std::memory_order_relaxed); }
+
+    static uint8_t levelBit(LogLevel level) { return static_cast<uint8_t>(1u << static_cast<int>(level)); }
+
+private:
+    std::atomic<uint32_t> _components[LogComponents::MAX_COMPONENTS / 32] = {};
+    std::atomic<bool> _componentFiltering{false};
+    std::atomic<uint8_t> _levels{ALL_LEVELS};
+};
@@ -1,18 +1,30 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include "SRQueue.h"
+#include "LogFilter.h"
 #include "LogMessage.h"
+#include "LogQueue.h"
 #include "PlatformConfig.h"
 #if SUPPORTS_SD_CARD
 #include "hal/SDCardController.h"
 #endif
 
+// Messages on their way to LogWriterTask (about 11 KB)
+typedef LogQueue<LogMessage, 64> AsyncLogQueue;
+
 /**
  * LogManager - Global logging interface
  * 
  * Provides a singleton interface for logging throughout the application.
- * Writes directly to SD card using platform abstraction.
+ * Writes to SD card using platform abstraction: through LogWriterTask's
+ * queue once that task runs, directly before then.
+ *
+ * Filters are checked before a message is formatted: the level and the
+ * component's interned id are bits in LogFilter. The LOG_* macros also
+ * drop calls below the compile-time floor (SR_LOG_MIN_LEVEL, LogFilter.h)
+ * from the build.
  */
 class LogManager {
 public:
@@ -35,6 +47,17 @@ public:
         _initialized = true;
     }
     
+    /**
+     * Hand SD card lines to the writer task's queue (nullptr: write them here
+     * again). Returns once no log call is still pushing to the previous queue.
+     */
+    void setAsyncQueue(AsyncLogQueue* queue) {
+        _asyncQueue.store(queue);
+        while (_asyncPushes.load() != 0) {
+            vTaskDelay(1);
+        }
+    }
+    
     /**
      * Archive the current log file with timestamp
      */
@@ -159,104 +182,96 @@ public:
      * Log a message at DEBUG level
      */
     void debug(const char* message) {
-        log(LogMessage::debug(message));
+        logMessage(LogLevel::DEBUG, "", message);
     }
     
     /**
      * Log a message at INFO level
      */
     void info(const char* message) {
-        log(LogMessage::info(message));
+        logMessage(LogLevel::INFO, "", message);
     }
     
     /**
      * Log a message at WARN level
      */
     void warn(const char* message) {
-        log(LogMessage::warn(message));
+        logMessage(LogLevel::WARN, "", message);
     }
     
     /**
      * Log a message at ERROR level
      */
     void error(const char* message) {
-        log(LogMessage::error(message));
+        logMessage(LogLevel::ERROR, "", message);
     }
     
     /**
      * Log a message at DEBUG level (String version)
      */
     void debug(const String& message) {
-        log(LogMessage::debug(message));
+        logMessage(LogLevel::DEBUG, "", message.c_str());
     }
     
     /**
      * Log a message at INFO level (String version)
      */
     void info(const String& message) {
-        log(LogMessage::info(message));
+        logMessage(LogLevel::INFO, "", message.c_str());
     }
     
     /**
      * Log a message at WARN level (String version)
      */
     void warn(const String& message) {
-        log(LogMessage::warn(message));
+        logMessage(LogLevel::WARN, "", message.c_str());
     }
     
     /**
      * Log a message at ERROR level (String version)
      */
     void error(const String& message) {
-        log(LogMessage::error(message));
+        logMessage(LogLevel::ERROR, "", message.c_str());
     }
     
     /**
      * Log a formatted message at INFO level
      */
     void printf(const char* format, ...) {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::INFO, "", format, args);
         va_end(args);
-        log(LogMessage::info(buffer));
     }
     
     /**
      * Log a formatted message at DEBUG level
      */
     void debugf(const char* format, ...) {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::DEBUG, "", format, args);
         va_end(args);
-        log(LogMessage::debug(buffer));
     }
     
     /**
      * Log a formatted message at WARN level
      */
     void warnf(const char* format, ...) {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::WARN, "", format, args);
         va_end(args);
-        log(LogMessage::warn(buffer));
     }
     
     /**
      * Log a formatted message at ERROR level
      */
     void errorf(const char* format, ...) {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::ERROR, "", format, args);
         va_end(args);
-        log(LogMessage::error(buffer));
     }
     
     /**
@@ -270,74 +285,95 @@ public:
      * NEW: Component-aware logging methods
      */
     void debugComponent(const char* component, const char* message) {
-        log(LogMessage::debug(component, message));
+        logMessage(LogLevel::DEBUG, component, message);
     }
     
     void infoComponent(const char* component, const char* message) {
-        log(LogMessage::info(component, message));
+        logMessage(LogLevel::INFO, component, message);
     }
     
     void warnComponent(const char* component, const char* message) {
-        log(LogMessage::warn(component, message));
+        logMessage(LogLevel::WARN, component, message);
     }
     
     void errorComponent(const char* component, const char* message) {
-        log(LogMessage::error(component, message));
+        logMessage(LogLevel::ERROR, component, message);
     }
     
     void debugComponent(const char* component, const String& message) {
-        log(LogMessage::debug(component, message));
+        logMessage(LogLevel::DEBUG, component, message.c_str());
     }
     void debugComponentPrintf(const char *component, const char *format, ...)
     {
-        char buffer[256];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::DEBUG, component, format, args);
         va_end(args);
-        log(LogMessage::debug(component, buffer));
     }
     
     void infoComponent(const char* component, const String& message) {
-        log(LogMessage::info(component, message));
+        logMessage(LogLevel::INFO, component, message.c_str());
     }
 
     void infoComponentPrintf(const char *component, const char *format, ...)
     {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::INFO, component, format, args);
         va_end(args);
-        log(LogMessage::info(component, buffer));
     }
     
     void warnComponent(const char* component, const String& message) {
-        log(LogMessage::warn(component, message));
+        logMessage(LogLevel::WARN, component, message.c_str());
     }
 
     void warnComponentPrintf(const char *component, const char *format, ...)
     {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::WARN, component, format, args);
         va_end(args);
-        log(LogMessage::warn(component, buffer));
     }
     
     void errorComponent(const char* component, const String& message) {
-        log(LogMessage::error(component, message));
+        logMessage(LogLevel::ERROR, component, message.c_str());
     }
 
     void errorComponentPrintf(const char *component, const char *format, ...)
     {
-        char buffer[128];
         va_list args;
         va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
+        logMessagef(LogLevel::ERROR, component, format, args);
+        va_end(args);
+    }
+    
+    /**
+     * Whether a message at this level from this component id would be
+     * logged; the LOG_* macros check this before formatting anything
+     */
+    bool enabled(LogLevel level, uint8_t componentId) const {
+        if (!_filter.allows(level, componentId)) {
+            return false;
+        }
+        return !_timestampFilteringEnabled || millis() >= _minTimestamp;
+    }
+    
+    /**
+     * Log without checking the filters again (for the LOG_* macros, after enabled())
+     */
+    void writeComponent(LogLevel level, const char* component, const char* message) {
+        write(LogMessage(level, component, message));
+    }
+    
+    void writeComponent(LogLevel level, const char* component, const String& message) {
+        write(LogMessage(level, component, message));
+    }
+    
+    void writeComponentPrintf(LogLevel level, const char* component, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        writeFormatted(level, component, format, args);
         va_end(args);
-        log(LogMessage::error(component, buffer));
     }
     
     /**
@@ -345,17 +381,23 @@ public:
      */
     void setComponentFilter(const std::vector<String>& components) {
         _allowedComponents = components;
-        _componentFilteringEnabled = !components.empty();
+        _filter.clearComponents();
+        for (const String& component : components) {
+            _filter.allowComponent(LogComponents::intern(component.c_str()));
+        }
+        _filter.setComponentFiltering(!components.empty());
     }
     
     void enableAllComponents() {
-        _componentFilteringEnabled = false;
+        _filter.setComponentFiltering(false);
+        _filter.clearComponents();
         _allowedComponents.clear();
     }
     
     void addComponent(const String& component) {
         _allowedComponents.push_back(component);
-        _componentFilteringEnabled = true;
+        _filter.allowComponent(LogComponents::intern(component.c_str()));
+        _filter.setComponentFiltering(true);
     }
     
     void removeComponent(const String& component) {
@@ -365,8 +407,15 @@ public:
                 break;
             }
         }
+        bool stillAllowed = false;  // Added more than once
+        for (const String& allowed : _allowedComponents) {
+            stillAllowed = stillAllowed || allowed == component;
+        }
+        if (!stillAllowed) {
+            _filter.disallowComponent(LogComponents::intern(component.c_str()));
+        }
         if (_allowedComponents.empty()) {
-            _componentFilteringEnabled = false;
+            _filter.setComponentFiltering(false);
         }
     }
     
@@ -392,7 +441,7 @@ public:
      * NEW: Get current filtering status
      */
     bool isComponentFilteringEnabled() const {
-        return _componentFilteringEnabled;
+        return _filter.isComponentFiltering();
     }
     
     bool isTimestampFilteringEnabled() const {
@@ -414,16 +463,19 @@ public:
     void setLevelFilter(const std::vector<String>& levels) {
         _allowedLevels = levels;
         _levelFilteringEnabled = !levels.empty();
+        updateLevelMask();
     }
 
     void enableAllLevels() {
         _levelFilteringEnabled = false;
         _allowedLevels.clear();
+        updateLevelMask();
     }
     
     void addLevel(const String& level) {
         _allowedLevels.push_back(level);
         _levelFilteringEnabled = true;
+        updateLevelMask();
     }
 
     void removeLevel(const String& level) {
@@ -436,6 +488,7 @@ public:
         if (_allowedLevels.empty()) {
             _levelFilteringEnabled = false;
         }
+        updateLevelMask();
     }
     
     std::vector<String> getAllowedLevels() const {
@@ -444,67 +497,58 @@ public:
     
 private:
     LogManager() : _initialized(false), 
-                   _componentFilteringEnabled(false),
                    _timestampFilteringEnabled(false),
+                   _levelFilteringEnabled(false),
                    _minTimestamp(0) {}
     
-    /**
-     * NEW: Check if message should be logged based on filters
-     */
-    bool shouldLog(const LogMessage& msg) {
-        // Check component filter
-        if (_componentFilteringEnabled) {
-            bool componentAllowed = false;
-            for (const String& allowed : _allowedComponents) {
-                if (strcmp(msg.component, allowed.c_str()) == 0) {
-                    componentAllowed = true;
-                    break;
-                }
-            }
-            if (!componentAllowed) {
-                return false;
-            }
+    void logMessage(LogLevel level, const char* component, const char* message) {
+        if (!enabled(level, LogComponents::internCached(component))) {
+            return;
         }
-
-        if (_levelFilteringEnabled) {
-            bool levelAllowed = false;
-            for (const String& allowed : _allowedLevels) {
-                if (strcmp(msg.getLevelString(), allowed.c_str()) == 0) {
-                    levelAllowed = true;
-                    break;
+        write(LogMessage(level, component, message));
+    }
+    
+    void logMessagef(LogLevel level, const char* component, const char* format, va_list args) {
+        if (!enabled(level, LogComponents::internCached(component))) {
+            return;  // Filtered: not formatted
+        }
+        writeFormatted(level, component, format, args);
+    }
+    
+    void writeFormatted(LogLevel level, const char* component, const char* format, va_list args) {
+        LogMessage msg(level, component, "");
+        vsnprintf(msg.message, sizeof(msg.message), format, args);
+        write(msg);
+    }
+    
+    void updateLevelMask() {
+        uint8_t mask = _levelFilteringEnabled ? 0 : LogFilter::ALL_LEVELS;
+        for (const String& allowed : _allowedLevels) {
+            for (LogLevel level : { LogLevel::DEBUG, LogLevel::INFO, LogLevel::WARN, LogLevel::ERROR }) {
+                if (allowed == LogLevels::name(level)) {
+                    mask |= LogFilter::levelBit(level);
                 }
             }
-            if (!levelAllowed) {
-                return false;
-            }
         }
-        
-        // Check timestamp filter
-        if (_timestampFilteringEnabled && msg.timestamp < _minTimestamp) {
-            return false;
-        }
-        
-        return true;
+        _filter.setLevels(mask);
     }
     
-    void log(const LogMessage& msg) {
-        // NEW: Check if this message should be logged
-        if (!shouldLog(msg)) {
-            return; // Skip logging if filtered out
-        }
-        
+    /**
+     * Output a message that passed the filters
+     */
+    void write(const LogMessage& msg) {
         // Always output to Serial for immediate debugging
-        if (strlen(msg.component) > 0) {
+        if (msg.component[0] != '\0') {
             // Component-aware logging
-            Serial.printf("[%s] [%-5s]: {%s} %s\n", 
-                String(msg.timestamp).c_str(),
-                        msg.getLevelString(), 
+            Serial.printf("[%lu] [%-5s]: {%s} %s\n", 
+                         (unsigned long) msg.timestamp,
+                         msg.getLevelString(), 
                          msg.component,
                          msg.message);
         } else {
             // Legacy logging (no component)
-                Serial.printf("[%s] [%-5s]: %s\n", 
-                         String(msg.timestamp).c_str(),
+            Serial.printf("[%lu] [%-5s]: %s\n", 
+                         (unsigned long) msg.timestamp,
                          msg.getLevelString(), 
                          msg.message);
         }
@@ -512,6 +556,16 @@ private:
         // Write to SD card if available
 #if SUPPORTS_SD_CARD
         if (_initialized) {
+            // Lock-free copy into the writer's queue; the card is written from its task
+            _asyncPushes.fetch_add(1);
+            AsyncLogQueue* queue = _asyncQueue.load();
+            if (queue) {
+                queue->push(msg);
+            }
+            _asyncPushes.fetch_sub(1);
+            if (queue) {
+                return;
+            }
             extern SDCardController* g_sdCardController;
             if (g_sdCardController) {
                 // Format log entry
@@ -535,9 +589,11 @@ private:
     }
     
     bool _initialized;
+    std::atomic<AsyncLogQueue*> _asyncQueue{nullptr};
+    std::atomic<int> _asyncPushes{0};  // Log calls between loading _asyncQueue and pushing to it
     
     // NEW: Filtering state variables
-    bool _componentFilteringEnabled;
+    LogFilter _filter;  // Level and component bits checked before formatting
     bool _timestampFilteringEnabled;
     bool _levelFilteringEnabled;
     std::vector<String> _allowedComponents;
@@ -545,26 +601,48 @@ private:
     uint32_t _minTimestamp;
 };
 
+// Compiled out below the floor; otherwise the filters are checked before
+// the message is formatted. Each call site interns its component once.
+#define SR_LOG_COMPONENT(level, comp, msg) do { \
+    if constexpr (LogLevels::compiledIn(level, comp)) { \
+        static const uint8_t _logComponentId = LogComponents::intern(comp); \
+        LogManager& _logManager = LogManager::getInstance(); \
+        if (_logManager.enabled(level, _logComponentId)) { \
+            _logManager.writeComponent(level, comp, msg); \
+        } \
+    } \
+} while (0)
+
+#define SR_LOG_COMPONENTF(level, comp, fmt, ...) do { \
+    if constexpr (LogLevels::compiledIn(level, comp)) { \
+        static const uint8_t _logComponentId = LogComponents::intern(comp); \
+        LogManager& _logManager = LogManager::getInstance(); \
+        if (_logManager.enabled(level, _logComponentId)) { \
+            _logManager.writeComponentPrintf(level, comp, fmt, ##__VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
 // Convenience macros for easy logging (legacy - backward compatible)
-#define LOG_DEBUG(msg) LogManager::getInstance().debug(msg)
-#define LOG_INFO(msg)  LogManager::getInstance().info(msg)
-#define LOG_WARN(msg)  LogManager::getInstance().warn(msg)
-#define LOG_ERROR(msg) LogManager::getInstance().error(msg)
-#define LOG_PRINTF(fmt, ...) LogManager::getInstance().printf(fmt, ##__VA_ARGS__)
-#define LOG_DEBUGF(fmt, ...) LogManager::getInstance().debugf(fmt, ##__VA_ARGS__)
-#define LOG_INFOF(fmt, ...) LogManager::getInstance().printf(fmt, ##__VA_ARGS__)
-#define LOG_WARNF(fmt, ...) LogManager::getInstance().warnf(fmt, ##__VA_ARGS__)
-#define LOG_ERRORF(fmt, ...) LogManager::getInstance().errorf(fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(msg) SR_LOG_COMPONENT(LogLevel::DEBUG, "", msg)
+#define LOG_INFO(msg)  SR_LOG_COMPONENT(LogLevel::INFO, "", msg)
+#define LOG_WARN(msg)  SR_LOG_COMPONENT(LogLevel::WARN, "", msg)
+#define LOG_ERROR(msg) SR_LOG_COMPONENT(LogLevel::ERROR, "", msg)
+#define LOG_PRINTF(fmt, ...) SR_LOG_COMPONENTF(LogLevel::INFO, "", fmt, ##__VA_ARGS__)
+#define LOG_DEBUGF(fmt, ...) SR_LOG_COMPONENTF(LogLevel::DEBUG, "", fmt, ##__VA_ARGS__)
+#define LOG_INFOF(fmt, ...) SR_LOG_COMPONENTF(LogLevel::INFO, "", fmt, ##__VA_ARGS__)
+#define LOG_WARNF(fmt, ...) SR_LOG_COMPONENTF(LogLevel::WARN, "", fmt, ##__VA_ARGS__)
+#define LOG_ERRORF(fmt, ...) SR_LOG_COMPONENTF(LogLevel::ERROR, "", fmt, ##__VA_ARGS__)
 
 // NEW: Component-aware logging macros
-#define LOG_DEBUG_COMPONENT(comp, msg) LogManager::getInstance().debugComponent(comp, msg)
-#define LOG_DEBUGF_COMPONENT(comp, fmt, ...) LogManager::getInstance().debugComponentPrintf(comp, fmt, ##__VA_ARGS__)
-#define LOG_INFO_COMPONENT(comp, msg)  LogManager::getInstance().infoComponent(comp, msg)
-#define LOG_INFOF_COMPONENT(comp, fmt, ...) LogManager::getInstance().infoComponentPrintf(comp, fmt, ##__VA_ARGS__)
-#define LOG_WARN_COMPONENT(comp, msg)  LogManager::getInstance().warnComponent(comp, msg)
-#define LOG_WARNF_COMPONENT(comp, fmt, ...) LogManager::getInstance().warnComponentPrintf(comp, fmt, ##__VA_ARGS__)
-#define LOG_ERROR_COMPONENT(comp, msg) LogManager::getInstance().errorComponent(comp, msg)
-#define LOG_ERRORF_COMPONENT(comp, fmt, ...) LogManager::getInstance().errorComponentPrintf(comp, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG_COMPONENT(comp, msg) SR_LOG_COMPONENT(LogLevel::DEBUG, comp, msg)
+#define LOG_DEBUGF_COMPONENT(comp, fmt, ...) SR_LOG_COMPONENTF(LogLevel::DEBUG, comp, fmt, ##__VA_ARGS__)
+#define LOG_INFO_COMPONENT(comp, msg)  SR_LOG_COMPONENT(LogLevel::INFO, comp, msg)
+#define LOG_INFOF_COMPONENT(comp, fmt, ...) SR_LOG_COMPONENTF(LogLevel::INFO, comp, fmt, ##__VA_ARGS__)
+#define LOG_WARN_COMPONENT(comp, msg)  SR_LOG_COMPONENT(LogLevel::WARN, comp, msg)
+#define LOG_WARNF_COMPONENT(comp, fmt, ...) SR_LOG_COMPONENTF(LogLevel::WARN, comp, fmt, ##__VA_ARGS__)
+#define LOG_ERROR_COMPONENT(comp, msg) SR_LOG_COMPONENT(LogLevel::ERROR, comp, msg)
+#define LOG_ERRORF_COMPONENT(comp, fmt, ...) SR_LOG_COMPONENTF(LogLevel::ERROR, comp, fmt, ##__VA_ARGS__)
 
 // NEW: Filtering control macros
 #define LOG_SET_COMPONENT_FILTER(components) LogManager::getInstance().setComponentFilter(components)
@@ -1,16 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
-
-/**
- * Log levels
- */
-enum class LogLevel {
-    DEBUG = 0,
-    INFO = 1,
-    WARN = 2,
-    ERROR = 3
-};
+#include "LogFilter.h"
 
 /**
  * LogMessage - Structure for passing log messages through queues
@@ -80,12 +71,6 @@ struct LogMessage {
     
     // Get level as string
     const char* getLevelString() const {
-        switch (level) {
-            case LogLevel::DEBUG: return "DEBUG";
-            case LogLevel::INFO:  return "INFO";
-            case LogLevel::WARN:  return "WARN";
-            case LogLevel::ERROR: return "ERROR";
-            default: return "UNKNOWN";
-        }
+        return LogLevels::name(level);
     }
 }; 
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include "SRRing.h"
+
+/**
+ * Log queue counters since boot
+ */
+struct LogQueueStats {
+    uint32_t queued = 0;
+    uint32_t dropped = 0;    // Ring full: the message was lost
+    uint32_t overflows = 0;  // Times the ring filled up (each run of drops counts once)
+};
+
+/**
+ * LogQueue - Lock-free hand-off of fixed-size log records to the writer
+ *
+ * Any task may push; only the writer task pops. A full ring drops the
+ * record rather than blocking the caller: logging from the LED task must
+ * never wait on the SD card. The writer takes the drops since its last
+ * look with takeDropped() and notes them in the log, so gaps are visible.
+ *
+ * Templated on the record; on the device it carries LogMessage (see
+ * LogWriterTask.h).
+ */
+template<typename Record, size_t Capacity>
+class LogQueue {
+public:
+    bool push(const Record& record) {
+        if (_ring.push(record)) {
+            _queued.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        if (_droppedSinceTaken.fetch_add(1, std::memory_order_relaxed) == 0) {
+            _overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    // Writer task only
+    bool pop(Record& out) { return _ring.pop(out); }
+
+    /**
+     * Drops since the last call (writer task)
+     */
+    uint32_t takeDropped() { return _droppedSinceTaken.exchange(0, std::memory_order_relaxed); }
+
+    bool empty() const { return _ring.empty(); }
+    size_t size() const { return _ring.size(); }
+    static constexpr size_t capacity() { return Capacity; }
+
+    LogQueueStats getStats() const {
+        LogQueueStats stats;
+        stats.queued = _queued.load(std::memory_order_relaxed);
+        stats.dropped = _dropped.load(std::memory_order_relaxed);
+        stats.overflows = _overflows.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    SRMpscRing<Record, Capacity> _ring;
+    std::atomic<uint32_t> _queued{0};
+    std::atomic<uint32_t> _dropped{0};
+    std::atomic<uint32_t> _overflows{0};
+    std::atomic<uint32_t> _droppedSinceTaken{0};
+};
@@ -0,0 +1,179 @@
+#include "LogWriterTask.h"
+#if SUPPORTS_SD_CARD
+#include "hal/SDCardController.h"
+#endif
+
+LogWriterTask::LogWriterTask(const char* path, uint32_t flushIntervalMs)
+    : SRTask("LogWriter", 4096, tskIDLE_PRIORITY + 1, 0),  // Core 0, away from the LED task
+      _path(path),
+      _flushIntervalMs(flushIntervalMs),
+      _writeMutex(xSemaphoreCreateMutex()) {}
+
+LogWriterTask::~LogWriterTask() {
+    closeFile();
+    if (_writeMutex) {
+        vSemaphoreDelete(_writeMutex);
+    }
+}
+
+void LogWriterTask::flushNow() {
+    xSemaphoreTake(_writeMutex, portMAX_DELAY);
+    service(millis(), true);
+    xSemaphoreGive(_writeMutex);
+}
+
+void LogWriterTask::shutdown() {
+    // Stopped while this holds _writeMutex, so not inside service()
+    xSemaphoreTake(_writeMutex, portMAX_DELAY);
+    service(millis(), true);
+    stop();
+    xSemaphoreGive(_writeMutex);
+}
+
+LogWriterStats LogWriterTask::getStats() const {
+    xSemaphoreTake(_writeMutex, portMAX_DELAY);
+    LogWriterStats stats = _stats;
+    xSemaphoreGive(_writeMutex);
+    stats.queue = _queue.getStats();
+    return stats;
+}
+
+void LogWriterTask::run() {
+    LOG_INFO_COMPONENT("LogWriter", "Log writer task started");
+    TickType_t lastWakeTime = xTaskGetTickCount();
+    _lastFlushMs = _lastStatsMs = millis();
+    while (true) {
+        xSemaphoreTake(_writeMutex, portMAX_DELAY);
+        service(millis(), false);
+        xSemaphoreGive(_writeMutex);
+
+        const uint32_t now = millis();
+        if (now - _lastStatsMs >= STATS_INTERVAL_MS) {
+            _lastStatsMs = now;
+            const LogWriterStats stats = getStats();
+            LOG_DEBUGF_COMPONENT("LogWriter", "%lu lines in %lu blocks, %lu flushes, max write %lu us, %lu dropped in %lu overflows",
+                (unsigned long) stats.lines, (unsigned long) stats.blocks, (unsigned long) stats.flushes,
+                (unsigned long) stats.maxWriteUs, (unsigned long) stats.queue.dropped, (unsigned long) stats.queue.overflows);
+        }
+        SRTask::sleepUntil(&lastWakeTime, POLL_INTERVAL_MS);
+    }
+}
+
+void LogWriterTask::service(uint32_t nowMs, bool force) {
+    const uint32_t dropped = _queue.takeDropped();
+    if (dropped > 0) {
+        appendDropNote(dropped, nowMs);
+    }
+    LogMessage msg;
+    while (_queue.pop(msg)) {
+        append(msg, nowMs);
+    }
+    // A part-filled block still goes out once it has waited a flush interval
+    if (!_block.empty() && (force || nowMs - _blockStartMs >= _flushIntervalMs)) {
+        writeBlock();
+    }
+    if (_unflushed && (force || nowMs - _lastFlushMs >= _flushIntervalMs)) {
+        flushFile(nowMs);
+    }
+}
+
+void LogWriterTask::append(const LogMessage& msg, uint32_t nowMs) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const bool wasEmpty = _block.empty();
+        size_t written;
+        if (msg.component[0] != '\0') {
+            written = _block.appendf("[%lu] [%s] %s: %s\n", (unsigned long) msg.timestamp,
+                msg.component, msg.getLevelString(), msg.message);
+        } else {
+            written = _block.appendf("[%lu] %s: %s\n", (unsigned long) msg.timestamp,
+                msg.getLevelString(), msg.message);
+        }
+        if (written > 0) {
+            if (wasEmpty) {
+                _blockStartMs = nowMs;
+            }
+            _stats.lines++;
+            return;
+        }
+        writeBlock();  // Full: write it out, then the line starts the next one
+    }
+}
+
+void LogWriterTask::appendDropNote(uint32_t dropped, uint32_t nowMs) {
+    LogMessage note(LogLevel::WARN, "LogWriter", "");
+    snprintf(note.message, sizeof(note.message), "%lu log messages dropped (queue full)", (unsigned long) dropped);
+    note.timestamp = nowMs;
+    append(note, nowMs);
+}
+
+void LogWriterTask::writeBlock() {
+    if (_block.empty()) {
+        return;
+    }
+#if SUPPORTS_SD_CARD
+    extern SDCardController* g_sdCardController;
+    if (openFile()) {
+        const uint32_t start = micros();
+        const size_t written = g_sdCardController->write(_file, (const uint8_t*) _block.data(), _block.size());
+        const uint32_t elapsed = micros() - start;
+        _stats.lastWriteUs = elapsed;
+        if (elapsed > _stats.maxWriteUs) {
+            _stats.maxWriteUs = elapsed;
+        }
+        _stats.bytesWritten += written;
+        if (written == _block.size()) {
+            _stats.blocks++;
+            _unflushed = true;
+            _errorReported = false;
+        } else {
+            _stats.writeErrors++;
+            closeFile();  // Reopened for the next block
+        }
+    } else {
+        _stats.writeErrors++;
+        if (!_errorReported) {
+            _errorReported = true;
+            Serial.printf("[LogWriter] Cannot open %s - log lines are not reaching the SD card\n", _path);
+        }
+    }
+#endif
+    _block.clear();
+}
+
+void LogWriterTask::flushFile(uint32_t nowMs) {
+#if SUPPORTS_SD_CARD
+    extern SDCardController* g_sdCardController;
+    if (_file && g_sdCardController) {
+        g_sdCardController->flush(_file);
+        _stats.flushes++;
+    }
+#endif
+    _unflushed = false;
+    _lastFlushMs = nowMs;
+}
+
+bool LogWriterTask::openFile() {
+#if SUPPORTS_SD_CARD
+    extern SDCardController* g_sdCardController;
+    if (_file) {
+        return true;
+    }
+    if (!g_sdCardController || !g_sdCardController->isAvailable()) {
+        return false;
+    }
+    _file = g_sdCardController->open(_path, "a");
+    return _file != nullptr;
+#else
+    return false;
+#endif
+}
+
+void LogWriterTask::closeFile() {
+#if SUPPORTS_SD_CARD
+    extern SDCardController* g_sdCardController;
+    if (_file && g_sdCardController) {
+        g_sdCardController->close(_file);
+    }
+#endif
+    _file = nullptr;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "SRTask.h"
+#include "LogManager.h"
+#include "LogQueue.h"
+#include "PlatformConfig.h"
+#include "utility/LogBlockBuffer.h"
+
+struct SDCardFileHandle;
+
+/**
+ * Log writer counters since boot
+ */
+struct LogWriterStats {
+    uint32_t lines = 0;        // Lines formatted into blocks
+    uint32_t blocks = 0;       // Writes to the card
+    uint32_t flushes = 0;
+    uint32_t bytesWritten = 0;
+    uint32_t writeErrors = 0;  // Blocks lost to a missing card or a short write
+    uint32_t lastWriteUs = 0;
+    uint32_t maxWriteUs = 0;
+    LogQueueStats queue;       // Queued, dropped and overflow counts
+};
+
+/**
+ * LogWriterTask - Writes the SD card log off the logging task
+ *
+ * Once started, LogManager pushes each message into this task's lock-free
+ * queue instead of opening, appending and closing the log file itself, so
+ * a log call from the LED task costs a copy, not a FAT write. This
+ * low-priority task keeps the file open, gathers lines into a 4 KB block,
+ * writes the block when it fills or has waited flushIntervalMs, and flushes
+ * the file at most once per flushIntervalMs. When the queue overflows the
+ * messages are dropped, counted, and a note of how many goes in the log.
+ */
+class LogWriterTask : public SRTask {
+public:
+    static constexpr size_t BLOCK_SIZE = 4096;
+
+    LogWriterTask(const char* path = "/logs/srdriver.log", uint32_t flushIntervalMs = 1000);
+    ~LogWriterTask();
+
+    AsyncLogQueue& queue() { return _queue; }
+
+    /**
+     * Write everything queued and flush the file now (shutdown, before a restart)
+     */
+    void flushNow();
+
+    /**
+     * Write and flush everything queued and stop the task, never in the
+     * middle of a write. Detach the queue from LogManager first.
+     */
+    void shutdown();
+
+    LogWriterStats getStats() const;
+
+protected:
+    void run() override;
+
+private:
+    static const uint32_t POLL_INTERVAL_MS = 20;
+    static const uint32_t STATS_INTERVAL_MS = 60000;
+
+    // All under _writeMutex
+    void service(uint32_t nowMs, bool force);
+    void append(const LogMessage& msg, uint32_t nowMs);
+    void appendDropNote(uint32_t dropped, uint32_t nowMs);
+    void writeBlock();
+    void flushFile(uint32_t nowMs);
+    bool openFile();
+    void closeFile();
+
+    const char* _path;
+    uint32_t _flushIntervalMs;
+    SemaphoreHandle_t _writeMutex;   // The block, the file and _stats
+    AsyncLogQueue _queue;
+    LogBlockBuffer<BLOCK_SIZE> _block;  // A member, not on the task's stack
+    SDCardFileHandle* _file = nullptr;
+    uint32_t _blockStartMs = 0;
+    uint32_t _lastFlushMs = 0;
+    uint32_t _lastStatsMs = 0;
+    bool _unflushed = false;
+    bool _errorReported = false;
+    LogWriterStats _stats;
+};
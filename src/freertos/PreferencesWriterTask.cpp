@@ -0,0 +1,103 @@
+#include "PreferencesWriterTask.h"
+#include "../GlobalState.h"
+
+void PreferencesWriterTask::setSavedState(const DeviceState& state) {
+    xSemaphoreTake(_writeMutex, portMAX_DELAY);
+    _saved = state;
+    _hasSaved = true;
+    xSemaphoreGive(_writeMutex);
+}
+
+void PreferencesWriterTask::requestSave(const DeviceState& state) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _pending = state;
+    _timer.markDirty(millis());
+    _stats.requests++;
+    xSemaphoreGive(_mutex);
+}
+
+void PreferencesWriterTask::flushNow() {
+    // With nothing new this still waits for a write the task may be in the middle of
+    flushPending(true);
+}
+
+void PreferencesWriterTask::shutdown() {
+    // Stopped while this holds _writeMutex, so not inside write()
+    xSemaphoreTake(_writeMutex, portMAX_DELAY);
+    DeviceState state;
+    if (takePending(state, true)) {
+        write(state);
+    }
+    stop();
+    xSemaphoreGive(_writeMutex);
+}
+
+PreferencesWriterStats PreferencesWriterTask::getStats() const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    PreferencesWriterStats stats = _stats;
+    xSemaphoreGive(_mutex);
+    return stats;
+}
+
+bool PreferencesWriterTask::flushPending(bool force) {
+    // The snapshot is taken under _writeMutex too: a snapshot taken later
+    // (flushNow racing the task) can never be written before an earlier one
+    xSemaphoreTake(_writeMutex, portMAX_DELAY);
+    DeviceState state;
+    const bool taken = takePending(state, force);
+    if (taken) {
+        write(state);
+    }
+    xSemaphoreGive(_writeMutex);
+    return taken;
+}
+
+bool PreferencesWriterTask::takePending(DeviceState& out, bool force) {
+    bool taken = false;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_timer.dirty() && (force || _timer.due(millis()))) {
+        out = _pending;
+        _timer.flushed();
+        taken = true;
+    }
+    xSemaphoreGive(_mutex);
+    return taken;
+}
+
+void PreferencesWriterTask::write(const DeviceState& state) {
+#if SUPPORTS_PREFERENCES
+    const uint32_t start = micros();
+    const size_t bytes = prefsManager.saveChanged(state, _hasSaved ? &_saved : nullptr);
+    const uint32_t elapsed = micros() - start;
+    _saved = state;
+    _hasSaved = true;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _stats.flushes++;
+    _stats.bytesWritten += bytes;
+    _stats.lastFlushUs = elapsed;
+    if (elapsed > _stats.maxFlushUs) {
+        _stats.maxFlushUs = elapsed;
+    }
+    const uint32_t requests = _stats.requests;
+    const uint32_t flushes = _stats.flushes;
+    xSemaphoreGive(_mutex);
+
+    if (bytes > 0) {
+        LOG_DEBUGF_COMPONENT("PrefsWriter", "Saved %d byte state blob in %lu us (%lu requests, %lu flushes)",
+            bytes, elapsed, requests, flushes);
+    } else {
+        LOG_DEBUGF_COMPONENT("PrefsWriter", "Nothing persisted changed - skipped write (%lu requests, %lu flushes)",
+            requests, flushes);
+    }
+#endif
+}
+
+void PreferencesWriterTask::run() {
+    LOG_INFO_COMPONENT("PrefsWriter", "Preferences writer task started");
+    TickType_t lastWakeTime = xTaskGetTickCount();
+    while (true) {
+        flushPending(false);
+        SRTask::sleepUntil(&lastWakeTime, POLL_INTERVAL_MS);
+    }
+}
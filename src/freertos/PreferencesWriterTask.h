@@ -0,0 +1,89 @@
+#pragma once
+
+#include "SRTask.h"
+#include "LogManager.h"
+#include "PlatformConfig.h"
+#include "DeviceState.h"
+#include "utility/WriteBehind.h"
+
+/**
+ * Preferences writer counters since boot
+ */
+struct PreferencesWriterStats {
+    uint32_t requests = 0;      // requestSave() calls
+    uint32_t flushes = 0;       // Flash writes
+    uint32_t bytesWritten = 0;
+    uint32_t lastFlushUs = 0;
+    uint32_t maxFlushUs = 0;
+};
+
+/**
+ * PreferencesWriterTask - Write-behind persistence of DeviceState
+ *
+ * requestSave() copies the state and marks it dirty; it never touches flash,
+ * so the LED task and the network handlers can call it freely. This
+ * low-priority task writes the latest copy once changes have been quiet for
+ * quietMs (or maxDelayMs after the first unsaved change), and skips the
+ * write when nothing persisted differs from what was last written.
+ */
+class PreferencesWriterTask : public SRTask {
+public:
+    PreferencesWriterTask(uint32_t quietMs = 2000, uint32_t maxDelayMs = 10000)
+        : SRTask("PrefsWriter", 4096, tskIDLE_PRIORITY + 1, 0),  // Core 0, away from the LED task
+          _timer(quietMs, maxDelayMs),
+          _mutex(xSemaphoreCreateMutex()),
+          _writeMutex(xSemaphoreCreateMutex()) {}
+
+    ~PreferencesWriterTask() {
+        if (_mutex) {
+            vSemaphoreDelete(_mutex);
+        }
+        if (_writeMutex) {
+            vSemaphoreDelete(_writeMutex);
+        }
+    }
+
+    /**
+     * What flash already holds (the state loaded at boot), so the first
+     * flush only writes what changed since
+     */
+    void setSavedState(const DeviceState& state);
+
+    /**
+     * Snapshot state for the next flush. Safe from any task.
+     */
+    void requestSave(const DeviceState& state);
+
+    /**
+     * Write any pending change now (shutdown, before a restart)
+     */
+    void flushNow();
+
+    /**
+     * Write any pending change and stop the task, never in the middle of a
+     * write. Nothing may call requestSave() from here on.
+     */
+    void shutdown();
+
+    bool hasPendingChanges() const { return _timer.dirty(); }
+    PreferencesWriterStats getStats() const;
+
+protected:
+    void run() override;
+
+private:
+    static const uint32_t POLL_INTERVAL_MS = 100;
+
+    // Takes the pending snapshot, if one is waiting, and writes it
+    bool flushPending(bool force);
+    bool takePending(DeviceState& out, bool force);
+    void write(const DeviceState& state);  // Caller holds _writeMutex
+
+    WriteBehind _timer;
+    SemaphoreHandle_t _mutex;       // _timer, _pending, _stats
+    SemaphoreHandle_t _writeMutex;  // Taking a snapshot through writing it; _saved
+    DeviceState _pending;           // Latest requested state
+    DeviceState _saved;             // What flash holds
+    bool _hasSaved = false;         // Until known, the first flush writes every key
+    PreferencesWriterStats _stats;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "SRRing.h"
+
+enum class QueueSendResult : uint8_t {
+    Queued,     // Appended
+    Coalesced,  // Replaced a pending item in place
+    Full        // Nothing to replace and no room
+};
+
+/**
+ * SRKeyedRing - SRMpscRing that coalesces keyed items as they are pushed
+ *
+ * Key 0 items are ordered and go through the ring as they are. A keyed item
+ * is parked in one of Slots latest-value slots and only a marker goes through
+ * the ring; a newer item with the same key replaces the parked one while its
+ * marker is pending. A burst of slider moves therefore takes one ring entry
+ * per key however long the consumer stalls, and a full ring never refuses
+ * the newest value for a key that is already pending.
+ *
+ * Each ordered push starts a new epoch: a keyed item never replaces one
+ * parked in an earlier epoch, so a value sent after an effect change is
+ * still applied after it. With every slot taken, a keyed item goes through
+ * the ring whole and counts as ordered.
+ *
+ * Ordered pushes are lock-free. Keyed pushes, and the consumer taking a
+ * parked item, hold a mutex for a scan of the slots and nothing else.
+ */
+template<typename T, size_t Capacity, size_t Slots>
+class SRKeyedRing {
+    static_assert(Slots >= 1 && Slots < 255, "SRKeyedRing slot index is a uint8_t");
+
+public:
+    static constexpr uint32_t ORDERED = 0;
+
+    SRKeyedRing() : _epoch(0) {}
+    SRKeyedRing(const SRKeyedRing&) = delete;
+    SRKeyedRing& operator=(const SRKeyedRing&) = delete;
+
+    /**
+     * Any task. Queued, Coalesced (replaced the pending item for key), or
+     * Full (the item is dropped).
+     */
+    template<typename U>
+    QueueSendResult push(uint32_t key, U&& item) {
+        if (key == ORDERED) {
+            return pushWhole(std::forward<U>(item));
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        const uint32_t epoch = _epoch.load(std::memory_order_relaxed);
+        size_t freeSlot = Slots;
+        for (size_t i = 0; i < Slots; i++) {
+            Slot& slot = _slots[i];
+            if (!slot.used) {
+                if (freeSlot == Slots) freeSlot = i;
+            } else if (slot.key == key && slot.epoch == epoch) {
+                slot.value = std::forward<U>(item);
+                return QueueSendResult::Coalesced;
+            }
+        }
+        if (freeSlot == Slots) {
+            return pushWhole(std::forward<U>(item));
+        }
+        if (!_ring.push(Entry{T(), (uint8_t) freeSlot})) {
+            return QueueSendResult::Full;
+        }
+        Slot& slot = _slots[freeSlot];
+        slot.used = true;
+        slot.key = key;
+        slot.epoch = epoch;
+        slot.value = std::forward<U>(item);
+        return QueueSendResult::Queued;
+    }
+
+    /**
+     * Consumer only. Moves the oldest item into out; false when empty.
+     */
+    bool pop(T& out) {
+        Entry entry;
+        if (!_ring.pop(entry)) {
+            return false;
+        }
+        if (entry.slot == NO_SLOT) {
+            out = std::move(entry.item);
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        Slot& slot = _slots[entry.slot];
+        out = std::move(slot.value);
+        slot.value = T();
+        slot.used = false;
+        return true;
+    }
+
+    // Approximate while producers are running
+    size_t size() const { return _ring.size(); }
+    bool empty() const { return _ring.empty(); }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static constexpr uint8_t NO_SLOT = 0xFF;
+
+    struct Entry {
+        T item;                 // Ordered items
+        uint8_t slot = NO_SLOT; // Keyed items: where the latest value is parked
+    };
+
+    struct Slot {
+        T value;
+        uint32_t key = 0;
+        uint32_t epoch = 0;
+        bool used = false;
+    };
+
+    // Ordered from here on: later keyed items get a new epoch
+    template<typename U>
+    QueueSendResult pushWhole(U&& item) {
+        if (!_ring.push(Entry{std::forward<U>(item), NO_SLOT})) {
+            return QueueSendResult::Full;
+        }
+        _epoch.fetch_add(1, std::memory_order_relaxed);
+        return QueueSendResult::Queued;
+    }
+
+    SRMpscRing<Entry, Capacity> _ring;
+    std::atomic<uint32_t> _epoch;
+    std::mutex _mutex;
+    Slot _slots[Slots];
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+/**
+ * SRRing - Fixed-capacity lock-free rings for passing items between tasks
+ *
+ * Unlike SRSmartQueue there is no mutex and no allocation per item: the
+ * slots are a plain array inside the ring, items are moved in and out (so
+ * std::shared_ptr / std::unique_ptr work), and a full ring refuses the push
+ * instead of blocking.
+ *
+ * SRSpscRing - exactly one producer task and one consumer task.
+ * SRMpscRing - any number of producer tasks, one consumer task (every
+ *              transport feeding the LED task).
+ *
+ * Capacity must be a power of two. Indices are kept on separate cache lines
+ * so the producer and consumer cores do not fight over one line.
+ */
+
+#ifndef SR_CACHE_LINE
+#define SR_CACHE_LINE 64
+#endif
+
+template<typename T, size_t Capacity>
+class SRSpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SRSpscRing capacity must be a power of two");
+
+public:
+    SRSpscRing() : _head(0), _tail(0) {}
+    SRSpscRing(const SRSpscRing&) = delete;
+    SRSpscRing& operator=(const SRSpscRing&) = delete;
+
+    /**
+     * Producer only. Moves item in; false (item untouched) when full.
+     */
+    template<typename U>
+    bool push(U&& item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        _slots[tail & MASK] = std::forward<U>(item);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer only. Moves the oldest item into out; false when empty.
+     * The slot is reset so it does not keep the item's resources alive.
+     */
+    bool pop(T& out) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        T& slot = _slots[head & MASK];
+        out = std::move(slot);
+        slot = T();
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate while the other side is running
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    alignas(SR_CACHE_LINE) std::atomic<size_t> _head;  // Next slot to read (consumer)
+    alignas(SR_CACHE_LINE) std::atomic<size_t> _tail;  // Next slot to write (producer)
+    alignas(SR_CACHE_LINE) T _slots[Capacity];
+};
+
+/**
+ * Bounded multi-producer ring (Vyukov's sequence-per-slot design, with the
+ * consumer side simplified for a single reader). Producers claim a position
+ * with one compare-and-swap; a slot's sequence number says whether it is
+ * free for that lap, and publishes the item to the consumer once written.
+ */
+template<typename T, size_t Capacity>
+class SRMpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SRMpscRing capacity must be a power of two");
+
+public:
+    SRMpscRing() : _head(0), _tail(0) {
+        for (size_t i = 0; i < Capacity; i++) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    SRMpscRing(const SRMpscRing&) = delete;
+    SRMpscRing& operator=(const SRMpscRing&) = delete;
+
+    /**
+     * Any task. Moves item in; false (item untouched) when full.
+     */
+    template<typename U>
+    bool push(U&& item) {
+        size_t position = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = _slots[position & MASK];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const intptr_t lap = (intptr_t) sequence - (intptr_t) position;
+            if (lap == 0) {
+                // Free for this lap: claim it
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = std::forward<U>(item);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+                // position was reloaded by the failed exchange
+            } else if (lap < 0) {
+                return false;  // Consumer has not freed it yet: full
+            } else {
+                position = _tail.load(std::memory_order_relaxed);  // Another producer got here first
+            }
+        }
+    }
+
+    /**
+     * Consumer only. Moves the oldest item into out; false when empty (or
+     * when the oldest claimed slot is still being written).
+     */
+    bool pop(T& out) {
+        const size_t position = _head.load(std::memory_order_relaxed);
+        Slot& slot = _slots[position & MASK];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+        out = std::move(slot.value);
+        slot.value = T();
+        slot.sequence.store(position + Capacity, std::memory_order_release);
+        _head.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Approximate while producers are running
+    size_t size() const {
+        const size_t tail = _tail.load(std::memory_order_acquire);
+        const size_t head = _head.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    alignas(SR_CACHE_LINE) std::atomic<size_t> _head;  // Consumer
+    alignas(SR_CACHE_LINE) std::atomic<size_t> _tail;  // Producers
+    alignas(SR_CACHE_LINE) Slot _slots[Capacity];
+};
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
-#include <queue>
+#include <deque>
 #include <memory>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -9,7 +9,7 @@
 /**
  * SRSmartQueue - Thread-safe queue that supports smart pointers and move semantics
  * 
- * Uses FreeRTOS mutex for thread safety and std::queue for storage.
+ * Uses FreeRTOS mutex for thread safety and std::deque for storage.
  * This allows queuing of non-POD types like std::shared_ptr and std::unique_ptr.
  * 
  * Note: This is slightly less efficient than SRQueue (mutex overhead vs memcpy),
@@ -79,7 +79,7 @@ public:
         }
         
         // Add item to queue (move if rvalue, copy if lvalue)
-        _queue.push(std::forward<U>(item));
+        _queue.push_back(std::forward<U>(item));
         
         xSemaphoreGive(_mutex);
         return true;
@@ -121,16 +121,7 @@ public:
             return false;  // Queue full
         }
         
-        // For front insertion, we need to use a deque or manually reorder
-        // Since std::queue doesn't support front insertion, we'll use a workaround:
-        // Create a temporary queue, add new item, then copy all old items
-        std::queue<T> tempQueue;
-        tempQueue.push(std::forward<U>(item));
-        while (!_queue.empty()) {
-            tempQueue.push(std::move(_queue.front()));
-            _queue.pop();
-        }
-        _queue = std::move(tempQueue);
+        _queue.push_front(std::forward<U>(item));
         
         xSemaphoreGive(_mutex);
         return true;
@@ -171,7 +162,7 @@ public:
         
         // Get item from front of queue
         item = std::move(_queue.front());
-        _queue.pop();
+        _queue.pop_front();
         
         xSemaphoreGive(_mutex);
         const auto endTime = micros();
@@ -263,9 +254,7 @@ public:
         if (!_mutex) return;
         
         if (xSemaphoreTake(_mutex, portMAX_DELAY) == pdTRUE) {
-            while (!_queue.empty()) {
-                _queue.pop();
-            }
+            _queue.clear();
             xSemaphoreGive(_mutex);
         }
     }
@@ -277,7 +266,7 @@ public:
 
 private:
     SemaphoreHandle_t _mutex;
-    std::queue<T> _queue;
+    std::deque<T> _queue;
     UBaseType_t _maxLength;
     const char* _name;
 };
@@ -5,6 +5,8 @@
 #include "BLEUpdateTask.h"
 #include "LogManager.h"
 #include "LVGLDisplayTask.h"
+#include "PreferencesWriterTask.h"
+#include "LogWriterTask.h"
 #include "hal/network/ICommandHandler.h"
 // Note: LEDUpdateTask.h is included in TaskManager_createLEDTask.cpp
 // to avoid macro conflicts between FastLED and Adafruit SSD1306
@@ -125,13 +127,67 @@ bool TaskManager::createLVGLDisplayTask(const JsonSettings* settings, uint32_t u
     #endif
 }
 
+bool TaskManager::createPreferencesWriterTask(uint32_t quietMs, uint32_t maxDelayMs) {
+#if SUPPORTS_PREFERENCES
+    if (_preferencesWriterTask != nullptr) {
+        LOG_WARN_COMPONENT("TaskManager", "Preferences writer task already created");
+        return _preferencesWriterTask->isRunning();
+    }
+
+    _preferencesWriterTask = new PreferencesWriterTask(quietMs, maxDelayMs);
+    if (_preferencesWriterTask->start()) {
+        LOG_INFO_COMPONENT("TaskManager", "Preferences writer task created and started");
+        return true;
+    } else {
+        LOG_ERROR_COMPONENT("TaskManager", "Failed to start preferences writer task");
+        delete _preferencesWriterTask;
+        _preferencesWriterTask = nullptr;
+        return false;
+    }
+#else
+    LOG_INFO_COMPONENT("TaskManager", "Preferences not supported on this platform");
+    return false;
+#endif
+}
+
+bool TaskManager::createLogWriterTask(uint32_t flushIntervalMs) {
+#if SUPPORTS_SD_CARD
+    if (_logWriterTask != nullptr) {
+        LOG_WARN_COMPONENT("TaskManager", "Log writer task already created");
+        return _logWriterTask->isRunning();
+    }
+
+    _logWriterTask = new LogWriterTask("/logs/srdriver.log", flushIntervalMs);
+    if (_logWriterTask->start()) {
+        // From here log calls only queue; the task writes the card
+        LogManager::getInstance().setAsyncQueue(&_logWriterTask->queue());
+        LOG_INFO_COMPONENT("TaskManager", "Log writer task created and started");
+        return true;
+    } else {
+        LOG_ERROR_COMPONENT("TaskManager", "Failed to start log writer task");
+        delete _logWriterTask;
+        _logWriterTask = nullptr;
+        return false;
+    }
+#else
+    LOG_INFO_COMPONENT("TaskManager", "SD card logging not supported on this platform");
+    return false;
+#endif
+}
+
 void TaskManager::cleanupAll() {
+    // The tasks that save preferences and log go first: the writers are only
+    // deleted once nothing can still call into them
     cleanupSystemMonitorTask();
     cleanupOLEDDisplayTask();
     cleanupWiFiManager();
     cleanupBLETask();
     cleanupLEDTask();
     cleanupLVGLDisplayTask();
+    // Then the last change made before shutdown is written to flash
+    cleanupPreferencesWriterTask();
+    // Last, so the other tasks' shutdown messages reach the card
+    cleanupLogWriterTask();
 }
 
 void TaskManager::cleanupSystemMonitorTask() {
@@ -210,3 +266,34 @@ bool TaskManager::isLVGLDisplayTaskRunning() const {
     return false;
 #endif
 }
+
+void TaskManager::cleanupPreferencesWriterTask() {
+    if (_preferencesWriterTask) {
+        // SaveUserPreferences writes directly from here on
+        PreferencesWriterTask* writer = _preferencesWriterTask;
+        _preferencesWriterTask = nullptr;
+        writer->shutdown();
+        delete writer;
+        LOG_INFO_COMPONENT("TaskManager", "Preferences writer task cleaned up");
+    }
+}
+
+bool TaskManager::isPreferencesWriterTaskRunning() const {
+    return _preferencesWriterTask != nullptr && _preferencesWriterTask->isRunning();
+}
+
+void TaskManager::cleanupLogWriterTask() {
+    if (_logWriterTask) {
+        // Back to direct writes (returns once no log call is still pushing to
+        // the queue), then write out whatever was still queued
+        LogManager::getInstance().setAsyncQueue(nullptr);
+        _logWriterTask->shutdown();
+        delete _logWriterTask;
+        _logWriterTask = nullptr;
+        LOG_INFO_COMPONENT("TaskManager", "Log writer task cleaned up");
+    }
+}
+
+bool TaskManager::isLogWriterTaskRunning() const {
+    return _logWriterTask != nullptr && _logWriterTask->isRunning();
+}
@@ -15,6 +15,8 @@ class BLEUpdateTask;
 class BLEManager;
 class LEDUpdateTask;
 class LVGLDisplayTask;
+class PreferencesWriterTask;
+class LogWriterTask;
 
 /**
  * TaskManager - Singleton for managing all FreeRTOS tasks
@@ -36,6 +38,8 @@ public:
     bool createBLETask(BLEManager& manager, uint32_t updateIntervalMs = 10);
     bool createLEDTask(uint32_t updateIntervalMs = 16);  // Default 60 FPS
     bool createLVGLDisplayTask(const JsonSettings* settings = nullptr, uint32_t updateIntervalMs = 200);
+    bool createPreferencesWriterTask(uint32_t quietMs = 2000, uint32_t maxDelayMs = 10000);
+    bool createLogWriterTask(uint32_t flushIntervalMs = 1000);
     
     // Accessors - return nullptr if task not created
     SystemMonitorTask* getSystemMonitorTask() const { return _systemMonitorTask; }
@@ -44,8 +48,11 @@ public:
     BLEUpdateTask* getBLETask() const { return _bleTask; }
     LEDUpdateTask* getLEDTask() const { return _ledTask; }
     LVGLDisplayTask* getLVGLDisplayTask() const { return _lvglDisplayTask; }
+    PreferencesWriterTask* getPreferencesWriterTask() const { return _preferencesWriterTask; }
+    LogWriterTask* getLogWriterTask() const { return _logWriterTask; }
     
-    // Cleanup
+    // Cleanup. cleanupAll() stops the other tasks before the preferences and
+    // log writers; stop the tasks that save or log before calling either alone.
     void cleanupAll();
     void cleanupSystemMonitorTask();
     void cleanupOLEDDisplayTask();
@@ -53,6 +60,8 @@ public:
     void cleanupBLETask();
     void cleanupLEDTask();
     void cleanupLVGLDisplayTask();
+    void cleanupPreferencesWriterTask();
+    void cleanupLogWriterTask();
     
     // Check if tasks are running
     bool isSystemMonitorTaskRunning() const;
@@ -61,6 +70,8 @@ public:
     bool isBLETaskRunning() const;
     bool isLEDTaskRunning() const;
     bool isLVGLDisplayTaskRunning() const;
+    bool isPreferencesWriterTaskRunning() const;
+    bool isLogWriterTaskRunning() const;
 private:
     TaskManager() = default;
     ~TaskManager() { cleanupAll(); }
@@ -74,5 +85,7 @@ private:
     BLEUpdateTask *_bleTask = nullptr;
     LEDUpdateTask *_ledTask = nullptr;
     LVGLDisplayTask *_lvglDisplayTask = nullptr;
+    PreferencesWriterTask *_preferencesWriterTask = nullptr;
+    LogWriterTask *_logWriterTask = nullptr;
 };
 
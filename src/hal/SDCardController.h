@@ -27,6 +27,7 @@ public:
     virtual long position(SDCardFileHandle* handle) = 0;
     virtual long size(SDCardFileHandle* handle) = 0;
     virtual bool available(SDCardFileHandle* handle) = 0;
+    virtual bool flush(SDCardFileHandle* handle) = 0;  // Push buffered writes to the card, file stays open
     // Convenience methods for whole file operations
     virtual bool writeFile(const char* path, const char* data) = 0;
     virtual String readFile(const char* path) = 0;
@@ -53,6 +54,7 @@ public:
     long position(SDCardFileHandle* handle) override { return 0; }
     long size(SDCardFileHandle* handle) override { return 0; }
     bool available(SDCardFileHandle* handle) override { return false; }
+    bool flush(SDCardFileHandle* handle) override { return false; }
     bool writeFile(const char* path, const char* data) override { return false; }
     String readFile(const char* path) override { return String(); }
     bool appendFile(const char* path, const char* data) override { return false; }
@@ -286,8 +286,15 @@ void BLEManager::registerCharacteristics() {
     handlers.push_back({
         &commandCharacteristic,
         [this](const unsigned char* value) {
+            // MessagePack writes skip the text path entirely
+            const size_t valueLength = (size_t) commandCharacteristic.valueLength();
+            if (CommandCodec::detect(value, valueLength) == CommandEncoding::MsgPack) {
+                LOG_DEBUGF_COMPONENT("BLEManager", "Binary command received: %d bytes", valueLength);
+                HandleCommandMessage(value, valueLength, CommandEncoding::MsgPack);
+                return;
+            }
             char buf[256];
-            size_t len = std::min(sizeof(buf) - 1, (size_t)commandCharacteristic.valueLength());
+            size_t len = std::min(sizeof(buf) - 1, valueLength);
             memcpy(buf, value, len);
             buf[len] = '\0';
             String s(buf);
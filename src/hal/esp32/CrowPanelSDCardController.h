@@ -137,6 +137,13 @@ public:
         return handle->file.available();
     }
 
+    bool flush(SDCardFileHandle *handle) override
+    {
+        if (!handle || handle->isDirectory) return false;
+        handle->file.flush();
+        return true;
+    }
+
     bool writeFile(const char *path, const char *data) override
     {
         if (!m_available) return false;
@@ -61,6 +61,11 @@ public:
         if (!handle || handle->isDirectory) return false;
         return handle->file.available();
     }
+    bool flush(SDCardFileHandle* handle) override {
+        if (!handle || handle->isDirectory) return false;
+        handle->file.flush();
+        return true;
+    }
     bool writeFile(const char* path, const char* data) override {
         if (!m_available) return false;
         File file = SD.open(path, FILE_WRITE);
@@ -0,0 +1,68 @@
+#include "CommandCodec.h"
+#include <string.h>
+
+// Same bounds HandleJSONCommand always used for one-off documents
+static const size_t MIN_DOC_SIZE = 2048;
+static const size_t MAX_DOC_SIZE = 32768;
+
+CommandEncoding CommandCodec::detect(const uint8_t* data, size_t length) {
+    if (!data || length == 0) {
+        return CommandEncoding::Json;
+    }
+    const uint8_t first = data[0];
+    // fixmap, fixarray, array16/32, map16/32
+    if ((first >= 0x80 && first <= 0x9F) || (first >= 0xDC && first <= 0xDF)) {
+        return CommandEncoding::MsgPack;
+    }
+    return CommandEncoding::Json;
+}
+
+const char* CommandCodec::encodingName(CommandEncoding encoding) {
+    return encoding == CommandEncoding::MsgPack ? "msgpack" : "json";
+}
+
+bool CommandCodec::encodingFromName(const char* name, CommandEncoding& out) {
+    if (!name) return false;
+    if (strcmp(name, "json") == 0) {
+        out = CommandEncoding::Json;
+        return true;
+    }
+    if (strcmp(name, "msgpack") == 0) {
+        out = CommandEncoding::MsgPack;
+        return true;
+    }
+    return false;
+}
+
+DeserializationError CommandCodec::decode(JsonDocument& doc, const uint8_t* data, size_t length, CommandEncoding encoding) {
+    // const char* input: strings are copied into doc, so data may be a transport buffer
+    const char* input = (const char*) data;
+    if (encoding == CommandEncoding::MsgPack) {
+        return deserializeMsgPack(doc, input, length);
+    }
+    return deserializeJson(doc, input, length);
+}
+
+size_t CommandCodec::measure(JsonVariantConst value, CommandEncoding encoding) {
+    return encoding == CommandEncoding::MsgPack ? measureMsgPack(value) : measureJson(value);
+}
+
+size_t CommandCodec::encode(JsonVariantConst value, CommandEncoding encoding, uint8_t* out, size_t capacity) {
+    // serializeJson also writes a terminator
+    const size_t needed = measure(value, encoding) + (encoding == CommandEncoding::Json ? 1 : 0);
+    if (!out || needed > capacity) {
+        return 0;
+    }
+    if (encoding == CommandEncoding::MsgPack) {
+        return serializeMsgPack(value, out, capacity);
+    }
+    return serializeJson(value, (char*) out, capacity);
+}
+
+size_t CommandCodec::docSizeFor(size_t length, CommandEncoding encoding) {
+    // ArduinoJson needs 2.5-3x the JSON length for nested structures
+    size_t docSize = length * (encoding == CommandEncoding::MsgPack ? 4 : 3);
+    if (docSize < MIN_DOC_SIZE) docSize = MIN_DOC_SIZE;
+    if (docSize > MAX_DOC_SIZE) docSize = MAX_DOC_SIZE;
+    return docSize;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * CommandCodec - Wire encodings for control commands
+ *
+ * Commands use one schema (the same "type"/"t" objects everywhere); only
+ * the encoding on the wire differs:
+ *
+ *   Json     UTF-8 text, WebSocket text frames and BLE writes as before
+ *   MsgPack  MessagePack of the same object, WebSocket binary frames and
+ *            BLE writes. About a third smaller, and ArduinoJson decodes it
+ *            without scanning text for numbers and escapes.
+ *
+ * Both decode into the same JsonDocument, so everything past the transport
+ * (queue, LEDManager::handleCommand) is unchanged.
+ *
+ * A WebSocket connection picks the encoding of its replies with
+ * {"t":"hello","encoding":"msgpack"} (sent in either encoding); incoming
+ * messages are recognized per message, so a client may switch at any time.
+ */
+
+enum class CommandEncoding : uint8_t {
+    Json,
+    MsgPack
+};
+
+class CommandCodec {
+public:
+    /**
+     * Guess the encoding from the first byte. A JSON command starts with
+     * '{', '[' or whitespace; a MessagePack command with a map or array
+     * marker, none of which are printable ASCII.
+     */
+    static CommandEncoding detect(const uint8_t* data, size_t length);
+
+    static const char* encodingName(CommandEncoding encoding);
+    static bool encodingFromName(const char* name, CommandEncoding& out);
+
+    static DeserializationError decode(JsonDocument& doc, const uint8_t* data, size_t length, CommandEncoding encoding);
+    static size_t measure(JsonVariantConst value, CommandEncoding encoding);
+    // Returns the bytes written, 0 if out is too small
+    static size_t encode(JsonVariantConst value, CommandEncoding encoding, uint8_t* out, size_t capacity);
+
+    /**
+     * Bytes of JsonDocument a length-byte message needs. MessagePack packs
+     * the same elements into fewer bytes, so it gets a bigger multiplier.
+     */
+    static size_t docSizeFor(size_t length, CommandEncoding encoding);
+};
@@ -0,0 +1,82 @@
+#include "CommandDocPool.h"
+
+CommandDocPool g_commandDocPool;
+
+CommandDocPool::CommandDocPool(size_t numSlots, size_t slotCapacity)
+    : count(numSlots < MAX_SLOTS ? numSlots : MAX_SLOTS), capacity(slotCapacity) {
+    // Allocated once up front: slot.doc is never reassigned afterwards, so
+    // use_count() can be read from any task
+    for (size_t i = 0; i < count; i++) {
+        slots[i].doc = std::make_shared<DynamicJsonDocument>(capacity);
+    }
+}
+
+std::shared_ptr<DynamicJsonDocument> CommandDocPool::claimSlot() {
+    for (size_t i = 0; i < count; i++) {
+        Slot& slot = slots[i];
+        if (slot.claiming.test_and_set(std::memory_order_acquire)) {
+            continue;  // Another task is claiming this one
+        }
+        std::shared_ptr<DynamicJsonDocument> doc;
+        // Only the pool's reference left: the last consumer is done with it
+        if (slot.doc && slot.doc->capacity() > 0 && slot.doc.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            doc = slot.doc;
+        }
+        slot.claiming.clear(std::memory_order_release);
+        if (doc) {
+            return doc;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<DynamicJsonDocument> CommandDocPool::acquire(size_t length, CommandEncoding encoding) {
+    const size_t docSize = docSizeFor(length, encoding);
+    if (docSize <= capacity) {
+        std::shared_ptr<DynamicJsonDocument> doc = claimSlot();
+        if (doc) {
+            doc->clear();
+            stats.acquired++;
+            const size_t used = inUse();
+            if (used > stats.peakInUse) {
+                stats.peakInUse = (uint16_t) used;
+            }
+            return doc;
+        }
+        stats.exhausted++;
+    } else {
+        stats.oversize++;
+    }
+
+    std::shared_ptr<DynamicJsonDocument> doc = std::make_shared<DynamicJsonDocument>(docSize);
+    return doc && doc->capacity() > 0 ? doc : nullptr;
+}
+
+std::shared_ptr<DynamicJsonDocument> CommandDocPool::parse(const uint8_t* data, size_t length, CommandEncoding encoding,
+                                                           DeserializationError& error) {
+    std::shared_ptr<DynamicJsonDocument> doc = acquire(length, encoding);
+    if (!doc) {
+        error = DeserializationError::NoMemory;
+        stats.parseErrors++;
+        return nullptr;
+    }
+    error = CommandCodec::decode(*doc, data, length, encoding);
+    if (error) {
+        stats.parseErrors++;
+        return nullptr;  // Dropping doc hands a pooled slot straight back
+    }
+    return doc;
+}
+
+size_t CommandDocPool::inUse() const {
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].doc.use_count() > 1) used++;
+    }
+    return used;
+}
+
+void CommandDocPool::resetStats() {
+    stats = CommandDocPoolStats();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include "CommandCodec.h"
+
+/**
+ * CommandDocPool - Reusable, fixed-capacity JSON documents for incoming commands
+ *
+ * Every transport used to parse into a fresh DynamicJsonDocument, and
+ * HandleJSONCommand then deep-copied it into a second one just to queue it.
+ * The pool keeps a few documents alive for the life of the program instead:
+ * the transport parses straight into one and the same shared_ptr travels
+ * through the command queue, so a command costs no heap allocation at all.
+ *
+ * A slot is free again once the pool holds the only reference to it - the
+ * consumer hands it back simply by dropping its shared_ptr. Claiming a slot
+ * is lock-free, so any task may call acquire() or parse().
+ *
+ * Commands too big for a slot, or arriving while every slot is still queued,
+ * fall back to a one-off document sized like before; getStats() counts both.
+ */
+
+struct CommandDocPoolStats {
+    uint32_t acquired = 0;      // Documents handed out from a slot
+    uint32_t oversize = 0;      // Commands too big for a slot
+    uint32_t exhausted = 0;     // Every slot was still in use
+    uint32_t parseErrors = 0;
+    uint16_t peakInUse = 0;
+};
+
+class CommandDocPool {
+public:
+    static constexpr size_t DEFAULT_SLOTS = 4;
+    static constexpr size_t DEFAULT_SLOT_CAPACITY = 4096;
+
+    explicit CommandDocPool(size_t numSlots = DEFAULT_SLOTS, size_t slotCapacity = DEFAULT_SLOT_CAPACITY);
+
+    /**
+     * Hand out a cleared document with room for a length-byte message.
+     * Returns a pooled slot when one fits and is free, otherwise a one-off
+     * document (nullptr only if that allocation fails).
+     */
+    std::shared_ptr<DynamicJsonDocument> acquire(size_t length, CommandEncoding encoding = CommandEncoding::Json);
+
+    /**
+     * Decode a message into a document from acquire(). On failure the
+     * document is released again and nullptr is returned with the reason in
+     * error.
+     */
+    std::shared_ptr<DynamicJsonDocument> parse(const char* json, size_t length, DeserializationError& error) {
+        return parse((const uint8_t*) json, length, CommandEncoding::Json, error);
+    }
+    std::shared_ptr<DynamicJsonDocument> parse(const uint8_t* data, size_t length, CommandEncoding encoding,
+                                               DeserializationError& error);
+
+    // Capacity a one-off document for a length-byte message gets
+    static size_t docSizeFor(size_t length, CommandEncoding encoding = CommandEncoding::Json) {
+        return CommandCodec::docSizeFor(length, encoding);
+    }
+
+    size_t slotCount() const { return count; }
+    size_t slotCapacity() const { return capacity; }
+    size_t inUse() const;
+    const CommandDocPoolStats& getStats() const { return stats; }
+    void resetStats();
+
+private:
+    static constexpr size_t MAX_SLOTS = 8;
+
+    struct Slot {
+        std::shared_ptr<DynamicJsonDocument> doc;
+        std::atomic_flag claiming = ATOMIC_FLAG_INIT;
+    };
+
+    std::shared_ptr<DynamicJsonDocument> claimSlot();
+
+    Slot slots[MAX_SLOTS];
+    size_t count;
+    size_t capacity;
+    CommandDocPoolStats stats;
+};
+
+// Shared by the WebSocket server and HandleJSONCommand
+extern CommandDocPool g_commandDocPool;
@@ -0,0 +1,180 @@
+#include "CommandTrace.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+CommandTracer g_commandTracer;
+
+size_t LatencyHistogram::bucketFor(uint32_t us) {
+    size_t index = 0;
+    while (us > 1 && index < BUCKETS - 1) {
+        us >>= 1;
+        index++;
+    }
+    return index;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index >= BUCKETS - 1) return UINT32_MAX;
+    return (2u << index) - 1;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+    _buckets[bucketFor(us)]++;
+    _count++;
+    if (us > _max) {
+        _max = us;
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+    if (other._max > _max) {
+        _max = other._max;
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _max = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+    if (_count == 0) return 0;
+    // Smallest bucket holding at least percent of the samples
+    const uint64_t target = ((uint64_t) _count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= target) {
+            const uint32_t bound = bucketUpperBound(i);
+            return bound < _max ? bound : _max;
+        }
+    }
+    return _max;
+}
+
+void CommandTracer::record(const CommandTrace& trace, uint32_t nowMs) {
+    if (!_windowStarted) {
+        _windowStarted = true;
+        _windowStartMs = nowMs;
+    } else if (nowMs - _windowStartMs >= _windowMs) {
+        // Roll: the finished window becomes the previous one
+        for (size_t i = 0; i < SEGMENTS; i++) {
+            _previous[i] = _current[i];
+            _current[i].reset();
+        }
+        _windowStartMs = nowMs;
+    }
+
+    size_t first = CommandTrace::HOPS, last = 0;
+    for (size_t hop = 0; hop < CommandTrace::HOPS; hop++) {
+        if (!trace.stamps[hop]) continue;
+        if (first == CommandTrace::HOPS) first = hop;
+        last = hop;
+        if (hop > 0 && trace.stamps[hop - 1]) {
+            _current[hop - 1].record(trace.stamps[hop] - trace.stamps[hop - 1]);
+        }
+    }
+    if (first < last) {
+        _current[TOTAL].record(trace.stamps[last] - trace.stamps[first]);
+    }
+}
+
+void CommandTracer::reset() {
+    for (size_t i = 0; i < SEGMENTS; i++) {
+        _current[i].reset();
+        _previous[i].reset();
+    }
+    _windowStarted = false;
+}
+
+LatencyHistogram CommandTracer::histogram(size_t segment) const {
+    LatencyHistogram combined;
+    if (segment < SEGMENTS) {
+        combined.merge(_previous[segment]);
+        combined.merge(_current[segment]);
+    }
+    return combined;
+}
+
+const char* CommandTracer::segmentName(size_t segment) {
+    switch (segment) {
+        case 0: return "parse";  // Received -> Parsed
+        case 1: return "queue";  // Parsed -> Enqueued
+        case 2: return "wait";   // Enqueued -> Dequeued (ring + frame boundary)
+        case 3: return "apply";  // Dequeued -> Applied
+        case 4: return "show";   // Applied -> Shown
+        case TOTAL: return "total";
+    }
+    return "?";
+}
+
+// Appends to out at *length; false once it no longer fits
+static bool append(char* out, size_t size, size_t* length, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static bool append(char* out, size_t size, size_t* length, const char* format, ...) {
+    if (*length >= size) return false;
+    va_list args;
+    va_start(args, format);
+    const int written = vsnprintf(out + *length, size - *length, format, args);
+    va_end(args);
+    if (written < 0 || (size_t) written >= size - *length) {
+        *length = size;
+        return false;
+    }
+    *length += written;
+    return true;
+}
+
+size_t CommandTracer::formatTrace(const CommandTrace& trace, char* out, size_t size) {
+    size_t length = 0;
+    append(out, size, &length, "{\"t\":\"trace\",\"id\":%lu,\"us\":{", (unsigned long) trace.id);
+    bool first = true;
+    for (size_t hop = 1; hop < CommandTrace::HOPS; hop++) {
+        if (!trace.stamps[hop] || !trace.stamps[hop - 1]) continue;
+        append(out, size, &length, "%s\"%s\":%lu", first ? "" : ",", segmentName(hop - 1),
+            (unsigned long) (trace.stamps[hop] - trace.stamps[hop - 1]));
+        first = false;
+    }
+    size_t firstHop = CommandTrace::HOPS, lastHop = 0;
+    for (size_t hop = 0; hop < CommandTrace::HOPS; hop++) {
+        if (!trace.stamps[hop]) continue;
+        if (firstHop == CommandTrace::HOPS) firstHop = hop;
+        lastHop = hop;
+    }
+    if (firstHop < lastHop) {
+        append(out, size, &length, "%s\"total\":%lu", first ? "" : ",",
+            (unsigned long) (trace.stamps[lastHop] - trace.stamps[firstHop]));
+    }
+    if (!append(out, size, &length, "}}")) {
+        if (size > 0) out[0] = '\0';
+        return 0;
+    }
+    return length;
+}
+
+size_t CommandTracer::formatReport(char* out, size_t size) const {
+    size_t length = 0;
+    const LatencyHistogram total = histogram(TOTAL);
+    append(out, size, &length, "{\"t\":\"latency\",\"enabled\":%s,\"count\":%lu,\"us\":{",
+        enabled() ? "true" : "false", (unsigned long) total.count());
+    for (size_t segment = 0; segment < SEGMENTS; segment++) {
+        const LatencyHistogram h = histogram(segment);
+        append(out, size, &length, "%s\"%s\":{\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}",
+            segment ? "," : "", segmentName(segment),
+            (unsigned long) h.percentile(50), (unsigned long) h.percentile(90),
+            (unsigned long) h.percentile(99), (unsigned long) h.max());
+    }
+    if (!append(out, size, &length, "}}")) {
+        if (size > 0) out[0] = '\0';
+        return 0;
+    }
+    return length;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * CommandTrace - Where a command's time goes, from transport to LEDs
+ *
+ * Each command carries the micros() at which it passed each hop:
+ *
+ *   Received  transport handed over the bytes (WebSocket event, BLE write)
+ *   Parsed    decoded into its pooled document
+ *   Enqueued  pushed into LEDManager's command ring
+ *   Dequeued  taken off the ring by the LED task
+ *   Applied   LEDManager::handleCommand returned
+ *   Shown     FastLED.show() of that frame returned
+ *
+ * CommandTracer keeps rolling histograms of each hop-to-hop segment and of
+ * the total, and formats a per-command trace to echo back when the command
+ * asked for one ({"t":"brightness","brightness":90,"trace":true,"id":7}).
+ *
+ * Off by default. While off, each hop costs one relaxed atomic load and a
+ * branch; built with SR_COMMAND_TRACE=0 the stamps compile away entirely.
+ */
+
+#ifndef SR_COMMAND_TRACE
+#define SR_COMMAND_TRACE 1
+#endif
+
+enum class TraceHop : uint8_t {
+    Received,
+    Parsed,
+    Enqueued,
+    Dequeued,
+    Applied,
+    Shown,
+    Count
+};
+
+struct CommandTrace {
+    static const size_t HOPS = (size_t) TraceHop::Count;
+
+    uint32_t stamps[HOPS] = {};  // micros(); 0 = not stamped
+    uint32_t id = 0;             // Client's "id", echoed back
+    bool echo = false;           // Client asked for the trace ("trace":true)
+    int client = -1;             // Transport's sender (WebSocket client id), gets the replies; -1 = all
+
+    void stamp(TraceHop hop, uint32_t nowUs) {
+        stamps[(size_t) hop] = nowUs ? nowUs : 1;
+    }
+    bool has(TraceHop hop) const { return stamps[(size_t) hop] != 0; }
+    bool active() const { return has(TraceHop::Received); }
+
+    /**
+     * Microseconds from one hop to another, 0 if either is missing
+     */
+    uint32_t between(TraceHop from, TraceHop to) const {
+        if (!has(from) || !has(to)) return 0;
+        return stamps[(size_t) to] - stamps[(size_t) from];
+    }
+};
+
+/**
+ * Power-of-two buckets: bucket i holds [2^i, 2^(i+1)) us, bucket 0 also 0,
+ * the last everything from ~4 s up. Percentiles are bucket upper bounds.
+ */
+class LatencyHistogram {
+public:
+    static const size_t BUCKETS = 24;
+
+    void record(uint32_t us);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint32_t count() const { return _count; }
+    uint32_t max() const { return _max; }
+    uint32_t percentile(uint8_t percent) const;
+    uint32_t bucket(size_t index) const { return index < BUCKETS ? _buckets[index] : 0; }
+
+    static size_t bucketFor(uint32_t us);
+    static uint32_t bucketUpperBound(size_t index);
+
+private:
+    uint32_t _buckets[BUCKETS] = {};
+    uint32_t _count = 0;
+    uint32_t _max = 0;
+};
+
+class CommandTracer {
+public:
+    // Segments between consecutive hops, then the end-to-end total
+    static const size_t SEGMENTS = CommandTrace::HOPS;
+    static const size_t TOTAL = SEGMENTS - 1;
+
+    explicit CommandTracer(uint32_t windowMs = 60000) : _windowMs(windowMs) {}
+
+#if SR_COMMAND_TRACE
+    bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+#else
+    constexpr bool enabled() const { return false; }
+#endif
+    void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+    /**
+     * Add a finished trace (LED task only). Histograms cover the current
+     * window plus the one before it, so they always span at least windowMs.
+     */
+    void record(const CommandTrace& trace, uint32_t nowMs);
+    void reset();
+
+    /**
+     * Current and previous window combined
+     */
+    LatencyHistogram histogram(size_t segment) const;
+
+    static const char* segmentName(size_t segment);
+
+    /**
+     * {"t":"trace","id":7,"us":{"parse":..,"queue":..,"wait":..,"apply":..,"show":..,"total":..}}
+     * Returns the length written, 0 if it did not fit.
+     */
+    static size_t formatTrace(const CommandTrace& trace, char* out, size_t size);
+
+    /**
+     * {"t":"latency","enabled":true,"count":N,"us":{"parse":{"p50":..,"p99":..,"max":..},...}}
+     */
+    size_t formatReport(char* out, size_t size) const;
+
+private:
+    std::atomic<bool> _enabled{false};
+    uint32_t _windowMs;
+    uint32_t _windowStartMs = 0;
+    bool _windowStarted = false;
+    LatencyHistogram _current[SEGMENTS];
+    LatencyHistogram _previous[SEGMENTS];
+};
+
+extern CommandTracer g_commandTracer;
+
+#if SR_COMMAND_TRACE
+#define SR_TRACE_STAMP(trace, hop) \
+    do { if (g_commandTracer.enabled()) (trace).stamp((hop), micros()); } while (0)
+#else
+#define SR_TRACE_STAMP(trace, hop) do { } while (0)
+#endif
@@ -2,6 +2,7 @@
 
 #include <ArduinoJson.h>
 #include <memory>
+#include "CommandTrace.h"
 
 /**
  * ICommandHandler - Interface for command processing
@@ -21,6 +22,19 @@ public:
      */
     virtual bool handleCommand(const JsonObject& command) = 0;
     
+    /**
+     * Handle an array of commands as one unit (see CommandBatch.h)
+     * Default: one after another through handleCommand()
+     * @return true if every command was handled
+     */
+    virtual bool handleCommandBatch(const JsonArray& commands) {
+        bool allHandled = true;
+        for (JsonObject command : commands) {
+            allHandled = handleCommand(command) && allHandled;
+        }
+        return allHandled;
+    }
+    
     /**
      * Check if this handler supports queued command processing
      * @return true if handleQueuedCommand() should be used instead of handleCommand()
@@ -46,6 +60,37 @@ public:
         return false;
     }
     
+    /**
+     * Queued handling with the hops the transport already stamped
+     * (receive, parse). Handlers that do not trace ignore it.
+     */
+    virtual bool handleQueuedCommand(std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace) {
+        (void) trace;
+        return handleQueuedCommand(std::move(doc));
+    }
+    
+    /**
+     * Fetch a reply produced after a queued command ran (e.g. the pre-flight
+     * report for a choreography). Polled by the server; returns false when
+     * nothing is waiting.
+     * @param out Receives the JSON reply
+     * @param client Receives the CommandTrace::client of the command it
+     *               answers (-1: not tied to one sender)
+     */
+    virtual bool takeResponse(String& out, int& client) {
+        (void) out;
+        (void) client;
+        return false;
+    }
+    
+    /**
+     * Number of command batches applied since boot; the server broadcasts
+     * status once each time it moves
+     */
+    virtual uint32_t getBatchesApplied() const {
+        return 0;
+    }
+    
     /**
      * Get current brightness value (0-255)
      * Used for status reporting
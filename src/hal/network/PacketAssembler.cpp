@@ -0,0 +1,185 @@
+#include "PacketAssembler.h"
+#include <algorithm>
+#include <string.h>
+
+PacketAssembler::PacketAssembler(size_t capacity, uint32_t timeoutMs)
+    : _capacity(capacity), _timeoutMs(timeoutMs) {
+    reset();
+}
+
+bool PacketAssembler::isFragment(JsonObjectConst message) {
+    return message.containsKey("_s") && message.containsKey("_p");
+}
+
+bool PacketAssembler::readFragment(JsonObjectConst message, PacketFragment& out) {
+    const long sequence = message["_s"] | 0L;
+    const long total = message["_n"] | 0L;
+    const char* payload = message["_p"].as<const char*>();
+    if (sequence < 1 || sequence > (long) MAX_FRAGMENTS || total < 0 || total > (long) MAX_FRAGMENTS || !payload) {
+        return false;
+    }
+    out.transferId = message["_id"] | 0UL;
+    out.sequence = (uint16_t) sequence;
+    out.total = (uint16_t) total;
+    out.end = message["_e"] | false;
+    out.payload = payload;
+    out.payloadLength = strlen(payload);
+    return true;
+}
+
+void PacketAssembler::reset() {
+    _active = false;
+    _complete = false;
+    _source = 0;
+    _transferId = 0;
+    _total = 0;
+    _received = 0;
+    _highest = 0;
+    _used = 0;
+    for (size_t i = 0; i < MAX_FRAGMENTS; i++) {
+        _parts[i].offset = 0;
+        _parts[i].length = 0;
+        _parts[i].received = false;
+    }
+}
+
+void PacketAssembler::begin(uint8_t source, uint32_t transferId) {
+    reset();
+    if (!_buffer) {
+        // Allocated on the first multi-part transfer, then kept
+        _buffer.reset(new uint8_t[_capacity]);
+    }
+    _active = true;
+    _source = source;
+    _transferId = transferId;
+}
+
+bool PacketAssembler::expire(uint32_t nowMs) {
+    if (_active && !_complete && nowMs - _lastFragmentMs >= _timeoutMs) {
+        _stats.timedOut++;
+        reset();
+        return true;
+    }
+    return false;
+}
+
+bool PacketAssembler::finished() const {
+    // Every one of parts 1.._total, not just that many parts
+    if (_total == 0 || _received < _total) {
+        return false;
+    }
+    for (uint16_t i = 0; i < _total; i++) {
+        if (!_parts[i].received) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FragmentResult PacketAssembler::accept(uint8_t source, const PacketFragment& fragment, uint32_t nowMs) {
+    _stats.fragments++;
+    if (_complete) {
+        reset();  // The last command has been taken
+    }
+    expire(nowMs);
+
+    if (fragment.sequence < 1 || fragment.sequence > MAX_FRAGMENTS || fragment.total > MAX_FRAGMENTS || !fragment.payload ||
+        (fragment.total > 0 && fragment.sequence > fragment.total)) {
+        _stats.rejected++;
+        return FragmentResult::Invalid;
+    }
+
+    if (_active && source != _source) {
+        _stats.rejected++;
+        return FragmentResult::Busy;
+    }
+    if (_active && fragment.transferId != _transferId) {
+        _stats.abandoned++;
+        _active = false;
+    }
+    if (!_active) {
+        begin(source, fragment.transferId);
+    }
+    _lastFragmentMs = nowMs;
+
+    // The part count can come from any part's _n or from the last part's _s
+    const uint16_t total = fragment.total ? fragment.total : (fragment.end ? fragment.sequence : 0);
+    if (total) {
+        if ((_total && _total != total) || _highest > total) {
+            _stats.rejected++;
+            reset();
+            return FragmentResult::Invalid;
+        }
+        _total = total;
+    } else if (_total && fragment.sequence > _total) {
+        // Past the count an earlier part gave; the transfer goes on without it
+        _stats.rejected++;
+        return FragmentResult::Invalid;
+    }
+
+    Part& part = _parts[fragment.sequence - 1];
+    if (part.received) {
+        _stats.duplicates++;
+        return FragmentResult::Duplicate;
+    }
+    if (fragment.payloadLength > 0xFFFF || _used + fragment.payloadLength > _capacity) {
+        _stats.rejected++;
+        reset();
+        return FragmentResult::Overflow;
+    }
+
+    memcpy(_buffer.get() + _used, fragment.payload, fragment.payloadLength);
+    part.offset = (uint32_t) _used;
+    part.length = (uint16_t) fragment.payloadLength;
+    part.received = true;
+    _used += fragment.payloadLength;
+    _received++;
+    if (fragment.sequence > _highest) {
+        _highest = fragment.sequence;
+    }
+
+    if (!finished()) {
+        return FragmentResult::Accepted;
+    }
+    if (putInOrder()) {
+        _stats.reordered++;
+    }
+    _complete = true;
+    _stats.completed++;
+    return FragmentResult::Complete;
+}
+
+bool PacketAssembler::putInOrder() {
+    // Parts sit in arrival order. Rotate each into place in turn: the bytes
+    // it jumps over all belong to later parts, which shift right by its length.
+    bool moved = false;
+    uint32_t position = 0;
+    for (uint16_t i = 0; i < _total; i++) {
+        Part& part = _parts[i];
+        if (part.offset != position) {
+            uint8_t* base = _buffer.get();
+            std::rotate(base + position, base + part.offset, base + part.offset + part.length);
+            for (uint16_t j = i + 1; j < _total; j++) {
+                if (_parts[j].offset >= position && _parts[j].offset < part.offset) {
+                    _parts[j].offset += part.length;
+                }
+            }
+            part.offset = position;
+            moved = true;
+        }
+        position += part.length;
+    }
+    return moved;
+}
+
+const char* PacketAssembler::resultName(FragmentResult result) {
+    switch (result) {
+        case FragmentResult::Accepted: return "accepted";
+        case FragmentResult::Duplicate: return "duplicate";
+        case FragmentResult::Complete: return "complete";
+        case FragmentResult::Busy: return "busy";
+        case FragmentResult::Overflow: return "overflow";
+        case FragmentResult::Invalid: return "invalid";
+    }
+    return "?";
+}
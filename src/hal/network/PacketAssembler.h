@@ -0,0 +1,138 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * PacketAssembler - Reassembles commands sent in parts
+ *
+ * A command larger than one BLE write or WebSocket frame is split by the
+ * client into fragments, each a small JSON object:
+ *
+ *   {"_s":1,"_n":3,"_p":"{\"t\":\"choreography\",..."}   part 1 of 3
+ *   {"_s":2,"_p":"..."}
+ *   {"_s":3,"_e":true,"_p":"...}"}                        last part
+ *
+ *   _s   sequence number, from 1
+ *   _n   number of parts (optional; the "_e":true part's _s also says it)
+ *   _e   last part
+ *   _p   this part of the command text
+ *   _id  transfer id (optional); a new _id from the same source abandons
+ *        the transfer in progress
+ *
+ * Each payload is copied once, in arrival order, into a buffer allocated on
+ * the first transfer and kept. Parts may arrive out of order or twice;
+ * duplicates are dropped, and when the last one is in, out-of-order parts
+ * are put in order in place. The finished command is one contiguous buffer
+ * the transport parses once and queues like any other command.
+ *
+ * Multi-part commands are JSON only. _p is a string (read up to its NUL),
+ * so the reassembled bytes are always parsed as JSON text; the envelope
+ * itself may come in either encoding. A MessagePack command must fit one
+ * write, or be sent as JSON.
+ *
+ * One transfer at a time, tagged with its source (WebSocket client id, 0
+ * for BLE); a transfer idle for longer than timeoutMs is dropped. Not
+ * thread-safe: each transport owns its assembler and calls it from its own
+ * task.
+ */
+
+enum class FragmentResult : uint8_t {
+    Accepted,   // Stored; more parts to come
+    Duplicate,  // Already had this part; ignored
+    Complete,   // All parts in: data()/length() hold the command
+    Busy,       // Another source's transfer is in progress
+    Overflow,   // Too many parts or too many bytes for the buffer
+    Invalid     // Not a usable fragment (bad _s/_n, no _p, _s beyond _n)
+};
+
+struct PacketFragment {
+    uint32_t transferId = 0;  // "_id", 0 when absent
+    uint16_t sequence = 0;    // "_s", from 1
+    uint16_t total = 0;       // "_n", 0 when absent
+    bool end = false;         // "_e"
+    const char* payload = nullptr;
+    size_t payloadLength = 0;
+};
+
+struct PacketAssemblerStats {
+    uint32_t completed = 0;
+    uint32_t fragments = 0;
+    uint32_t duplicates = 0;
+    uint32_t reordered = 0;  // Completed transfers that arrived out of order
+    uint32_t timedOut = 0;
+    uint32_t abandoned = 0;  // Replaced by a new transfer from the same source
+    uint32_t rejected = 0;   // Busy, Overflow or Invalid
+};
+
+class PacketAssembler {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16384;
+    static constexpr size_t MAX_FRAGMENTS = 128;
+
+    explicit PacketAssembler(size_t capacity = DEFAULT_CAPACITY, uint32_t timeoutMs = 5000);
+
+    /**
+     * True when a parsed message is a fragment rather than a command
+     */
+    static bool isFragment(JsonObjectConst message);
+
+    /**
+     * Read the envelope fields; payload points into message's document.
+     * False if required fields are missing or out of range.
+     */
+    static bool readFragment(JsonObjectConst message, PacketFragment& out);
+
+    /**
+     * Store one fragment. After Complete, data()/length() stay valid until
+     * the next accept() or reset().
+     */
+    FragmentResult accept(uint8_t source, const PacketFragment& fragment, uint32_t nowMs);
+
+    /**
+     * Drop the transfer in progress if it has been idle too long. Returns
+     * true if one was dropped.
+     */
+    bool expire(uint32_t nowMs);
+
+    void reset();
+
+    bool inProgress() const { return _active; }
+    uint8_t source() const { return _source; }
+    const uint8_t* data() const { return _buffer.get(); }
+    size_t length() const { return _complete ? _used : 0; }
+    size_t capacity() const { return _capacity; }
+    const PacketAssemblerStats& getStats() const { return _stats; }
+
+    static const char* resultName(FragmentResult result);
+
+private:
+    struct Part {
+        uint32_t offset;
+        uint16_t length;
+        bool received;
+    };
+
+    void begin(uint8_t source, uint32_t transferId);
+    bool finished() const;
+    bool putInOrder();  // Returns true if anything had to move
+
+    std::unique_ptr<uint8_t[]> _buffer;
+    size_t _capacity;
+    uint32_t _timeoutMs;
+
+    bool _active = false;
+    bool _complete = false;
+    uint8_t _source = 0;
+    uint32_t _transferId = 0;
+    uint16_t _total = 0;       // 0 until known
+    uint16_t _received = 0;
+    uint16_t _highest = 0;     // Largest sequence seen
+    size_t _used = 0;
+    uint32_t _lastFragmentMs = 0;
+    Part _parts[MAX_FRAGMENTS];
+
+    PacketAssemblerStats _stats;
+};
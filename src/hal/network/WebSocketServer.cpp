@@ -6,10 +6,18 @@
 #include "../PatternManager.h"
 #include "DeviceState.h"
 #include "DeviceInfo.h"
+#include "CommandDocPool.h"
+#include "CommandTrace.h"
+#include "lights/CommandBatch.h"
+#include <string.h>
 
 SRWebSocketServer::SRWebSocketServer(ICommandHandler* commandHandler, uint16_t port) 
-    : _commandHandler(commandHandler), _port(port), _isRunning(false), _lastStatusUpdate(0) {
+    : _commandHandler(commandHandler), _port(port), _isRunning(false), _lastStatusUpdate(0),
+      _binaryLength(0), _lastBatchesApplied(0) {
     _wsServer = nullptr;
+    for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+        _clientEncoding[i] = CommandEncoding::Json;
+    }
 }
 
 SRWebSocketServer::~SRWebSocketServer() {
@@ -91,6 +99,34 @@ void SRWebSocketServer::update() {
         return;
     }
     
+    // A multi-part command whose sender went quiet
+    if (_assembler.expire(millis())) {
+        LOG_WARNF_COMPONENT("WebSocketServer", "Multi-part command from client %d timed out", _assembler.source());
+    }
+
+    // Replies the handler produced after running a queued command (e.g. choreography
+    // pre-flight), each to the client that sent that command
+    String response;
+    int client = -1;
+    while (_commandHandler && _commandHandler->takeResponse(response, client)) {
+        if (client < 0) {
+            broadcastMessage(response);
+        } else if (canSendToClient((uint8_t) client)) {
+            sendToClient((uint8_t) client, response);
+        }
+    }
+    
+    // One status broadcast per applied command batch, however many commands it held
+    if (_commandHandler) {
+        const uint32_t batches = _commandHandler->getBatchesApplied();
+        if (batches != _lastBatchesApplied) {
+            _lastBatchesApplied = batches;
+            if (getConnectedClients() > 0) {
+                broadcastStatus();
+            }
+        }
+    }
+    
     // Handle periodic status updates (every 5 seconds)
     unsigned long now = millis();
     if (now - _lastStatusUpdate > 5000) {
@@ -174,6 +210,24 @@ void SRWebSocketServer::broadcastMessage(const String& message) {
         return;
     }
     
+    // MessagePack clients need their own copy; everyone else still shares one broadcast
+    bool anyBinary = false;
+    for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+        anyBinary = anyBinary || _clientEncoding[i] == CommandEncoding::MsgPack;
+    }
+    if (anyBinary && encodeBinary(message)) {
+        for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+            if (!canSendToClient(i)) continue;
+            if (_clientEncoding[i] == CommandEncoding::MsgPack) {
+                _wsServer->sendBIN(i, _binaryBuffer.data(), _binaryLength);
+            } else {
+                _wsServer->sendTXT(i, message.c_str(), message.length());
+            }
+        }
+        LOG_DEBUGF_COMPONENT("WebSocketServer", "Broadcasted message to %d clients (mixed encodings)", clientCount);
+        return;
+    }
+    
     try {
         // CRITICAL: Check return value - broadcastTXT returns false on failure
         bool success = _wsServer->broadcastTXT(message.c_str(), message.length());
@@ -221,9 +275,13 @@ void SRWebSocketServer::sendToClient(uint8_t clientId, const String& message) {
         return;
     }
     
+    // Clients that said hello with msgpack get replies as binary frames
+    const bool binary = clientEncoding(clientId) == CommandEncoding::MsgPack && encodeBinary(message);
+    
     try {
-        // CRITICAL: Check return value - sendTXT returns false on failure
-        bool success = _wsServer->sendTXT(clientId, message.c_str(), message.length());
+        // CRITICAL: Check return value - sendTXT/sendBIN return false on failure
+        bool success = binary ? _wsServer->sendBIN(clientId, _binaryBuffer.data(), _binaryLength)
+                              : _wsServer->sendTXT(clientId, message.c_str(), message.length());
         if (success) {
             LOG_DEBUGF_COMPONENT("WebSocketServer", "Sent message to client %d", clientId);
         } else {
@@ -245,6 +303,10 @@ void SRWebSocketServer::handleWebSocketEvent(uint8_t clientId, WStype_t type, ui
             LOG_DEBUGF_COMPONENT("WebSocketServer", "WebSocket client %d disconnected (total: %d)", 
                 clientId, getConnectedClients());
             // Don't call any _wsServer methods here - library is cleaning up
+            setClientEncoding(clientId, CommandEncoding::Json);
+            if (_assembler.inProgress() && _assembler.source() == clientId) {
+                _assembler.reset();
+            }
             break;
             
         case WStype_CONNECTED:
@@ -255,12 +317,18 @@ void SRWebSocketServer::handleWebSocketEvent(uint8_t clientId, WStype_t type, ui
             // CRITICAL: Delay sending status update to avoid race conditions
             // The library might still be setting up the connection
             // sendToClient() will verify the client is connected first
+            setClientEncoding(clientId, CommandEncoding::Json);  // Until the client says hello
             sendStatusUpdate(clientId);
             break;
             
         case WStype_TEXT:
             LOG_DEBUGF_COMPONENT("WebSocketServer", "WebSocket text message received from client %d", clientId);
-            processMessage(clientId, String((char*)payload));
+            processMessage(clientId, payload, length, CommandEncoding::Json);
+            break;
+            
+        case WStype_BIN:
+            LOG_DEBUGF_COMPONENT("WebSocketServer", "WebSocket binary message received from client %d", clientId);
+            processMessage(clientId, payload, length, CommandCodec::detect(payload, length));
             break;
             
         case WStype_ERROR:
@@ -271,69 +339,87 @@ void SRWebSocketServer::handleWebSocketEvent(uint8_t clientId, WStype_t type, ui
     }
 }
 
-void SRWebSocketServer::processMessage(uint8_t clientId, const String& message) {
+void SRWebSocketServer::processMessage(uint8_t clientId, const uint8_t* message, size_t length, CommandEncoding encoding) {
     unsigned long startTime = micros();
-    // LOG_DEBUGF("Received message from client %d: %s", clientId, message.c_str());
-    LOG_DEBUGF_COMPONENT("WebSocketServer", "Received message from client %d: %d bytes", clientId, message.length());
+    CommandTrace trace;
+    trace.client = clientId;  // Replies to this command come back here
+    SR_TRACE_STAMP(trace, TraceHop::Received);
+    LOG_DEBUGF_COMPONENT("WebSocketServer", "Received %s message from client %d: %d bytes",
+        CommandCodec::encodingName(encoding), clientId, length);
     
-    // Parse JSON message
-    // static DynamicJsonDocument doc(1024);
-    std::shared_ptr<DynamicJsonDocument> doc = std::make_shared<DynamicJsonDocument>(1024);
+    // Decode into a pooled document (no per-message allocation)
+    DeserializationError error;
+    std::shared_ptr<DynamicJsonDocument> doc = g_commandDocPool.parse(message, length, encoding, error);
     if (!doc) {
-        LOG_ERROR_COMPONENT("WebSocketServer", "Failed to allocate memory for JSON document");
-        sendToClient(clientId, "{\"error\":\"Failed to allocate memory for JSON document\"}");
+        LOG_ERRORF_COMPONENT("WebSocketServer", "%s parse failed: %s", CommandCodec::encodingName(encoding), error.c_str());
+        if (error == DeserializationError::NoMemory) {
+            sendToClient(clientId, "{\"error\":\"Failed to allocate memory for JSON document\"}");
+        } else {
+            sendToClient(clientId, "{\"error\":\"Invalid JSON\"}");
+        }
         return;
     }
-    DeserializationError error = deserializeJson(*doc, message);
     
-    if (error) {
-        LOG_ERRORF_COMPONENT("WebSocketServer", "JSON parse failed: %s", error.c_str());
-        sendToClient(clientId, "{\"error\":\"Invalid JSON\"}");
+    JsonObject root = doc->as<JsonObject>();
+    if (PacketAssembler::isFragment(root)) {
+        handleFragment(clientId, root);
         return;
     }
+    SR_TRACE_STAMP(trace, TraceHop::Parsed);
     
-    JsonObject root = doc->as<JsonObject>();
+    if (CommandBatch::isBatch(doc->as<JsonVariantConst>())) {
+        handleBatch(clientId, std::move(doc), trace);
+        return;
+    }
 
-    LOG_DEBUGF_COMPONENT("WebSocketServer", "Took %lu us to parse JSON", micros() - startTime);
-    
-    // Handle different command types - support both "type" and "t" (compact format)
-    String type;
-    if (root.containsKey("type")) {
-        type = root["type"].as<String>();
-    } else if (root.containsKey("t")) {
-        type = root["t"].as<String>();
-    } else {
+    LOG_DEBUGF_COMPONENT("WebSocketServer", "Took %lu us to parse %s", micros() - startTime, CommandCodec::encodingName(encoding));
+    
+    // Handle different command types - support both "type" and "t" (compact format).
+    // Compared in place, the type never becomes a String.
+    const char* type = root["type"].as<const char*>();
+    if (!type) {
+        type = root["t"].as<const char*>();
+    }
+    if (!type) {
         LOG_WARN_COMPONENT("WebSocketServer", "Message missing 'type' or 't' field");
         sendToClient(clientId, "{\"error\":\"Missing 'type' or 't' field\"}");
         return;
     }
     
-    if (type == "effect") {
+    if (strcmp(type, "effect") == 0 || strcmp(type, "choreography") == 0 || strcmp(type, "choreo") == 0 ||
+        strcmp(type, "choreo_seek") == 0 || strcmp(type, "choreo_bake") == 0 ||
+        strcmp(type, "choreo_queue") == 0 || strcmp(type, "choreo_skip") == 0 || strcmp(type, "choreo_clear") == 0 ||
+        strcmp(type, "speed") == 0 || strcmp(type, "effect_params") == 0 || strcmp(type, "latency") == 0 ||
+        (strcmp(type, "brightness") == 0 && _commandHandler && _commandHandler->supportsQueuing())) {
+        // Brightness, speed and effect_params coalesce in the queue (latest wins), so a
+        // slider drag no longer fills it with stale values
         // Route to command handler
         if (_commandHandler) {
             LOG_DEBUGF_COMPONENT("WebSocketServer", "Command handler supports queuing: %s", _commandHandler->supportsQueuing() ? "true" : "false");
             // Use queued command if handler supports it (for thread-safe processing)
             if (_commandHandler->supportsQueuing()) {
                 LOG_DEBUGF_COMPONENT("WebSocketServer", "Handling queued command");
-                _commandHandler->handleQueuedCommand(doc);
+                _commandHandler->handleQueuedCommand(std::move(doc), trace);
             } else {
                 // Direct command handling for handlers that don't support queuing
                 _commandHandler->handleCommand(root);
             }
         }
-    } else if (type == "brightness") {
+    } else if (strcmp(type, "brightness") == 0) {
         handleBrightnessCommand(root);
-    } else if (type == "next_effect") {
+    } else if (strcmp(type, "hello") == 0) {
+        handleHelloCommand(clientId, root);
+    } else if (strcmp(type, "next_effect") == 0) {
         // Cycle to next effect via PatternManager
         TriggerNextEffect();
         sendToClient(clientId, "{\"status\":\"next_effect_triggered\"}");
-    } else if (type == "status") {
+    } else if (strcmp(type, "status") == 0) {
         handleStatusCommand(clientId);
-    } else if (type == "trigger_choreography") {
+    } else if (strcmp(type, "trigger_choreography") == 0) {
         TriggerChoreography();
         sendToClient(clientId, "{\"status\":\"choreography_triggered\"}");
     } else {
-        LOG_WARNF_COMPONENT("WebSocketServer", "Unknown command type: %s", type.c_str());
+        LOG_WARNF_COMPONENT("WebSocketServer", "Unknown command type: %s", type);
         sendToClient(clientId, "{\"error\":\"Unknown command type\"}");
     }
     
@@ -342,6 +428,61 @@ void SRWebSocketServer::processMessage(uint8_t clientId, const String& message)
     SaveUserPreferences(deviceState);
 }
 
+void SRWebSocketServer::handleBatch(uint8_t clientId, std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace) {
+    // [{...},{...}]: checked here so the sender hears about a bad entry, then
+    // queued whole; the handler saves preferences once when it applies it
+    size_t badIndex = 0;
+    const BatchCheck check = CommandBatch::check(doc->as<JsonArrayConst>(), &badIndex);
+    if (check != BatchCheck::Ok) {
+        LOG_WARNF_COMPONENT("WebSocketServer", "Rejected command batch from client %d: %s", clientId, CommandBatch::checkName(check));
+        char reply[80];
+        snprintf(reply, sizeof(reply), "{\"error\":\"Invalid batch: %s\",\"index\":%u}",
+            CommandBatch::checkName(check), (unsigned) badIndex);
+        sendToClient(clientId, reply);
+        return;
+    }
+    if (!_commandHandler) {
+        return;
+    }
+    LOG_DEBUGF_COMPONENT("WebSocketServer", "Queuing batch of %d commands", doc->as<JsonArrayConst>().size());
+    if (_commandHandler->supportsQueuing()) {
+        _commandHandler->handleQueuedCommand(std::move(doc), trace);
+    } else {
+        _commandHandler->handleCommandBatch(doc->as<JsonArray>());
+    }
+}
+
+void SRWebSocketServer::handleFragment(uint8_t clientId, const JsonObject& fragment) {
+    PacketFragment part;
+    if (!PacketAssembler::readFragment(fragment, part)) {
+        sendToClient(clientId, "{\"error\":\"Invalid fragment\"}");
+        return;
+    }
+    const FragmentResult result = _assembler.accept(clientId, part, millis());
+    switch (result) {
+        case FragmentResult::Accepted:
+        case FragmentResult::Duplicate:
+            return;
+        case FragmentResult::Complete:
+            LOG_DEBUGF_COMPONENT("WebSocketServer", "Multi-part command from client %d complete: %d bytes",
+                clientId, _assembler.length());
+            // Parsed once from the assembly buffer; the pooled document copies what it keeps.
+            // Always JSON: fragments carry text (see PacketAssembler.h).
+            processMessage(clientId, _assembler.data(), _assembler.length(), CommandEncoding::Json);
+            _assembler.reset();
+            return;
+        default: {
+            LOG_WARNF_COMPONENT("WebSocketServer", "Fragment %d from client %d rejected: %s",
+                part.sequence, clientId, PacketAssembler::resultName(result));
+            char reply[64];
+            snprintf(reply, sizeof(reply), "{\"error\":\"Fragment %s\",\"_s\":%u}",
+                PacketAssembler::resultName(result), (unsigned) part.sequence);
+            sendToClient(clientId, reply);
+            return;
+        }
+    }
+}
+
 void SRWebSocketServer::processLEDCommand(const JsonObject& doc) {
     if (!_commandHandler) return;
     _commandHandler->handleCommand(doc);
@@ -364,11 +505,9 @@ void SRWebSocketServer::handleBrightnessCommand(const JsonObject& command) {
     if (command.containsKey("brightness")) {
         int brightness = command["brightness"];
         // Route brightness command through the handler interface
-        // LEDManager will handle it appropriately, other handlers can ignore or handle as needed
-        DynamicJsonDocument brightnessCmd(64);
-        brightnessCmd["type"] = "brightness";
-        brightnessCmd["brightness"] = brightness;
-        _commandHandler->handleCommand(brightnessCmd.as<JsonObject>());
+        // LEDManager will handle it appropriately, other handlers can ignore or handle as needed.
+        // The parsed message already carries type/t "brightness", so it goes as is.
+        _commandHandler->handleCommand(command);
         
         // Update the brightness controller (LEDManager-specific, but safe to call)
         BrightnessController* brightnessController = BrightnessController::getInstance();
@@ -383,6 +522,53 @@ void SRWebSocketServer::handleStatusCommand(uint8_t clientId) {
     sendStatusUpdate(clientId);
 }
 
+void SRWebSocketServer::handleHelloCommand(uint8_t clientId, const JsonObject& command) {
+    // {"t":"hello","encoding":"msgpack"} - replies to this client switch encoding
+    CommandEncoding encoding = CommandEncoding::Json;
+    const char* requested = command["encoding"] | "json";
+    if (!CommandCodec::encodingFromName(requested, encoding)) {
+        LOG_WARNF_COMPONENT("WebSocketServer", "Client %d asked for unknown encoding '%s'", clientId, requested);
+        sendToClient(clientId, "{\"error\":\"Unknown encoding\"}");
+        return;
+    }
+    setClientEncoding(clientId, encoding);
+    LOG_INFOF_COMPONENT("WebSocketServer", "Client %d uses %s", clientId, CommandCodec::encodingName(encoding));
+    
+    StaticJsonDocument<96> reply;
+    reply["type"] = "hello";
+    reply["encoding"] = CommandCodec::encodingName(encoding);
+    String message;
+    serializeJson(reply, message);
+    sendToClient(clientId, message);
+}
+
+CommandEncoding SRWebSocketServer::clientEncoding(uint8_t clientId) const {
+    return clientId < WEBSOCKETS_SERVER_CLIENT_MAX ? _clientEncoding[clientId] : CommandEncoding::Json;
+}
+
+void SRWebSocketServer::setClientEncoding(uint8_t clientId, CommandEncoding encoding) {
+    if (clientId < WEBSOCKETS_SERVER_CLIENT_MAX) {
+        _clientEncoding[clientId] = encoding;
+    }
+}
+
+bool SRWebSocketServer::encodeBinary(const String& json) {
+    // Replies are rare (status, errors, pre-flight), so re-encoding the JSON text is fine
+    DeserializationError error;
+    std::shared_ptr<DynamicJsonDocument> doc = g_commandDocPool.parse(json.c_str(), json.length(), error);
+    if (!doc) {
+        LOG_WARNF_COMPONENT("WebSocketServer", "Cannot re-encode reply as msgpack: %s", error.c_str());
+        return false;
+    }
+    const size_t needed = CommandCodec::measure(doc->as<JsonVariantConst>(), CommandEncoding::MsgPack);
+    if (_binaryBuffer.size() < needed) {
+        _binaryBuffer.resize(needed);
+    }
+    _binaryLength = CommandCodec::encode(doc->as<JsonVariantConst>(), CommandEncoding::MsgPack,
+                                         _binaryBuffer.data(), _binaryBuffer.size());
+    return _binaryLength > 0;
+}
+
 String SRWebSocketServer::generateStatusJSON() const {
     DynamicJsonDocument doc(512);
     
@@ -4,6 +4,9 @@
 #include "freertos/LogManager.h"
 #include <WebSocketsServer.h>
 #include "ICommandHandler.h"
+#include "CommandCodec.h"
+#include "PacketAssembler.h"
+#include <vector>
 
 /**
  * SRWebSocketServer - Self-contained WebSocket server for command control
@@ -41,10 +44,17 @@ private:
     bool _isRunning;
     // REMOVED: uint8_t _connectedClients;  // No manual tracking - query library directly
     unsigned long _lastStatusUpdate;
+    CommandEncoding _clientEncoding[WEBSOCKETS_SERVER_CLIENT_MAX];  // Reply encoding chosen by "hello"
+    std::vector<uint8_t> _binaryBuffer;  // Last reply re-encoded as MessagePack
+    size_t _binaryLength;
+    PacketAssembler _assembler;  // Multi-part commands, one sender at a time
+    uint32_t _lastBatchesApplied;  // Handler's batch count at the last status broadcast
     
     // WebSocket event handling
     void handleWebSocketEvent(uint8_t clientId, WStype_t type, uint8_t* payload, size_t length);
-    void processMessage(uint8_t clientId, const String& message);
+    void processMessage(uint8_t clientId, const uint8_t* message, size_t length, CommandEncoding encoding);
+    void handleFragment(uint8_t clientId, const JsonObject& fragment);
+    void handleBatch(uint8_t clientId, std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace);
     void processLEDCommand(const JsonObject& command);
     void sendStatusUpdate(uint8_t clientId);
     
@@ -52,6 +62,12 @@ private:
     void handleEffectCommand(const JsonObject& command);
     void handleBrightnessCommand(const JsonObject& command);
     void handleStatusCommand(uint8_t clientId);
+    void handleHelloCommand(uint8_t clientId, const JsonObject& command);
+    
+    // Per-connection encoding
+    CommandEncoding clientEncoding(uint8_t clientId) const;
+    void setClientEncoding(uint8_t clientId, CommandEncoding encoding);
+    bool encodeBinary(const String& json);
     
     // Status generation
     String generateStatusJSON() const;
@@ -0,0 +1,323 @@
+#include "BakedFrames.h"
+#include <string.h>
+
+static const uint8_t FRAME_KEYFRAME = 0x01;
+static const size_t FRAME_HEADER_SIZE = 6;
+// Runs shorter than this are cheaper as literals
+static const int MIN_RUN = 3;
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t) (v >> (8 * i));
+    }
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static bool samePixel(const uint8_t* a, const uint8_t* b) {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+
+bool BakedFrameWriter::begin(BakedFrameSink* out, int leds, uint16_t framesPerSecond, uint16_t interval) {
+    sink = out;
+    numLEDs = leds;
+    fps = framesPerSecond ? framesPerSecond : 30;
+    keyframeInterval = interval ? interval : fps;
+    frames = 0;
+    offset = 0;
+    failed = !sink || numLEDs <= 0;
+    previous.assign((size_t) numLEDs * 3, 0);
+    payload.clear();
+    payload.reserve((size_t) numLEDs * 3 + 16);
+    index.clear();
+    return !failed && writeHeader();
+}
+
+bool BakedFrameWriter::writeHeader() {
+    uint8_t header[BAKED_HEADER_SIZE] = {};
+    memcpy(header, "SRBK", 4);
+    put16(header + 4, BAKED_FILE_VERSION);
+    put16(header + 6, fps);
+    put32(header + 8, (uint32_t) numLEDs);
+    put32(header + 12, frames);
+    put32(header + 16, (uint32_t) ((uint64_t) frames * 1000 / fps));
+    put32(header + 20, index.empty() ? 0 : offset);
+    put32(header + 24, (uint32_t) index.size());
+    put16(header + 28, keyframeInterval);
+    return write(header, sizeof(header));
+}
+
+bool BakedFrameWriter::write(const uint8_t* data, size_t length) {
+    if (failed) return false;
+    if (!sink->write(data, length)) {
+        failed = true;
+        return false;
+    }
+    offset += (uint32_t) length;
+    return true;
+}
+
+void BakedFrameWriter::putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        payload.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    payload.push_back((uint8_t) value);
+}
+
+void BakedFrameWriter::encode(const uint8_t* rgb, const uint8_t* ref) {
+    static const uint8_t BLACK[3] = {0, 0, 0};
+    payload.clear();
+    int i = 0;
+    while (i < numLEDs) {
+        int skip = 0;
+        while (i < numLEDs && samePixel(rgb + i * 3, ref ? ref + i * 3 : BLACK)) {
+            i++;
+            skip++;
+        }
+        if (i >= numLEDs) break;  // Trailing unchanged pixels are implicit
+
+        int run = 1;
+        while (i + run < numLEDs && samePixel(rgb + (i + run) * 3, rgb + i * 3)) {
+            run++;
+        }
+        putVarint((uint32_t) skip);
+        if (run >= MIN_RUN) {
+            putVarint(((uint32_t) run << 1) | 1);
+            payload.insert(payload.end(), rgb + i * 3, rgb + i * 3 + 3);
+            i += run;
+            continue;
+        }
+
+        // Literal span: up to the next unchanged pixel or the start of a run
+        int end = i;
+        while (end < numLEDs && !samePixel(rgb + end * 3, ref ? ref + end * 3 : BLACK)) {
+            int ahead = 1;
+            while (ahead < MIN_RUN && end + ahead < numLEDs && samePixel(rgb + (end + ahead) * 3, rgb + end * 3)) {
+                ahead++;
+            }
+            if (ahead >= MIN_RUN && end > i) break;
+            end++;
+        }
+        putVarint((uint32_t) (end - i) << 1);
+        payload.insert(payload.end(), rgb + i * 3, rgb + end * 3);
+        i = end;
+    }
+}
+
+bool BakedFrameWriter::addFrame(const uint8_t* rgb, uint8_t brightness) {
+    if (failed || !rgb) return false;
+
+    const bool keyframe = frames % keyframeInterval == 0;
+    if (keyframe) {
+        BakedKeyframe entry;
+        entry.timeMs = (uint32_t) ((uint64_t) frames * 1000 / fps);
+        entry.frame = frames;
+        entry.offset = offset;
+        index.push_back(entry);
+    }
+    encode(rgb, keyframe ? nullptr : previous.data());
+
+    uint8_t frameHeader[FRAME_HEADER_SIZE];
+    frameHeader[0] = keyframe ? FRAME_KEYFRAME : 0;
+    frameHeader[1] = brightness;
+    put32(frameHeader + 2, (uint32_t) payload.size());
+    if (!write(frameHeader, sizeof(frameHeader)) || !write(payload.data(), payload.size())) {
+        return false;
+    }
+    memcpy(previous.data(), rgb, previous.size());
+    frames++;
+    return true;
+}
+
+bool BakedFrameWriter::finish() {
+    if (failed) return false;
+    const uint32_t indexOffset = offset;
+    for (const BakedKeyframe& entry : index) {
+        uint8_t record[12];
+        put32(record, entry.timeMs);
+        put32(record + 4, entry.frame);
+        put32(record + 8, entry.offset);
+        if (!write(record, sizeof(record))) return false;
+    }
+    if (!sink->seek(0)) {
+        failed = true;
+        return false;
+    }
+    // writeHeader() records offset as the index position
+    const uint32_t end = offset;
+    offset = indexOffset;
+    bool ok = writeHeader();
+    offset = end;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+bool BakedFrameReader::open(BakedFrameSource* src) {
+    close();
+    if (!src || !src->seek(0)) return false;
+    source = src;
+
+    uint8_t header[BAKED_HEADER_SIZE];
+    if (!readBytes(header, sizeof(header)) || memcmp(header, "SRBK", 4) != 0 ||
+        get16(header + 4) != BAKED_FILE_VERSION) {
+        close();
+        return false;
+    }
+    fps = get16(header + 6);
+    numLEDs = (int) get32(header + 8);
+    frameCount = get32(header + 12);
+    durationMs = get32(header + 16);
+    const uint32_t indexOffset = get32(header + 20);
+    const uint32_t indexCount = get32(header + 24);
+    if (fps == 0 || numLEDs <= 0 || indexCount == 0 || !jumpTo(indexOffset)) {
+        close();  // An unfinished bake has no index
+        return false;
+    }
+
+    index.resize(indexCount);
+    for (BakedKeyframe& entry : index) {
+        uint8_t record[12];
+        if (!readBytes(record, sizeof(record))) {
+            close();
+            return false;
+        }
+        entry.timeMs = get32(record);
+        entry.frame = get32(record + 4);
+        entry.offset = get32(record + 8);
+    }
+    nextFrame = 0;
+    return jumpTo(BAKED_HEADER_SIZE);
+}
+
+void BakedFrameReader::close() {
+    source = nullptr;
+    index.clear();
+    bufferLen = bufferPos = 0;
+    nextFrame = 0;
+}
+
+uint32_t BakedFrameReader::frameAtMs(uint32_t timeMs) const {
+    uint32_t frame = (uint32_t) ((uint64_t) timeMs * fps / 1000);
+    return frameCount && frame >= frameCount ? frameCount - 1 : frame;
+}
+
+bool BakedFrameReader::jumpTo(uint32_t fileOffset) {
+    bufferLen = bufferPos = 0;
+    return source && source->seek(fileOffset);
+}
+
+int BakedFrameReader::getByte() {
+    if (bufferPos >= bufferLen) {
+        bufferLen = source ? source->read(buffer, READ_BUFFER_SIZE) : 0;
+        bufferPos = 0;
+        if (bufferLen == 0) return -1;
+    }
+    consumed++;
+    return buffer[bufferPos++];
+}
+
+bool BakedFrameReader::readBytes(uint8_t* out, size_t length) {
+    while (length > 0) {
+        if (bufferPos >= bufferLen) {
+            if (getByte() < 0) return false;
+            bufferPos--;
+            consumed--;
+        }
+        size_t n = bufferLen - bufferPos;
+        if (n > length) n = length;
+        memcpy(out, buffer + bufferPos, n);
+        bufferPos += n;
+        consumed += (uint32_t) n;
+        out += n;
+        length -= n;
+    }
+    return true;
+}
+
+bool BakedFrameReader::readVarint(uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = getByte();
+        if (c < 0) return false;
+        value |= (uint32_t) (c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+bool BakedFrameReader::readFrame(uint8_t* rgb, uint8_t* brightness) {
+    if (!source || nextFrame >= frameCount) return false;
+
+    uint8_t frameHeader[FRAME_HEADER_SIZE];
+    if (!readBytes(frameHeader, sizeof(frameHeader))) return false;
+    const uint32_t length = get32(frameHeader + 2);
+    if (frameHeader[0] & FRAME_KEYFRAME) {
+        memset(rgb, 0, (size_t) numLEDs * 3);
+    }
+    if (brightness) *brightness = frameHeader[1];
+
+    consumed = 0;
+    uint32_t pixel = 0;
+    while (consumed < length) {
+        uint32_t skip, op;
+        if (!readVarint(skip) || !readVarint(op)) return false;
+        pixel += skip;
+        const uint32_t count = op >> 1;
+        if (pixel + count > (uint32_t) numLEDs) return false;  // Corrupt frame
+        uint8_t* dst = rgb + pixel * 3;
+        if (op & 1) {
+            uint8_t color[3];
+            if (!readBytes(color, 3)) return false;
+            for (uint32_t i = 0; i < count; i++, dst += 3) {
+                dst[0] = color[0];
+                dst[1] = color[1];
+                dst[2] = color[2];
+            }
+        } else if (!readBytes(dst, count * 3)) {
+            return false;
+        }
+        pixel += count;
+    }
+    nextFrame++;
+    return consumed == length;
+}
+
+bool BakedFrameReader::seekFrame(uint32_t frame, uint8_t* rgb, uint8_t* brightness) {
+    if (!source || frame >= frameCount) return false;
+
+    const BakedKeyframe* key = nullptr;
+    size_t lo = 0, hi = index.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (index[mid].frame <= frame) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0) key = &index[lo - 1];
+    if (!key) return false;
+    // Decoding on from the current frame beats a jump unless a keyframe is in between
+    if (nextFrame == 0 || frame < nextFrame || key->frame >= nextFrame) {
+        if (!jumpTo(key->offset)) return false;
+        nextFrame = key->frame;
+    }
+    while (nextFrame <= frame) {
+        if (!readFrame(rgb, brightness)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Baked show files - a choreography rendered ahead of time into frames
+ *
+ * Layout (all integers little-endian):
+ *
+ *   header    32 bytes: "SRBK", version u16, fps u16, numLEDs u32,
+ *             frameCount u32, durationMs u32, indexOffset u32,
+ *             indexCount u32, keyframeInterval u16, reserved u16
+ *   frames    flags u8 (bit 0 = keyframe), brightness u8, payload length u32,
+ *             then payload ops until the length is used up:
+ *               varint skip               pixels unchanged from the reference
+ *               varint (count << 1 | run) run: one RGB repeated count times
+ *                                         literal: count RGB triplets
+ *             A keyframe's reference is black, any other frame's is the
+ *             previous frame. Pixels after the last op are unchanged.
+ *   index     indexCount x {timeMs u32, frame u32, offset u32}, one per keyframe
+ *
+ * Frames are RGB byte triplets, the same layout as Light/CRGB, so the device
+ * can hand the frame buffer straight to an effect.
+ */
+
+static constexpr uint16_t BAKED_FILE_VERSION = 1;
+static constexpr size_t BAKED_HEADER_SIZE = 32;
+
+// Output of a bake: the writer only needs sequential writes plus one seek
+// back to fill in the header
+class BakedFrameSink {
+public:
+    virtual ~BakedFrameSink() = default;
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+    virtual bool seek(uint32_t offset) = 0;
+};
+
+class BakedFrameSource {
+public:
+    virtual ~BakedFrameSource() = default;
+    virtual size_t read(uint8_t* data, size_t length) = 0;
+    virtual bool seek(uint32_t offset) = 0;
+};
+
+struct BakedKeyframe {
+    uint32_t timeMs;
+    uint32_t frame;
+    uint32_t offset;
+};
+
+class BakedFrameWriter {
+public:
+    /**
+     * Start a file of numLEDs-pixel frames at fps. A keyframe is written
+     * every keyframeInterval frames (0 = once per second); seeking decodes
+     * at most that many frames.
+     */
+    bool begin(BakedFrameSink* sink, int numLEDs, uint16_t fps, uint16_t keyframeInterval = 0);
+    bool addFrame(const uint8_t* rgb, uint8_t brightness);
+    // Write the keyframe index and patch the header
+    bool finish();
+
+    uint32_t frameCount() const { return frames; }
+    uint32_t bytesWritten() const { return offset; }
+    uint32_t keyframeCount() const { return (uint32_t) index.size(); }
+
+private:
+    void encode(const uint8_t* rgb, const uint8_t* ref);
+    void putVarint(uint32_t value);
+    bool write(const uint8_t* data, size_t length);
+    bool writeHeader();
+
+    BakedFrameSink* sink = nullptr;
+    int numLEDs = 0;
+    uint16_t fps = 30;
+    uint16_t keyframeInterval = 30;
+    uint32_t frames = 0;
+    uint32_t offset = 0;
+    bool failed = false;
+    std::vector<uint8_t> previous;
+    std::vector<uint8_t> payload;
+    std::vector<BakedKeyframe> index;
+};
+
+class BakedFrameReader {
+public:
+    bool open(BakedFrameSource* source);
+    void close();
+    bool isOpen() const { return source != nullptr; }
+
+    int getNumLEDs() const { return numLEDs; }
+    uint16_t getFps() const { return fps; }
+    uint32_t getFrameCount() const { return frameCount; }
+    uint32_t getDurationMs() const { return durationMs; }
+    // Next frame readFrame() will produce
+    uint32_t getPosition() const { return nextFrame; }
+    uint32_t frameAtMs(uint32_t timeMs) const;
+
+    /**
+     * Decode the next frame into rgb, which must still hold the previous
+     * frame (numLEDs * 3 bytes). Returns false at the end or on a bad file.
+     */
+    bool readFrame(uint8_t* rgb, uint8_t* brightness = nullptr);
+    /**
+     * Leave frame `frame` in rgb: jumps to the nearest keyframe at or before
+     * it through the index, then decodes forward.
+     */
+    bool seekFrame(uint32_t frame, uint8_t* rgb, uint8_t* brightness = nullptr);
+    bool seekMs(uint32_t timeMs, uint8_t* rgb, uint8_t* brightness = nullptr) {
+        return seekFrame(frameAtMs(timeMs), rgb, brightness);
+    }
+
+private:
+    static constexpr size_t READ_BUFFER_SIZE = 256;
+
+    int getByte();
+    bool readBytes(uint8_t* out, size_t length);
+    bool readVarint(uint32_t& value);
+    bool jumpTo(uint32_t fileOffset);
+
+    BakedFrameSource* source = nullptr;
+    int numLEDs = 0;
+    uint16_t fps = 30;
+    uint32_t frameCount = 0;
+    uint32_t durationMs = 0;
+    uint32_t nextFrame = 0;
+    std::vector<BakedKeyframe> index;
+    uint8_t buffer[READ_BUFFER_SIZE];
+    size_t bufferLen = 0;
+    size_t bufferPos = 0;
+    uint32_t consumed = 0;  // Payload bytes read since the counter was reset
+};
@@ -0,0 +1,212 @@
+#include "ChoreographyAnalyzer.h"
+#include <math.h>
+#include <algorithm>
+
+namespace {
+
+// Cells in the clipped bounding box of a circle of radius r, 0 when off the grid
+int boxCells(float row, float col, float r, int rows, int cols) {
+    int rMin = (int) (row - r), rMax = (int) (row + r);
+    int cMin = (int) (col - r), cMax = (int) (col + r);
+    if (rMin >= rows || rMax < 0 || cMin >= cols || cMax < 0) return 0;
+    rMin = std::max(rMin, 0);
+    cMin = std::max(cMin, 0);
+    rMax = std::min(rMax, rows - 1);
+    cMax = std::min(cMax, cols - 1);
+    return (rMax - rMin + 1) * (cMax - cMin + 1);
+}
+
+}  // namespace
+
+uint32_t ChoreographyAnalyzer::analysisSpan(const CompiledChoreography& show) {
+    if (show.durationMs > 0) return std::min(show.durationMs, MAX_ANALYZE_MS);
+    uint32_t last = 0;
+    for (const ChoreoEvent& event : show.events) {
+        last = std::max(last, event.timeMs);
+    }
+    for (const ChoreoBeat& beat : show.beats) {
+        last = std::max(last, beat.endMs > 0 ? beat.endMs : beat.startMs);
+    }
+    return std::min(last + OPEN_END_TAIL_MS, MAX_ANALYZE_MS);
+}
+
+void ChoreographyAnalyzer::analyze(const CompiledChoreography& show, const ChoreoCostModel& model,
+                                   ChoreoPreflightReport& report) {
+    ChoreographyAnalysis analysis;
+    analysis.begin(show, model);
+    while (analysis.step(UINT32_MAX)) {
+    }
+    report = analysis.getReport();
+}
+
+void ChoreographyAnalysis::begin(const CompiledChoreography& show, const ChoreoCostModel& costModel) {
+    model = costModel;
+    report = ChoreoPreflightReport();
+    ringVoices.init(model.ringVoices, model.stealPolicy);
+    pulseVoices.init(model.pulseVoices, model.stealPolicy);
+    rings.assign(ringVoices.size(), SimRing());
+    pulses.assign(pulseVoices.size(), SimPulse());
+    scheduler.start(show);
+
+    maxRadius = sqrtf((float) (model.rows * model.rows + model.cols * model.cols));
+    frameMs = model.frameMs > 0.0f ? model.frameMs : 1000.0f / 60.0f;
+    spanMs = ChoreographyAnalyzer::analysisSpan(show);
+    frame = 0;
+    nowMs = 0;
+    totalUs = 0.0;
+    inOverload = false;
+    runStored = false;
+    running = true;
+}
+
+bool ChoreographyAnalysis::step(uint32_t maxFrames) {
+    for (uint32_t n = 0; running && n < maxFrames; n++) {
+        nowMs = (uint32_t) (frame * (double) frameMs + 0.5);
+        if (nowMs >= spanMs) {
+            finish();
+            break;
+        }
+        simulateFrame();
+        frame++;
+    }
+    return running;
+}
+
+void ChoreographyAnalysis::charge(const ChoreoAction& action) {
+    // Loudness and grid position aren't simulated; every policy but None
+    // steals the voice that has run longest, which is what they mostly pick
+    auto byAge = [this](uint32_t startMs) { return (float) (nowMs - startMs); };
+
+    switch (action.type) {
+        case ChoreoActionType::FireRing: {
+            frameUs += model.voiceSpawnUs;
+            int voice = ringVoices.allocate(nowMs, [&](int i) { return byAge(rings[i].startMs); });
+            if (voice < 0) break;
+            const ChoreoRingParams& p = action.ring;
+            rings[voice] = SimRing{nowMs, p.hasRow ? p.row : model.rows * 0.5f, p.hasCol ? p.col : model.cols * 0.5f,
+                p.ringSpeed, p.ringWidth, p.fadeRadius + p.fadeWidth, p.onePulse};
+            break;
+        }
+        case ChoreoActionType::FirePulse: {
+            frameUs += model.voiceSpawnUs;
+            int voice = pulseVoices.allocate(nowMs, [&](int i) { return byAge(pulses[i].startMs); });
+            if (voice < 0) break;
+            pulses[voice] = SimPulse{nowMs, (float) action.pulse.width, fabsf(action.pulse.speed)};
+            break;
+        }
+        case ChoreoActionType::ChangeEffect:
+            frameUs += model.changeEffectUs;
+            break;
+        case ChoreoActionType::UpdateEffectParams:
+            frameUs += model.updateParamsUs;
+            break;
+        case ChoreoActionType::BrightnessPulse:
+        case ChoreoActionType::SetBrightness:
+            frameUs += model.brightnessUs;
+            break;
+        default:
+            break;
+    }
+}
+
+void ChoreographyAnalysis::simulateFrame() {
+    frameUs = model.baseFrameUs;
+
+    scheduler.pollEvents(nowMs, [this](const ChoreoEvent& event) { charge(event.action); });
+    scheduler.pollBeats(nowMs, frameMs, [this](const ChoreoBeat& beat, float) { charge(beat.action); });
+
+    // Voices still drawing this frame
+    for (int i = 0; i < ringVoices.size(); i++) {
+        if (!ringVoices.isBusy(i)) continue;
+        const SimRing& ring = rings[i];
+        const float r0 = ring.speed * (nowMs - ring.startMs) * 0.001f;
+        if (ring.onePulse && (r0 >= ring.fadeEnd || r0 > maxRadius)) {
+            ringVoices.release(i);
+            continue;
+        }
+        const float reach = ring.onePulse ? r0 + ring.width : std::min(r0, ring.fadeEnd);
+        frameUs += boxCells(ring.row, ring.col, reach, model.rows, model.cols) * model.ringUsPerCell;
+    }
+    for (int i = 0; i < pulseVoices.size(); i++) {
+        if (!pulseVoices.isBusy(i)) continue;
+        const SimPulse& pulse = pulses[i];
+        if (pulse.speed * (nowMs - pulse.startMs) * 0.001f >= model.numLEDs + pulse.width * 0.5f) {
+            pulseVoices.release(i);
+            continue;
+        }
+        frameUs += std::min(pulse.width, (float) model.numLEDs) * model.pulseUsPerLED;
+    }
+
+    if (ringVoices.activeCount() > report.peakRings) {
+        report.peakRings = (uint16_t) ringVoices.activeCount();
+        report.peakRingsMs = nowMs;
+    }
+    if (pulseVoices.activeCount() > report.peakPulses) {
+        report.peakPulses = (uint16_t) pulseVoices.activeCount();
+        report.peakPulsesMs = nowMs;
+    }
+
+    const uint32_t us = (uint32_t) frameUs;
+    totalUs += us;
+    report.frames++;
+    if (us > report.worstFrameUs) {
+        report.worstFrameUs = us;
+        report.worstFrameMs = nowMs;
+    }
+    if (us > model.frameBudgetUs) {
+        report.overBudgetFrames++;
+        if (!inOverload) {
+            runStored = report.overloads.size() < ChoreoPreflightReport::MAX_OVERLOADS;
+            if (runStored) {
+                report.overloads.push_back(ChoreoOverload{nowMs, nowMs, us});
+            } else {
+                report.droppedOverloads++;
+            }
+        } else if (runStored) {
+            ChoreoOverload& run = report.overloads.back();
+            run.endMs = nowMs;
+            run.peakUs = std::max(run.peakUs, us);
+        }
+        inOverload = true;
+    } else {
+        inOverload = false;
+    }
+}
+
+void ChoreographyAnalysis::finish() {
+    report.analyzedMs = spanMs;
+    report.averageFrameUs = report.frames ? (uint32_t) (totalUs / report.frames) : 0;
+    report.rings = ringVoices.getStats();
+    report.pulses = pulseVoices.getStats();
+    scheduler.clear();
+    running = false;
+}
+
+void ChoreographyAnalyzer::toJson(const ChoreoPreflightReport& report, const ChoreoCostModel& model, JsonObject out) {
+    out["type"] = "choreo_preflight";
+    out["analyzed_ms"] = report.analyzedMs;
+    out["frames"] = report.frames;
+    out["budget_us"] = model.frameBudgetUs;
+    out["worst_frame_us"] = report.worstFrameUs;
+    out["worst_frame_ms"] = report.worstFrameMs;
+    out["avg_frame_us"] = report.averageFrameUs;
+    out["over_budget_frames"] = report.overBudgetFrames;
+    out["peak_rings"] = report.peakRings;
+    out["peak_rings_ms"] = report.peakRingsMs;
+    out["peak_pulses"] = report.peakPulses;
+    out["peak_pulses_ms"] = report.peakPulsesMs;
+    out["stolen"] = report.rings.stolen + report.pulses.stolen;
+    out["dropped"] = report.rings.dropped + report.pulses.dropped;
+
+    // [startMs, endMs, peakUs] per overloaded range
+    JsonArray overloads = out.createNestedArray("overloads");
+    for (const ChoreoOverload& run : report.overloads) {
+        JsonArray entry = overloads.createNestedArray();
+        entry.add(run.startMs);
+        entry.add(run.endMs);
+        entry.add(run.peakUs);
+    }
+    if (report.droppedOverloads > 0) {
+        out["more_overloads"] = report.droppedOverloads;
+    }
+}
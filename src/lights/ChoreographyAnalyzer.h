@@ -0,0 +1,138 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <vector>
+#include "ChoreographyTimeline.h"
+#include "VoiceAllocator.h"
+
+/**
+ * Pre-flight cost estimate for a compiled choreography
+ *
+ * Plays the show on a virtual clock - the same ChoreographyScheduler and
+ * VoiceAllocator the manager uses, one step per frame - and charges every
+ * frame with the known cost of the actions that fire and the voices that are
+ * still drawing. Nothing is rendered, so a whole show takes milliseconds.
+ *
+ * Runs on the device before playback and in tools/choreo_preflight.
+ */
+
+/**
+ * Per-frame costs in microseconds. The defaults are rough ESP32-S3 figures
+ * at 240 MHz (settings "choreography" can override the budget and base
+ * cost); voice costs scale with the area each voice touches.
+ */
+struct ChoreoCostModel {
+    uint32_t frameBudgetUs = 16667;     // 60 fps
+    float frameMs = 1000.0f / 60.0f;
+    int rows = 32;
+    int cols = 32;
+    int numLEDs = 1024;
+    int ringVoices = 15;
+    int pulseVoices = 15;
+    VoiceStealPolicy stealPolicy = VoiceStealPolicy::Oldest;
+
+    float baseFrameUs = 4000.0f;        // Primary effect, blend and show
+    float ringUsPerCell = 0.35f;        // Per grid cell in a ring's bounding box
+    float pulseUsPerLED = 0.25f;        // Per LED under a pulse
+    float voiceSpawnUs = 40.0f;
+    float changeEffectUs = 6000.0f;     // Cold EffectFactory build + initialize
+    float updateParamsUs = 1500.0f;     // Payload -> Effect::updateParams
+    float brightnessUs = 50.0f;
+};
+
+// A run of consecutive frames over budget
+struct ChoreoOverload {
+    uint32_t startMs;
+    uint32_t endMs;
+    uint32_t peakUs;
+};
+
+struct ChoreoPreflightReport {
+    static constexpr size_t MAX_OVERLOADS = 16;
+
+    uint32_t analyzedMs = 0;
+    uint32_t frames = 0;
+    uint16_t peakRings = 0;
+    uint16_t peakPulses = 0;
+    uint32_t peakRingsMs = 0;
+    uint32_t peakPulsesMs = 0;
+    uint32_t worstFrameUs = 0;
+    uint32_t worstFrameMs = 0;
+    uint32_t averageFrameUs = 0;
+    uint32_t overBudgetFrames = 0;
+    VoiceStats rings;
+    VoiceStats pulses;
+    // In time order; runs past MAX_OVERLOADS are only counted
+    std::vector<ChoreoOverload> overloads;
+    uint32_t droppedOverloads = 0;
+
+    bool overloaded() const { return overBudgetFrames > 0; }
+};
+
+class ChoreographyAnalyzer {
+public:
+    // Shows without a duration are analyzed until their last start plus this
+    // tail (never-ending beats included), and never for longer than MAX_ANALYZE_MS
+    static constexpr uint32_t OPEN_END_TAIL_MS = 60UL * 1000UL;
+    static constexpr uint32_t MAX_ANALYZE_MS = 10UL * 60UL * 1000UL;
+
+    // The whole show in one call (host tool, tests); see ChoreographyAnalysis
+    static void analyze(const CompiledChoreography& show, const ChoreoCostModel& model, ChoreoPreflightReport& report);
+    static void toJson(const ChoreoPreflightReport& report, const ChoreoCostModel& model, JsonObject out);
+    static uint32_t analysisSpan(const CompiledChoreography& show);
+};
+
+/**
+ * ChoreographyAnalysis - The same pass, a slice of frames at a time
+ *
+ * A long show takes too long to simulate in one LED frame, so the manager
+ * calls step() once per frame until it returns false. The show must not
+ * change or move until then (or until cancel()).
+ */
+class ChoreographyAnalysis {
+public:
+    void begin(const CompiledChoreography& show, const ChoreoCostModel& model);
+    // Simulate up to maxFrames more frames; false once the report is complete
+    bool step(uint32_t maxFrames);
+    void cancel() { running = false; }
+    bool isRunning() const { return running; }
+    const ChoreoPreflightReport& getReport() const { return report; }
+
+private:
+    struct SimRing {
+        uint32_t startMs;
+        float row, col;
+        float speed;
+        float width;
+        float fadeEnd;       // fadeRadius + fadeWidth
+        bool onePulse;
+    };
+    struct SimPulse {
+        uint32_t startMs;
+        float width;
+        float speed;         // Absolute LEDs per second
+    };
+
+    void charge(const ChoreoAction& action);
+    void simulateFrame();
+    void finish();
+
+    ChoreoCostModel model;
+    ChoreographyScheduler scheduler;
+    VoiceAllocator ringVoices;
+    VoiceAllocator pulseVoices;
+    std::vector<SimRing> rings;
+    std::vector<SimPulse> pulses;
+    ChoreoPreflightReport report;
+    float maxRadius = 0.0f;
+    float frameMs = 0.0f;
+    uint32_t spanMs = 0;
+    uint32_t frame = 0;
+    uint32_t nowMs = 0;
+    float frameUs = 0.0f;
+    double totalUs = 0.0;
+    bool inOverload = false;
+    bool runStored = false;   // The current overload run made it into report.overloads
+    bool running = false;
+};
@@ -7,85 +7,82 @@
 #include "LEDManager.h"
 #include "RingPlayer.h"
 #include "PulsePlayer.h"
+#include "PixelMap.h"
+#include "ShowClock.h"
+#include "hal/SDCardController.h"
 
-// Forward declaration for parseColorString (defined in EffectFactory.cpp)
-void parseColorString(const String& colorString, Light& color);
-
-// Helper function to parse time strings like "0:45.500" (minutes:seconds.milliseconds) to milliseconds
-// Also supports "45.500" (seconds.milliseconds), "1:23" (minutes:seconds), or plain numbers (milliseconds)
-unsigned long ChoreographyManager::parseTimeString(const JsonVariant& timeValue) {
-    // If it's already a number, return it directly (backward compatibility)
-    if (timeValue.is<unsigned long>()) {
-        return timeValue.as<unsigned long>();
+#if SUPPORTS_SD_CARD
+// Feeds a streamed show to ChoreographyStreamLoader straight from an SD file
+class SDChoreoSource : public ChoreoByteSource {
+public:
+    explicit SDChoreoSource(SDCardFileHandle* handle) : handle(handle) {}
+    ~SDChoreoSource() override {
+        if (handle && g_sdCardController) {
+            g_sdCardController->close(handle);
+        }
     }
-    if (timeValue.is<long>()) {
-        return (unsigned long)timeValue.as<long>();
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        return g_sdCardController ? g_sdCardController->read(handle, buffer, length) : 0;
     }
-    if (timeValue.is<int>()) {
-        return (unsigned long)timeValue.as<int>();
+
+private:
+    SDCardFileHandle* handle;
+};
+#endif
+
+// Feeds a queued inline show to ChoreographyStreamLoader from its JSON text
+class StringChoreoSource : public ChoreoByteSource {
+public:
+    explicit StringChoreoSource(String&& json) : json(std::move(json)), offset(0) {}
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        size_t count = std::min(length, (size_t) json.length() - offset);
+        memcpy(buffer, json.c_str() + offset, count);
+        offset += count;
+        return count;
     }
-    
-    // If it's a string, parse the time format
-    // Format: "M:SS.mmm" (minutes:seconds.milliseconds) or "SS.mmm" (seconds.milliseconds)
-    // Example: "0:10.520" = 0 minutes, 10 seconds, 520 milliseconds = 10520 ms
-    if (timeValue.is<String>()) {
-        String timeStr = timeValue.as<String>();
-        timeStr.trim();
-        
-        unsigned long totalMs = 0;
-        
-        // Check if it contains a colon (minutes:seconds.milliseconds format)
-        int colonIndex = timeStr.indexOf(':');
-        if (colonIndex >= 0) {
-            // Has minutes:seconds.milliseconds format
-            String minutesStr = timeStr.substring(0, colonIndex);
-            String secondsAndMsStr = timeStr.substring(colonIndex + 1);
-            
-            unsigned long minutes = minutesStr.toInt();
-            
-            // Parse seconds and milliseconds from "SS.mmm"
-            int dotIndex = secondsAndMsStr.indexOf('.');
-            if (dotIndex >= 0) {
-                String secondsStr = secondsAndMsStr.substring(0, dotIndex);
-                String msStr = secondsAndMsStr.substring(dotIndex + 1);
-                unsigned long seconds = secondsStr.toInt();
-                unsigned long milliseconds = msStr.toInt();
-                totalMs = (minutes * 60 * 1000) + (seconds * 1000) + milliseconds;
-            } else {
-                // No milliseconds, just seconds
-                unsigned long seconds = secondsAndMsStr.toInt();
-                totalMs = (minutes * 60 * 1000) + (seconds * 1000);
-            }
-        } else {
-            // Just seconds.milliseconds format (no minutes)
-            int dotIndex = timeStr.indexOf('.');
-            if (dotIndex >= 0) {
-                String secondsStr = timeStr.substring(0, dotIndex);
-                String msStr = timeStr.substring(dotIndex + 1);
-                unsigned long seconds = secondsStr.toInt();
-                unsigned long milliseconds = msStr.toInt();
-                totalMs = (seconds * 1000) + milliseconds;
-            } else {
-                // Just seconds, no milliseconds
-                unsigned long seconds = timeStr.toInt();
-                totalMs = seconds * 1000;
-            }
-        }
-        
-        return totalMs;
+
+private:
+    String json;
+    size_t offset;
+};
+
+// The loader needs "param_defs" ahead of the beats and events that use it,
+// so the show is written in the loader's field order, not the command's
+static void serializeQueuedShow(const JsonObject& command, String& out) {
+    static const char* const FIELDS[] = { "param_defs", "bg_effect", "automation", "duration", "beats", "events" };
+    out.reserve(measureJson(command));
+    out = "{";
+    for (const char* field : FIELDS) {
+        JsonVariant value = command[field];
+        if (value.isNull()) continue;
+        if (out.length() > 1) out += ',';
+        out += '"';
+        out += field;
+        out += "\":";
+        serializeJson(value, out);  // Appends
     }
-    
-    // Default to 0 if we can't parse it
-    LOG_WARNF_COMPONENT("ChoreographyManager", "Could not parse time value, defaulting to 0");
-    return 0;
+    out += '}';
 }
 
+ChoreoVoiceConfig g_choreoVoiceConfig;
+ChoreoCostModel g_choreoCostModel;
+
 ChoreographyManager::ChoreographyManager() 
-    : active(false), effectManager(nullptr), choreographyStartTime(0), choreographyDuration(0),
-      outputBuffer(nullptr), gridRows(32), gridCols(32), ringPlayersInitialized(false),
-      numLEDs(0), pulsePlayersInitialized(false), nextPulsePlayerIdx(0),
-      lastCountInPulseTime(0) {
-    LOG_DEBUG_COMPONENT("ChoreographyManager", "Initializing");
+    : backgroundApplied(false), boundEffectId(-1), analysisMicros(0), preflightPending(false), holding(false),
+      seekPending(false), pendingSeekMs(0), pendingSeekCountIn(0),
+      joinPrewarmTried(false), joinWaiting(false), choreographyStartTime(0), choreographyDuration(0), active(false),
+      countInMs(DEFAULT_COUNT_IN_MS), timelineOffsetMs(0), lastCountInPulseTime(0), effectManager(nullptr),
+      prewarmWindowMs(DEFAULT_PREWARM_MS), workBudgetUs(DEFAULT_WORK_BUDGET_US), prewarmScan(0), prewarmedPayload(-1),
+      firedThisFrame(false), frameStartMicros(0), frameWork(FrameWork::None),
+      outputBuffer(nullptr), gridRows(g_ledGeometry.rows), gridCols(g_ledGeometry.cols),
+      centerRow(g_ledGeometry.rows * 0.5f), centerCol(g_ledGeometry.cols * 0.5f), ringPlayersInitialized(false),
+      numLEDs(0), pulsePlayersInitialized(false) {
+    ringVoices.init(g_choreoVoiceConfig.ringVoices, g_choreoVoiceConfig.stealPolicy);
+    pulseVoices.init(g_choreoVoiceConfig.pulseVoices, g_choreoVoiceConfig.stealPolicy);
+    ringPlayerPool.resize(ringVoices.size());
+    pulsePlayerPool.resize(pulseVoices.size());
+    LOG_DEBUGF_COMPONENT("ChoreographyManager", "Initializing: %d ring / %d pulse voices, steal %s",
+        ringVoices.size(), pulseVoices.size(), VoiceAllocator::policyName(ringVoices.getPolicy()));
 }
 
 ChoreographyManager::~ChoreographyManager() {
@@ -101,164 +98,143 @@ void ChoreographyManager::startChoreography(const JsonObject& command, EffectMan
         return;
     }
     
+    const char* file = command["file"] | (const char*) nullptr;
+    if (file && !openStream(file)) {
+        LOG_ERRORF_COMPONENT("ChoreographyManager", "Cannot open choreography file %s", file);
+        return;
+    }
+    
+    // A show started directly replaces the playlist too
+    clearQueue();
+    
     effectManager = em;
     active = true;
-    choreographyStartTime = millis();
+    choreographyStartTime = ShowClock::nowMs();
     lastCountInPulseTime = 0;  // Reset count-in pulse tracking
+    countInMs = command["count_in_ms"] | DEFAULT_COUNT_IN_MS;
+    timelineOffsetMs = 0;
     
-    // Reset ring players for new choreography
-    if (ringPlayersInitialized) {
-        for (auto& rp : ringPlayerPool) {
-            rp.isPlaying = false;
-        }
-    }
+    // Reset voices and their counters for the new choreography
+    stopVoices();
+    ringVoices.resetStats();
+    pulseVoices.resetStats();
     
     // Save current state
     saveCurrentState();
     
-    // Optional top-level param_defs: map of name -> params object for compact "params": "name" in beats/events
-    JsonObject paramDefs = command.containsKey("param_defs") && command["param_defs"].is<JsonObject>()
-        ? command["param_defs"].as<JsonObject>() : JsonObject();
-    
-    // Parse background effect (optional)
-    if (command.containsKey("bg_effect")) {
-        JsonObject bgEffect = command["bg_effect"].as<JsonObject>();
-        auto effect = EffectFactory::createEffect(bgEffect);
-        if (effect) {
-            effectManager->removeAllEffects();
-            extern Light BlendLightArr[];
-            effectManager->addEffect(std::move(effect), BlendLightArr, NUM_LEDS);
-        }
-    }
-    
-    // Parse beat patterns
-    beatPatterns.clear();
-    if (command.containsKey("beats") && command["beats"].is<JsonArray>()) {
-        JsonArray beats = command["beats"].as<JsonArray>();
-        for (JsonObject beat : beats) {
-            BeatPattern pattern;
-            pattern.id = beat.containsKey("id") ? beat["id"].as<String>() : "";
-            pattern.bps = beat.containsKey("bps") ? beat["bps"].as<float>() : 1.0f;
-            
-            // Parse action type
-            pattern.action = beat.containsKey("action") ? beat["action"].as<String>() : "brightness_pulse";
-            
-            // Store params as JSON string for later parsing (inline object or name ref from param_defs)
-            {
-                JsonObject paramsToUse;
-                if (beat.containsKey("params")) {
-                    if (beat["params"].is<JsonObject>()) {
-                        paramsToUse = beat["params"].as<JsonObject>();
-                    } else if ((beat["params"].is<const char*>() || beat["params"].is<String>()) && !paramDefs.isNull()) {
-                        const char* name = nullptr;
-                        String nameStr;
-                        if (beat["params"].is<const char*>()) {
-                            name = beat["params"].as<const char*>();
-                        } else {
-                            nameStr = beat["params"].as<String>();
-                            name = nameStr.c_str();
-                        }
-                        paramsToUse = paramDefs[name].as<JsonObject>();
-                        if (paramsToUse.isNull()) {
-                            LOG_WARNF_COMPONENT("ChoreographyManager", "param_defs[\"%s\"] not found for beat, using {}", name);
-                        }
-                    }
-                }
-                String paramsStr;
-                if (!paramsToUse.isNull()) {
-                    serializeJson(paramsToUse, paramsStr);
-                }
-                pattern.paramsJson = paramsStr.length() > 0 ? paramsStr : "{}";
-            }
-            
-            // Parse start_t - supports both number (ms) and string (e.g., "0:45.500")
-            pattern.startTime = beat.containsKey("start_t") ? 
-                parseTimeString(beat["start_t"]) : 0;
-            
-            // Support both "duration" and "end_t" - convert duration to endTime if provided
-            if (beat.containsKey("duration")) {
-                unsigned long duration = parseTimeString(beat["duration"]);
-                pattern.endTime = pattern.startTime + duration;
-            } else if (beat.containsKey("end_t")) {
-                pattern.endTime = parseTimeString(beat["end_t"]);
-            } else {
-                // Default to 0 if neither provided (pattern never ends)
-                pattern.endTime = 0;
-            }
-            
-            pattern.lastBeatTime = 0;
-            pattern.active = false;
-            
-            // Only add non-empty beat patterns (skip empty objects in JSON)
-            // Check if the JSON object actually has any keys - if it's empty {}, size() will be 0
-            if (beat.size() > 0) {
-                beatPatterns.push_back(pattern);
-            } else {
-                LOG_DEBUG_COMPONENT("ChoreographyManager", "Skipping empty beat pattern object in JSON");
-            }
-        }
+    // Compile the show once: actions, colors and times become POD records so
+    // firing beats and events never touches JSON
+    backgroundApplied = false;
+    analysis.cancel();
+    preflight = ChoreoPreflightReport();
+    preflightPending = false;
+    holding = command["strict"] | false;
+    seekPending = false;
+    workBudgetUs = command["work_budget_us"] | DEFAULT_WORK_BUDGET_US;
+    if (file) {
+        // Streamed: compile the first batch now, the rest a little every frame
+        scheduler.start(show);
+        continueStreaming(STREAM_FIRST_BATCH);
+    } else {
+        streamLoader.reset();
+        ChoreoCompileStats stats;
+        ChoreographyCompiler::compile(command, show, &stats);
+        logCompileStats(stats);
+        scheduler.start(show);
+        beginPreflight();
     }
+    automation.start(show);
+    boundEffectId = -1;
     
-    // Parse timeline events
-    timelineEvents.clear();
-    if (command.containsKey("events") && command["events"].is<JsonArray>()) {
-        JsonArray events = command["events"].as<JsonArray>();
-        for (JsonObject event : events) {
-            TimelineEvent timelineEvent;
-            // Parse time - supports both number (ms) and string (e.g., "0:45.500")
-            timelineEvent.time = event.containsKey("time") ? 
-                parseTimeString(event["time"]) : 0;
-            timelineEvent.action = event.containsKey("action") ? event["action"].as<String>() : "";
-            timelineEvent.executed = false;
-            
-            // Store params as JSON string for later parsing (inline object or name ref from param_defs)
-            {
-                JsonObject paramsToUse;
-                if (event.containsKey("params")) {
-                    if (event["params"].is<JsonObject>()) {
-                        paramsToUse = event["params"].as<JsonObject>();
-                    } else if ((event["params"].is<const char*>() || event["params"].is<String>()) && !paramDefs.isNull()) {
-                        const char* name = nullptr;
-                        String nameStr;
-                        if (event["params"].is<const char*>()) {
-                            name = event["params"].as<const char*>();
-                        } else {
-                            nameStr = event["params"].as<String>();
-                            name = nameStr.c_str();
-                        }
-                        paramsToUse = paramDefs[name].as<JsonObject>();
-                        if (paramsToUse.isNull()) {
-                            LOG_WARNF_COMPONENT("ChoreographyManager", "param_defs[\"%s\"] not found for event, using {}", name);
-                        }
-                    }
-                }
-                String paramsStr;
-                if (!paramsToUse.isNull()) {
-                    serializeJson(paramsToUse, paramsStr);
-                }
-                timelineEvent.paramsJson = paramsStr.length() > 0 ? paramsStr : "{}";
-            }
-            
-            timelineEvents.push_back(timelineEvent);
-        }
+    // Background effect (optional); a strict show applies it once it has passed
+    if (!holding) {
+        applyBackground();
     }
+    choreographyDuration = show.durationMs;
     
-    // Get choreography duration - supports both number (ms) and string (e.g., "1:06.000")
-    choreographyDuration = command.containsKey("duration") ? 
-        parseTimeString(command["duration"]) : 0;
+    prewarmWindowMs = command["prewarm_ms"] | DEFAULT_PREWARM_MS;
+    prewarmScan = 0;
+    dropPrewarm();
+    changeTimings = ChangeTimings();
     
     LOG_DEBUGF_COMPONENT("ChoreographyManager", 
-        "Started choreography with %d beats, %d events, duration %lu ms",
-        beatPatterns.size(), timelineEvents.size(), choreographyDuration);
+        "Started choreography with %d beats, %d events, duration %lu ms%s",
+        show.beats.size(), show.events.size(), choreographyDuration, holding ? " (held for pre-flight)" : "");
+}
+
+void ChoreographyManager::updateHold() {
+    // Finish compiling and analyzing within the frame's work budget. The
+    // count-in starts from the frame the show passes.
+    while (streamLoader.isLoading() && withinWorkBudget()) {
+        continueStreaming(STREAM_BATCH);
+    }
+    stepPreflight();
+    if (streamLoader.isLoading() || analysis.isRunning()) return;
+    
+    if (preflight.overloaded()) {
+        LOG_WARNF_COMPONENT("ChoreographyManager",
+            "Refusing show: %lu frames over the %lu us budget (worst %lu us at %lu ms)",
+            (unsigned long) preflight.overBudgetFrames, (unsigned long) g_choreoCostModel.frameBudgetUs,
+            (unsigned long) preflight.worstFrameUs, (unsigned long) preflight.worstFrameMs);
+        stop();
+        return;
+    }
+    holding = false;
+    choreographyStartTime = ShowClock::nowMs();
+    applyBackground();
+    choreographyDuration = show.durationMs;
+    LOG_DEBUG_COMPONENT("ChoreographyManager", "Pre-flight passed - starting held show");
 }
 
 void ChoreographyManager::update(float dt) {
     if (!active) return;
+    frameStartMicros = micros();
+    frameWork = FrameWork::None;
+    
+    updateFrame(dt);
+    
+    const uint32_t frameUs = micros() - frameStartMicros;
+    switch (frameWork) {
+        case FrameWork::ColdChange:
+            changeTimings.coldFrameUs = std::max(changeTimings.coldFrameUs, frameUs);
+            break;
+        case FrameWork::WarmChange:
+            changeTimings.warmFrameUs = std::max(changeTimings.warmFrameUs, frameUs);
+            break;
+        case FrameWork::Prewarm:
+            changeTimings.prewarmFrameUs = std::max(changeTimings.prewarmFrameUs, frameUs);
+            break;
+        default:
+            break;
+    }
+}
+
+void ChoreographyManager::updateFrame(float dt) {
+    firedThisFrame = false;
+    if (holding) {
+        updateHold();
+        return;
+    }
+    if (streamLoader.isLoading()) {
+        continueStreaming(STREAM_BATCH);
+        while (seekPending && streamLoader.isLoading() && withinWorkBudget()) {
+            continueStreaming(STREAM_BATCH);
+        }
+    }
+    if (seekPending && !streamLoader.isLoading()) {
+        applySeek(pendingSeekMs, pendingSeekCountIn);
+    }
+    unsigned long elapsed = ShowClock::nowMs() - choreographyStartTime;
     
-    unsigned long elapsed = millis() - choreographyStartTime;
+    stepPreflight();
+    // The next show only gets what the current one leaves of the budget
+    if (!streamLoader.isLoading() && !analysis.isRunning() && !playlist.empty() &&
+        !playlist.front().ready && withinWorkBudget()) {
+        prepareQueuedShow(STREAM_BATCH);
+    }
     
     // Handle count-in phase (first 3 seconds)
-    if (elapsed < COUNT_IN_DURATION) {
+    if (elapsed < countInMs) {
         // Fire white ring pulse at 0s, 1s, 2s (once per second)
         unsigned long countInSecond = elapsed / 1000;  // Which second we're in (0, 1, or 2)
         unsigned long expectedPulseTime = countInSecond * 1000;  // Expected time for this pulse
@@ -266,9 +242,9 @@ void ChoreographyManager::update(float dt) {
         // Fire pulse if we've reached a new second and haven't fired for this second yet
         if (elapsed >= expectedPulseTime && lastCountInPulseTime < expectedPulseTime) {
             // Fire count-in ring (white pulse at center)
-            RingPlayer* rp = findAvailableRingPlayer();
-            if (rp && ringPlayersInitialized) {
-                rp->setRingCenter(16.0f, 16.0f);
+            RingPlayer* rp = ringPlayersInitialized ? allocateRingPlayer() : nullptr;
+            if (rp) {
+                rp->setRingCenter(centerRow, centerCol);
                 rp->setRingProps(20.0f, 6.0f, 12.0f, 12.0f);
                 rp->hiLt = Light(255, 255, 255);  // White
                 rp->loLt = Light(0, 0, 0);        // Black
@@ -279,51 +255,53 @@ void ChoreographyManager::update(float dt) {
             }
         }
         
-        // Update active ring players during count-in
-        if (ringPlayersInitialized) {
-            for (auto& rp : ringPlayerPool) {
-                if (rp.isPlaying) {
-                    rp.update(dt);
-                }
-            }
-        }
-        if (pulsePlayersInitialized) {
-            for (auto& pp : pulsePlayerPool) {
-                pp.update(dt);
-            }
-        }
+        // Update active voices during count-in
+        updateVoices(dt);
+        // Effects that change right after the count-in can be built now
+        prewarmUpcomingEffect((long) (elapsed + timelineOffsetMs) - (long) countInMs);
         return;  // Don't process timeline during count-in
     }
     
     // After count-in, calculate timeline-relative elapsed time
-    unsigned long timelineElapsed = elapsed - COUNT_IN_DURATION;
+    unsigned long timelineElapsed = elapsed - countInMs + timelineOffsetMs;
     
-    // Check if choreography is complete - stop when duration is reached
-    if (choreographyDuration > 0 && timelineElapsed >= choreographyDuration) {
-        stop();
-        return;
+    // At the end of the show join the next queued one, or stop. The next
+    // timeline starts exactly where this one ended so beats stay on the grid.
+    while (choreographyDuration > 0 && timelineElapsed >= choreographyDuration) {
+        while (!playlist.empty() && !playlist.front().ready && withinWorkBudget()) {
+            prepareQueuedShow(STREAM_BATCH);  // Drops a show that fails to load
+        }
+        if (!nextShowReady()) {
+            if (playlist.empty()) {
+                stop();
+                return;
+            }
+            // Still being prepared: the background plays on and the next show
+            // is joined on the first frame it is ready
+            if (!joinWaiting) {
+                LOG_WARN_COMPONENT("ChoreographyManager", "Next show not ready at the boundary - waiting for it");
+                joinWaiting = true;
+            }
+            updateVoices(dt);
+            return;
+        }
+        unsigned long overshoot = joinWaiting ? 0 : timelineElapsed - choreographyDuration;
+        joinNextShow(ShowClock::nowMs() - overshoot);
+        timelineElapsed = overshoot;
     }
     
     // Update timeline events (one-off actions)
     updateTimelineEvents(timelineElapsed);
     
     // Update beat patterns
-    updateBeatPatterns(timelineElapsed);
+    updateBeatPatterns(timelineElapsed, dt);
     
-    // Update active ring players
-    if (ringPlayersInitialized) {
-        for (auto& rp : ringPlayerPool) {
-            if (rp.isPlaying) {
-                rp.update(dt);
-            }
-        }
-    }
-    // Update all pulse players (round-robin pool; each no-ops when past strip)
-    if (pulsePlayersInitialized) {
-        for (auto& pp : pulsePlayerPool) {
-            pp.update(dt);
-        }
-    }
+    updateAutomation(timelineElapsed);
+    
+    prewarmUpcomingEffect((long) timelineElapsed);
+    prewarmJoin((long) timelineElapsed);
+    
+    updateVoices(dt);
 }
 
 void ChoreographyManager::render(Light* outputBuffer, int numLEDs, int gridRows, int gridCols) {
@@ -343,19 +321,18 @@ void ChoreographyManager::stop() {
     
     active = false;
     
-    // Stop all beat patterns
-    for (auto& beat : beatPatterns) {
-        beat.active = false;
-    }
+    logShowStats();
+    // Stop all beat patterns, pending events and queued shows
+    scheduler.clear();
+    analysis.cancel();
+    holding = false;
+    seekPending = false;
+    automation.clear();
+    boundEffectId = -1;
+    clearQueue();
     
-    // Stop all active ring players
-    if (ringPlayersInitialized) {
-        for (auto& rp : ringPlayerPool) {
-            if (rp.isPlaying) {
-                rp.isPlaying = false;
-            }
-        }
-    }
+    // Stop all active ring and pulse players
+    stopVoices();
     
     // Stop any active brightness pulses
     BrightnessController* bc = BrightnessController::getInstance();
@@ -366,149 +343,551 @@ void ChoreographyManager::stop() {
     // Restore previous state
     restorePreviousState();
     
+    // Release the compiled show (payload documents can be sizeable)
+    streamLoader.reset();
+    dropPrewarm();
+    show.clear();
+    
     LOG_DEBUG_COMPONENT("ChoreographyManager", "Choreography stopped, state restored");
 }
 
-void ChoreographyManager::updateBeatPatterns(unsigned long timelineElapsed) {
-    unsigned long now = millis();
+void ChoreographyManager::logShowStats() {
+    const ChangeTimings& t = changeTimings;
+    if (t.coldSwapUs > 0 || t.warmSwapUs > 0) {
+        LOG_INFOF_COMPONENT("ChoreographyManager",
+            "change_effect worst: cold swap %lu us (frame %lu us), pre-warmed swap %lu us (frame %lu us), "
+            "pre-warm stage %lu us (frame %lu us)",
+            (unsigned long) t.coldSwapUs, (unsigned long) t.coldFrameUs,
+            (unsigned long) t.warmSwapUs, (unsigned long) t.warmFrameUs,
+            (unsigned long) t.prewarmStepUs, (unsigned long) t.prewarmFrameUs);
+    }
+    if (scheduler.skippedBeats() > 0) {
+        LOG_DEBUGF_COMPONENT("ChoreographyManager", "Skipped %lu beats after frame stalls",
+            (unsigned long) scheduler.skippedBeats());
+    }
     
+    const VoiceStats& rings = ringVoices.getStats();
+    const VoiceStats& pulses = pulseVoices.getStats();
+    if (rings.stolen || rings.dropped || pulses.stolen || pulses.dropped) {
+        LOG_INFOF_COMPONENT("ChoreographyManager",
+            "Voices: rings peak %u/%u, %lu stolen, %lu dropped; pulses peak %u/%u, %lu stolen, %lu dropped",
+            rings.peakActive, rings.poolSize, (unsigned long) rings.stolen, (unsigned long) rings.dropped,
+            pulses.peakActive, pulses.poolSize, (unsigned long) pulses.stolen, (unsigned long) pulses.dropped);
+    }
+}
+
+bool ChoreographyManager::seek(uint32_t timeMs, unsigned long countIn) {
+    if (!active) {
+        LOG_WARN_COMPONENT("ChoreographyManager", "Seek ignored - no choreography running");
+        return false;
+    }
+    if (holding) {
+        LOG_WARN_COMPONENT("ChoreographyManager", "Seek ignored - show is held for pre-flight");
+        return false;
+    }
+    // A streamed show has to be fully compiled to know its state at timeMs.
+    // The rest is compiled within the frame budget and the seek applied then.
+    if (streamLoader.isLoading()) {
+        seekPending = true;
+        pendingSeekMs = timeMs;
+        pendingSeekCountIn = countIn;
+        LOG_DEBUGF_COMPONENT("ChoreographyManager", "Seek to %lu ms pending until the show is compiled",
+            (unsigned long) timeMs);
+        return true;
+    }
+    return applySeek(timeMs, countIn);
+}
+
+bool ChoreographyManager::applySeek(uint32_t timeMs, unsigned long countIn) {
+    seekPending = false;
+    if (choreographyDuration > 0 && timeMs >= choreographyDuration) {
+        LOG_WARNF_COMPONENT("ChoreographyManager", "Seek to %lu ms is past the end (%lu ms)",
+            (unsigned long) timeMs, choreographyDuration);
+        return false;
+    }
+    
+    uint32_t startMicros = micros();
+    ChoreoSeekState state = show.stateAt(timeMs);
+    
+    // Drop voices and pulses from before the jump
+    stopVoices();
     BrightnessController* bc = BrightnessController::getInstance();
+    if (bc) {
+        bc->stopPulse();
+        bc->setBrightness(state.brightness >= 0 ? state.brightness : savedState.brightness);
+    }
+    dropPrewarm();
     
-    for (auto& beat : beatPatterns) {
-        // Check if beat pattern should start (using timeline-relative time)
-        if (!beat.active && timelineElapsed >= beat.startTime) {
-            beat.active = true;
-            beat.lastBeatTime = now;
+    // Effect as of timeMs, plus any params updates made to it since
+    if (state.effectEvent >= 0) {
+        executeChangeEffect(show.payload(show.events[state.effectEvent].action.payload.index));
+    } else if (show.backgroundPayload >= 0) {
+        executeChangeEffect(show.payload(show.backgroundPayload));
+    }
+    for (uint32_t i = (uint32_t) (state.effectEvent + 1); i < state.eventIndex; i++) {
+        if (show.events[i].action.type == ChoreoActionType::UpdateEffectParams) {
+            executeUpdateEffectParams(show.payload(show.events[i].action.payload.index));
         }
-        
-        // Update active beat patterns
-        if (beat.active) {
-            // Check if end time reached (endTime of 0 means pattern never ends)
-            // Use timeline-relative time for comparison
-            if (beat.endTime > 0 && timelineElapsed >= beat.endTime) {
-                beat.active = false;
-                // Don't restore brightness here - let the pulse cycle complete naturally
-                // If a new pattern starts, it will override anyway
-                continue;
-            }
-            
-            // Check if it's time for next beat
-            // BrightnessController handles the full pulse cycle, we just need to check if it's done
-            unsigned long interval = beat.getIntervalMs();
-            unsigned long timeSinceLastBeat = now - beat.lastBeatTime;
-            
-            // Trigger next action if interval has passed - timeline always takes precedence
-            if (timeSinceLastBeat >= interval) {
-                executeBeatAction(beat);
-                beat.lastBeatTime = now;
-            }
+    }
+    
+    scheduler.seek(timeMs, state.eventIndex);
+    automation.seek(timeMs);
+    prewarmScan = state.eventIndex;
+    countInMs = countIn;
+    timelineOffsetMs = timeMs;
+    lastCountInPulseTime = 0;
+    choreographyStartTime = ShowClock::nowMs();
+    
+    LOG_INFOF_COMPONENT("ChoreographyManager",
+        "Seek to %lu ms: checkpoint %lu ms + %lu events replayed in %lu us",
+        (unsigned long) timeMs, (unsigned long) state.checkpointMs,
+        (unsigned long) state.replayedEvents, (unsigned long) (micros() - startMicros));
+    return true;
+}
+
+bool ChoreographyManager::queueChoreography(const JsonObject& command, EffectManager* em) {
+    if (!active) {
+        startChoreography(command, em);
+        return active;
+    }
+    if (playlist.size() >= MAX_QUEUED_SHOWS) {
+        LOG_WARNF_COMPONENT("ChoreographyManager", "Playlist full (%u shows) - show not queued",
+            (unsigned) playlist.size());
+        return false;
+    }
+    
+    QueuedShow entry;
+    entry.show.reset(new CompiledChoreography());
+    entry.strict = command["strict"] | false;
+    entry.compiled = false;
+    entry.ready = false;
+    const char* file = command["file"] | (const char*) nullptr;
+    if (file) {
+        entry.file = file;
+    } else {
+        if (command["beats"].size() == 0 && command["events"].size() == 0 &&
+            command["automation"].size() == 0 && command["bg_effect"].isNull()) {
+            LOG_WARN_COMPONENT("ChoreographyManager", "Queued show is empty - not queued");
+            return false;
         }
+        // The command document goes away after this; keep the text, not a
+        // compiled show. It is compiled once it reaches the front.
+        serializeQueuedShow(command, entry.json);
     }
+    playlist.push_back(std::move(entry));
+    
+    if (choreographyDuration == 0) {
+        LOG_WARN_COMPONENT("ChoreographyManager", "Current show has no duration - queued show waits for a skip");
+    }
+    LOG_INFOF_COMPONENT("ChoreographyManager", "Queued %s (%u in playlist)",
+        file ? file : "inline show", (unsigned) playlist.size());
+    return true;
 }
 
-void ChoreographyManager::executeBeatAction(BeatPattern& beat) {
-    // Parse params JSON string
-    DynamicJsonDocument doc(2048);
-    DeserializationError error = deserializeJson(doc, beat.paramsJson);
-    if (error) {
-        LOG_ERRORF_COMPONENT("ChoreographyManager", 
-            "Failed to parse params JSON for beat %s: %s", beat.id.c_str(), error.c_str());
-        return;
+bool ChoreographyManager::skip() {
+    if (!active) return false;
+    if (playlist.empty()) {
+        LOG_INFO_COMPONENT("ChoreographyManager", "Skip with an empty playlist - stopping");
+        stop();
+        return true;
+    }
+    if (!nextShowReady()) {
+        if (playlist.empty()) {
+            LOG_INFO_COMPONENT("ChoreographyManager", "Skip refused every queued show - stopping");
+            stop();
+            return true;
+        }
+        LOG_WARN_COMPONENT("ChoreographyManager", "Skip ignored - next show is still being prepared");
+        return false;
+    }
+    joinNextShow(ShowClock::nowMs());
+    return true;
+}
+
+void ChoreographyManager::clearQueue() {
+    queueLoader.reset();
+    queueAnalysis.cancel();
+    playlist.clear();
+    joinEffect.reset();
+    joinPrewarmed.reset();
+    joinPrewarmTried = false;
+    joinWaiting = false;
+}
+
+bool ChoreographyManager::prepareQueuedShow(int maxElements) {
+    QueuedShow& next = playlist.front();
+    if (next.ready) return true;
+    const char* name = next.file.length() > 0 ? next.file.c_str() : "inline show";
+    
+    if (next.compiled) {
+        // Pre-flight, slices within the frame's work budget (at least one)
+        while (queueAnalysis.step(ANALYSIS_SLICE_FRAMES) && withinWorkBudget()) {
+        }
+        if (queueAnalysis.isRunning()) return true;
+        next.preflight = queueAnalysis.getReport();
+        next.ready = true;
+        LOG_DEBUGF_COMPONENT("ChoreographyManager", "Queued %s ready: worst frame %lu us%s", name,
+            (unsigned long) next.preflight.worstFrameUs, next.preflight.overloaded() ? " (over budget)" : "");
+        return true;
     }
     
-    JsonObject params = doc.as<JsonObject>();
+    if (!queueLoader.isLoading()) {
+        std::unique_ptr<ChoreoByteSource> source;
+        if (next.file.length() > 0) {
+            source = openSource(next.file.c_str());
+        } else {
+            source.reset(new StringChoreoSource(std::move(next.json)));
+        }
+        if (!source) {
+            LOG_ERRORF_COMPONENT("ChoreographyManager", "Cannot open queued choreography %s - dropped", name);
+            playlist.pop_front();
+            return false;
+        }
+        queueLoader.begin(std::move(source), *next.show);
+        queueStats = ChoreoCompileStats();
+    }
+    size_t eventsBefore = next.show->events.size();
+    bool more = queueLoader.step(*next.show, maxElements, &queueStats);
+    // Sorted a batch at a time, as the current show's stream is
+    ChoreographyCompiler::mergeEvents(*next.show, 0, eventsBefore);
+    if (more) return true;
     
-    // Dispatch to appropriate action handler
-    if (beat.action == "brightness_pulse") {
-        executeBrightnessPulse(params);
-    } else if (beat.action == "fire_ring") {
-        executeFireRing(params);
-    } else if (beat.action == "fire_pulse") {
-        executeFirePulse(params);
+    if (queueLoader.hasError()) {
+        LOG_ERRORF_COMPONENT("ChoreographyManager", "Queued choreography %s failed: %s - dropped",
+            name, queueLoader.errorMessage());
+        queueLoader.reset();
+        playlist.pop_front();
+        return false;
+    }
+    queueLoader.reset();
+    logCompileStats(queueStats);
+    LOG_DEBUGF_COMPONENT("ChoreographyManager", "Queued %s compiled: %d beats, %d events",
+        name, queueStats.beats, queueStats.events);
+    next.show->buildCheckpoints();
+    next.compiled = true;
+    queueAnalysis.begin(*next.show, preflightModel());
+    return true;
+}
+
+bool ChoreographyManager::nextShowReady() {
+    while (!playlist.empty() && playlist.front().ready) {
+        const QueuedShow& front = playlist.front();
+        if (!front.strict || !front.preflight.overloaded()) return true;
+        LOG_WARNF_COMPONENT("ChoreographyManager",
+            "Refusing queued %s: %lu frames over the %lu us budget (worst %lu us at %lu ms)",
+            front.file.length() > 0 ? front.file.c_str() : "inline show",
+            (unsigned long) front.preflight.overBudgetFrames, (unsigned long) g_choreoCostModel.frameBudgetUs,
+            (unsigned long) front.preflight.worstFrameUs, (unsigned long) front.preflight.worstFrameMs);
+        playlist.pop_front();
+        joinEffect.reset();
+        joinPrewarmed.reset();
+        joinPrewarmTried = false;
+    }
+    return false;
+}
+
+bool ChoreographyManager::joinNextShow(unsigned long startMs) {
+    if (!nextShowReady()) return false;
+    
+    logShowStats();
+    QueuedShow next = std::move(playlist.front());
+    playlist.pop_front();
+    
+    // Swap the compiled show in. Voices, brightness and the saved state
+    // carry over; only timeline state is reset.
+    streamLoader.reset();
+    analysis.cancel();  // Still on the outgoing show
+    seekPending = false;
+    joinWaiting = false;
+    show = std::move(*next.show);
+    scheduler.start(show);
+    automation.start(show);
+    boundEffectId = -1;
+    preflight = next.preflight;
+    preflightPending = true;
+    dropPrewarm();
+    prewarmScan = 0;
+    changeTimings = ChangeTimings();
+    ringVoices.resetStats();
+    pulseVoices.resetStats();
+    
+    // Opening effect: swap in the one built ahead of the boundary, else build it now
+    if (joinPrewarmed.isValid() && effectManager) {
+        effectManager->removeAllEffects();
+        effectManager->addPreparedEffect(joinPrewarmed);
+        backgroundApplied = true;
     } else {
-        LOG_ERRORF_COMPONENT("ChoreographyManager", "Unknown action type: %s for beat %s", beat.action.c_str(), beat.id.c_str());
+        backgroundApplied = false;
+        applyBackground();
     }
+    joinEffect.reset();
+    joinPrewarmed.reset();
+    joinPrewarmTried = false;
+    
+    choreographyDuration = show.durationMs;
+    choreographyStartTime = startMs;
+    countInMs = 0;
+    timelineOffsetMs = 0;
+    lastCountInPulseTime = 0;
+    
+    LOG_INFOF_COMPONENT("ChoreographyManager", "Joined next show: %d beats, %d events, %u still queued",
+        (int) show.beats.size(), (int) show.events.size(), (unsigned) playlist.size());
+    return true;
 }
 
-void ChoreographyManager::executeBrightnessPulse(const JsonObject& params) {
-    BrightnessController* bc = BrightnessController::getInstance();
-    if (!bc) {
-        LOG_ERROR_COMPONENT("ChoreographyManager", "BrightnessController not available");
+void ChoreographyManager::prewarmJoin(long timelineMs) {
+    if (joinPrewarmTried || !effectManager || prewarmWindowMs == 0) return;
+    // Same rules as prewarmUpcomingEffect: quiet frames, one stage per frame
+    if (firedThisFrame || frameWork != FrameWork::None || !withinWorkBudget()) return;
+    if (playlist.empty() || !playlist.front().ready || choreographyDuration == 0) return;
+    if ((long) choreographyDuration > timelineMs + (long) prewarmWindowMs) return;
+    
+    const QueuedShow& queued = playlist.front();
+    const CompiledChoreography& next = *queued.show;
+    if (next.backgroundPayload < 0 || (queued.strict && queued.preflight.overloaded())) {
+        joinPrewarmTried = true;  // Nothing to build, or the show is refused at the join
         return;
     }
     
-    // Parse brightness pulse parameters
-    int baseBrightness = params.containsKey("base") ? params["base"].as<int>() : 128;
-    int peakBrightness = params.containsKey("peak") ? params["peak"].as<int>() : 255;
-    unsigned long pulseDuration = params.containsKey("pulse_duration") ? params["pulse_duration"].as<unsigned long>() : 250;
+    uint32_t startMicros = micros();
+    if (joinEffect) {
+        // Stage two: into a private output, not BlendLightArr, which the
+        // current show is still drawing into
+        effectManager->prepareEffect(std::move(joinEffect), nullptr, g_ledGeometry.numLEDs, joinPrewarmed, true);
+        joinPrewarmTried = true;  // One attempt; a failed build falls back to building at the join
+    } else {
+        joinEffect = EffectFactory::createEffect(next.payload(next.backgroundPayload));
+        if (!joinEffect) {
+            joinPrewarmTried = true;
+        }
+    }
+    uint32_t took = micros() - startMicros;
+    changeTimings.prewarmStepUs = std::max(changeTimings.prewarmStepUs, took);
+    frameWork = FrameWork::Prewarm;
+}
+
+std::unique_ptr<ChoreoByteSource> ChoreographyManager::openSource(const char* path) {
+#if SUPPORTS_SD_CARD
+    if (!g_sdCardController || !g_sdCardController->isAvailable()) {
+        return nullptr;
+    }
+    SDCardFileHandle* handle = g_sdCardController->open(path, "r");
+    if (!handle) {
+        return nullptr;
+    }
+    return std::unique_ptr<ChoreoByteSource>(new SDChoreoSource(handle));
+#else
+    (void) path;
+    return nullptr;
+#endif
+}
+
+bool ChoreographyManager::openStream(const char* path) {
+    std::unique_ptr<ChoreoByteSource> source = openSource(path);
+    if (!source) {
+        return false;
+    }
+    streamLoader.begin(std::move(source), show);
+    streamStats = ChoreoCompileStats();
+    LOG_DEBUGF_COMPONENT("ChoreographyManager", "Streaming choreography from %s", path);
+    return true;
+}
+
+void ChoreographyManager::continueStreaming(int maxElements) {
+    size_t beatsBefore = show.beats.size();
+    size_t eventsBefore = show.events.size();
+    bool more = streamLoader.step(show, maxElements, &streamStats);
     
-    // Let BrightnessController handle the full pulse cycle (base -> peak -> base)
-    bc->startPulseCycle(baseBrightness, peakBrightness, pulseDuration);
+    for (size_t i = beatsBefore; i < show.beats.size(); i++) {
+        scheduler.addBeat(i);
+    }
+    if (show.events.size() > eventsBefore) {
+        // Keep the unfired part sorted for the cursor (an event that arrives
+        // after its time has passed fires on the next frame). The tail is
+        // sorted already, so only the new batch is sorted and merged in.
+        size_t from = std::min(scheduler.nextEventIndex(), eventsBefore);
+        ChoreographyCompiler::mergeEvents(show, from, eventsBefore);
+        prewarmScan = scheduler.nextEventIndex();
+    }
+    if (show.lanes.size() != automation.laneCount()) {
+        automation.start(show);
+        boundEffectId = -1;
+    }
+    if (!holding) {
+        applyBackground();
+    }
+    choreographyDuration = show.durationMs;
     
-    LOG_DEBUGF_COMPONENT("ChoreographyManager", 
-        "Executing brightness pulse cycle: base=%d, peak=%d, duration=%lu ms",
-        baseBrightness, peakBrightness, pulseDuration);
+    if (!more) {
+        if (streamLoader.hasError()) {
+            LOG_ERRORF_COMPONENT("ChoreographyManager", "Choreography stream failed after %u bytes: %s",
+                (unsigned) streamLoader.bytesRead(), streamLoader.errorMessage());
+        } else {
+            LOG_DEBUGF_COMPONENT("ChoreographyManager", "Streamed %u bytes: %d beats, %d events",
+                (unsigned) streamLoader.bytesRead(), streamStats.beats, streamStats.events);
+        }
+        logCompileStats(streamStats);
+        streamLoader.reset();
+        show.buildCheckpoints();
+        beginPreflight();
+    }
+}
+
+ChoreoCostModel ChoreographyManager::preflightModel() const {
+    ChoreoCostModel model = g_choreoCostModel;
+    model.rows = g_ledGeometry.rows;
+    model.cols = g_ledGeometry.cols;
+    model.numLEDs = numLEDs > 0 ? numLEDs : g_ledGeometry.numLEDs;
+    model.ringVoices = ringVoices.size();
+    model.pulseVoices = pulseVoices.size();
+    model.stealPolicy = ringVoices.getPolicy();
+    return model;
+}
+
+void ChoreographyManager::beginPreflight() {
+    analysis.begin(show, preflightModel());
+    analysisMicros = 0;
+}
+
+void ChoreographyManager::stepPreflight() {
+    if (!analysis.isRunning()) return;
+    uint32_t startMicros = micros();
+    while (analysis.step(ANALYSIS_SLICE_FRAMES) && withinWorkBudget()) {
+    }
+    analysisMicros += micros() - startMicros;
+    if (analysis.isRunning()) return;
+    
+    preflight = analysis.getReport();
+    preflightPending = true;
+    if (preflight.overloaded()) {
+        LOG_WARNF_COMPONENT("ChoreographyManager",
+            "Pre-flight: %lu of %lu frames over %lu us, worst %lu us at %lu ms, %u overloaded ranges",
+            (unsigned long) preflight.overBudgetFrames, (unsigned long) preflight.frames,
+            (unsigned long) preflightModel().frameBudgetUs, (unsigned long) preflight.worstFrameUs,
+            (unsigned long) preflight.worstFrameMs,
+            (unsigned) (preflight.overloads.size() + preflight.droppedOverloads));
+    }
+    LOG_DEBUGF_COMPONENT("ChoreographyManager",
+        "Pre-flight: peak %u rings / %u pulses, worst frame %lu us, analyzed in %lu us",
+        preflight.peakRings, preflight.peakPulses, (unsigned long) preflight.worstFrameUs,
+        (unsigned long) analysisMicros);
+}
+
+bool ChoreographyManager::takePreflightReport() {
+    bool pending = preflightPending;
+    preflightPending = false;
+    return pending;
+}
+
+void ChoreographyManager::applyBackground() {
+    if (backgroundApplied || show.backgroundPayload < 0) return;
+    backgroundApplied = true;
+    executeChangeEffect(show.payload(show.backgroundPayload));
+}
+
+void ChoreographyManager::logCompileStats(const ChoreoCompileStats& stats) {
+    if (stats.missingParamDefs > 0 || stats.unknownActions > 0 || stats.badColors > 0 || stats.badAutomation > 0 ||
+        stats.badPulseSpeeds > 0) {
+        LOG_WARNF_COMPONENT("ChoreographyManager",
+            "Compile: %d missing param_defs, %d unknown actions, %d bad colors, %d bad automation lanes, "
+            "%d zero-speed pulses",
+            stats.missingParamDefs, stats.unknownActions, stats.badColors, stats.badAutomation, stats.badPulseSpeeds);
+    }
+}
+
+void ChoreographyManager::updateBeatPatterns(unsigned long timelineElapsed, float dt) {
+    // Only beats due this frame are touched (min-heap on next fire time). Each
+    // fires on the frame nearest its analytic time; the remainder is passed on
+    // as phase so the voice lands where it would have with an exact clock.
+    scheduler.pollBeats(timelineElapsed, dt * 1000.0f, [this](const ChoreoBeat& beat, float phaseSec) {
+        executeAction(beat.action, phaseSec);
+    });
 }
 
 void ChoreographyManager::updateTimelineEvents(unsigned long timelineElapsed) {
     if (!active) return;
     
-    for (auto& event : timelineEvents) {
-        // Fire event once when time is reached (never early, may fire late)
-        // Use timeline-relative time for comparison
-        if (!event.executed && timelineElapsed >= event.time) {
-            executeEventAction(event);
-            event.executed = true;
+    // Fire each event once when time is reached (never early, may fire late).
+    // Events are sorted, so the cursor stops at the first one still in the future.
+    scheduler.pollEvents(timelineElapsed, [this](const ChoreoEvent& event) {
+        executeAction(event.action);
+    });
+}
+
+void ChoreographyManager::updateAutomation(unsigned long timelineElapsed) {
+    if (automation.laneCount() == 0 || !effectManager) return;
+    Effect* effect = effectManager->getPrimaryEffect();
+    if (!effect) return;
+    
+    // Resolve parameter names once per effect, not per frame
+    if (effect->getId() != boundEffectId) {
+        boundEffectId = effect->getId();
+        laneSlots.resize(show.lanes.size());
+        for (size_t i = 0; i < show.lanes.size(); i++) {
+            laneSlots[i] = effect->findParam(show.lanes[i].param);
+        }
+        automation.invalidate();  // The new effect gets every lane's current value
+    }
+    
+    automation.evaluate((uint32_t) timelineElapsed, [this, effect](size_t lane, float value) {
+        if (laneSlots[lane] >= 0) {
+            effect->setParam(laneSlots[lane], value);
         }
+    });
+}
+
+void ChoreographyManager::executeAction(const ChoreoAction& action, float phaseSec) {
+    firedThisFrame = true;
+    switch (action.type) {
+        case ChoreoActionType::BrightnessPulse:
+            executeBrightnessPulse(action.brightnessPulse);
+            break;
+        case ChoreoActionType::FireRing:
+            executeFireRing(action.ring, phaseSec);
+            break;
+        case ChoreoActionType::FirePulse:
+            executeFirePulse(action.pulse, phaseSec);
+            break;
+        case ChoreoActionType::ChangeEffect:
+            executeChangeEffect(action.payload.index);
+            break;
+        case ChoreoActionType::SetBrightness:
+            executeSetBrightness(action.setBrightness);
+            break;
+        case ChoreoActionType::UpdateEffectParams:
+            executeUpdateEffectParams(show.payload(action.payload.index));
+            break;
+        default:
+            break;
     }
 }
 
-void ChoreographyManager::executeEventAction(TimelineEvent& event) {
-    // Parse params JSON string (e.g. change_effect with nested effect can be large)
-    DynamicJsonDocument doc(2048);
-    DeserializationError error = deserializeJson(doc, event.paramsJson);
-    if (error) {
-        LOG_ERRORF_COMPONENT("ChoreographyManager", 
-            "Failed to parse params JSON for event at %lu ms: %s", event.time, error.c_str());
+void ChoreographyManager::executeBrightnessPulse(const ChoreoBrightnessPulseParams& params) {
+    BrightnessController* bc = BrightnessController::getInstance();
+    if (!bc) {
+        LOG_ERROR_COMPONENT("ChoreographyManager", "BrightnessController not available");
         return;
     }
     
-    JsonObject params = doc.as<JsonObject>();
-    
-    // Dispatch to appropriate action handler
-    if (event.action == "change_effect") {
-        executeChangeEffect(params);
-    } else if (event.action == "set_brightness") {
-        executeSetBrightness(params);
-    } else if (event.action == "fire_ring") {
-        executeFireRing(params);  // Reuse existing method
-    } else if (event.action == "fire_pulse") {
-        executeFirePulse(params);
-    } else if (event.action == "update_effect_params") {
-        executeUpdateEffectParams(params);
-    } else {
-        LOG_ERRORF_COMPONENT("ChoreographyManager", 
-            "Unknown event action type: %s at time %lu ms", event.action.c_str(), event.time);
-    }
+    // Let BrightnessController handle the full pulse cycle (base -> peak -> base)
+    bc->startPulseCycle(params.base, params.peak, params.durationMs);
 }
 
-void ChoreographyManager::executeChangeEffect(const JsonObject& params) {
+void ChoreographyManager::executeChangeEffect(const JsonObject& effectObj) {
     if (!effectManager) {
         LOG_ERROR_COMPONENT("ChoreographyManager", "EffectManager not available");
         return;
     }
     
-    if (!params.containsKey("effect")) {
+    if (effectObj.isNull()) {
         LOG_ERROR_COMPONENT("ChoreographyManager", "change_effect action missing 'effect' parameter");
         return;
     }
     
-    JsonObject effectObj = params["effect"].as<JsonObject>();
     auto effect = EffectFactory::createEffect(effectObj);
     if (effect) {
         effectManager->removeAllEffects();
-        extern Light BlendLightArr[];
-        effectManager->addEffect(std::move(effect), BlendLightArr, NUM_LEDS);
+        effectManager->addEffect(std::move(effect), BlendLightArr, g_ledGeometry.numLEDs);
         
         LOG_DEBUGF_COMPONENT("ChoreographyManager", "Changed background effect via timeline event");
     } else {
@@ -516,6 +895,69 @@ void ChoreographyManager::executeChangeEffect(const JsonObject& params) {
     }
 }
 
+void ChoreographyManager::executeChangeEffect(uint16_t payloadIndex) {
+    uint32_t startMicros = micros();
+    if (prewarmedPayload == (int) payloadIndex && prewarmed.isValid() && effectManager) {
+        // Built and initialized ahead of time - just swap it in
+        effectManager->removeAllEffects();
+        effectManager->addPreparedEffect(prewarmed);
+        prewarmedPayload = -1;
+        uint32_t took = micros() - startMicros;
+        changeTimings.warmSwapUs = std::max(changeTimings.warmSwapUs, took);
+        frameWork = FrameWork::WarmChange;
+        return;
+    }
+    if (prewarmedPayload == (int) payloadIndex) {
+        dropPrewarm();  // Only half built in time
+    }
+    executeChangeEffect(show.payload(payloadIndex));
+    uint32_t took = micros() - startMicros;
+    changeTimings.coldSwapUs = std::max(changeTimings.coldSwapUs, took);
+    frameWork = FrameWork::ColdChange;
+}
+
+void ChoreographyManager::prewarmUpcomingEffect(long timelineMs) {
+    if (prewarmed.isValid() || !effectManager || prewarmWindowMs == 0) return;
+    // Keep beat and event frames free, and do at most one stage per frame
+    if (firedThisFrame || frameWork != FrameWork::None || !withinWorkBudget()) return;
+    
+    uint32_t startMicros = micros();
+    if (prewarmEffect) {
+        // Stage two: output and initialize(). The private output keeps the
+        // build out of BlendLightArr, which this frame is still drawing into.
+        if (!effectManager->prepareEffect(std::move(prewarmEffect), nullptr, g_ledGeometry.numLEDs, prewarmed, true)) {
+            prewarmedPayload = -1;  // The event falls back to building at fire time
+        }
+    } else {
+        // Stage one: find the next change_effect that has not fired yet and construct it
+        if (prewarmScan < scheduler.nextEventIndex()) {
+            prewarmScan = scheduler.nextEventIndex();
+        }
+        while (prewarmScan < show.events.size() &&
+               show.events[prewarmScan].action.type != ChoreoActionType::ChangeEffect) {
+            prewarmScan++;
+        }
+        if (prewarmScan >= show.events.size()) return;
+        
+        const ChoreoEvent& event = show.events[prewarmScan];
+        if ((long) event.timeMs > timelineMs + (long) prewarmWindowMs) return;
+        
+        prewarmEffect = EffectFactory::createEffect(show.payload(event.action.payload.index));
+        prewarmedPayload = prewarmEffect ? event.action.payload.index : -1;
+        // Don't retry a failed build every frame; the event falls back to building at fire time
+        prewarmScan++;
+    }
+    uint32_t took = micros() - startMicros;
+    changeTimings.prewarmStepUs = std::max(changeTimings.prewarmStepUs, took);
+    frameWork = FrameWork::Prewarm;
+}
+
+void ChoreographyManager::dropPrewarm() {
+    prewarmEffect.reset();
+    prewarmed.reset();
+    prewarmedPayload = -1;
+}
+
 void ChoreographyManager::executeUpdateEffectParams(const JsonObject& params) {
     LOG_DEBUGF_COMPONENT("ChoreographyManager", "Executing update_effect_params");
     if (!effectManager) {
@@ -532,107 +974,58 @@ void ChoreographyManager::executeUpdateEffectParams(const JsonObject& params) {
     }
 }
 
-void ChoreographyManager::executeSetBrightness(const JsonObject& params) {
+void ChoreographyManager::executeSetBrightness(const ChoreoSetBrightnessParams& params) {
     BrightnessController* bc = BrightnessController::getInstance();
     if (!bc) {
         LOG_ERROR_COMPONENT("ChoreographyManager", "BrightnessController not available");
         return;
     }
     
-    int brightness = params.containsKey("brightness") ? params["brightness"].as<int>() : 128;
-    brightness = constrain(brightness, 0, 255);
-    
-    bc->setBrightness(brightness);
+    bc->setBrightness(params.brightness);
     
     LOG_DEBUGF_COMPONENT("ChoreographyManager", 
-        "Set brightness to %d via timeline event", brightness);
+        "Set brightness to %d via timeline event", params.brightness);
 }
 
-void ChoreographyManager::executeFirePulse(const JsonObject& params) {
+void ChoreographyManager::executeFirePulse(const ChoreoPulseParams& params, float phaseSec) {
     if (!pulsePlayersInitialized || !outputBuffer || numLEDs <= 0) {
         LOG_WARN_COMPONENT("ChoreographyManager", "Pulse players not initialized - cannot fire pulse");
         return;
     }
 
-    // Round-robin: use next slot in the pool
-    PulsePlayer* pp = &pulsePlayerPool[nextPulsePlayerIdx];
-    nextPulsePlayerIdx = (nextPulsePlayerIdx + 1) % PULSE_PLAYER_POOL_SIZE;
-
-    // Parse color (default white)
-    Light hiColor(255, 255, 255);
-    if (params.containsKey("hi_color")) {
-        String hiColorStr = params["hi_color"].as<String>();
-        parseColorString(hiColorStr, hiColor);
+    PulsePlayer* pp = allocatePulsePlayer();
+    if (!pp) {
+        return;  // Pool full and stealing disabled; counted as dropped
     }
 
-    // Parse pulse properties (match PulsePlayerEffect / EffectFactory naming where applicable)
-    int pulseWidth = params.containsKey("pulse_width") ? params["pulse_width"].as<int>() : 16;
-    if (pulseWidth < 1) pulseWidth = 1;
-    float speed = params.containsKey("speed") ? params["speed"].as<float>() : 50.0f;
-    bool reverse = params.containsKey("reverse") ? params["reverse"].as<bool>() : false;
-    if (reverse) speed = -speed;
-
-    pp->init(outputBuffer[0], numLEDs, hiColor, pulseWidth, speed, false);
+    const Light hiColor(params.hi.r, params.hi.g, params.hi.b);
+    pp->init(outputBuffer[0], numLEDs, hiColor, params.width, params.speed, false);
     pp->Start();
-
-    int slot = (nextPulsePlayerIdx + PULSE_PLAYER_POOL_SIZE - 1) % PULSE_PLAYER_POOL_SIZE;
-    // LOG_DEBUGF_COMPONENT("ChoreographyManager",
-    //     "Fired pulse (round-robin slot %d): width=%d, speed=%.1f", slot, pulseWidth, speed);
+    pp->tElap += phaseSec;  // Sub-frame beat phase
 }
 
-void ChoreographyManager::executeFireRing(const JsonObject& params) {
+void ChoreographyManager::executeFireRing(const ChoreoRingParams& params, float phaseSec) {
     if (!ringPlayersInitialized) {
         LOG_WARN_COMPONENT("ChoreographyManager", "Ring players not initialized - cannot fire ring");
         return;
     }
     
-    // Find an available ring player
-    RingPlayer* rp = findAvailableRingPlayer();
+    RingPlayer* rp = allocateRingPlayer();
     if (!rp) {
-        LOG_WARN_COMPONENT("ChoreographyManager", "No available ring player in pool - all are playing");
-        return;
+        return;  // Pool full and stealing disabled; counted as dropped
     }
     
-    // Parse position
-    float row = params.containsKey("row") ? params["row"].as<float>() : 16.0f;
-    float col = params.containsKey("col") ? params["col"].as<float>() : 16.0f;
+    // Configure ring player (missing row/col default to the grid center)
+    rp->setRingCenter(params.hasRow ? params.row : centerRow, params.hasCol ? params.col : centerCol);
+    rp->setRingProps(params.ringSpeed, params.ringWidth, params.fadeRadius, params.fadeWidth);
+    rp->hiLt = Light(params.hi.r, params.hi.g, params.hi.b);
+    rp->loLt = Light(params.lo.r, params.lo.g, params.lo.b);
+    rp->Amp = params.amplitude;
+    rp->onePulse = params.onePulse;
     
-    // Parse colors
-    Light hiColor(255, 255, 255); // Default white
-    Light loColor(0, 0, 0);       // Default black
-    
-    if (params.containsKey("hi_color")) {
-        String hiColorStr = params["hi_color"].as<String>();
-        parseColorString(hiColorStr, hiColor);
-    }
-    
-    if (params.containsKey("lo_color")) {
-        String loColorStr = params["lo_color"].as<String>();
-        parseColorString(loColorStr, loColor);
-    }
-    
-    // Parse ring properties
-    float ringSpeed = params.containsKey("ring_speed") ? params["ring_speed"].as<float>() : 100.0f;
-    float ringWidth = params.containsKey("ring_width") ? params["ring_width"].as<float>() : 2.0f;
-    float fadeRadius = params.containsKey("fade_radius") ? params["fade_radius"].as<float>() : 50.0f;
-    float fadeWidth = params.containsKey("fade_width") ? params["fade_width"].as<float>() : 4.0f;
-    float amplitude = params.containsKey("amplitude") ? params["amplitude"].as<float>() : 1.0f;
-    bool onePulse = params.containsKey("one_pulse") ? params["one_pulse"].as<bool>() : true;
-    
-    // Configure ring player
-    rp->setRingCenter(row, col);
-    rp->setRingProps(ringSpeed, ringWidth, fadeRadius, fadeWidth);
-    rp->hiLt = hiColor;
-    rp->loLt = loColor;
-    rp->Amp = amplitude;
-    rp->onePulse = onePulse;
-    
-    // Start the ring
+    // Start the ring, advanced by the sub-frame beat phase
     rp->Start();
-    
-    // LOG_DEBUGF_COMPONENT("ChoreographyManager", 
-    //     "Fired ring at (%.1f, %.1f) with speed=%.1f, width=%.1f, onePulse=%d",
-    //     row, col, ringSpeed, ringWidth, onePulse ? 1 : 0);
+    rp->tElap += phaseSec;
 }
 
 void ChoreographyManager::initializeRingPlayers(Light* buffer, int rows, int cols) {
@@ -641,14 +1034,26 @@ void ChoreographyManager::initializeRingPlayers(Light* buffer, int rows, int col
     outputBuffer = buffer;
     gridRows = rows;
     gridCols = cols;
+    centerRow = rows * 0.5f;
+    centerCol = cols * 0.5f;
     
+    // Custom fixture layouts render through the pixel map so rings only touch real LEDs
+    const bool useMap = g_pixelMap.isCustomLayout();
+    if (useMap) {
+        centerRow = g_pixelMap.centerY();
+        centerCol = g_pixelMap.centerX();
+    }
     for (auto& rp : ringPlayerPool) {
-        rp.initToGrid(buffer, rows, cols);
+        if (useMap) {
+            rp.initToMap(buffer, &g_pixelMap);
+        } else {
+            rp.initToGrid(buffer, rows, cols);
+        }
     }
     
     ringPlayersInitialized = true;
     LOG_DEBUGF_COMPONENT("ChoreographyManager", 
-        "Initialized %d ring players with grid %dx%d", RING_PLAYER_POOL_SIZE, rows, cols);
+        "Initialized %d ring players with grid %dx%d", (int) ringPlayerPool.size(), rows, cols);
 }
 
 void ChoreographyManager::initializePulsePlayers(Light* buffer, int numLeds) {
@@ -657,21 +1062,102 @@ void ChoreographyManager::initializePulsePlayers(Light* buffer, int numLeds) {
     outputBuffer = buffer;
     numLEDs = numLeds;
     for (auto& pp : pulsePlayerPool) {
-        // Park each player off-strip (doRepeat=false, no Start) so they're ready for round-robin fire
+        // Park each player off-strip (doRepeat=false, no Start) until its voice is allocated
         pp.init(buffer[0], numLeds, Light(0, 0, 0), 1, 1.0f, false);
     }
     pulsePlayersInitialized = true;
     LOG_DEBUGF_COMPONENT("ChoreographyManager",
-        "Initialized %d pulse players (round-robin) with %d LEDs", PULSE_PLAYER_POOL_SIZE, numLeds);
+        "Initialized %d pulse players with %d LEDs", (int) pulsePlayerPool.size(), numLeds);
 }
 
-RingPlayer* ChoreographyManager::findAvailableRingPlayer() {
-    for (auto& rp : ringPlayerPool) {
-        if (!rp.isPlaying) {
-            return &rp;
+// Rough light output of a voice in 0..1, for the Quietest steal policy
+static float lightLevel(uint8_t r, uint8_t g, uint8_t b) {
+    return (r + g + b) / 765.0f;
+}
+
+RingPlayer* ChoreographyManager::allocateRingPlayer() {
+    // Extent of the layout in ring units: the pixel map bounds, or the grid
+    float rowMin = 0.0f, rowMax = (float) gridRows;
+    float colMin = 0.0f, colMax = (float) gridCols;
+    if (g_pixelMap.isCustomLayout()) {
+        rowMin = g_pixelMap.centerY() - 0.5f * g_pixelMap.height();
+        rowMax = rowMin + g_pixelMap.height();
+        colMin = g_pixelMap.centerX() - 0.5f * g_pixelMap.width();
+        colMax = colMin + g_pixelMap.width();
+    }
+    const VoiceStealPolicy policy = ringVoices.getPolicy();
+    int voice = ringVoices.allocate(ShowClock::nowMs(), [&](int i) {
+        const RingPlayer& rp = ringPlayerPool[i];
+        float radius = rp.ringSpeed * rp.tElap;
+        if (policy == VoiceStealPolicy::Quietest) {
+            float fade = 1.0f;
+            if (radius > rp.fadeRadius) {
+                fade = rp.fadeWidth > 0.0f ? 1.0f - (radius - rp.fadeRadius) / rp.fadeWidth : 0.0f;
+                if (fade < 0.0f) fade = 0.0f;
+            }
+            return -rp.Amp * fade * lightLevel(rp.hiLt.r, rp.hiLt.g, rp.hiLt.b);
+        }
+        // FurthestOffGrid: how far the ring's inner edge is past the furthest corner
+        float dRow = fmaxf(fabsf(rp.fRowC - rowMin), fabsf(rp.fRowC - rowMax));
+        float dCol = fmaxf(fabsf(rp.fColC - colMin), fabsf(rp.fColC - colMax));
+        return radius - 0.5f * rp.ringWidth - sqrtf(dRow * dRow + dCol * dCol);
+    });
+    return voice >= 0 ? &ringPlayerPool[voice] : nullptr;
+}
+
+PulsePlayer* ChoreographyManager::allocatePulsePlayer() {
+    const VoiceStealPolicy policy = pulseVoices.getPolicy();
+    int voice = pulseVoices.allocate(ShowClock::nowMs(), [&](int i) {
+        const PulsePlayer& pp = pulsePlayerPool[i];
+        int center = pp.speed < 0.0f ? pp.numLts + (int) (pp.tElap * pp.speed) : pp.get_nMid();
+        // LEDs of the pulse past either end of the strip
+        float offStrip = fmaxf((float) (center - pp.hfW - pp.numLts), (float) (-center - pp.hfW));
+        if (policy == VoiceStealPolicy::Quietest) {
+            float width = 2.0f * pp.hfW;
+            float onStrip = width > 0.0f ? 1.0f + fminf(offStrip, 0.0f) / width : 0.0f;
+            onStrip = fmaxf(0.0f, fminf(onStrip, 1.0f));
+            return -onStrip * lightLevel((uint8_t) pp.fRd, (uint8_t) pp.fGn, (uint8_t) pp.fBu);
+        }
+        return offStrip;
+    });
+    return voice >= 0 ? &pulsePlayerPool[voice] : nullptr;
+}
+
+void ChoreographyManager::updateVoices(float dt) {
+    // Finished voices go back on the free list
+    if (ringPlayersInitialized) {
+        for (int i = 0; i < (int) ringPlayerPool.size(); i++) {
+            RingPlayer& rp = ringPlayerPool[i];
+            if (!rp.isPlaying || !rp.update(dt)) {
+                ringVoices.release(i);
+            }
         }
     }
-    return nullptr;
+    if (pulsePlayersInitialized) {
+        for (int i = 0; i < (int) pulsePlayerPool.size(); i++) {
+            if (!pulseVoices.isBusy(i)) continue;
+            PulsePlayer& pp = pulsePlayerPool[i];
+            pp.update(dt);
+            if (pp.isFinished()) {
+                pulseVoices.release(i);
+            }
+        }
+    }
+}
+
+void ChoreographyManager::stopVoices() {
+    if (ringPlayersInitialized) {
+        for (auto& rp : ringPlayerPool) {
+            rp.isPlaying = false;
+        }
+    }
+    if (pulsePlayersInitialized) {
+        for (auto& pp : pulsePlayerPool) {
+            pp.init(outputBuffer[0], numLEDs, Light(0, 0, 0), 1, 1.0f, false);
+        }
+    }
+    ringVoices.releaseAll();
+    pulseVoices.releaseAll();
 }
 
 void ChoreographyManager::saveCurrentState() {
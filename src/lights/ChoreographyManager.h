@@ -3,53 +3,99 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <vector>
-#include <array>
+#include <deque>
 #include "../controllers/BrightnessController.h"
 #include "../GlobalState.h"
 #include "freertos/LogManager.h"
 #include "RingPlayer.h"
 #include "PulsePlayer.h"
+#include "ChoreographyTimeline.h"
+#include "ChoreographyStream.h"
+#include "ChoreographyAnalyzer.h"
+#include "VoiceAllocator.h"
+#include "effects/EffectManager.h"
+
+/**
+ * Ring/pulse voice pools, from the settings.json "choreography" block
+ * ("ringVoices", "pulseVoices", "stealPolicy"). Set at boot before the
+ * LEDManager is created; a running ChoreographyManager keeps its sizes.
+ */
+struct ChoreoVoiceConfig {
+    int ringVoices = 15;
+    int pulseVoices = 15;
+    VoiceStealPolicy stealPolicy = VoiceStealPolicy::Oldest;
+};
+
+extern ChoreoVoiceConfig g_choreoVoiceConfig;
+
+/**
+ * Pre-flight cost model. Settings "choreography" can set "frameBudgetUs" and
+ * "baseFrameUs"; the grid, LED count and voice pools are taken from the live
+ * configuration each time a show is analyzed.
+ */
+extern ChoreoCostModel g_choreoCostModel;
 
-// Forward declaration
-class EffectManager;
 
 class ChoreographyManager {
 public:
+    // Built-in count-in duration (3 seconds); "count_in_ms" on start/seek shortens or skips it
+    static constexpr unsigned long DEFAULT_COUNT_IN_MS = 3100;
+    
     ChoreographyManager();
     ~ChoreographyManager();
     
-    // Lifecycle
+    // Lifecycle. A command with "file" streams the show from SD instead of
+    // carrying it inline (for shows too large for one JSON document).
+    // With "strict": true nothing plays until the show is compiled in full and
+    // its pre-flight estimate is done, and a show over the frame budget is refused.
     void startChoreography(const JsonObject& command, EffectManager* effectManager);
     void update(float dt);
-    void render(Light* outputBuffer, int numLEDs, int gridRows = 32, int gridCols = 32);
+    void render(Light* outputBuffer, int numLEDs, int gridRows, int gridCols);
     void stop();
     bool isActive() const { return active; }
+    /**
+     * Jump to timeMs (from the start of the timeline), restoring the effect and
+     * brightness the show would have there, then play a count-in of countInMs
+     * (0 = none). Returns false if no show is running or timeMs is past its end.
+     * While a streamed show is still compiling the seek is kept pending and
+     * applied on the frame the stream finishes (the last seek wins).
+     */
+    bool seek(uint32_t timeMs, unsigned long countInMs);
     
-private:
-    // Beat pattern structure - generic to support any action type
-    struct BeatPattern {
-        String id;
-        float bps;  // Beats per second (e.g., 1.0 = 1 beat/sec)
-        String action;  // Action type: "brightness_pulse", "fire_ring", "fire_pulse", etc.
-        String paramsJson;  // JSON string of action parameters (parsed when needed)
-        unsigned long startTime;  // Relative to choreography start (ms)
-        unsigned long endTime;    // When this beat pattern ends (ms, relative to choreography start)
-        unsigned long lastBeatTime;  // When we last fired this beat
-        bool active;
-        
-        unsigned long getIntervalMs() const {
-            return (unsigned long)(1000.0f / bps);
-        }
-    };
+    /**
+     * Playlist. queueChoreography() starts the show when nothing is playing
+     * and otherwise appends it. The next show is compiled in the background
+     * while the current one plays and is joined at its end: no state restore,
+     * no reparse, no count-in, and running voices carry over. A queued
+     * "strict" show that fails its pre-flight is skipped at the join. A show
+     * that is not ready at the boundary is joined on the first frame it is,
+     * with the current background playing on until then.
+     * skip() joins the next show now (stops if there is none); it returns
+     * false and changes nothing while the next show is still being prepared.
+     */
+    static constexpr size_t MAX_QUEUED_SHOWS = 8;
+    bool queueChoreography(const JsonObject& command, EffectManager* effectManager);
+    bool skip();
+    void clearQueue();
+    size_t queuedCount() const { return playlist.size(); }
     
-    // Timeline event structure - one-off actions at specific timestamps
-    struct TimelineEvent {
-        unsigned long time;  // When to fire (ms from choreography start)
-        String action;       // Action type: "change_effect", "set_brightness", "fire_ring", "fire_pulse", etc.
-        String paramsJson;  // JSON string of action parameters (parsed when needed)
-        bool executed;       // Has this event fired? (ensures it fires once and only once)
-    };
+    // Voice pool counters for the current (or last) show
+    const VoiceStats& getRingVoiceStats() const { return ringVoices.getStats(); }
+    const VoiceStats& getPulseVoiceStats() const { return pulseVoices.getStats(); }
+    int activeRingVoices() const { return ringVoices.activeCount(); }
+    int activePulseVoices() const { return pulseVoices.activeCount(); }
     
+    /**
+     * Pre-flight estimate of the current show, started once it is fully
+     * compiled (at start for inline shows, when the stream ends otherwise)
+     * and run a slice per frame. takePreflightReport() is true once per new
+     * report.
+     */
+    bool takePreflightReport();
+    const ChoreoPreflightReport& getPreflightReport() const { return preflight; }
+    ChoreoCostModel preflightModel() const;
+    
+private:
     // Saved state for restoration
     struct SavedState {
         String effectType;
@@ -59,52 +105,160 @@ private:
     };
     
     // Choreography state
-    std::vector<BeatPattern> beatPatterns;
-    std::vector<TimelineEvent> timelineEvents;
+    CompiledChoreography show;
+    ChoreographyScheduler scheduler;  // Event cursor + beat min-heap over show
+    bool backgroundApplied;
+    
+    // Automation lanes write into the primary effect's parameter slots;
+    // laneSlots[i] is lane i's slot on boundEffectId (-1 = not automatable)
+    ChoreoAutomationPlayer automation;
+    std::vector<int> laneSlots;
+    int boundEffectId;
+    
+    // Streamed shows: the first batch is compiled at start, then a batch per frame
+    static constexpr int STREAM_FIRST_BATCH = 64;
+    static constexpr int STREAM_BATCH = 8;
+    ChoreographyStreamLoader streamLoader;
+    ChoreoCompileStats streamStats;
+    
+    // Pre-flight of the current show, a slice of simulated frames per LED
+    // frame within workBudgetUs. A strict show holds (no count-in, no
+    // background) until it is compiled and has passed.
+    static constexpr uint32_t ANALYSIS_SLICE_FRAMES = 32;
+    ChoreographyAnalysis analysis;
+    uint32_t analysisMicros;       // LED task time spent on it so far
+    ChoreoPreflightReport preflight;
+    bool preflightPending;
+    bool holding;
+    
+    // Seek received while the show was still streaming
+    bool seekPending;
+    uint32_t pendingSeekMs;
+    unsigned long pendingSeekCountIn;
+    
+    // Queued shows. Nothing is compiled when a show is queued: an inline one
+    // keeps its JSON text. Once a show reaches the front, queueLoader
+    // compiles it a batch per frame and queueAnalysis runs its pre-flight in
+    // slices, both after the current show's own work and within workBudgetUs.
+    // A strict show that fails its pre-flight is refused at the join.
+    struct QueuedShow {
+        String file;
+        String json;               // Inline shows, until the loader takes it
+        std::unique_ptr<CompiledChoreography> show;
+        ChoreoPreflightReport preflight;
+        bool strict;
+        bool compiled;             // Compiled in full, pre-flight running
+        bool ready;                // Compiled in full and analyzed
+    };
+    std::deque<QueuedShow> playlist;
+    ChoreographyStreamLoader queueLoader;
+    ChoreoCompileStats queueStats;
+    ChoreographyAnalysis queueAnalysis;
+    // Opening effect of the next show, built ahead of the join in two stages
+    // like prewarmed, into its own buffer
+    std::unique_ptr<Effect> joinEffect;
+    EffectManager::PreparedEffect joinPrewarmed;
+    bool joinPrewarmTried;
+    bool joinWaiting;              // Past the end, the next show still being prepared
     SavedState savedState;
     
     unsigned long choreographyStartTime;
     unsigned long choreographyDuration;
     bool active;
     
-    // Built-in count-in duration (3 seconds)
-    static constexpr unsigned long COUNT_IN_DURATION = 3100;
+    unsigned long countInMs;
+    unsigned long timelineOffsetMs;      // Timeline position at the end of the count-in (set by seek)
     unsigned long lastCountInPulseTime;  // Track last count-in pulse to avoid firing multiple times
     
     EffectManager* effectManager;
     
-    // Ring player pool for fire_ring actions
-    static constexpr int RING_PLAYER_POOL_SIZE = 15;
-    std::array<RingPlayer, RING_PLAYER_POOL_SIZE> ringPlayerPool;
+    // Pre-warming: the next change_effect event within prewarmWindowMs is built
+    // ahead of time so firing it is just a swap. The build runs in two stages
+    // (construct, then initialize into a private output), at most one per quiet
+    // frame and only while the frame has spent less than workBudgetUs.
+    static constexpr uint32_t DEFAULT_PREWARM_MS = 1000;
+    static constexpr uint32_t DEFAULT_WORK_BUDGET_US = 3000;
+    uint32_t prewarmWindowMs;
+    uint32_t workBudgetUs;
+    size_t prewarmScan;            // First event index that may still need pre-warming
+    int prewarmedPayload;          // Payload index of the effect being built or built, -1 if none
+    std::unique_ptr<Effect> prewarmEffect;  // Constructed, not yet initialized
+    EffectManager::PreparedEffect prewarmed;
+    bool firedThisFrame;           // A beat/event fired this frame - not a quiet frame
+    uint32_t frameStartMicros;     // When this frame's update() started
+    
+    // What this frame did besides playing the timeline, for the timings below
+    enum class FrameWork : uint8_t { None, ColdChange, WarmChange, Prewarm };
+    FrameWork frameWork;
+    // Worst costs seen this show: the change_effect swap built at fire time
+    // (cold) and pre-warmed (warm), a pre-warm stage, and the whole update()
+    // of the frames each happened on
+    struct ChangeTimings {
+        uint32_t coldSwapUs = 0;
+        uint32_t warmSwapUs = 0;
+        uint32_t prewarmStepUs = 0;
+        uint32_t coldFrameUs = 0;
+        uint32_t warmFrameUs = 0;
+        uint32_t prewarmFrameUs = 0;
+    };
+    ChangeTimings changeTimings;
+    
+    // Ring player pool for fire_ring actions; ringVoices tracks which are busy
+    std::vector<RingPlayer> ringPlayerPool;
+    VoiceAllocator ringVoices;
     Light* outputBuffer;
     int gridRows;
     int gridCols;
+    float centerRow;  // Default ring center (grid center, or pixel map center)
+    float centerCol;
     bool ringPlayersInitialized;
 
-    // Pulse player pool for fire_pulse actions (round-robin)
-    static constexpr int PULSE_PLAYER_POOL_SIZE = 15;
-    std::array<PulsePlayer, PULSE_PLAYER_POOL_SIZE> pulsePlayerPool;
+    // Pulse player pool for fire_pulse actions; pulseVoices tracks which are busy
+    std::vector<PulsePlayer> pulsePlayerPool;
+    VoiceAllocator pulseVoices;
     int numLEDs;
     bool pulsePlayersInitialized;
-    int nextPulsePlayerIdx;
     
     // Methods
     void saveCurrentState();
     void restorePreviousState();
-    void updateBeatPatterns(unsigned long timelineElapsed);
+    void updateFrame(float dt);
+    void updateBeatPatterns(unsigned long timelineElapsed, float dt);
     void updateTimelineEvents(unsigned long timelineElapsed);
-    void executeBeatAction(BeatPattern& beat);
-    void executeEventAction(TimelineEvent& event);
-    void executeBrightnessPulse(const JsonObject& params);
-    void executeFireRing(const JsonObject& params);
-    void executeChangeEffect(const JsonObject& params);
-    void executeSetBrightness(const JsonObject& params);
+    void updateAutomation(unsigned long timelineElapsed);
+    void beginPreflight();
+    void stepPreflight();
+    void updateHold();
+    bool applySeek(uint32_t timeMs, unsigned long countIn);
+    // phaseSec: how far past the exact beat time we are firing (voices are advanced by it)
+    void executeAction(const ChoreoAction& action, float phaseSec = 0.0f);
+    bool openStream(const char* path);
+    std::unique_ptr<ChoreoByteSource> openSource(const char* path);
+    // Compile or analyze part of playlist.front(); false if it failed and was dropped
+    bool prepareQueuedShow(int maxElements);
+    // Drops refused strict shows; true if playlist.front() can be joined now
+    bool nextShowReady();
+    // Swap in the next ready show with its timeline starting at startMs
+    bool joinNextShow(unsigned long startMs);
+    void prewarmJoin(long timelineMs);
+    void logShowStats();
+    void continueStreaming(int maxElements);
+    void applyBackground();
+    void logCompileStats(const ChoreoCompileStats& stats);
+    void executeBrightnessPulse(const ChoreoBrightnessPulseParams& params);
+    void executeFireRing(const ChoreoRingParams& params, float phaseSec);
+    void executeChangeEffect(const JsonObject& effectObj);
+    void executeChangeEffect(uint16_t payloadIndex);
+    void prewarmUpcomingEffect(long timelineMs);
+    void dropPrewarm();
+    bool withinWorkBudget() const { return micros() - frameStartMicros < workBudgetUs; }
+    void executeSetBrightness(const ChoreoSetBrightnessParams& params);
     void executeUpdateEffectParams(const JsonObject& params);
-    void executeFirePulse(const JsonObject& params);
+    void executeFirePulse(const ChoreoPulseParams& params, float phaseSec);
     void initializeRingPlayers(Light* buffer, int rows, int cols);
     void initializePulsePlayers(Light* buffer, int numLeds);
-    RingPlayer* findAvailableRingPlayer();
-    
-    // Helper function to parse time strings (e.g., "0:45.500" or "45.500") to milliseconds
-    static unsigned long parseTimeString(const JsonVariant& timeValue);
+    RingPlayer* allocateRingPlayer();
+    PulsePlayer* allocatePulsePlayer();
+    void updateVoices(float dt);
+    void stopVoices();
 };
@@ -0,0 +1,235 @@
+#include "ChoreographyStream.h"
+#include <string.h>
+#include <ctype.h>
+
+ChoreographyStreamLoader::ChoreographyStreamLoader()
+    : state(State::Done), error(nullptr), bufferLen(0), bufferPos(0), totalRead(0),
+      elementDoc(ELEMENT_DOC_SIZE) {
+    // Only the fields the compiler reads are kept; "params" is kept whole
+    // since change_effect / update_effect_params hand it on as-is
+    static const char* const FIELDS[] = {
+        "time", "start_t", "end_t", "duration", "bps", "action", "params"
+    };
+    for (const char* field : FIELDS) {
+        elementFilter[field] = true;
+    }
+}
+
+void ChoreographyStreamLoader::begin(std::unique_ptr<ChoreoByteSource> src, CompiledChoreography& out) {
+    reset();
+    out.clear();
+    source = std::move(src);
+    state = source ? State::Start : State::Error;
+    error = source ? nullptr : "no source";
+}
+
+void ChoreographyStreamLoader::reset() {
+    source.reset();
+    paramDefs.reset();
+    state = State::Done;
+    error = nullptr;
+    bufferLen = bufferPos = totalRead = 0;
+}
+
+size_t ChoreographyStreamLoader::Reader::readBytes(char* out, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = loader->next();
+        if (c < 0) break;
+        out[n++] = (char) c;
+    }
+    return n;
+}
+
+int ChoreographyStreamLoader::peek() {
+    if (bufferPos >= bufferLen) {
+        if (!source) return -1;
+        bufferLen = source->readBytes(buffer, READ_BUFFER_SIZE);
+        bufferPos = 0;
+        totalRead += bufferLen;
+        if (bufferLen == 0) return -1;
+    }
+    return buffer[bufferPos];
+}
+
+int ChoreographyStreamLoader::next() {
+    int c = peek();
+    if (c >= 0) bufferPos++;
+    return c;
+}
+
+int ChoreographyStreamLoader::skipWhitespace() {
+    int c = peek();
+    while (c >= 0 && isspace(c)) {
+        bufferPos++;
+        c = peek();
+    }
+    return c;
+}
+
+bool ChoreographyStreamLoader::fail(const char* message) {
+    state = State::Error;
+    error = message;
+    return false;
+}
+
+bool ChoreographyStreamLoader::readKey(char* key, size_t size) {
+    if (next() != '"') {
+        return fail("expected key");
+    }
+    size_t len = 0;
+    for (;;) {
+        int c = next();
+        if (c < 0) return fail("unexpected end in key");
+        if (c == '"') break;
+        if (c == '\\') c = next();
+        if (len + 1 < size) key[len++] = (char) c;  // Long keys are truncated (and ignored)
+    }
+    key[len] = '\0';
+    return true;
+}
+
+bool ChoreographyStreamLoader::readScalar(char* out, size_t size) {
+    // A number, true/false/null or a quoted string, up to (not including) the
+    // next ',' or '}'. deserializeJson can't be used here: it consumes the
+    // character after a bare number.
+    size_t len = 0;
+    bool inString = false;
+    for (;;) {
+        int c = peek();
+        if (c < 0) return fail("unexpected end in value");
+        if (!inString && (c == ',' || c == '}' || isspace(c))) break;
+        bufferPos++;
+        if (c == '"') {
+            inString = !inString;
+        } else if (c == '\\' && inString) {
+            if (len + 1 < size) out[len++] = (char) c;
+            c = next();
+        }
+        if (len + 1 < size) out[len++] = (char) c;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+bool ChoreographyStreamLoader::readValue(const char* key, CompiledChoreography& out, ChoreoCompileStats* stats) {
+    Reader reader{this};
+    int c = skipWhitespace();
+
+    if (strcmp(key, "param_defs") == 0 && c == '{') {
+        paramDefs.reset(new DynamicJsonDocument(VALUE_DOC_SIZE));
+        if (deserializeJson(*paramDefs, reader)) {
+            return fail("bad param_defs");
+        }
+        paramDefs->shrinkToFit();
+        return true;
+    }
+
+    if (strcmp(key, "bg_effect") == 0 && c == '{') {
+        DynamicJsonDocument doc(VALUE_DOC_SIZE);
+        if (deserializeJson(doc, reader)) {
+            return fail("bad bg_effect");
+        }
+        ChoreographyCompiler::compileBackground(doc.as<JsonObjectConst>(), out);
+        return true;
+    }
+
+    if (strcmp(key, "automation") == 0 && c == '[') {
+        // Lanes are compiled whole; they're small next to beats/events
+        DynamicJsonDocument doc(VALUE_DOC_SIZE);
+        if (deserializeJson(doc, reader)) {
+            return fail("bad automation");
+        }
+        ChoreographyCompiler::compileAutomation(doc.as<JsonArrayConst>(), out, stats);
+        return true;
+    }
+
+    if (c == '{' || c == '[') {
+        // Skip anything else without storing it
+        StaticJsonDocument<16> skip;
+        skip.set(false);
+        StaticJsonDocument<16> sink;
+        DeserializationError err = deserializeJson(sink, reader, DeserializationOption::Filter(skip));
+        return err ? fail("bad value") : true;
+    }
+
+    char scalar[32];
+    if (!readScalar(scalar, sizeof(scalar))) {
+        return false;
+    }
+    if (strcmp(key, "duration") == 0) {
+        StaticJsonDocument<64> doc;
+        if (!deserializeJson(doc, scalar)) {
+            out.durationMs = ChoreographyCompiler::parseTime(doc.as<JsonVariantConst>());
+        }
+    }
+    return true;
+}
+
+bool ChoreographyStreamLoader::step(CompiledChoreography& out, int maxElements, ChoreoCompileStats* stats) {
+    Reader reader{this};
+    int count = 0;
+    while (count < maxElements) {
+        int c;
+        switch (state) {
+            case State::Start:
+                if (skipWhitespace() != '{') return fail("expected '{'");
+                next();
+                state = State::Key;
+                break;
+
+            case State::Key: {
+                c = skipWhitespace();
+                if (c < 0) return fail("unexpected end of show");
+                if (c == ',') { next(); break; }
+                if (c == '}') {
+                    next();
+                    state = State::Done;
+                    source.reset();  // Close the file as soon as we're done with it
+                    return false;
+                }
+                char key[24];
+                if (!readKey(key, sizeof(key))) return false;
+                if (skipWhitespace() != ':') return fail("expected ':'");
+                next();
+                c = skipWhitespace();
+                if (c == '[' && strcmp(key, "beats") == 0) {
+                    next();
+                    state = State::Beats;
+                } else if (c == '[' && strcmp(key, "events") == 0) {
+                    next();
+                    state = State::Events;
+                } else if (!readValue(key, out, stats)) {
+                    return false;
+                }
+                break;
+            }
+
+            case State::Beats:
+            case State::Events: {
+                c = skipWhitespace();
+                if (c < 0) return fail("unexpected end in array");
+                if (c == ',') { next(); break; }
+                if (c == ']') { next(); state = State::Key; break; }
+
+                DeserializationError err = deserializeJson(elementDoc, reader,
+                    DeserializationOption::Filter(elementFilter));
+                if (err) {
+                    return fail(err == DeserializationError::NoMemory ? "beat/event too large" : "bad beat/event");
+                }
+                JsonObjectConst defs = paramDefs ? paramDefs->as<JsonObjectConst>() : JsonObjectConst();
+                if (state == State::Beats) {
+                    ChoreographyCompiler::compileBeat(elementDoc.as<JsonObjectConst>(), defs, out, stats);
+                } else {
+                    ChoreographyCompiler::compileEvent(elementDoc.as<JsonObjectConst>(), defs, out, stats);
+                }
+                count++;
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include "ChoreographyTimeline.h"
+
+/**
+ * Source of show bytes for ChoreographyStreamLoader (an SD file, an upload
+ * buffer, ...). readBytes returns 0 at the end of the input.
+ */
+class ChoreoByteSource {
+public:
+    virtual ~ChoreoByteSource() = default;
+    virtual size_t readBytes(uint8_t* buffer, size_t length) = 0;
+};
+
+/**
+ * Streaming choreography loader
+ *
+ * Walks the top-level show object token by token and deserializes one value
+ * at a time with ArduinoJson's stream reader:
+ *   - each element of "beats" / "events" goes through a fixed-size document
+ *     (filtered to the fields the compiler reads) and is compiled straight
+ *     into the CompiledChoreography
+ *   - "bg_effect" becomes a payload, "param_defs" is kept for name lookups,
+ *     "automation" lanes are compiled whole
+ *   - "duration" is read as a scalar, anything else is skipped unparsed
+ * Peak RAM is the read buffer, the element document and param_defs,
+ * whatever the length of the show.
+ *
+ * step() compiles a bounded batch, so playback can start after the first
+ * batch and the rest is compiled a little every frame. "param_defs" must come
+ * before the beats/events that refer to it.
+ */
+class ChoreographyStreamLoader {
+public:
+    static constexpr size_t READ_BUFFER_SIZE = 512;
+    static constexpr size_t ELEMENT_DOC_SIZE = 4096;    // One beat or event
+    static constexpr size_t VALUE_DOC_SIZE = 8192;      // bg_effect / param_defs / automation
+
+    ChoreographyStreamLoader();
+
+    // Start reading from source (takes ownership). out is cleared.
+    void begin(std::unique_ptr<ChoreoByteSource> source, CompiledChoreography& out);
+    // Drop the source and any loader state
+    void reset();
+
+    /**
+     * Compile up to maxElements beats/events into out (top-level values in
+     * between are handled as they come). Returns true while there is more to
+     * load; false once the show is complete or loading failed.
+     */
+    bool step(CompiledChoreography& out, int maxElements, ChoreoCompileStats* stats = nullptr);
+
+    bool isLoading() const { return state != State::Done && state != State::Error && source != nullptr; }
+    bool hasError() const { return state == State::Error; }
+    const char* errorMessage() const { return error; }
+    size_t bytesRead() const { return totalRead; }
+
+    // ArduinoJson custom reader over the buffered source
+    struct Reader {
+        ChoreographyStreamLoader* loader;
+        int read() { return loader->next(); }
+        size_t readBytes(char* buffer, size_t length);
+    };
+
+private:
+    enum class State : uint8_t { Start, Key, Beats, Events, Done, Error };
+
+    std::unique_ptr<ChoreoByteSource> source;
+    State state;
+    const char* error;
+    uint8_t buffer[READ_BUFFER_SIZE];
+    size_t bufferLen;
+    size_t bufferPos;
+    size_t totalRead;
+
+    DynamicJsonDocument elementDoc;
+    StaticJsonDocument<256> elementFilter;
+    std::unique_ptr<DynamicJsonDocument> paramDefs;
+
+    int peek();
+    int next();
+    int skipWhitespace();      // Returns the next non-space char without consuming it
+    bool readKey(char* key, size_t size);
+    bool readScalar(char* out, size_t size);
+    bool readValue(const char* key, CompiledChoreography& out, ChoreoCompileStats* stats);
+    bool fail(const char* message);
+};
@@ -0,0 +1,541 @@
+#include "ChoreographyTimeline.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <math.h>
+
+void CompiledChoreography::clear() {
+    events.clear();
+    beats.clear();
+    payloads.clear();
+    checkpoints.clear();
+    lanes.clear();
+    segments.clear();
+    backgroundPayload = -1;
+    durationMs = 0;
+}
+
+JsonObject CompiledChoreography::payload(uint16_t index) const {
+    if (index >= payloads.size() || !payloads[index]) {
+        return JsonObject();
+    }
+    return payloads[index]->as<JsonObject>();
+}
+
+void CompiledChoreography::buildCheckpoints(uint32_t intervalMs) {
+    checkpoints.clear();
+    if (intervalMs == 0) return;
+    uint32_t endMs = durationMs;
+    if (!events.empty() && events.back().timeMs > endMs) {
+        endMs = events.back().timeMs;
+    }
+    checkpoints.reserve(endMs / intervalMs + 1);
+
+    ChoreoCheckpoint cp = {0, 0, -1, -1};
+    for (uint32_t t = 0; t <= endMs; t += intervalMs) {
+        while (cp.eventIndex < events.size() && events[cp.eventIndex].timeMs < t) {
+            const ChoreoAction& action = events[cp.eventIndex].action;
+            if (action.type == ChoreoActionType::ChangeEffect) {
+                cp.effectEvent = (int32_t) cp.eventIndex;
+            } else if (action.type == ChoreoActionType::SetBrightness) {
+                cp.brightness = action.setBrightness.brightness;
+            }
+            cp.eventIndex++;
+        }
+        cp.timeMs = t;
+        checkpoints.push_back(cp);
+    }
+}
+
+ChoreoSeekState CompiledChoreography::stateAt(uint32_t timeMs) const {
+    ChoreoCheckpoint cp = {0, 0, -1, -1};
+    if (!checkpoints.empty()) {
+        // Checkpoints are evenly spaced and sorted; take the last one <= timeMs
+        auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), timeMs,
+            [](uint32_t t, const ChoreoCheckpoint& c) { return t < c.timeMs; });
+        if (it != checkpoints.begin()) {
+            cp = *(it - 1);
+        }
+    }
+
+    ChoreoSeekState state = {cp.eventIndex, cp.effectEvent, cp.brightness, cp.timeMs, 0};
+    while (state.eventIndex < events.size() && events[state.eventIndex].timeMs < timeMs) {
+        const ChoreoAction& action = events[state.eventIndex].action;
+        if (action.type == ChoreoActionType::ChangeEffect) {
+            state.effectEvent = (int32_t) state.eventIndex;
+        } else if (action.type == ChoreoActionType::SetBrightness) {
+            state.brightness = action.setBrightness.brightness;
+        }
+        state.eventIndex++;
+        state.replayedEvents++;
+    }
+    return state;
+}
+
+uint32_t ChoreographyCompiler::parseTime(JsonVariantConst value) {
+    if (value.is<float>() || value.is<long>()) {
+        float ms = value.as<float>();
+        return ms > 0.0f ? (uint32_t) (ms + 0.5f) : 0;
+    }
+
+    const char* str = value.as<const char*>();
+    if (!str) {
+        return 0;
+    }
+    while (isspace((unsigned char) *str)) str++;
+
+    // Optional "M:" prefix, then seconds with an optional fraction
+    uint32_t minutes = 0;
+    const char* colon = strchr(str, ':');
+    if (colon) {
+        minutes = (uint32_t) strtoul(str, nullptr, 10);
+        str = colon + 1;
+    }
+    char* end = nullptr;
+    uint32_t seconds = (uint32_t) strtoul(str, &end, 10);
+    uint32_t ms = 0;
+    if (end && *end == '.') {
+        // Fraction of a second: ".5" = 500 ms, ".520" = 520 ms
+        uint32_t scale = 100;
+        for (const char* p = end + 1; isdigit((unsigned char) *p) && scale > 0; p++) {
+            ms += (uint32_t) (*p - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return minutes * 60000UL + seconds * 1000UL + ms;
+}
+
+bool ChoreographyCompiler::parseColor(const char* str, ChoreoColor& out) {
+    out = ChoreoColor{255, 255, 255};
+    if (!str || strncmp(str, "rgb(", 4) != 0) {
+        return false;
+    }
+    const char* p = str + 4;
+    int values[3];
+    for (int i = 0; i < 3; i++) {
+        char* end = nullptr;
+        long v = strtol(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+        values[i] = v < 0 ? 0 : (v > 255 ? 255 : (int) v);
+        while (isspace((unsigned char) *end)) end++;
+        if (*end != (i < 2 ? ',' : ')')) {
+            return false;
+        }
+        p = end + 1;
+    }
+    out = ChoreoColor{(uint8_t) values[0], (uint8_t) values[1], (uint8_t) values[2]};
+    return true;
+}
+
+ChoreoActionType ChoreographyCompiler::actionFromName(const char* name) {
+    if (!name) return ChoreoActionType::None;
+    if (strcmp(name, "brightness_pulse") == 0) return ChoreoActionType::BrightnessPulse;
+    if (strcmp(name, "fire_ring") == 0) return ChoreoActionType::FireRing;
+    if (strcmp(name, "fire_pulse") == 0) return ChoreoActionType::FirePulse;
+    if (strcmp(name, "change_effect") == 0) return ChoreoActionType::ChangeEffect;
+    if (strcmp(name, "set_brightness") == 0) return ChoreoActionType::SetBrightness;
+    if (strcmp(name, "update_effect_params") == 0) return ChoreoActionType::UpdateEffectParams;
+    return ChoreoActionType::None;
+}
+
+const char* ChoreographyCompiler::actionName(ChoreoActionType type) {
+    switch (type) {
+        case ChoreoActionType::BrightnessPulse: return "brightness_pulse";
+        case ChoreoActionType::FireRing: return "fire_ring";
+        case ChoreoActionType::FirePulse: return "fire_pulse";
+        case ChoreoActionType::ChangeEffect: return "change_effect";
+        case ChoreoActionType::SetBrightness: return "set_brightness";
+        case ChoreoActionType::UpdateEffectParams: return "update_effect_params";
+        default: return "none";
+    }
+}
+
+ChoreoInterp ChoreographyCompiler::interpFromName(const char* name, ChoreoInterp fallback) {
+    if (!name) return fallback;
+    if (strcmp(name, "step") == 0) return ChoreoInterp::Step;
+    if (strcmp(name, "linear") == 0) return ChoreoInterp::Linear;
+    if (strcmp(name, "smooth") == 0) return ChoreoInterp::Smooth;
+    if (strcmp(name, "exp") == 0 || strcmp(name, "exponential") == 0) return ChoreoInterp::Exponential;
+    return fallback;
+}
+
+static uint8_t clampByte(int v) {
+    return (uint8_t) (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static void compileColor(JsonObjectConst params, const char* key, ChoreoColor& out, ChoreoColor fallback,
+                         ChoreoCompileStats* stats) {
+    out = fallback;
+    const char* str = params[key].as<const char*>();
+    if (str && !ChoreographyCompiler::parseColor(str, out) && stats) {
+        stats->badColors++;
+    }
+}
+
+bool ChoreographyCompiler::compileAction(const char* action, JsonObjectConst params, bool allowEventActions,
+                                         CompiledChoreography& show, ChoreoAction& out, ChoreoCompileStats* stats) {
+    out = ChoreoAction{};
+    out.type = actionFromName(action);
+
+    switch (out.type) {
+        case ChoreoActionType::BrightnessPulse:
+            out.brightnessPulse.base = clampByte(params["base"] | 128);
+            out.brightnessPulse.peak = clampByte(params["peak"] | 255);
+            out.brightnessPulse.durationMs = params["pulse_duration"] | 250UL;
+            return true;
+
+        case ChoreoActionType::FireRing: {
+            ChoreoRingParams& ring = out.ring;
+            ring.hasRow = params.containsKey("row");
+            ring.hasCol = params.containsKey("col");
+            ring.row = params["row"] | 0.0f;
+            ring.col = params["col"] | 0.0f;
+            compileColor(params, "hi_color", ring.hi, ChoreoColor{255, 255, 255}, stats);
+            compileColor(params, "lo_color", ring.lo, ChoreoColor{0, 0, 0}, stats);
+            ring.ringSpeed = params["ring_speed"] | 100.0f;
+            ring.ringWidth = params["ring_width"] | 2.0f;
+            ring.fadeRadius = params["fade_radius"] | 50.0f;
+            ring.fadeWidth = params["fade_width"] | 4.0f;
+            ring.amplitude = params["amplitude"] | 1.0f;
+            ring.onePulse = params["one_pulse"] | true;
+            return true;
+        }
+
+        case ChoreoActionType::FirePulse: {
+            ChoreoPulseParams& pulse = out.pulse;
+            compileColor(params, "hi_color", pulse.hi, ChoreoColor{255, 255, 255}, stats);
+            int width = params["pulse_width"] | 16;
+            pulse.width = (int16_t) (width < 1 ? 1 : width);
+            pulse.speed = params["speed"] | 50.0f;
+            if (fabsf(pulse.speed) < 0.001f) {
+                // Would never move, let alone leave the strip (PulsePlayer treats it as finished)
+                if (stats) stats->badPulseSpeeds++;
+                out.type = ChoreoActionType::None;
+                return false;
+            }
+            if (params["reverse"] | false) {
+                pulse.speed = -pulse.speed;
+            }
+            return true;
+        }
+
+        case ChoreoActionType::SetBrightness:
+            if (!allowEventActions) break;
+            out.setBrightness.brightness = clampByte(params["brightness"] | 128);
+            return true;
+
+        case ChoreoActionType::ChangeEffect:
+        case ChoreoActionType::UpdateEffectParams: {
+            if (!allowEventActions) break;
+            JsonObjectConst payloadSource = params;
+            if (out.type == ChoreoActionType::ChangeEffect) {
+                payloadSource = params["effect"].as<JsonObjectConst>();
+                if (payloadSource.isNull()) break;
+            }
+            int index = addPayload(show, payloadSource);
+            if (index < 0) break;
+            out.payload.index = (uint16_t) index;
+            return true;
+        }
+
+        default:
+            break;
+    }
+
+    if (stats) stats->unknownActions++;
+    out.type = ChoreoActionType::None;
+    return false;
+}
+
+int ChoreographyCompiler::addPayload(CompiledChoreography& show, JsonObjectConst obj) {
+    // Own a copy sized to the source so the command document can be freed
+    std::unique_ptr<DynamicJsonDocument> doc(new DynamicJsonDocument(obj.memoryUsage() + 128));
+    if (!doc->set(obj)) {
+        return -1;
+    }
+    doc->shrinkToFit();
+    show.payloads.push_back(std::move(doc));
+    return (int) show.payloads.size() - 1;
+}
+
+JsonObjectConst ChoreographyCompiler::resolveParams(JsonVariantConst params, JsonObjectConst paramDefs,
+                                                    ChoreoCompileStats* stats) {
+    if (params.is<JsonObjectConst>()) {
+        return params.as<JsonObjectConst>();
+    }
+    // Compact form: "params": "name" refers to an entry of the top-level param_defs
+    const char* name = params.as<const char*>();
+    if (name && !paramDefs.isNull()) {
+        JsonObjectConst resolved = paramDefs[name].as<JsonObjectConst>();
+        if (resolved.isNull() && stats) {
+            stats->missingParamDefs++;
+        }
+        return resolved;
+    }
+    return JsonObjectConst();
+}
+
+bool ChoreographyCompiler::compileBeat(JsonObjectConst beat, JsonObjectConst paramDefs, CompiledChoreography& out,
+                                       ChoreoCompileStats* stats) {
+    // Skip empty {} placeholders in the beats array
+    if (beat.size() == 0) {
+        if (stats) stats->skippedEmptyBeats++;
+        return false;
+    }
+    ChoreoBeat record;
+    record.bps = beat["bps"] | 1.0f;
+    if (record.bps <= 0.0f) record.bps = 1.0f;
+    record.startMs = parseTime(beat["start_t"]);
+    // Support both "duration" and "end_t"
+    if (beat.containsKey("duration")) {
+        record.endMs = record.startMs + parseTime(beat["duration"]);
+    } else {
+        record.endMs = parseTime(beat["end_t"]);
+    }
+    const char* action = beat["action"] | "brightness_pulse";
+    JsonObjectConst params = resolveParams(beat["params"], paramDefs, stats);
+    if (!compileAction(action, params, false, out, record.action, stats)) {
+        return false;
+    }
+    out.beats.push_back(record);
+    if (stats) stats->beats++;
+    return true;
+}
+
+bool ChoreographyCompiler::compileEvent(JsonObjectConst event, JsonObjectConst paramDefs, CompiledChoreography& out,
+                                        ChoreoCompileStats* stats) {
+    ChoreoEvent record;
+    record.timeMs = parseTime(event["time"]);
+    const char* action = event["action"] | "";
+    JsonObjectConst params = resolveParams(event["params"], paramDefs, stats);
+    if (!compileAction(action, params, true, out, record.action, stats)) {
+        return false;
+    }
+    out.events.push_back(record);
+    if (stats) stats->events++;
+    return true;
+}
+
+bool ChoreographyCompiler::compileBackground(JsonObjectConst bgEffect, CompiledChoreography& out) {
+    if (bgEffect.isNull()) {
+        return false;
+    }
+    out.backgroundPayload = addPayload(out, bgEffect);
+    return out.backgroundPayload >= 0;
+}
+
+int ChoreographyCompiler::compileAutomation(JsonArrayConst lanes, CompiledChoreography& out,
+                                           ChoreoCompileStats* stats) {
+    struct Key {
+        uint32_t timeMs;
+        float value;
+        ChoreoInterp interp;
+    };
+    std::vector<Key> keys;
+    int added = 0;
+    for (JsonObjectConst laneObj : lanes) {
+        const char* param = laneObj["param"] | (const char*) nullptr;
+        JsonArrayConst keyArray = laneObj["keys"].as<JsonArrayConst>();
+        if (!param || !*param || keyArray.size() == 0) {
+            if (stats) stats->badAutomation++;
+            continue;
+        }
+        const ChoreoInterp laneInterp = interpFromName(laneObj["interp"] | (const char*) nullptr);
+
+        keys.clear();
+        for (JsonVariantConst k : keyArray) {
+            Key key;
+            if (k.is<JsonArrayConst>()) {
+                key.timeMs = parseTime(k[0]);
+                key.value = k[1] | 0.0f;
+                key.interp = laneInterp;
+            } else {
+                key.timeMs = parseTime(k["time"]);
+                key.value = k["value"] | 0.0f;
+                key.interp = interpFromName(k["interp"] | (const char*) nullptr, laneInterp);
+            }
+            keys.push_back(key);
+        }
+        std::stable_sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) { return a.timeMs < b.timeMs; });
+
+        ChoreoAutomationLane lane;
+        strncpy(lane.param, param, ChoreoAutomationLane::MAX_PARAM_NAME);
+        lane.param[ChoreoAutomationLane::MAX_PARAM_NAME] = '\0';
+        lane.firstSegment = (uint32_t) out.segments.size();
+        // n keys make n - 1 segments; a lone key is a segment that just holds its value
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (i + 1 == keys.size() && keys.size() > 1) break;
+            const Key& a = keys[i];
+            const Key& b = i + 1 < keys.size() ? keys[i + 1] : keys[i];
+            out.segments.push_back(ChoreoAutomationSegment{a.timeMs, b.timeMs, a.value, b.value, a.interp});
+        }
+        lane.segmentCount = (uint32_t) out.segments.size() - lane.firstSegment;
+        out.lanes.push_back(lane);
+        added++;
+        if (stats) {
+            stats->automationLanes++;
+            stats->automationKeys += (int) keys.size();
+        }
+    }
+    return added;
+}
+
+void ChoreographyCompiler::sortEvents(CompiledChoreography& show, size_t from) {
+    // Events are consumed in time order through a cursor; equal times keep file order
+    if (from >= show.events.size()) return;
+    std::stable_sort(show.events.begin() + from, show.events.end(),
+        [](const ChoreoEvent& a, const ChoreoEvent& b) { return a.timeMs < b.timeMs; });
+}
+
+void ChoreographyCompiler::mergeEvents(CompiledChoreography& show, size_t from, size_t added) {
+    if (added >= show.events.size()) return;
+    sortEvents(show, added);
+    if (from >= added) return;
+    // Stable too: on equal times the earlier batch stays first
+    std::inplace_merge(show.events.begin() + from, show.events.begin() + added, show.events.end(),
+        [](const ChoreoEvent& a, const ChoreoEvent& b) { return a.timeMs < b.timeMs; });
+}
+
+bool ChoreographyCompiler::compile(JsonObjectConst command, CompiledChoreography& out, ChoreoCompileStats* stats) {
+    out.clear();
+    JsonObjectConst paramDefs = command["param_defs"].as<JsonObjectConst>();
+
+    compileBackground(command["bg_effect"].as<JsonObjectConst>(), out);
+
+    JsonArrayConst beats = command["beats"].as<JsonArrayConst>();
+    out.beats.reserve(beats.size());
+    for (JsonObjectConst beat : beats) {
+        compileBeat(beat, paramDefs, out, stats);
+    }
+
+    JsonArrayConst events = command["events"].as<JsonArrayConst>();
+    out.events.reserve(events.size());
+    for (JsonObjectConst event : events) {
+        compileEvent(event, paramDefs, out, stats);
+    }
+    sortEvents(out, 0);
+
+    compileAutomation(command["automation"].as<JsonArrayConst>(), out, stats);
+
+    out.durationMs = parseTime(command["duration"]);
+    out.buildCheckpoints();
+    return !out.beats.empty() || !out.events.empty() || !out.lanes.empty() || out.backgroundPayload >= 0;
+}
+
+void ChoreographyScheduler::start(const CompiledChoreography& compiled) {
+    show = &compiled;
+    nextEvent = 0;
+    skipped = 0;
+    beatQueue.clear();
+    beatQueue.reserve(compiled.beats.size());
+    for (size_t i = 0; i < compiled.beats.size(); i++) {
+        pushBeat((uint16_t) i, 1);
+    }
+}
+
+void ChoreographyScheduler::addBeat(size_t index) {
+    if (!show || index >= show->beats.size()) return;
+    // One heap slot per beat: grow here, with the batch, rather than in pushBeat
+    beatQueue.reserve(show->beats.size());
+    pushBeat((uint16_t) index, 1);
+}
+
+void ChoreographyScheduler::seek(uint32_t timeMs, size_t eventIndex) {
+    if (!show) return;
+    nextEvent = eventIndex;
+    beatQueue.clear();
+    for (size_t i = 0; i < show->beats.size(); i++) {
+        const ChoreoBeat& beat = show->beats[i];
+        if (beat.endMs > 0 && beat.endMs <= timeMs) {
+            continue;
+        }
+        // First beat at or after timeMs (beats start at n = 1)
+        uint32_t n = 1;
+        if (timeMs > beat.startMs) {
+            double period = 1000.0 / beat.bps;
+            n = (uint32_t) ceil((timeMs - beat.startMs) / period);
+            if (n < 1) n = 1;
+        }
+        pushBeat((uint16_t) i, n);
+    }
+}
+
+void ChoreographyScheduler::clear() {
+    show = nullptr;
+    nextEvent = 0;
+    beatQueue.clear();
+}
+
+bool ChoreographyScheduler::laterThan(const BeatEntry& a, const BeatEntry& b) {
+    if (a.dueMs != b.dueMs) return a.dueMs > b.dueMs;
+    return a.beat > b.beat;
+}
+
+void ChoreographyScheduler::popBeat() {
+    std::pop_heap(beatQueue.begin(), beatQueue.end(), laterThan);
+    beatQueue.pop_back();
+}
+
+void ChoreographyScheduler::pushBeat(uint16_t beat, uint32_t n) {
+    // At most one entry per beat, and a beat is re-pushed only after its pop,
+    // so this stays within the size reserved in start() / addBeat()
+    const ChoreoBeat& record = show->beats[beat];
+    beatQueue.push_back(BeatEntry{record.startMs + n * (1000.0 / record.bps), n, beat});
+    std::push_heap(beatQueue.begin(), beatQueue.end(), laterThan);
+}
+
+float ChoreoAutomationSegment::valueAt(uint32_t timeMs) const {
+    if (timeMs >= endMs) return to;
+    if (timeMs <= startMs) return from;
+    float u = (float) (timeMs - startMs) / (float) (endMs - startMs);
+    switch (interp) {
+        case ChoreoInterp::Step:
+            return from;
+        case ChoreoInterp::Smooth:
+            u = u * u * (3.0f - 2.0f * u);
+            break;
+        case ChoreoInterp::Exponential:
+            if ((from > 0.0f && to > 0.0f) || (from < 0.0f && to < 0.0f)) {
+                return from * powf(to / from, u);
+            }
+            break;
+        default:
+            break;
+    }
+    return from + (to - from) * u;
+}
+
+void ChoreoAutomationPlayer::start(const CompiledChoreography& compiled) {
+    show = &compiled;
+    cursors.assign(compiled.lanes.size(), Cursor{0, 0.0f, false});
+}
+
+void ChoreoAutomationPlayer::clear() {
+    show = nullptr;
+    cursors.clear();
+}
+
+void ChoreoAutomationPlayer::seek(uint32_t timeMs) {
+    if (!show) return;
+    for (size_t i = 0; i < cursors.size(); i++) {
+        const ChoreoAutomationLane& lane = show->lanes[i];
+        // Last segment starting at or before timeMs
+        uint32_t lo = 0, hi = lane.segmentCount;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (show->segments[lane.firstSegment + mid].startMs <= timeMs) lo = mid + 1;
+            else hi = mid;
+        }
+        cursors[i].segment = lo > 0 ? lo - 1 : 0;
+        cursors[i].reported = false;
+    }
+}
+
+void ChoreoAutomationPlayer::invalidate() {
+    for (Cursor& cursor : cursors) {
+        cursor.reported = false;
+    }
+}
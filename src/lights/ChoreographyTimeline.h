@@ -0,0 +1,373 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/**
+ * Compiled choreography timeline
+ *
+ * startChoreography() compiles the JSON show once into these POD records:
+ * action types are enums, colors are pre-parsed and all times are in ms.
+ * Firing a beat or event then only reads a record - no JSON documents,
+ * no String parsing and no heap allocation on the hot path.
+ *
+ * Actions that hand JSON to other systems (change_effect for EffectFactory,
+ * update_effect_params for Effect::updateParams) keep their params in a
+ * payload document that is also built once at compile time.
+ *
+ * Automation lanes ("automation": [{"param", "interp", "keys"}]) compile
+ * into piecewise segments evaluated per frame by ChoreoAutomationPlayer and
+ * written straight into the effect's typed parameter slots.
+ *
+ * This file only depends on ArduinoJson so it can be built and benchmarked
+ * on the host (see test/test_choreography_timeline).
+ */
+
+enum class ChoreoActionType : uint8_t {
+    None = 0,
+    BrightnessPulse,
+    FireRing,
+    FirePulse,
+    ChangeEffect,
+    SetBrightness,
+    UpdateEffectParams
+};
+
+struct ChoreoColor {
+    uint8_t r, g, b;
+};
+
+struct ChoreoRingParams {
+    float row, col;          // Only meaningful when hasRow / hasCol are set
+    ChoreoColor hi, lo;
+    float ringSpeed;
+    float ringWidth;
+    float fadeRadius;
+    float fadeWidth;
+    float amplitude;
+    bool onePulse;
+    bool hasRow, hasCol;     // Missing row/col use the grid center at fire time
+};
+
+struct ChoreoPulseParams {
+    ChoreoColor hi;
+    int16_t width;
+    float speed;             // Negative when "reverse" is set
+};
+
+struct ChoreoBrightnessPulseParams {
+    uint8_t base, peak;
+    uint32_t durationMs;
+};
+
+struct ChoreoSetBrightnessParams {
+    uint8_t brightness;
+};
+
+struct ChoreoPayloadParams {
+    uint16_t index;          // Into CompiledChoreography::payloads
+};
+
+struct ChoreoAction {
+    ChoreoActionType type;
+    union {
+        ChoreoRingParams ring;
+        ChoreoPulseParams pulse;
+        ChoreoBrightnessPulseParams brightnessPulse;
+        ChoreoSetBrightnessParams setBrightness;
+        ChoreoPayloadParams payload;
+    };
+};
+
+struct ChoreoEvent {
+    uint32_t timeMs;         // From the end of the count-in
+    ChoreoAction action;
+};
+
+struct ChoreoBeat {
+    uint32_t startMs;
+    uint32_t endMs;          // 0 = never ends
+    float bps;
+    ChoreoAction action;
+};
+
+// Curve shape from one automation key to the next
+enum class ChoreoInterp : uint8_t {
+    Step = 0,      // Hold the earlier key's value until the next key
+    Linear,
+    Smooth,        // Smoothstep: eases out of and into both keys
+    Exponential    // Constant ratio per ms; linear if the keys differ in sign or touch zero
+};
+
+struct ChoreoAutomationSegment {
+    uint32_t startMs;
+    uint32_t endMs;
+    float from, to;
+    ChoreoInterp interp;
+
+    // Clamped to from before startMs and to after endMs
+    float valueAt(uint32_t timeMs) const;
+};
+
+/**
+ * One automation lane: the effect parameter it drives and its range of
+ * CompiledChoreography::segments (time-ordered, back to back).
+ */
+struct ChoreoAutomationLane {
+    static constexpr size_t MAX_PARAM_NAME = 15;
+    char param[MAX_PARAM_NAME + 1];
+    uint32_t firstSegment;
+    uint32_t segmentCount;
+};
+
+/**
+ * Show state at a point in time, for seeking. Beat patterns need no
+ * checkpointing: which are running (and their next beat) follows from the
+ * analytic beat clock.
+ */
+struct ChoreoCheckpoint {
+    uint32_t timeMs;
+    uint32_t eventIndex;     // First event with timeMs >= this time
+    int32_t effectEvent;     // Last change_effect event before it, -1 = bg_effect
+    int16_t brightness;      // Last set_brightness before it, -1 = none yet
+};
+
+// What a seek must restore: the checkpoint plus the events after it
+struct ChoreoSeekState {
+    uint32_t eventIndex;     // Cursor position for the seek target
+    int32_t effectEvent;
+    int16_t brightness;
+    uint32_t checkpointMs;
+    uint32_t replayedEvents; // Events scanned past the checkpoint
+};
+
+class CompiledChoreography {
+public:
+    static constexpr uint32_t CHECKPOINT_INTERVAL_MS = 10000;
+
+    std::vector<ChoreoEvent> events;     // Sorted by timeMs
+    std::vector<ChoreoBeat> beats;
+    std::vector<std::unique_ptr<DynamicJsonDocument>> payloads;
+    std::vector<ChoreoCheckpoint> checkpoints;  // Every CHECKPOINT_INTERVAL_MS from 0
+    std::vector<ChoreoAutomationLane> lanes;
+    std::vector<ChoreoAutomationSegment> segments;
+    int backgroundPayload = -1;  // Payload index of bg_effect, -1 if none
+    uint32_t durationMs = 0;     // 0 = runs until stopped
+
+    void clear();
+    JsonObject payload(uint16_t index) const;
+
+    // Rebuild checkpoints from the (sorted) events
+    void buildCheckpoints(uint32_t intervalMs = CHECKPOINT_INTERVAL_MS);
+    // Start from the nearest checkpoint at or before timeMs and replay the events after it
+    ChoreoSeekState stateAt(uint32_t timeMs) const;
+};
+
+/**
+ * Counters from a compile, so the caller can log what was dropped.
+ */
+struct ChoreoCompileStats {
+    int events = 0;
+    int beats = 0;
+    int skippedEmptyBeats = 0;
+    int unknownActions = 0;
+    int missingParamDefs = 0;
+    int badColors = 0;
+    int badPulseSpeeds = 0;  // fire_pulse with speed 0, dropped
+    int automationLanes = 0;
+    int automationKeys = 0;
+    int badAutomation = 0;   // Lanes without a param or keys
+};
+
+class ChoreographyCompiler {
+public:
+    /**
+     * Compile a choreography command ({"bg_effect", "param_defs", "beats",
+     * "events", "duration"}) into out. Returns false if nothing playable
+     * was found.
+     */
+    static bool compile(JsonObjectConst command, CompiledChoreography& out, ChoreoCompileStats* stats = nullptr);
+
+    /**
+     * Compile one action. Beat-only callers pass allowEventActions = false,
+     * which rejects change_effect / set_brightness / update_effect_params.
+     */
+    static bool compileAction(const char* action, JsonObjectConst params, bool allowEventActions,
+                              CompiledChoreography& show, ChoreoAction& out, ChoreoCompileStats* stats = nullptr);
+
+    // Single records, for loaders that see the show a piece at a time.
+    // paramDefs may be null when the show has no param_defs.
+    static bool compileBeat(JsonObjectConst beat, JsonObjectConst paramDefs, CompiledChoreography& out,
+                            ChoreoCompileStats* stats = nullptr);
+    static bool compileEvent(JsonObjectConst event, JsonObjectConst paramDefs, CompiledChoreography& out,
+                             ChoreoCompileStats* stats = nullptr);
+    static bool compileBackground(JsonObjectConst bgEffect, CompiledChoreography& out);
+    /**
+     * Compile "automation": [{"param": "speed", "interp": "linear",
+     * "keys": [{"time": "0:04", "value": 1.0, "interp": "smooth"}, ...]}].
+     * A key's "interp" shapes the segment that starts at it; keys may also be
+     * [time, value] pairs. Returns the number of lanes added.
+     */
+    static int compileAutomation(JsonArrayConst lanes, CompiledChoreography& out, ChoreoCompileStats* stats = nullptr);
+    // Stable-sort events[from..] by time (earlier entries may already have fired)
+    static void sortEvents(CompiledChoreography& show, size_t from);
+    // Streamed batch: events[from..added) is already sorted, so sort only the
+    // new events[added..] and merge them in behind it
+    static void mergeEvents(CompiledChoreography& show, size_t from, size_t added);
+
+    // "M:SS.mmm", "SS.mmm", "SS" or a number of ms
+    static uint32_t parseTime(JsonVariantConst value);
+    // "rgb(r,g,b)"; returns false (and white) for anything else
+    static bool parseColor(const char* str, ChoreoColor& out);
+    static ChoreoActionType actionFromName(const char* name);
+    static ChoreoInterp interpFromName(const char* name, ChoreoInterp fallback = ChoreoInterp::Linear);
+    static const char* actionName(ChoreoActionType type);
+
+private:
+    static JsonObjectConst resolveParams(JsonVariantConst params, JsonObjectConst paramDefs, ChoreoCompileStats* stats);
+    static int addPayload(CompiledChoreography& show, JsonObjectConst obj);
+};
+
+/**
+ * Per-frame scheduling for a compiled show.
+ *
+ * Events are sorted at compile time and consumed through a cursor; beats sit
+ * in a min-heap keyed on their next due time. A frame therefore only touches
+ * the records that are due now, no matter how long the show is. The heap is
+ * reserved to one entry per beat up front, so polling never allocates.
+ *
+ * Beat times are analytic: beat n of a pattern lands at startMs + n * 1000 / bps
+ * (n >= 1), computed from the beat number rather than accumulated from the
+ * frame it last fired on, so frame jitter never builds up into drift.
+ */
+class ChoreographyScheduler {
+public:
+    void start(const CompiledChoreography& compiled);
+    void clear();
+    // Schedule a beat appended to the show after start() (streamed loads)
+    void addBeat(size_t index);
+    // Jump to timeMs: events resume at eventIndex, beats at their next beat >= timeMs
+    void seek(uint32_t timeMs, size_t eventIndex);
+
+    /**
+     * Fire every event with timeMs <= nowMs that has not fired yet, in time
+     * order. fn(const ChoreoEvent&)
+     */
+    template<typename Fn>
+    void pollEvents(uint32_t nowMs, Fn&& fn) {
+        if (!show) return;
+        while (nextEvent < show->events.size() && show->events[nextEvent].timeMs <= nowMs) {
+            fn(show->events[nextEvent++]);
+        }
+    }
+
+    /**
+     * Fire every beat whose analytic time is nearest this frame, i.e. within
+     * half a frame (frameMs) of nowMs. fn(const ChoreoBeat&, float phaseSec)
+     * gets how far nowMs is past the exact beat time (negative when firing a
+     * little early) so the spawned voice can be advanced by that amount.
+     * After a stall only the latest due beat of a pattern fires.
+     */
+    template<typename Fn>
+    void pollBeats(uint32_t nowMs, float frameMs, Fn&& fn) {
+        if (!show) return;
+        const double horizon = (double) nowMs + 0.5 * frameMs;
+        while (!beatQueue.empty() && beatQueue.front().dueMs <= horizon) {
+            BeatEntry entry = beatQueue.front();
+            popBeat();
+            const ChoreoBeat& beat = show->beats[entry.beat];
+            const double period = 1000.0 / beat.bps;
+
+            // Jump over beats missed during a stall instead of firing a burst
+            uint32_t latest = (uint32_t) ((horizon - beat.startMs) / period);
+            if (latest > entry.n) {
+                skipped += latest - entry.n;
+                entry.n = latest;
+            }
+            const double beatMs = beat.startMs + entry.n * period;
+            // Beats at or past endMs never fire (endMs of 0 means pattern never ends)
+            if (beat.endMs > 0 && beatMs >= beat.endMs) {
+                continue;
+            }
+            fn(beat, (float) ((nowMs - beatMs) * 0.001));
+            pushBeat(entry.beat, entry.n + 1);
+        }
+    }
+
+    bool eventsDone() const { return !show || nextEvent >= show->events.size(); }
+    size_t nextEventIndex() const { return nextEvent; }
+    size_t pendingBeats() const { return beatQueue.size(); }
+    uint32_t skippedBeats() const { return skipped; }
+
+private:
+    struct BeatEntry {
+        double dueMs;    // Exact time of beat n, from the end of the count-in
+        uint32_t n;      // Beat number within the pattern (first fire is n = 1)
+        uint16_t beat;   // Index into CompiledChoreography::beats
+    };
+
+    const CompiledChoreography* show = nullptr;
+    size_t nextEvent = 0;
+    std::vector<BeatEntry> beatQueue;  // Min-heap on dueMs
+    uint32_t skipped = 0;
+
+    static bool laterThan(const BeatEntry& a, const BeatEntry& b);
+    void popBeat();
+    void pushBeat(uint16_t beat, uint32_t n);
+};
+
+/**
+ * Per-frame evaluation of automation lanes.
+ *
+ * Each lane keeps a cursor on its current segment, so a frame costs a
+ * comparison and one curve evaluation per lane; the cursor only walks
+ * forward (seek() repositions it). A lane reports nothing before its first
+ * key and holds its last value after the final key. Values are only
+ * reported when they change.
+ */
+class ChoreoAutomationPlayer {
+public:
+    void start(const CompiledChoreography& compiled);
+    void clear();
+    void seek(uint32_t timeMs);
+    // Report every started lane on the next evaluate(), e.g. after binding a new effect
+    void invalidate();
+    size_t laneCount() const { return cursors.size(); }
+
+    /**
+     * fn(size_t lane, float value) for each lane whose value at nowMs
+     * differs from the last one reported.
+     */
+    template<typename Fn>
+    void evaluate(uint32_t nowMs, Fn&& fn) {
+        if (!show) return;
+        for (size_t i = 0; i < cursors.size(); i++) {
+            const ChoreoAutomationLane& lane = show->lanes[i];
+            if (lane.segmentCount == 0) continue;
+            const ChoreoAutomationSegment* segs = &show->segments[lane.firstSegment];
+            if (nowMs < segs[0].startMs) continue;
+
+            Cursor& cursor = cursors[i];
+            while (cursor.segment + 1 < lane.segmentCount && nowMs >= segs[cursor.segment].endMs) {
+                cursor.segment++;
+            }
+            float value = segs[cursor.segment].valueAt(nowMs);
+            if (cursor.reported && value == cursor.lastValue) continue;
+            cursor.lastValue = value;
+            cursor.reported = true;
+            fn(i, value);
+        }
+    }
+
+private:
+    struct Cursor {
+        uint32_t segment;
+        float lastValue;
+        bool reported;
+    };
+
+    const CompiledChoreography* show = nullptr;
+    std::vector<Cursor> cursors;
+};
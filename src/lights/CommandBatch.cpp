@@ -0,0 +1,67 @@
+#include "CommandBatch.h"
+#include <string.h>
+
+// The types LEDManager::handleCommand dispatches; keep the two in step
+static const char* const KNOWN_TYPES[] = {
+    "effect", "sequence", "choreography", "choreo", "choreo_queue", "choreo_skip", "choreo_clear",
+    "choreo_seek", "choreo_bake", "emergency", "speed", "effect_params", "latency", "brightness",
+};
+
+bool CommandBatch::isKnownType(const char* type) {
+    for (const char* known : KNOWN_TYPES) {
+        if (strcmp(type, known) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BatchCheck CommandBatch::check(JsonArrayConst commands, size_t* badIndex) {
+    const size_t count = commands.size();
+    if (count == 0) {
+        return BatchCheck::Empty;
+    }
+    if (count > MAX_COMMANDS) {
+        return BatchCheck::TooMany;
+    }
+    size_t index = 0;
+    for (JsonVariantConst entry : commands) {
+        JsonObjectConst command = entry.as<JsonObjectConst>();
+        // As handleCommand reads it: "type" first, then "t"
+        const char* type = command["type"].as<const char*>();
+        if (!type) {
+            type = command["t"].as<const char*>();
+        }
+        if (command.isNull() || !type || !isKnownType(type)) {
+            if (badIndex) {
+                *badIndex = index;
+            }
+            return type ? BatchCheck::UnknownType : BatchCheck::NotACommand;
+        }
+        index++;
+    }
+    return BatchCheck::Ok;
+}
+
+void CommandBatch::traceFields(JsonArrayConst commands, bool& echo, uint32_t& id) {
+    echo = false;
+    id = 0;
+    for (JsonVariantConst entry : commands) {
+        JsonObjectConst command = entry.as<JsonObjectConst>();
+        if ((command["trace"] | false) && !echo) {
+            echo = true;
+            id = command["id"] | 0UL;
+        }
+    }
+}
+
+const char* CommandBatch::checkName(BatchCheck result) {
+    switch (result) {
+        case BatchCheck::Ok: return "ok";
+        case BatchCheck::Empty: return "empty";
+        case BatchCheck::TooMany: return "too many commands";
+        case BatchCheck::NotACommand: return "entry is not a command";
+        case BatchCheck::UnknownType: return "unknown command type";
+    }
+    return "?";
+}
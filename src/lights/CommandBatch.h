@@ -0,0 +1,54 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Batched LED commands
+ *
+ * A message whose root is an array is a batch: its commands are queued as
+ * one entry and applied back to back at the same frame boundary, so a desk
+ * sending effect + brightness + speed never shows the in-between states.
+ *
+ *   [{"t":"effect","e":{"t":"rainbow"}},{"t":"brightness","brightness":80},
+ *    {"t":"speed","speed":2}]
+ *
+ * The batch is checked once, when queued; a bad entry rejects the whole
+ * batch rather than applying part of it. A batch is ORDERED for coalescing
+ * (see CommandKey.h): never merged, and later values cannot overtake it.
+ */
+
+enum class BatchCheck : uint8_t {
+    Ok,
+    Empty,
+    TooMany,      // More than CommandBatch::MAX_COMMANDS
+    NotACommand,  // An entry that is not an object with "t"/"type" (nested arrays included)
+    UnknownType,  // A "t"/"type" LEDManager::handleCommand does not handle
+};
+
+class CommandBatch {
+public:
+    static constexpr size_t MAX_COMMANDS = 16;
+
+    static bool isBatch(JsonVariantConst root) { return root.is<JsonArrayConst>(); }
+
+    /**
+     * Check every entry; badIndex receives the first bad one for NotACommand
+     * and UnknownType
+     */
+    static BatchCheck check(JsonArrayConst commands, size_t* badIndex = nullptr);
+
+    /**
+     * A command type LEDManager::handleCommand handles
+     */
+    static bool isKnownType(const char* type);
+
+    /**
+     * Tracing fields for the batch as a whole, from the first entry with
+     * "trace": true (and its "id")
+     */
+    static void traceFields(JsonArrayConst commands, bool& echo, uint32_t& id);
+
+    static const char* checkName(BatchCheck result);
+};
@@ -0,0 +1,32 @@
+#include "CommandKey.h"
+#include <string.h>
+
+uint32_t CommandKey::of(JsonObjectConst command) {
+    const char* type = command["type"].as<const char*>();
+    if (!type) {
+        type = command["t"].as<const char*>();
+    }
+    if (!type) {
+        return ORDERED;
+    }
+    if (strcmp(type, "brightness") == 0) {
+        return BRIGHTNESS;
+    }
+    if (strcmp(type, "speed") == 0) {
+        return SPEED;
+    }
+    if (strcmp(type, "effect_params") == 0) {
+        JsonVariantConst id = command["id"];
+        return EFFECT_PARAMS | (id.is<int>() ? ((uint32_t) id.as<int>() & 0xFFFF) : PRIMARY_EFFECT);
+    }
+    return ORDERED;
+}
+
+const char* CommandKey::name(uint32_t key) {
+    switch (key) {
+        case ORDERED: return "ordered";
+        case BRIGHTNESS: return "brightness";
+        case SPEED: return "speed";
+        default: return (key & EFFECT_PARAMS) ? "effect_params" : "unknown";
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+
+/**
+ * Coalescing keys for queued LED commands
+ *
+ * Commands that only set a value - brightness, speed, one effect's params -
+ * get a key; a newer command with the same key supersedes a pending one
+ * (see SRKeyedRing.h). Everything else is ORDERED: never coalesced, and
+ * a barrier that keeps later values from jumping ahead of it.
+ */
+class CommandKey {
+public:
+    static constexpr uint32_t ORDERED = 0;
+    static constexpr uint32_t BRIGHTNESS = 1;
+    static constexpr uint32_t SPEED = 2;
+    // EFFECT_PARAMS | (effect id & 0xFFFF); the primary effect when no id is given
+    static constexpr uint32_t EFFECT_PARAMS = 0x10000;
+    static constexpr uint32_t PRIMARY_EFFECT = 0xFFFF;
+
+    // {"t":"brightness",...}, {"t":"speed",...}, {"t":"effect_params","id":3,...}
+    static uint32_t of(JsonObjectConst command);
+
+    static bool isOrdered(uint32_t key) { return key == ORDERED; }
+    static const char* name(uint32_t key);
+};
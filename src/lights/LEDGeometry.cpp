@@ -0,0 +1,74 @@
+#include "LEDGeometry.h"
+#include "PlatformConfig.h"
+#include "freertos/LogManager.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#if SUPPORTS_ESP32_APIS
+#include <esp_heap_caps.h>
+#endif
+
+LEDGeometry g_ledGeometry;
+
+Light* LightArr = nullptr;
+Light* BlendLightArr = nullptr;
+
+LEDGeometry MakeLEDGeometry(int numLEDs, int rows, int cols) {
+    LEDGeometry geometry;
+    geometry.numLEDs = numLEDs > 0 ? numLEDs : NUM_LEDS;
+
+    if (rows <= 0 || cols <= 0) {
+        int side = (int) sqrtf((float) geometry.numLEDs);
+        if (side * side == geometry.numLEDs) {
+            rows = side;
+            cols = side;
+        } else {
+            rows = 1;
+            cols = geometry.numLEDs;
+        }
+    }
+    geometry.rows = rows;
+    geometry.cols = cols;
+    geometry.bufferSize = std::max(geometry.numLEDs, rows * cols);
+    return geometry;
+}
+
+Light* AllocateLightBuffer(int count) {
+    if (count <= 0) {
+        return nullptr;
+    }
+    size_t bytes = sizeof(Light) * (size_t) count;
+    void* mem = nullptr;
+#if SUPPORTS_ESP32_APIS
+    mem = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+        mem = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+#else
+    mem = malloc(bytes);
+#endif
+    if (!mem) {
+        return nullptr;
+    }
+    memset(mem, 0, bytes);
+    return static_cast<Light*>(mem);
+}
+
+bool AllocateLEDBuffers(const LEDGeometry& geometry) {
+    if (LightArr || BlendLightArr) {
+        LOG_WARN_COMPONENT("LEDGeometry", "LED buffers already allocated - ignoring");
+        return false;
+    }
+
+    LightArr = AllocateLightBuffer(geometry.bufferSize);
+    BlendLightArr = AllocateLightBuffer(geometry.bufferSize);
+    if (!LightArr || !BlendLightArr) {
+        LOG_ERRORF_COMPONENT("LEDGeometry", "Failed to allocate LED buffers for %d LEDs", geometry.bufferSize);
+        return false;
+    }
+
+    g_ledGeometry = geometry;
+    LOG_INFOF_COMPONENT("LEDGeometry", "Allocated LED buffers: %d LEDs, %dx%d grid (%d bytes each)",
+        geometry.numLEDs, geometry.rows, geometry.cols, (int) (geometry.bufferSize * sizeof(Light)));
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Light.h"
+#include "../Globals.h"
+
+/**
+ * LEDGeometry - Runtime LED count and grid layout
+ *
+ * The LED count and the logical grid that effects render into come from
+ * settings.json ("numLEDs" and "grid": {"rows", "cols"}) instead of being
+ * baked in at compile time. NUM_LEDS and DIMS_PANELS are only used as the
+ * defaults when the settings file does not specify them.
+ *
+ * bufferSize is the number of Lights in LightArr/BlendLightArr. It is the
+ * larger of numLEDs and rows * cols, since effects draw into the grid and
+ * panels then map the grid onto the physical strip.
+ */
+struct LEDGeometry {
+    int numLEDs = NUM_LEDS;
+    int rows = DIMS_PANELS;
+    int cols = DIMS_PANELS;
+    int bufferSize = NUM_LEDS;
+
+    int centerRow() const { return rows / 2; }
+    int centerCol() const { return cols / 2; }
+    bool contains(int row, int col) const {
+        return row >= 0 && row < rows && col >= 0 && col < cols;
+    }
+};
+
+extern LEDGeometry g_ledGeometry;
+
+// Frame buffers, allocated once by AllocateLEDBuffers()
+extern Light* LightArr;
+extern Light* BlendLightArr;
+
+/**
+ * Derive a grid for numLEDs when settings.json has no "grid" entry:
+ * square counts become a square grid, anything else a single-row strip.
+ */
+LEDGeometry MakeLEDGeometry(int numLEDs, int rows = 0, int cols = 0);
+
+/**
+ * Allocate a zeroed Light buffer, preferring PSRAM when the platform has it
+ * and falling back to internal RAM. Returns nullptr on failure.
+ */
+Light* AllocateLightBuffer(int count);
+
+/**
+ * Allocate LightArr and BlendLightArr for the given geometry and publish it
+ * as g_ledGeometry. Must be called once at boot before the LED task starts.
+ * Returns false if either buffer could not be allocated.
+ */
+bool AllocateLEDBuffers(const LEDGeometry& geometry);
@@ -1,16 +1,23 @@
 #include "LEDManager.h"
 #include "freertos/LogManager.h"
 #include "../controllers/BrightnessController.h"
+#include "../controllers/SpeedController.h"
 #include <FastLED.h>
+#include <string.h>
 #include "effects/EffectManager.h"
 #include "effects/EffectFactory.h"
 #include "ChoreographyManager.h"
+#include "BakedFrames.h"
+#include "ShowClock.h"
+#include "CommandKey.h"
+#include "CommandBatch.h"
+#include "effects/BakedShowEffect.h"
 #include "../GlobalState.h"
 #include "../PatternManager.h"
 #include "../Globals.h"
 
 LEDManager::LEDManager() 
-    : commandQueue(10, "LEDCommandQueue")  // TEST: Initialize test queue
+    : responseMutex(xSemaphoreCreateMutex())
 {
     LOG_DEBUGF_COMPONENT("LEDManager", "Initializing");
     
@@ -50,13 +57,16 @@ LEDManager::LEDManager()
 
 LEDManager::~LEDManager() {
     LOG_DEBUGF_COMPONENT("LEDManager", "Destroying");
+    if (responseMutex) {
+        vSemaphoreDelete(responseMutex);
+    }
 }
 
 void LEDManager::initPanels(const std::vector<PanelConfig>& panelConfigs) {
     _panelConfigs = panelConfigs;
     _lightPanels.resize(panelConfigs.size());
     for (size_t i = 0; i < panelConfigs.size(); i++) {
-        _lightPanels[i].init_Src(BlendLightArr, 32, 32);
+        _lightPanels[i].init_Src(BlendLightArr, g_ledGeometry.rows, g_ledGeometry.cols);
         _lightPanels[i].set_SrcArea(panelConfigs[i].rows, panelConfigs[i].cols, panelConfigs[i].row0, panelConfigs[i].col0);
         _lightPanels[i].pTgt0 = LightArr + i * panelConfigs[i].rows * panelConfigs[i].cols;
         _lightPanels[i].rotIdx = panelConfigs[i].rotIdx;
@@ -101,6 +111,7 @@ void LEDManager::update(float dtSeconds, Light* output, int numLEDs) {
     }
     if (choreographyManager && getCurrentState() == LEDManagerState::CHOREOGRAPHY_PLAYING) {
         choreographyManager->update(dtSeconds);
+        postPreflightReport();  // Streamed shows are analyzed when the stream ends
     }
     render(output, numLEDs);
     // if (sequenceManager) sequenceManager->update(dtSeconds);
@@ -141,7 +152,7 @@ void LEDManager::render(Light* output, int numLEDs) {
             }
             // Render choreography effects (brightness pulsing handled by BrightnessController)
             if (choreographyManager) {
-                choreographyManager->render(BlendLightArr, numLEDs, 32, 32);
+                choreographyManager->render(BlendLightArr, numLEDs, g_ledGeometry.rows, g_ledGeometry.cols);
             }
             break;
             
@@ -275,34 +286,65 @@ void LEDManager::onStateUpdate(LEDManagerState state, float dtSeconds) {
 }
 
 bool LEDManager::handleCommand(const JsonObject& command) {
-    String commandType = "";
-    if (command.containsKey("type")) {
-        commandType = String(command["type"].as<const char*>());
-    } else if (command.containsKey("t")) {
-        commandType = String(command["t"].as<const char*>());
-    }
-    // LOG_DEBUGF_COMPONENT("LEDManager", "Handling command type: %s", commandType.c_str());
-    if (commandType == "effect") {
+    // Compared in place: JSON and MessagePack commands both arrive here without a String copy
+    const char* commandType = command["type"].as<const char*>();
+    if (!commandType) {
+        commandType = command["t"].as<const char*>();
+    }
+    if (!commandType) {
+        commandType = "";
+    }
+    // LOG_DEBUGF_COMPONENT("LEDManager", "Handling command type: %s", commandType);
+    // A new type also goes in CommandBatch's list, or batches containing it are rejected
+    if (strcmp(commandType, "effect") == 0) {
         // const auto startTime = micros();
         handleEffectCommand(command);
         // const auto endTime = micros();
         // const auto duration = endTime - startTime;
-        // LOG_DEBUGF_COMPONENT("LEDManager", "Took %lu us to handle command type %s", duration, commandType.c_str());
+        // LOG_DEBUGF_COMPONENT("LEDManager", "Took %lu us to handle command type %s", duration, commandType);
         return true;
     }
-    else if (commandType == "sequence") {
+    else if (strcmp(commandType, "sequence") == 0) {
         handleSequenceCommand(command);
         return true;
     }
-    else if (commandType == "choreography" || commandType == "choreo") {
+    else if (strcmp(commandType, "choreography") == 0 || strcmp(commandType, "choreo") == 0) {
         handleChoreographyCommand(command);
         return true;
     }
-    else if (commandType == "emergency") {
+    else if (strcmp(commandType, "choreo_queue") == 0 || strcmp(commandType, "choreo_skip") == 0 || strcmp(commandType, "choreo_clear") == 0) {
+        handleChoreographyQueueCommand(commandType, command);
+        return true;
+    }
+    else if (strcmp(commandType, "choreo_seek") == 0) {
+        handleChoreographySeekCommand(command);
+        return true;
+    }
+    else if (strcmp(commandType, "choreo_bake") == 0) {
+        handleChoreographyBakeCommand(command);
+        return true;
+    }
+    else if (strcmp(commandType, "emergency") == 0) {
         handleEmergencyCommand(command);
         return true;
     }
-    else if (commandType == "brightness") {
+    else if (strcmp(commandType, "speed") == 0) {
+        // {"t":"speed","speed":2.5}
+        SpeedController* speedController = SpeedController::getInstance();
+        if (command.containsKey("speed") && speedController) {
+            speedController->setSpeed(command["speed"].as<float>());
+        }
+        return true;
+    }
+    else if (strcmp(commandType, "effect_params") == 0) {
+        handleEffectParamsCommand(command);
+        return true;
+    }
+    else if (strcmp(commandType, "latency") == 0) {
+        handleLatencyCommand(command);
+        return true;
+    }
+    else if (strcmp(commandType, "brightness") == 0) {
         if (command.containsKey("brightness")) {
             int brightness = command["brightness"];
             setBrightness(brightness);
@@ -315,11 +357,37 @@ bool LEDManager::handleCommand(const JsonObject& command) {
         return true;
     }
     else {
-        LOG_ERRORF_COMPONENT("LEDManager", "Unknown command type: %s", commandType.c_str());
+        LOG_ERRORF_COMPONENT("LEDManager", "Unknown command type: %s", commandType);
         return false;
     }
 }
 
+bool LEDManager::handleCommandBatch(const JsonArray& commands) {
+    // Applied back to back on the LED task, before the next render: the frame
+    // shows all of the batch or none of it
+    applyingBatch = true;
+    size_t handled = 0;
+    for (JsonObject command : commands) {
+        if (handleCommand(command)) {
+            handled++;
+        }
+    }
+    applyingBatch = false;
+    // One save for the whole batch. Brightness and speed change device state
+    // without saving, so this also covers them; an unchanged state costs no write
+    SaveUserPreferences(deviceState);
+    batchesApplied++;
+    LOG_DEBUGF_COMPONENT("LEDManager", "Applied batch: %u of %u commands", (unsigned) handled, (unsigned) commands.size());
+    return handled == commands.size();
+}
+
+void LEDManager::savePreferences() {
+    if (applyingBatch) {
+        return;  // handleCommandBatch saves once at the end
+    }
+    SaveUserPreferences(deviceState);
+}
+
 void LEDManager::handleEffectCommand(const JsonObject& command) {
     LOG_DEBUGF_COMPONENT("LEDManager", "Handling effect command");
     const auto startTime = micros();
@@ -376,7 +444,7 @@ void LEDManager::handleEffectCommand(const JsonObject& command) {
 
             // LOG_DEBUGF_COMPONENT("LEDManager", "Saved effect - Type: %s, Params: %s",
             //     deviceState.currentEffectType.c_str(), deviceState.currentEffectParams.c_str());
-            SaveUserPreferences(deviceState);
+            savePreferences();
             // LOG_DEBUGF_COMPONENT("LEDManager", "Saved user preferences with current effect");
         } else {
             LOG_ERRORF_COMPONENT("LEDManager", "Failed to create effect");
@@ -389,6 +457,21 @@ void LEDManager::handleEffectCommand(const JsonObject& command) {
     // LOG_DEBUGF_COMPONENT("LEDManager", "Took %lu us to handle effect command", duration);
 }
 
+void LEDManager::handleEffectParamsCommand(const JsonObject& command) {
+    // {"t":"effect_params","id":3,"p":{"speed":2}} - "id" defaults to the primary effect
+    if (!effectManager) return;
+    Effect* effect = command.containsKey("id") ? effectManager->getEffect(command["id"].as<int>())
+                                               : effectManager->getPrimaryEffect();
+    if (!effect) {
+        LOG_WARN_COMPONENT("LEDManager", "effect_params: no such effect");
+        return;
+    }
+    JsonObject params = command.containsKey("p") ? command["p"].as<JsonObject>() : command["parameters"].as<JsonObject>();
+    if (!effect->updateParams(params)) {
+        LOG_DEBUGF_COMPONENT("LEDManager", "Effect %d does not support updateParams", effect->getId());
+    }
+}
+
 void LEDManager::handleSequenceCommand(const JsonObject& command) {
     LOG_DEBUGF_COMPONENT("LEDManager", "Handling sequence command");
     transitionTo(LEDManagerState::SEQUENCE_PLAYING);
@@ -403,9 +486,158 @@ void LEDManager::handleChoreographyCommand(const JsonObject& command) {
     transitionTo(LEDManagerState::CHOREOGRAPHY_PLAYING);
     if (choreographyManager) {
         choreographyManager->startChoreography(command, effectManager.get());
+        postPreflightReport();
+    }
+}
+
+void LEDManager::postPreflightReport() {
+    if (!choreographyManager || !choreographyManager->takePreflightReport()) return;
+    DynamicJsonDocument doc(1024);
+    ChoreographyAnalyzer::toJson(choreographyManager->getPreflightReport(),
+        choreographyManager->preflightModel(), doc.to<JsonObject>());
+    doc["playing"] = choreographyManager->isActive();
+    String response;
+    serializeJson(doc, response);
+    postResponse(response);
+}
+
+void LEDManager::postResponse(const String& response, int client) {
+    if (!responseMutex || xSemaphoreTake(responseMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        LOG_WARN_COMPONENT("LEDManager", "Response dropped - mutex busy");
+        return;
+    }
+    // Nobody polling (no server running): keep only the newest replies
+    if (pendingResponses.size() >= MAX_PENDING_RESPONSES) {
+        pendingResponses.erase(pendingResponses.begin());
+    }
+    pendingResponses.push_back(PendingResponse{response, client});
+    xSemaphoreGive(responseMutex);
+}
+
+bool LEDManager::takeResponse(String& out, int& client) {
+    if (!responseMutex || xSemaphoreTake(responseMutex, 0) != pdTRUE) return false;
+    bool taken = !pendingResponses.empty();
+    if (taken) {
+        out = pendingResponses.front().text;
+        client = pendingResponses.front().client;
+        pendingResponses.erase(pendingResponses.begin());
+    }
+    xSemaphoreGive(responseMutex);
+    return taken;
+}
+
+void LEDManager::handleChoreographyQueueCommand(const char* commandType, const JsonObject& command) {
+    // {"t":"choreo_queue","file":"/data/music/next.json"} (or an inline show)
+    // {"t":"choreo_skip"}  {"t":"choreo_clear"}
+    if (!choreographyManager) return;
+    const bool playing = getCurrentState() == LEDManagerState::CHOREOGRAPHY_PLAYING && choreographyManager->isActive();
+    if (strcmp(commandType, "choreo_queue") == 0) {
+        if (!playing) {
+            // Nothing to queue behind: start it like a "choreography" command
+            handleChoreographyCommand(command);
+            return;
+        }
+        choreographyManager->queueChoreography(command, effectManager.get());
+    } else if (strcmp(commandType, "choreo_skip") == 0) {
+        if (!playing) {
+            LOG_WARN_COMPONENT("LEDManager", "choreo_skip ignored - no choreography playing");
+            return;
+        }
+        if (choreographyManager->skip()) {
+            postPreflightReport();
+        }
+    } else {
+        choreographyManager->clearQueue();
     }
 }
 
+void LEDManager::handleChoreographySeekCommand(const JsonObject& command) {
+    // {"t":"choreo_seek","time":"1:23.500","count_in_ms":0}
+    if (!choreographyManager || getCurrentState() != LEDManagerState::CHOREOGRAPHY_PLAYING) {
+        LOG_WARN_COMPONENT("LEDManager", "choreo_seek ignored - no choreography playing");
+        return;
+    }
+    uint32_t timeMs = ChoreographyCompiler::parseTime(command["time"]);
+    unsigned long countInMs = command["count_in_ms"] | ChoreographyManager::DEFAULT_COUNT_IN_MS;
+    choreographyManager->seek(timeMs, countInMs);
+}
+
+void LEDManager::handleChoreographyBakeCommand(const JsonObject& command) {
+    // {"t":"choreo_bake","file":"/data/music/show.json","out":"/data/bake/show.srb","fps":30}
+    // Renders the show offline into a frame file for the "baked" effect.
+    // Blocks the LED task until done; the show clock is pinned to each frame
+    // so the result plays back at the original timing.
+    static constexpr uint16_t DEFAULT_BAKE_FPS = 30;
+    static constexpr uint32_t DEFAULT_MAX_BAKE_MS = 15UL * 60UL * 1000UL;
+
+    const char* out = command["out"] | (const char*) nullptr;
+    if (!out || !choreographyManager || !effectManager) {
+        LOG_WARN_COMPONENT("LEDManager", "choreo_bake ignored - needs \"out\" and a show");
+        return;
+    }
+    std::unique_ptr<SDBakedFile> file = SDBakedFile::open(out, "w");
+    if (!file) {
+        LOG_ERRORF_COMPONENT("LEDManager", "Cannot create bake file %s", out);
+        return;
+    }
+    const uint16_t fps = constrain(command["fps"] | DEFAULT_BAKE_FPS, 1, 120);
+    const uint32_t maxFrames = (uint32_t) ((uint64_t) (command["max_ms"] | DEFAULT_MAX_BAKE_MS) * fps / 1000);
+    const int numLEDs = _numConfiguredLEDs;
+    BakedFrameWriter writer;
+    if (!writer.begin(file.get(), numLEDs, fps)) {
+        LOG_ERRORF_COMPONENT("LEDManager", "Cannot write bake file %s", out);
+        return;
+    }
+
+    // No count-in unless asked for: the bake starts on the first timeline frame
+    if (!command.containsKey("count_in_ms")) {
+        command["count_in_ms"] = 0;
+    }
+    const LEDManagerState previousState = getCurrentState();
+    const uint32_t startMs = millis();
+    ShowClock::pin(0);
+    handleChoreographyCommand(command);
+
+    const float dt = 1.0f / fps;
+    BrightnessController* bc = BrightnessController::getInstance();
+    bool ok = true;
+    while (ok && choreographyManager->isActive() && writer.frameCount() < maxFrames) {
+        ShowClock::pin((unsigned long) ((uint64_t) writer.frameCount() * 1000 / fps));
+        // LEDUpdateTask clears these before each live frame; the bake replaces that loop
+        memset(LightArr, 0, sizeof(Light) * g_ledGeometry.bufferSize);
+        memset(BlendLightArr, 0, sizeof(Light) * g_ledGeometry.bufferSize);
+        update(dt, LightArr, numLEDs);
+        if (!choreographyManager->isActive()) {
+            break;  // Show ended this frame; what's left is the restored effect
+        }
+        if (bc) {
+            bc->update();
+        }
+        ok = writer.addFrame(reinterpret_cast<const uint8_t*>(BlendLightArr), bc ? bc->getBrightness() : 255);
+        if (writer.frameCount() % 16 == 0) {
+            delay(1);  // Let the other tasks (and the idle watchdog) run
+        }
+    }
+    ShowClock::release();
+    if (choreographyManager->isActive()) {
+        choreographyManager->stop();
+    }
+    ok = ok && writer.finish();
+    transitionTo(previousState);
+
+    if (!ok) {
+        LOG_ERRORF_COMPONENT("LEDManager", "Bake to %s failed after %lu frames",
+            out, (unsigned long) writer.frameCount());
+        return;
+    }
+    const uint32_t rawBytes = writer.frameCount() * (uint32_t) numLEDs * 3;
+    LOG_INFOF_COMPONENT("LEDManager", "Baked %lu frames (%lu ms) to %s: %lu bytes, %lu%% of raw, in %lu ms",
+        (unsigned long) writer.frameCount(), (unsigned long) ((uint64_t) writer.frameCount() * 1000 / fps), out,
+        (unsigned long) writer.bytesWritten(),
+        (unsigned long) (rawBytes ? (uint64_t) writer.bytesWritten() * 100 / rawBytes : 0),
+        (unsigned long) (millis() - startMs));
+}
+
 void LEDManager::handleEmergencyCommand(const JsonObject& command) {
     LOG_DEBUGF_COMPONENT("LEDManager", "Handling emergency command");
     pushState(LEDManagerState::EMERGENCY);
@@ -457,6 +689,27 @@ String LEDManager::getStatus() const {
             stateStr = "IDLE";
             break;
     }
+    if (state == LEDManagerState::CHOREOGRAPHY_PLAYING && choreographyManager) {
+        // Voice pool pressure: active/size plus stolen and dropped this show
+        const VoiceStats& rings = choreographyManager->getRingVoiceStats();
+        const VoiceStats& pulses = choreographyManager->getPulseVoiceStats();
+        char voices[128];
+        snprintf(voices, sizeof(voices), " (rings %d/%u, %lu stolen, %lu dropped; pulses %d/%u, %lu stolen, %lu dropped)",
+            choreographyManager->activeRingVoices(), rings.poolSize, (unsigned long) rings.stolen, (unsigned long) rings.dropped,
+            choreographyManager->activePulseVoices(), pulses.poolSize, (unsigned long) pulses.stolen, (unsigned long) pulses.dropped);
+        stateStr += voices;
+        if (choreographyManager->queuedCount() > 0) {
+            stateStr += " +" + String((unsigned) choreographyManager->queuedCount()) + " queued";
+        }
+    }
+    // Slider bursts: how many stale values were folded away or turned away
+    const uint32_t coalesced = commandsCoalesced.load();
+    const uint32_t dropped = commandsDropped.load();
+    if (coalesced > 0 || dropped > 0) {
+        char queue[64];
+        snprintf(queue, sizeof(queue), " [cmds %lu coalesced, %lu dropped]", (unsigned long) coalesced, (unsigned long) dropped);
+        stateStr += queue;
+    }
     return "LEDManager: " + stateStr;
 }
 
@@ -552,54 +805,138 @@ void LEDManager::renderWhiteLEDs(Light* output, int numLEDs) {
 bool LEDManager::handleQueuedCommand(std::shared_ptr<DynamicJsonDocument> doc) {
     // This is the ICommandHandler interface method that uses the queue
     LOG_DEBUGF_COMPONENT("LEDManager", "Handling queued command");
-    return safeQueueCommand(doc);
+    return safeQueueCommand(std::move(doc));
 }
 
-bool LEDManager::safeQueueCommand(std::shared_ptr<DynamicJsonDocument> doc) {
+bool LEDManager::handleQueuedCommand(std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace) {
+    return safeQueueCommand(std::move(doc), trace);
+}
+
+static_assert(CommandKey::ORDERED == 0, "SRKeyedRing treats key 0 as ordered");
+
+bool LEDManager::safeQueueCommand(std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace) {
     if (!doc) {
         LOG_ERROR_COMPONENT("LEDManager", "TEST: Cannot queue null document");
         return false;
     }
     
+    const bool isBatch = CommandBatch::isBatch(doc->as<JsonVariantConst>());
+    if (isBatch) {
+        size_t badIndex = 0;
+        const BatchCheck check = CommandBatch::check(doc->as<JsonArrayConst>(), &badIndex);
+        if (check != BatchCheck::Ok) {
+            LOG_WARNF_COMPONENT("LEDManager", "Rejected command batch: %s (entry %u)", CommandBatch::checkName(check), (unsigned) badIndex);
+            return false;
+        }
+    }
+    
     TestCommand cmd;
-    cmd.doc = doc;  // shared_ptr copy
+    // A batch is ORDERED: one queue entry, never coalesced
+    cmd.key = isBatch ? CommandKey::ORDERED : CommandKey::of(doc->as<JsonObjectConst>());
+    cmd.trace.client = trace.client;  // Traced or not, replies go back to the sender
+    if (g_commandTracer.enabled()) {
+        cmd.trace = trace;
+        if (isBatch) {
+            CommandBatch::traceFields(doc->as<JsonArrayConst>(), cmd.trace.echo, cmd.trace.id);
+        } else {
+            JsonObjectConst root = doc->as<JsonObjectConst>();
+            cmd.trace.echo = root["trace"] | false;
+            cmd.trace.id = root["id"] | 0;
+        }
+        cmd.trace.stamp(TraceHop::Enqueued, micros());
+    }
+    cmd.doc = std::move(doc);  // Ownership moves into the queue, no copy
     cmd.timestamp = millis();
     
-    bool queued = commandQueue.send(std::move(cmd));
-    LOG_DEBUGF_COMPONENT("LEDManager", "Queued command: %s", doc->as<String>().c_str());
-    return queued;
+    // Log the size only: serializing the document here cost a heap String per command
+    const size_t docBytes = cmd.doc->memoryUsage();
+    const uint32_t key = cmd.key;
+    // Any task may push and nothing waits on the LED task. A newer brightness/speed/params
+    // value replaces the pending one here, before it takes ring space.
+    const QueueSendResult result = commandQueue.push(key, std::move(cmd));
+    if (result == QueueSendResult::Full) {
+        commandsDropped++;
+        LOG_WARNF_COMPONENT("LEDManager", "Dropped %s command - queue full (%lu dropped so far)",
+            CommandKey::name(key), (unsigned long) commandsDropped.load());
+        return false;
+    }
+    commandsQueued++;
+    if (result == QueueSendResult::Coalesced) {
+        commandsCoalesced++;
+    }
+    LOG_DEBUGF_COMPONENT("LEDManager", "Queued command: %u bytes", (unsigned) docBytes);
+    return true;
 }
 
-void LEDManager::safeProcessQueue() {
-    TestCommand cmd;
-    uint32_t queueCount = 0;
-    while (commandQueue.receive(cmd, 0)) {  // Non-blocking, process all
-        const auto receiveStartTime = micros();
-        LOG_DEBUGF_COMPONENT("LEDManager", "Received command from queue");
-        queueCount++;
-        
-        if (cmd.doc) {
-            JsonObject root = cmd.doc->as<JsonObject>();
-            String type = "";
-            if (root.containsKey("type")) {
-                type = root["type"].as<String>();
-            } else if (root.containsKey("t")) {
-                type = root["t"].as<String>();
+void LEDManager::onFrameShown() {
+    if (appliedTraceCount == 0) {
+        return;
+    }
+    const uint32_t shownUs = micros();
+    const uint32_t nowMs = millis();
+    for (size_t i = 0; i < appliedTraceCount; i++) {
+        CommandTrace& trace = appliedTraces[i];
+        trace.stamp(TraceHop::Shown, shownUs);
+        g_commandTracer.record(trace, nowMs);
+        if (trace.echo) {
+            char echo[192];
+            if (CommandTracer::formatTrace(trace, echo, sizeof(echo)) > 0) {
+                postResponse(String(echo), trace.client);
             }
-            
+        }
+    }
+    appliedTraceCount = 0;
+}
+
+void LEDManager::handleLatencyCommand(const JsonObject& command) {
+    // {"t":"latency","enabled":true}  {"t":"latency","reset":true}  {"t":"latency"} (report only)
+    if (command.containsKey("enabled")) {
+        g_commandTracer.setEnabled(command["enabled"].as<bool>());
+        LOG_INFOF_COMPONENT("LEDManager", "Command latency tracing %s", g_commandTracer.enabled() ? "enabled" : "disabled");
+    }
+    if (command["reset"] | false) {
+        g_commandTracer.reset();
+    }
+    char report[640];
+    if (g_commandTracer.formatReport(report, sizeof(report)) > 0) {
+        postResponse(String(report));
+    }
+}
+
+CommandQueueStats LEDManager::getCommandQueueStats() const {
+    CommandQueueStats stats;
+    stats.queued = commandsQueued.load();
+    stats.coalesced = commandsCoalesced.load();
+    stats.dropped = commandsDropped.load();
+    return stats;
+}
+
+void LEDManager::safeProcessQueue() {
+    // Apply what is pending this frame, in order. Values were coalesced as they
+    // were queued; at most a ring's worth, so appliedTraces cannot overflow.
+    TestCommand batched;
+    for (size_t i = 0; i < COMMAND_RING_SIZE && commandQueue.pop(batched); i++) {
+        SR_TRACE_STAMP(batched.trace, TraceHop::Dequeued);
+        replyClient = batched.trace.client;
+        if (batched.doc) {
             const auto startTime = micros();
-            handleCommand(root);
+            if (batched.doc->is<JsonArray>()) {
+                handleCommandBatch(batched.doc->as<JsonArray>());
+            } else {
+                handleCommand(batched.doc->as<JsonObject>());
+            }
             const auto endTime = micros();
             const auto duration = endTime - startTime;
-            // LOG_DEBUGF_COMPONENT("LEDManager", "Gap between receive and handle command: %lu us", startTime - receiveStartTime);
             
             // LOG_DEBUGF_COMPONENT("LEDManager", "Processed %s command in %lu us (queued for %lu ms)", 
-            //           type.c_str(), duration, millis() - cmd.timestamp);
+            //           root["type"] | root["t"] | "?", duration, millis() - batched.timestamp);
+        }
+        if (batched.trace.active() && g_commandTracer.enabled()) {
+            batched.trace.stamp(TraceHop::Applied, micros());
+            appliedTraces[appliedTraceCount++] = batched.trace;
         }
-        // shared_ptr automatically cleans up when cmd goes out of scope
-    }
-    
-    if (queueCount > 0) {
-        // LOG_DEBUGF_COMPONENT("LEDManager", "Processed %d command(s) from queue", queueCount);
     }
+    replyClient = -1;  // Replies from the show itself (a streamed pre-flight) go to everyone
+    // Dropping the last reference hands each pooled document back to g_commandDocPool
+    // (the next pop, or batched going out of scope)
 }
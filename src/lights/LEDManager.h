@@ -1,18 +1,30 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include "Light.h"
 #include "LightPanel.h"
-#include "freertos/SRSmartQueue.h"
+#include "LEDGeometry.h"
+#include "freertos/SRKeyedRing.h"
 #include "hal/network/ICommandHandler.h"
+#include "hal/network/CommandTrace.h"
 #include "../Globals.h"
 
 // Test structure for smart queue
 struct TestCommand {
     std::shared_ptr<DynamicJsonDocument> doc;
     uint32_t timestamp;
+    uint32_t key;  // CommandKey: ORDERED, or the value this command sets (latest wins)
+    CommandTrace trace;  // Hop timestamps while g_commandTracer is enabled
+};
+
+// Command queue counters since boot
+struct CommandQueueStats {
+    uint32_t queued;
+    uint32_t coalesced;  // Superseded by a newer command with the same key
+    uint32_t dropped;    // Ring full
 };
 
 // Forward declarations for sub-managers
@@ -44,14 +56,20 @@ public:
     
     // ICommandHandler interface
     bool handleCommand(const JsonObject& command) override;
+    bool handleCommandBatch(const JsonArray& commands) override;
     bool supportsQueuing() const override { return true; }
     bool handleQueuedCommand(std::shared_ptr<DynamicJsonDocument> doc) override;
+    bool handleQueuedCommand(std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace) override;
     int getBrightness() const override;
     String getStatus() const override;
+    bool takeResponse(String& out, int& client) override;
+    uint32_t getBatchesApplied() const override { return batchesApplied.load(); }
     
     // TEST: Smart queue test methods
-    bool safeQueueCommand(std::shared_ptr<DynamicJsonDocument> doc);  // thread-safe sending to queue
+    bool safeQueueCommand(std::shared_ptr<DynamicJsonDocument> doc, const CommandTrace& trace = CommandTrace());  // thread-safe sending to queue
     void safeProcessQueue();  // thread-safe receiving from queue (call from update/render)
+    void onFrameShown();  // LED task, right after FastLED.show(): closes the traces applied this frame
+    CommandQueueStats getCommandQueueStats() const;
     
     // Brightness control
     void setBrightness(int brightness);
@@ -82,10 +100,39 @@ private:
     int currentBrightness = 128;
     
     // LED count configuration (from SD card config)
-    int _numConfiguredLEDs = NUM_LEDS;
+    int _numConfiguredLEDs = g_ledGeometry.numLEDs;
+    
+    // Every transport feeds the LED task through one ring. Brightness, speed and
+    // effect params coalesce as they are pushed (latest wins), so a stalled LED
+    // task never costs the newest slider value; each frame drains the ring.
+    static constexpr size_t COMMAND_RING_SIZE = 32;
+    static constexpr size_t COMMAND_KEY_SLOTS = 8;
+    SRKeyedRing<TestCommand, COMMAND_RING_SIZE, COMMAND_KEY_SLOTS> commandQueue;
+    // Bumped by whichever task queues a command
+    std::atomic<uint32_t> commandsQueued{0};
+    std::atomic<uint32_t> commandsCoalesced{0};
+    std::atomic<uint32_t> commandsDropped{0};
+    std::atomic<uint32_t> batchesApplied{0};
+    // While a batch is applied, preference saves wait for its end (one per batch)
+    bool applyingBatch = false;
+    void savePreferences();
+    // Traces of commands applied this frame, waiting for the frame to be shown
+    CommandTrace appliedTraces[COMMAND_RING_SIZE];
+    size_t appliedTraceCount = 0;
     
-    // thread-safe queue for testing
-    SRSmartQueue<TestCommand> commandQueue;
+    // Replies for the server, written by the LED task and taken by the WiFi task.
+    // Each goes to the client whose command produced it.
+    struct PendingResponse {
+        String text;
+        int client;  // CommandTrace::client; -1 = all clients
+    };
+    static constexpr size_t MAX_PENDING_RESPONSES = 4;
+    std::vector<PendingResponse> pendingResponses;
+    SemaphoreHandle_t responseMutex;
+    int replyClient = -1;  // Sender of the command being applied (LED task only)
+    void postResponse(const String& response) { postResponse(response, replyClient); }
+    void postResponse(const String& response, int client);
+    void postPreflightReport();
     
     // Sub-managers
     std::unique_ptr<EffectManager> effectManager;
@@ -101,7 +148,12 @@ private:
     void handleEffectCommand(const JsonObject& command);
     void handleSequenceCommand(const JsonObject& command);
     void handleChoreographyCommand(const JsonObject& command);
+    void handleChoreographyQueueCommand(const char* commandType, const JsonObject& command);
+    void handleLatencyCommand(const JsonObject& command);
+    void handleChoreographySeekCommand(const JsonObject& command);
+    void handleChoreographyBakeCommand(const JsonObject& command);
     void handleEmergencyCommand(const JsonObject& command);
+    void handleEffectParamsCommand(const JsonObject& command);
     
     // Simple white LED effect
     void renderWhiteLEDs(Light* output, int numLEDs);
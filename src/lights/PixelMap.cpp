@@ -0,0 +1,199 @@
+#include "PixelMap.h"
+#include "freertos/LogManager.h"
+#include "hal/SDCardController.h"
+#include <math.h>
+
+PixelMap g_pixelMap;
+
+static constexpr float TWO_PI_F = 6.2831853f;
+
+PixelMap::Field PixelMap::fieldFromName(const char* name) {
+    if (!name) return Field::Strip;
+    if (strcmp(name, "x") == 0) return Field::X;
+    if (strcmp(name, "y") == 0) return Field::Y;
+    if (strcmp(name, "radius") == 0) return Field::Radius;
+    if (strcmp(name, "angle") == 0) return Field::Angle;
+    return Field::Strip;
+}
+
+const float* PixelMap::field(Field f) const {
+    if (!isValid()) return nullptr;
+    switch (f) {
+        case Field::X: return nx.data();
+        case Field::Y: return ny.data();
+        case Field::Radius: return r.data();
+        case Field::Angle: return theta.data();
+        case Field::Strip:
+        default: return strip.data();
+    }
+}
+
+void PixelMap::clear() {
+    px.clear(); py.clear();
+    nx.clear(); ny.clear();
+    r.clear(); theta.clear();
+    strip.clear();
+    cellStart.clear();
+    cellLeds.clear();
+    cellRows = cellCols = 0;
+}
+
+void PixelMap::addPoint(float x, float y) {
+    px.push_back(x);
+    py.push_back(y);
+}
+
+void PixelMap::buildGrid(int rows, int cols) {
+    clear();
+    px.reserve(rows * cols);
+    py.reserve(rows * cols);
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            addPoint((float) col, (float) row);
+        }
+    }
+    customLayout = false;
+    finalize();
+}
+
+bool PixelMap::buildFromJson(const JsonObject& layout, int maxLEDs) {
+    JsonArray fixtures = layout["fixtures"].as<JsonArray>();
+    if (fixtures.isNull() || fixtures.size() == 0) {
+        LOG_ERROR_COMPONENT("PixelMap", "Layout has no fixtures");
+        return false;
+    }
+
+    clear();
+    for (JsonObject fixture : fixtures) {
+        String type = fixture["type"] | "grid";
+        float x0 = fixture["x"] | 0.0f;
+        float y0 = fixture["y"] | 0.0f;
+
+        if (type == "grid") {
+            int rows = fixture["rows"] | 0;
+            int cols = fixture["cols"] | 0;
+            bool serpentine = fixture["serpentine"] | false;
+            for (int row = 0; row < rows; ++row) {
+                for (int i = 0; i < cols; ++i) {
+                    int col = (serpentine && (row & 1)) ? cols - 1 - i : i;
+                    addPoint(x0 + col, y0 + row);
+                }
+            }
+        } else if (type == "ring") {
+            int count = fixture["count"] | 0;
+            float radius = fixture["radius"] | 1.0f;
+            float startAngle = (fixture["start_angle"] | 0.0f) * (TWO_PI_F / 360.0f);
+            int dir = (fixture["reverse"] | false) ? -1 : 1;
+            for (int i = 0; i < count; ++i) {
+                float a = startAngle + dir * TWO_PI_F * i / count;
+                addPoint(x0 + radius * cosf(a), y0 + radius * sinf(a));
+            }
+            if (fixture["center"] | false) {
+                addPoint(x0, y0);  // Jewel-style center LED
+            }
+        } else if (type == "points") {
+            for (JsonVariant pt : fixture["points"].as<JsonArray>()) {
+                addPoint(x0 + (pt[0] | 0.0f), y0 + (pt[1] | 0.0f));
+            }
+        } else {
+            LOG_WARNF_COMPONENT("PixelMap", "Unknown fixture type '%s' - skipping", type.c_str());
+        }
+    }
+
+    if (px.empty()) {
+        LOG_ERROR_COMPONENT("PixelMap", "Layout produced no LEDs");
+        return false;
+    }
+    if ((int) px.size() > maxLEDs) {
+        LOG_WARNF_COMPONENT("PixelMap", "Layout has %d LEDs but buffer holds %d - truncating",
+            (int) px.size(), maxLEDs);
+        px.resize(maxLEDs);
+        py.resize(maxLEDs);
+    }
+
+    customLayout = true;
+    finalize();
+    return true;
+}
+
+bool PixelMap::loadFromFile(const char* path, int maxLEDs) {
+    if (!g_sdCardController || !g_sdCardController->exists(path)) {
+        return false;
+    }
+    String json = g_sdCardController->readFile(path);
+    DynamicJsonDocument doc(json.length() * 2 + 1024);
+    DeserializationError error = deserializeJson(doc, json);
+    if (error) {
+        LOG_ERRORF_COMPONENT("PixelMap", "Failed to parse %s: %s", path, error.c_str());
+        return false;
+    }
+    if (!buildFromJson(doc.as<JsonObject>(), maxLEDs)) {
+        return false;
+    }
+    LOG_INFOF_COMPONENT("PixelMap", "Loaded %d LEDs from %s (%.1f x %.1f)",
+        size(), path, width(), height());
+    return true;
+}
+
+void PixelMap::finalize() {
+    const int n = (int) px.size();
+    if (n == 0) return;
+
+    minX = maxX = px[0];
+    minY = maxY = py[0];
+    for (int i = 1; i < n; ++i) {
+        if (px[i] < minX) minX = px[i];
+        if (px[i] > maxX) maxX = px[i];
+        if (py[i] < minY) minY = py[i];
+        if (py[i] > maxY) maxY = py[i];
+    }
+
+    const float w = width() > 0.0f ? width() : 1.0f;
+    const float h = height() > 0.0f ? height() : 1.0f;
+    const float cx = 0.5f * (minX + maxX);
+    const float cy = 0.5f * (minY + maxY);
+    const float rMax = 0.5f * sqrtf(w * w + h * h);
+
+    nx.resize(n); ny.resize(n);
+    r.resize(n); theta.resize(n);
+    strip.resize(n);
+    for (int i = 0; i < n; ++i) {
+        nx[i] = (px[i] - minX) / w;
+        ny[i] = (py[i] - minY) / h;
+        float dx = px[i] - cx, dy = py[i] - cy;
+        r[i] = sqrtf(dx * dx + dy * dy) / rMax;
+        float a = atan2f(dy, dx) / TWO_PI_F;
+        theta[i] = a < 0.0f ? a + 1.0f : a;
+        strip[i] = n > 1 ? (float) i / (float) (n - 1) : 0.0f;
+    }
+
+    // Counting sort of LED indices into cells
+    cellCols = (int) (width() / CELL_SIZE) + 1;
+    cellRows = (int) (height() / CELL_SIZE) + 1;
+    const int numCells = cellRows * cellCols;
+    cellStart.assign(numCells + 1, 0);
+    cellLeds.resize(n);
+    for (int i = 0; i < n; ++i) {
+        ++cellStart[cellRow(py[i]) * cellCols + cellCol(px[i]) + 1];
+    }
+    for (int c = 0; c < numCells; ++c) {
+        cellStart[c + 1] += cellStart[c];
+    }
+    std::vector<uint16_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        int cell = cellRow(py[i]) * cellCols + cellCol(px[i]);
+        cellLeds[fill[cell]++] = (uint16_t) i;
+    }
+}
+
+int PixelMap::cellCol(float x) const {
+    int c = (int) ((x - minX) / CELL_SIZE);
+    if (c < 0) return 0;
+    return c >= cellCols ? cellCols - 1 : c;
+}
+
+int PixelMap::cellRow(float y) const {
+    int c = (int) ((y - minY) / CELL_SIZE);
+    if (c < 0) return 0;
+    return c >= cellRows ? cellRows - 1 : c;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * PixelMap - Per-LED spatial lookup tables for arbitrary fixture layouts
+ *
+ * Every LED in the render buffer gets a position that is computed once when
+ * the map is built, so effects can sample spatial fields without per-frame
+ * index math or trig:
+ *   - px/py:  position in grid units (same space as RingPlayer row/col)
+ *   - nx/ny:  position normalized to [0, 1] over the layout bounds
+ *   - r:      distance from the layout center, normalized to [0, 1]
+ *   - theta:  angle around the layout center, normalized to [0, 1)
+ *   - strip:  position along the physical strip, normalized to [0, 1]
+ *
+ * LEDs are also bucketed into coarse cells so spatial queries (e.g. rings)
+ * only visit LEDs that actually exist near the query area instead of every
+ * cell of a bounding box.
+ *
+ * Layouts are loaded from /config/pixelmap.json as a list of fixtures that
+ * are appended in strip order:
+ * {
+ *   "fixtures": [
+ *     { "type": "grid", "rows": 16, "cols": 16, "x": 0, "y": 0, "serpentine": false },
+ *     { "type": "ring", "count": 24, "x": 20, "y": 8, "radius": 4, "start_angle": 0 },
+ *     { "type": "points", "points": [[1, 1], [2, 1.5]] }
+ *   ]
+ * }
+ * Without that file the map is a dense row-major grid matching g_ledGeometry.
+ */
+class PixelMap {
+public:
+    static constexpr const char* DEFAULT_PATH = "/config/pixelmap.json";
+    static constexpr float CELL_SIZE = 4.0f;  // Bucket size in grid units
+
+    // A per-LED table in [0, 1] that effects can sweep across
+    enum class Field : uint8_t { Strip, X, Y, Radius, Angle };
+
+    // "strip", "x", "y", "radius" or "angle"; anything else is Strip
+    static Field fieldFromName(const char* name);
+
+    PixelMap() = default;
+
+    // Build a dense row-major grid (index = row * cols + col)
+    void buildGrid(int rows, int cols);
+    // Build from a parsed layout description; returns false if it is invalid
+    bool buildFromJson(const JsonObject& layout, int maxLEDs);
+    // Load a layout file from SD; returns false if the file is missing or invalid
+    bool loadFromFile(const char* path, int maxLEDs);
+
+    int size() const { return (int) px.size(); }
+    bool isValid() const { return !px.empty(); }
+    bool isCustomLayout() const { return customLayout; }
+    float width() const { return maxX - minX; }
+    float height() const { return maxY - minY; }
+    float centerX() const { return 0.5f * (minX + maxX); }
+    float centerY() const { return 0.5f * (minY + maxY); }
+
+    // The table for a field (size() entries), nullptr before the map is built
+    const float* field(Field f) const;
+
+    // Per-LED tables, indexed by render buffer index
+    std::vector<float> px, py;
+    std::vector<float> nx, ny;
+    std::vector<float> r, theta;
+    std::vector<float> strip;
+
+    /**
+     * Visit every LED whose position is inside the axis-aligned box
+     * [x0, x1] x [y0, y1] (grid units). Only buckets overlapping the box are
+     * scanned, and only real LEDs inside them are passed to fn.
+     */
+    template<typename Fn>
+    void forEachInBox(float x0, float y0, float x1, float y1, Fn&& fn) const {
+        if (cellCols <= 0 || x1 < minX || y1 < minY || x0 > maxX || y0 > maxY) return;
+        int c0 = cellCol(x0), c1 = cellCol(x1);
+        int r0 = cellRow(y0), r1 = cellRow(y1);
+        for (int cr = r0; cr <= r1; ++cr) {
+            for (int cc = c0; cc <= c1; ++cc) {
+                int cell = cr * cellCols + cc;
+                for (uint16_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                    uint16_t idx = cellLeds[k];
+                    float x = px[idx], y = py[idx];
+                    if (x < x0 || x > x1 || y < y0 || y > y1) continue;
+                    fn(idx, x, y);
+                }
+            }
+        }
+    }
+
+private:
+    bool customLayout = false;
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+    int cellRows = 0, cellCols = 0;
+    std::vector<uint16_t> cellStart;  // cellRows * cellCols + 1 offsets into cellLeds
+    std::vector<uint16_t> cellLeds;   // LED indices grouped by cell
+
+    void clear();
+    void addPoint(float x, float y);
+    void finalize();
+    int cellCol(float x) const;
+    int cellRow(float y) const;
+};
+
+extern PixelMap g_pixelMap;
@@ -78,6 +78,15 @@ void PulsePlayer::update(float dt)
     }// end if
 }
 
+bool PulsePlayer::isFinished()const
+{
+    if (doRepeat) return false;
+    // init() clamps a zero speed to 0.001 LEDs/s, which would hold the voice for hours
+    if (fabsf(speed) <= 0.001f) return true;
+    if (speed < 0.0f) return numLts + hfW + tElap * speed < 0.0f;// off left end
+    return tElap * speed >= numLts + hfW;// off right end
+}
+
 void PulsePlayer::updateLeft(float dt)// for speed < 0
 {
     // Safety check - ensure pLt0 is valid
@@ -40,6 +40,7 @@ public:
     int get_nMid()const { return tElap * speed; }
 
     void update(float dt);// pulse travels left to right
+    bool isFinished()const;// a one-shot pulse has left the strip (never true when repeating)
     void setPosition(int n) { tElap = n / speed; }// assign center position
 
     void init(Light &r_Lt0, int NumLts, Light HiLt, int W_pulse, float Speed, bool DoRepeat);
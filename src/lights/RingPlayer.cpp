@@ -1,4 +1,5 @@
 #include "RingPlayer.h"
+#include "PixelMap.h"
 
 // bool RPdata::init(FileParser &FP)
 // {
@@ -21,7 +22,12 @@ bool RingPlayer::update(float dt)// true if animating
 {
     if (!isPlaying) return false;
 
-    if (onePulse) updatePulse(dt);
+    if (pMap)
+    {
+        if (onePulse) updatePulseMapped(dt);
+        else updateWaveMapped(dt);
+    }
+    else if (onePulse) updatePulse(dt);
     else updateWave(dt);
 
     return isPlaying;
@@ -193,6 +199,115 @@ void RingPlayer::updateWave(float dt)
         isPlaying = false;
 }
 
+// PixelMap versions: same shading as above, but only LEDs that exist inside
+// the ring's box are visited, and they are written by buffer index
+void RingPlayer::updatePulseMapped(float dt)
+{
+    bool LtAssigned = false;
+    tElap += dt;
+
+    float R0 = ringSpeed * tElap;
+    float R0sq = R0 * R0;
+    float RF = R0 + ringWidth;
+    float RFsq = RF * RF;
+    float Rmid = 0.5f * (R0 + RF);
+
+    pMap->forEachInBox(fColC - RF, fRowC - RF, fColC + RF, fRowC + RF,
+        [&](int idx, float x, float y)
+    {
+        float Rx = fColC - x, Ry = fRowC - y;
+        float RnSq = Rx * Rx + Ry * Ry;
+        if (RnSq < R0sq || RnSq > RFsq) return;
+
+        float Rn = sqrtf(RnSq);
+        float fadeU = 1.0f;
+        if (Rn > fadeRadius)
+        {
+            fadeU = (fadeRadius + fadeWidth - Rn) / (fadeRadius + fadeWidth);
+            if (fadeU < 0.01f) return;
+        }
+
+        float U = 2.0f * (Rn - R0) / ringWidth;
+        if (Rn > Rmid) U = 2.0f * (RF - Rn) / ringWidth;
+        U *= Amp * fadeU * U;
+        float fadeIn = 1.0f - U;
+        Light &currLt = pLt0[idx];
+        currLt = Light(U * hiLt.r + fadeIn * currLt.r,
+                       U * hiLt.g + fadeIn * currLt.g,
+                       U * hiLt.b + fadeIn * currLt.b);
+        LtAssigned = true;
+    });
+
+    if (LtAssigned && !isVisible)
+        isVisible = true;
+
+    // An off-map center may never touch an LED; stop once the ring has faded out
+    if ((isVisible && !LtAssigned) || R0 >= fadeRadius + fadeWidth)
+        isPlaying = false;
+}
+
+void RingPlayer::updateWaveMapped(float dt)
+{
+    if (!isPlaying) return;
+
+    bool LtAssigned = false;
+    tElap += dt;
+    if (!isRadiating) stopTime += dt;
+
+    float R0 = ringSpeed * tElap;
+    if (R0 > fadeRadius + fadeWidth) R0 = fadeRadius + fadeWidth;
+
+    float rotFreq = 3.1416f * ringSpeed / ringWidth;
+    float K = 3.1416f / ringWidth;
+    float R0sq = R0 * R0;
+    float frwSq = (fadeRadius + fadeWidth) * (fadeRadius + fadeWidth);
+    float Rstop = ringSpeed * stopTime;
+
+    pMap->forEachInBox(fColC - R0, fRowC - R0, fColC + R0, fRowC + R0,
+        [&](int idx, float x, float y)
+    {
+        float Rx = fColC - x, Ry = fRowC - y;
+        float RnSq = Rx * Rx + Ry * Ry;
+        if (RnSq > R0sq || RnSq > frwSq) return;
+        float Rn = sqrtf(RnSq);
+        if (!isRadiating && Rn < Rstop) return;
+
+        float fadeU = 1.0f;
+        if (Rn > fadeRadius)
+        {
+            fadeU = (fadeRadius + fadeWidth - Rn) / (fadeRadius + fadeWidth);
+            if (fadeU < 0.01f) return;
+        }
+
+        float U = -Amp * sinf(K * Rn - direction * rotFreq * tElap);
+        U *= fadeU;
+        float fadeIn = (U > 0.0f) ? 1.0f - U : 1.0f + U;
+        Light &currLt = pLt0[idx];
+        float fr = fadeIn * currLt.r;
+        float fg = fadeIn * currLt.g;
+        float fb = fadeIn * currLt.b;
+        if (U > 0.0f)
+        {
+            fr += U * hiLt.r;
+            fg += U * hiLt.g;
+            fb += U * hiLt.b;
+        }
+        else
+        {
+            fr -= U * loLt.r;
+            fg -= U * loLt.g;
+            fb -= U * loLt.b;
+        }
+        currLt = Light(fr, fg, fb);
+        LtAssigned = true;
+    });
+
+    if (LtAssigned && !isVisible) isVisible = true;
+
+    if (isVisible && !LtAssigned)
+        isPlaying = false;
+}
+
 // static methods. FloatAll stores R0, RF, fadeRate for each player
 // LtAssAll stores LtAssigned for each player
 void RingPlayer::updatePulseAll(RingPlayer *pRP, int numRP, float dt, float *FloatAll, bool *LtAssAll)
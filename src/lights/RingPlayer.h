@@ -5,6 +5,8 @@
 #include "Light.h"
 // #include "FileParser.h"
 
+class PixelMap;
+
 struct RPdata
 {
     Light hiLt, loLt;
@@ -33,7 +35,12 @@ class RingPlayer
     float Amp = 1.0f;// limit blending of hiLt and loLt
 
     void initToGrid( Light* p_Lt0, int gridRows, int gridCols )
-    { pLt0 = p_Lt0; rows = gridRows; cols = gridCols; }
+    { pLt0 = p_Lt0; rows = gridRows; cols = gridCols; pMap = nullptr; }
+
+    // Render through a PixelMap: only real LEDs near the ring are visited.
+    // Ring center row/col are in the map's grid units (row = y, col = x).
+    void initToMap( Light* p_Lt0, const PixelMap* map )
+    { pLt0 = p_Lt0; pMap = map; }
 
     void setRingCenter( float rowC, float colC )
     { fRowC = rowC; fColC = colC; }
@@ -88,6 +95,8 @@ class RingPlayer
     // for each process
     void updatePulse( float dt );
     void updateWave( float dt );
+    void updatePulseMapped( float dt );
+    void updateWaveMapped( float dt );
 
     RingPlayer(){}
     ~RingPlayer(){}
@@ -98,6 +107,7 @@ class RingPlayer
     protected:
 
     private:
+    const PixelMap* pMap = nullptr;
 };
 
 #endif // RINGPLAYER_H
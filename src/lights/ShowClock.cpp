@@ -0,0 +1,4 @@
+#include "ShowClock.h"
+
+std::atomic<bool> ShowClock::pinned{false};
+std::atomic<unsigned long> ShowClock::pinnedMs{0};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * ShowClock - Time source for anything that animates a show
+ *
+ * Normally just millis(). An offline bake pins it to the frame being
+ * rendered so choreography, spawning effects and brightness pulses advance
+ * in show time however long each frame takes to render and write.
+ *
+ * The bake runs on the LED task, but other tasks (e.g. a brightness change
+ * from the web server) read the clock meanwhile, so the pin is atomic.
+ */
+class ShowClock {
+public:
+    static unsigned long nowMs() {
+        return pinned.load(std::memory_order_acquire) ? pinnedMs.load(std::memory_order_relaxed) : millis();
+    }
+    static void pin(unsigned long ms) {
+        pinnedMs.store(ms, std::memory_order_relaxed);
+        pinned.store(true, std::memory_order_release);
+    }
+    static void release() { pinned.store(false, std::memory_order_release); }
+    static bool isPinned() { return pinned.load(std::memory_order_acquire); }
+
+private:
+    static std::atomic<bool> pinned;
+    static std::atomic<unsigned long> pinnedMs;
+};
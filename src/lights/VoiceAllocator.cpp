@@ -0,0 +1,55 @@
+#include "VoiceAllocator.h"
+#include <string.h>
+
+void VoiceAllocator::init(int count, VoiceStealPolicy stealPolicy) {
+    if (count < 1) count = 1;
+    policy = stealPolicy;
+    busy.assign(count, 0);
+    startMs.assign(count, 0);
+    freeList.clear();
+    freeList.reserve(count);
+    // Hand out low indices first
+    for (int i = count - 1; i >= 0; i--) {
+        freeList.push_back((uint16_t) i);
+    }
+    active = 0;
+    resetStats();
+}
+
+void VoiceAllocator::release(int voice) {
+    if (!isBusy(voice)) return;
+    busy[voice] = 0;
+    active--;
+    freeList.push_back((uint16_t) voice);
+}
+
+void VoiceAllocator::releaseAll() {
+    for (int i = 0; i < (int) busy.size(); i++) {
+        release(i);
+    }
+}
+
+void VoiceAllocator::resetStats() {
+    stats = VoiceStats();
+    stats.poolSize = (uint16_t) busy.size();
+    stats.peakActive = active;
+}
+
+VoiceStealPolicy VoiceAllocator::policyFromName(const char* name, VoiceStealPolicy fallback) {
+    if (!name) return fallback;
+    if (strcmp(name, "none") == 0) return VoiceStealPolicy::None;
+    if (strcmp(name, "oldest") == 0) return VoiceStealPolicy::Oldest;
+    if (strcmp(name, "quietest") == 0) return VoiceStealPolicy::Quietest;
+    if (strcmp(name, "furthest_off_grid") == 0) return VoiceStealPolicy::FurthestOffGrid;
+    return fallback;
+}
+
+const char* VoiceAllocator::policyName(VoiceStealPolicy policy) {
+    switch (policy) {
+        case VoiceStealPolicy::None: return "none";
+        case VoiceStealPolicy::Oldest: return "oldest";
+        case VoiceStealPolicy::Quietest: return "quietest";
+        case VoiceStealPolicy::FurthestOffGrid: return "furthest_off_grid";
+        default: return "unknown";
+    }
+}
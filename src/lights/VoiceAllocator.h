@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * What to do when a voice is requested and every voice in the pool is busy.
+ *   None            - drop the request (counted as dropped)
+ *   Oldest          - reuse the voice that was started longest ago
+ *   Quietest        - reuse the voice that currently contributes least light
+ *   FurthestOffGrid - reuse the voice that is furthest outside the LED layout
+ *                     (a ring grown past the corners, a pulse run off the strip)
+ */
+enum class VoiceStealPolicy : uint8_t {
+    None = 0,
+    Oldest,
+    Quietest,
+    FurthestOffGrid
+};
+
+struct VoiceStats {
+    uint16_t poolSize = 0;
+    uint16_t peakActive = 0;
+    uint32_t allocated = 0;   // Includes stolen voices
+    uint32_t stolen = 0;
+    uint32_t dropped = 0;
+};
+
+/**
+ * VoiceAllocator - Free list over a fixed pool of player voices
+ *
+ * The allocator only tracks indices; the owner keeps the players themselves
+ * (RingPlayer, PulsePlayer) in a parallel array and releases a voice when its
+ * player finishes. Allocation is O(1) while voices are free; stealing scans
+ * the busy voices once.
+ */
+class VoiceAllocator {
+public:
+    void init(int count, VoiceStealPolicy stealPolicy);
+
+    /**
+     * Take a free voice, or steal one according to the policy. For Quietest
+     * and FurthestOffGrid, stealScore(voice) rates a busy voice and the
+     * highest score is stolen. Returns the voice index, or -1 if dropped.
+     */
+    template<typename ScoreFn>
+    int allocate(uint32_t nowMs, ScoreFn&& stealScore) {
+        int voice = -1;
+        if (!freeList.empty()) {
+            voice = freeList.back();
+            freeList.pop_back();
+            busy[voice] = 1;
+            active++;
+            if (active > stats.peakActive) stats.peakActive = active;
+        } else if (policy == VoiceStealPolicy::Oldest) {
+            uint32_t oldestAge = 0;
+            for (int i = 0; i < (int) busy.size(); i++) {
+                uint32_t age = nowMs - startMs[i];
+                if (voice < 0 || age > oldestAge) {
+                    voice = i;
+                    oldestAge = age;
+                }
+            }
+            if (voice >= 0) stats.stolen++;
+        } else if (policy != VoiceStealPolicy::None) {
+            float best = 0.0f;
+            for (int i = 0; i < (int) busy.size(); i++) {
+                float score = stealScore(i);
+                if (voice < 0 || score > best) {
+                    voice = i;
+                    best = score;
+                }
+            }
+            if (voice >= 0) stats.stolen++;
+        }
+
+        if (voice < 0) {
+            stats.dropped++;
+            return -1;
+        }
+        startMs[voice] = nowMs;
+        stats.allocated++;
+        return voice;
+    }
+
+    // Return a voice to the free list (ignored if it is already free)
+    void release(int voice);
+    void releaseAll();
+
+    bool isBusy(int voice) const { return voice >= 0 && voice < (int) busy.size() && busy[voice]; }
+    int activeCount() const { return active; }
+    int size() const { return (int) busy.size(); }
+    VoiceStealPolicy getPolicy() const { return policy; }
+    const VoiceStats& getStats() const { return stats; }
+    void resetStats();
+
+    static VoiceStealPolicy policyFromName(const char* name, VoiceStealPolicy fallback = VoiceStealPolicy::Oldest);
+    static const char* policyName(VoiceStealPolicy policy);
+
+private:
+    std::vector<uint16_t> freeList;
+    std::vector<uint32_t> startMs;
+    std::vector<uint8_t> busy;
+    uint16_t active = 0;
+    VoiceStealPolicy policy = VoiceStealPolicy::Oldest;
+    VoiceStats stats;
+};
@@ -0,0 +1,147 @@
+#include "BakedShowEffect.h"
+#include "freertos/LogManager.h"
+#include "hal/SDCardController.h"
+#include "../../controllers/BrightnessController.h"
+#include <string.h>
+
+static_assert(sizeof(Light) == 3, "Baked frames are copied straight into Light buffers");
+
+std::unique_ptr<SDBakedFile> SDBakedFile::open(const char* path, const char* mode) {
+#if SUPPORTS_SD_CARD
+    if (!g_sdCardController || !g_sdCardController->isAvailable()) {
+        return nullptr;
+    }
+    SDCardFileHandle* handle = g_sdCardController->open(path, mode);
+    if (!handle) {
+        return nullptr;
+    }
+    return std::unique_ptr<SDBakedFile>(new SDBakedFile(handle));
+#else
+    (void) path;
+    (void) mode;
+    return nullptr;
+#endif
+}
+
+SDBakedFile::~SDBakedFile() {
+#if SUPPORTS_SD_CARD
+    if (handle && g_sdCardController) {
+        g_sdCardController->close(handle);
+    }
+#endif
+}
+
+bool SDBakedFile::write(const uint8_t* data, size_t length) {
+#if SUPPORTS_SD_CARD
+    return g_sdCardController && g_sdCardController->write(handle, data, length) == length;
+#else
+    return false;
+#endif
+}
+
+size_t SDBakedFile::read(uint8_t* data, size_t length) {
+#if SUPPORTS_SD_CARD
+    return g_sdCardController ? g_sdCardController->read(handle, data, length) : 0;
+#else
+    return 0;
+#endif
+}
+
+bool SDBakedFile::seek(uint32_t offset) {
+#if SUPPORTS_SD_CARD
+    return g_sdCardController && g_sdCardController->seek(handle, (long) offset);
+#else
+    return false;
+#endif
+}
+
+BakedShowEffect::BakedShowEffect(int id, const String& path, uint32_t startMs, bool loop, bool applyBrightness)
+    : Effect(id), path(path), startMs(startMs), loop(loop), applyBrightness(applyBrightness) {}
+
+void BakedShowEffect::initialize(Light* output, int numLEDs) {
+    (void) output;
+    this->numLEDs = numLEDs;
+    file = SDBakedFile::open(path.c_str(), "r");
+    if (!file || !reader.open(file.get())) {
+        LOG_ERRORF_COMPONENT("BakedShowEffect", "Cannot open baked show %s", path.c_str());
+        file.reset();
+        finished = true;
+        return;
+    }
+    if (reader.getNumLEDs() != numLEDs) {
+        LOG_WARNF_COMPONENT("BakedShowEffect", "%s was baked for %d LEDs, playing on %d",
+            path.c_str(), reader.getNumLEDs(), numLEDs);
+    }
+    frame.assign((size_t) reader.getNumLEDs() * 3, 0);
+    LOG_DEBUGF_COMPONENT("BakedShowEffect", "Playing %s: %lu frames at %u fps",
+        path.c_str(), (unsigned long) reader.getFrameCount(), reader.getFps());
+    seekMs(startMs);
+}
+
+bool BakedShowEffect::seekMs(uint32_t timeMs) {
+    if (!reader.isOpen()) return false;
+    uint8_t brightness = 0;
+    if (!reader.seekMs(timeMs, frame.data(), &brightness)) {
+        LOG_WARNF_COMPONENT("BakedShowEffect", "Seek to %lu ms failed", (unsigned long) timeMs);
+        return false;
+    }
+    playMs = timeMs;
+    finished = false;
+    applyFrameBrightness(brightness);
+    return true;
+}
+
+void BakedShowEffect::update(float dt) {
+    if (!isActive || finished || !reader.isOpen()) return;
+
+    playMs += dt * 1000.0;
+    if (playMs >= reader.getDurationMs()) {
+        if (!loop) {
+            finished = true;
+            return;
+        }
+        playMs = 0.0;
+    }
+
+    // Usually the next frame; after a slow frame the reader decodes forward,
+    // or jumps to a keyframe when that is closer
+    uint32_t target = reader.frameAtMs((uint32_t) playMs);
+    if (target + 1 == reader.getPosition()) return;
+    uint8_t brightness = 0;
+    if (!reader.seekFrame(target, frame.data(), &brightness)) {
+        LOG_ERRORF_COMPONENT("BakedShowEffect", "Bad frame %lu in %s", (unsigned long) target, path.c_str());
+        finished = true;
+        return;
+    }
+    applyFrameBrightness(brightness);
+}
+
+void BakedShowEffect::render(Light* output) {
+    if (!isActive || frame.empty()) return;
+    int count = reader.getNumLEDs() < numLEDs ? reader.getNumLEDs() : numLEDs;
+    memcpy(output, frame.data(), (size_t) count * 3);
+}
+
+bool BakedShowEffect::isFinished() const {
+    return !isActive || finished;
+}
+
+bool BakedShowEffect::updateParams(const JsonObject& params) {
+    if (params.containsKey("seek_ms")) {
+        return seekMs(params["seek_ms"].as<uint32_t>());
+    }
+    if (params.containsKey("loop")) {
+        loop = params["loop"];
+        return true;
+    }
+    return false;
+}
+
+void BakedShowEffect::applyFrameBrightness(uint8_t brightness) {
+    if (!applyBrightness || brightness == appliedBrightness) return;
+    BrightnessController* bc = BrightnessController::getInstance();
+    if (bc) {
+        bc->setBrightness(brightness);
+        appliedBrightness = brightness;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Effect.h"
+#include "../BakedFrames.h"
+#include "PlatformConfig.h"
+#include <memory>
+#include <vector>
+
+struct SDCardFileHandle;
+
+/**
+ * SDBakedFile - A baked show file on SD, readable by BakedFrameReader and
+ * writable by BakedFrameWriter. Closes the file when destroyed.
+ */
+class SDBakedFile : public BakedFrameSink, public BakedFrameSource {
+public:
+    // mode is passed to the SD controller ("r" to play, "w" to bake)
+    static std::unique_ptr<SDBakedFile> open(const char* path, const char* mode);
+    ~SDBakedFile() override;
+
+    bool write(const uint8_t* data, size_t length) override;
+    size_t read(uint8_t* data, size_t length) override;
+    bool seek(uint32_t offset) override;
+
+private:
+    explicit SDBakedFile(SDCardFileHandle* handle) : handle(handle) {}
+    SDCardFileHandle* handle;
+};
+
+/**
+ * Baked Show Effect
+ *
+ * Plays a show baked by the "choreo_bake" command: each frame is decoded
+ * from SD into a frame buffer and copied out, so playback costs a few
+ * hundred bytes of reads and a memcpy per frame no matter how busy the
+ * original choreography was. Frame brightness is applied through the
+ * BrightnessController unless "brightness" is false.
+ *
+ * Seek with {"seek_ms": t} through update_effect_params.
+ */
+class BakedShowEffect : public Effect {
+public:
+    BakedShowEffect(int id, const String& path, uint32_t startMs, bool loop, bool applyBrightness);
+    ~BakedShowEffect() override = default;
+
+    void update(float dt) override;
+    void initialize(Light* output, int numLEDs) override;
+    void render(Light* output) override;
+    bool isFinished() const override;
+    bool updateParams(const JsonObject& params) override;
+
+    bool seekMs(uint32_t timeMs);
+
+private:
+    void applyFrameBrightness(uint8_t brightness);
+
+    String path;
+    std::unique_ptr<SDBakedFile> file;
+    BakedFrameReader reader;
+    std::vector<uint8_t> frame;  // Last decoded frame, RGB triplets
+    int numLEDs = 0;
+    uint32_t startMs;
+    double playMs = 0.0;
+    bool loop;
+    bool applyBrightness;
+    bool finished = false;
+    int appliedBrightness = -1;
+};
@@ -1,8 +1,9 @@
 #include "ColorBlendEffect.h"
 #include "freertos/LogManager.h"
 
-ColorBlendEffect::ColorBlendEffect(int id, const String &color1, const String &color2, float speed, float duration)
-    : Effect(id), color1String(color1), color2String(color2), speed(speed), duration(duration), elapsed(0.0f)
+ColorBlendEffect::ColorBlendEffect(int id, const String &color1, const String &color2, float speed, float duration,
+                                   PixelMap::Field field)
+    : Effect(id), color1String(color1), color2String(color2), speed(speed), duration(duration), elapsed(0.0f), field(field)
 {
 
     hasDuration = (duration > 0.0f);
@@ -33,6 +34,8 @@ void ColorBlendEffect::initialize(Light* output, int numLEDs)
 {
     this->numLEDs = numLEDs;
     (void)output; // Not needed for simple effects
+    fieldTable = g_pixelMap.field(field);
+    fieldSize = fieldTable ? g_pixelMap.size() : 0;
     LOG_DEBUGF_COMPONENT("ColorBlendEffect", "Initialized with %d LEDs", numLEDs);
 }
 
@@ -40,14 +43,14 @@ void ColorBlendEffect::render(Light *output)
 {
     if (!isActive) return;
 
-    // Create a flowing blend across the LED strip
+    // Create a flowing blend across the LED strip (or the chosen map field)
     for (int i = 0; i < numLEDs; i++)
     {
-        // Calculate position along the strip (0.0 to 1.0)
-        float stripPosition = (float) i / (float) (numLEDs - 1);
+        // Position in the field (0.0 to 1.0), precomputed per LED by the pixel map
+        float position = i < fieldSize ? fieldTable[i] : (float) i / (float) (numLEDs - 1);
 
         // Add the blend position to create flowing effect
-        float blendT = fmod(stripPosition + blendPosition, 1.0f);
+        float blendT = fmod(position + blendPosition, 1.0f);
 
         // Blend between the two colors
         Light blendedColor = blendColors(color1, color2, blendT);
@@ -74,6 +77,16 @@ void ColorBlendEffect::setColor2(const String &color)
     parseColorString(color2String, color2);
 }
 
+int ColorBlendEffect::findParam(const char* name) const
+{
+    return strcmp(name, "speed") == 0 ? 0 : -1;
+}
+
+void ColorBlendEffect::setParam(int slot, float value)
+{
+    if (slot == 0) setSpeed(value);
+}
+
 void ColorBlendEffect::setSpeed(float newSpeed)
 {
     speed = newSpeed;
@@ -1,15 +1,18 @@
 #pragma once
 
 #include "Effect.h"
+#include "../PixelMap.h"
 
 /**
  * Color blend effect that smoothly transitions between two colors
  * 
- * Creates a flowing blend between color1 and color2 across the LED strip
+ * Creates a flowing blend between color1 and color2 across the LED strip,
+ * or across another PixelMap field (x, y, radius, angle) of the layout
  */
 class ColorBlendEffect : public Effect {
 public:
-    ColorBlendEffect(int id, const String& color1, const String& color2, float speed = 1.0f, float duration = -1.0f);
+    ColorBlendEffect(int id, const String& color1, const String& color2, float speed = 1.0f, float duration = -1.0f,
+                     PixelMap::Field field = PixelMap::Field::Strip);
     ~ColorBlendEffect() = default;
     
     // Effect interface
@@ -17,6 +20,8 @@ public:
     void initialize(Light* output, int numLEDs) override;
     void render(Light* output) override;
     bool isFinished() const override;
+    int findParam(const char* name) const override;
+    void setParam(int slot, float value) override;
     
     // Color blend controls
     void setColor1(const String& color);
@@ -34,6 +39,9 @@ private:
     float elapsed;
     bool hasDuration;
     float blendPosition; // 0.0 to 1.0, cycles between colors
+    PixelMap::Field field;
+    const float* fieldTable = nullptr;  // g_pixelMap's table for field, looked up in initialize()
+    int fieldSize = 0;
     
     void parseColorString(const String& colorString, Light& color);
     Light blendColors(const Light& c1, const Light& c2, float t);
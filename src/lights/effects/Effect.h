@@ -38,7 +38,34 @@ public:
     // Optional: update parameters at runtime (e.g. from timeline). Returns true if params were applied.
     virtual bool updateParams(const JsonObject& params) { (void)params; return false; }
 
+    // Optional: typed parameter slots for per-frame automation. findParam() maps a
+    // name to a slot once (-1 = not automatable); setParam() is then called with
+    // the slot every frame, so it must stay cheap and allocation-free.
+    virtual int findParam(const char* name) const { (void)name; return -1; }
+    virtual void setParam(int slot, float value) { (void)slot; (void)value; }
+
+    // How a decimated effect's cached output goes onto the frame. Replace writes
+    // every pixel, as a full-strip effect does when it renders directly; ReplaceLit
+    // only writes the pixels it lit, for sparse effects (stars, rings, pulses);
+    // Add sums onto the layers below.
+    enum class OutputBlend : uint8_t { Replace, ReplaceLit, Add };
+
+    // Optional: preferred simulation rate in Hz (0 = every LED frame). EffectManager
+    // updates the effect at this rate and holds, or interpolates, its last output
+    // on the frames in between.
+    float getPreferredUpdateHz() const { return preferredUpdateHz; }
+    bool getInterpolatesOutput() const { return interpolateOutput; }
+    void setPreferredUpdateRate(float hz, bool interpolate = false) {
+        preferredUpdateHz = hz > 0.0f ? hz : 0.0f;
+        interpolateOutput = interpolate;
+    }
+    OutputBlend getOutputBlend() const { return outputBlend; }
+    void setOutputBlend(OutputBlend blend) { outputBlend = blend; }
+
 protected:
     int effectId;
     bool isActive;
+    float preferredUpdateHz = 0.0f;
+    bool interpolateOutput = false;
+    OutputBlend outputBlend = OutputBlend::Replace;
 };
@@ -8,7 +8,9 @@
 #include "WavePlayerEffect.h"
 #include "PulsePlayerEffect.h"
 #include "PointPlayerEffect.h"
+#include "BakedShowEffect.h"
 #include "freertos/LogManager.h"
+#include "../LEDGeometry.h"
 
 int EffectFactory::nextEffectId = 1;
 
@@ -61,35 +63,47 @@ std::unique_ptr<Effect> EffectFactory::createEffect(const JsonObject& effectComm
     
     LOG_DEBUG("EffectFactory: Creating effect of type: " + effectType);
     
+    std::unique_ptr<Effect> effect;
+    
     if (effectType == "white") {
-        return createWhiteEffect(params);
+        effect = createWhiteEffect(params);
     }
     else if (effectType == "solid_color") {
-        return createSolidColorEffect(params);
+        effect = createSolidColorEffect(params);
     }
     else if (effectType == "rainbow") {
-        return createRainbowEffect(params);
+        effect = createRainbowEffect(params);
     }
     else if (effectType == "color_blend") {
-        return createColorBlendEffect(params);
+        effect = createColorBlendEffect(params);
     }
     else if (effectType == "twinkle") {
-        return createTwinklingEffect(params);
+        effect = createTwinklingEffect(params);
     }
     else if (effectType == "rain") {
-        return createRainEffect(params);
+        effect = createRainEffect(params);
     }
     else if (effectType == "wave") {
-        return createWavePlayerEffect(params);
+        effect = createWavePlayerEffect(params);
     } else if (effectType == "pulse") {
-        return createPulsePlayerEffect(params);
+        effect = createPulsePlayerEffect(params);
     } else if (effectType == "point_player") {
-        return createPointPlayerEffect(params);
+        effect = createPointPlayerEffect(params);
+    } else if (effectType == "baked") {
+        effect = createBakedShowEffect(params);
     }
     else {
         LOG_ERROR("EffectFactory: Unknown effect type: " + effectType);
         return nullptr;
     }
+
+    // Optional override of the effect's preferred update rate (0 = every frame)
+    if (effect && (params.containsKey("update_hz") || params.containsKey("uhz"))) {
+        float hz = params.containsKey("update_hz") ? params["update_hz"].as<float>() : params["uhz"].as<float>();
+        bool interpolate = params["interpolate"] | effect->getInterpolatesOutput();
+        effect->setPreferredUpdateRate(hz, interpolate);
+    }
+    return effect;
 }
 
 std::unique_ptr<Effect> EffectFactory::createWhiteEffect(const JsonObject& params) {
@@ -162,11 +176,14 @@ std::unique_ptr<Effect> EffectFactory::createRainbowEffect(const JsonObject& par
         duration = params["d"];
     }
     
+    // Sweep across a pixel map field instead of strip order ("x", "y", "radius", "angle")
+    PixelMap::Field field = PixelMap::fieldFromName(params["field"] | "strip");
+    
     LOG_DEBUG("EffectFactory: Creating rainbow effect - speed: " + String(speed) + 
               ", reverse: " + String(reverseDirection) + 
               ", duration: " + String(duration));
     
-    return std::unique_ptr<RainbowEffect>(new RainbowEffect(generateEffectId(), speed, reverseDirection, duration));
+    return std::unique_ptr<RainbowEffect>(new RainbowEffect(generateEffectId(), speed, reverseDirection, duration, field));
 }
 
 std::unique_ptr<Effect> EffectFactory::createColorBlendEffect(const JsonObject& params) {
@@ -198,16 +215,18 @@ std::unique_ptr<Effect> EffectFactory::createColorBlendEffect(const JsonObject&
         duration = params["d"];
     }
     
+    PixelMap::Field field = PixelMap::fieldFromName(params["field"] | "strip");
+    
     LOG_DEBUG("EffectFactory: Creating color blend effect - color1: " + color1 + 
               ", color2: " + color2 + 
               ", speed: " + String(speed) + 
               ", duration: " + String(duration));
     
-    return std::unique_ptr<ColorBlendEffect>(new ColorBlendEffect(generateEffectId(), color1, color2, speed, duration));
+    return std::unique_ptr<ColorBlendEffect>(new ColorBlendEffect(generateEffectId(), color1, color2, speed, duration, field));
 }
 
 std::unique_ptr<Effect> EffectFactory::createTwinklingEffect(const JsonObject& params) {
-    int numLEDs = 32 * 32;
+    int numLEDs = g_ledGeometry.numLEDs;
     int startLED = 0;
     int endLED = numLEDs - 1;
 
@@ -290,10 +309,11 @@ std::unique_ptr<Effect> EffectFactory::createRainEffect(const JsonObject& params
     void setRingWidthRange(float minimum, float maximum) { ringWidthRange = RandomFloatInRange(minimum, maximum); }
     void setLifetimeRange(float minimum, float maximum) { lifetimeRange = RandomFloatInRange(minimum, maximum); }
     void setAmplitudeRange(float minimum, float maximum) { amplitudeRange = RandomFloatInRange(minimum, maximum); }*/
+    // Default spawn area is the grid plus a margin so rings can drift in from off-grid
     int spawnColumnRangeMinimum = -8;
-    int spawnColumnRangeMaximum = 38;
+    int spawnColumnRangeMaximum = g_ledGeometry.cols + 6;
     int spawnRowRangeMinimum = -8;
-    int spawnRowRangeMaximum = 38;
+    int spawnRowRangeMaximum = g_ledGeometry.rows + 6;
     int hiLightRangeMinimum = 80;
     int hiLightRangeMaximum = 160;
     int loLightRangeMinimum = 16;
@@ -401,8 +421,8 @@ std::unique_ptr<Effect> EffectFactory::createWavePlayerEffect(const JsonObject&
             "nTermsLt": 0,
             "speed": 0.03
             */
-    wavePlayerConfig.rows = 32;
-    wavePlayerConfig.cols = 32;
+    wavePlayerConfig.rows = g_ledGeometry.rows;
+    wavePlayerConfig.cols = g_ledGeometry.cols;
     wavePlayerConfig.onLight = Light(255, 255, 0);
     wavePlayerConfig.offLight = Light(0, 0, 255);
     wavePlayerConfig.AmpRt = 0.735f;
@@ -576,3 +596,24 @@ std::unique_ptr<Effect> EffectFactory::createPointPlayerEffect(const JsonObject&
 int EffectFactory::generateEffectId() {
     return nextEffectId++;
 }
+
+std::unique_ptr<Effect> EffectFactory::createBakedShowEffect(const JsonObject& params) {
+    String file = "";
+    if (params.containsKey("file")) {
+        file = params["file"].as<String>();
+    } else if (params.containsKey("f")) {
+        file = params["f"].as<String>();
+    }
+    if (file.length() == 0) {
+        LOG_ERROR("EffectFactory: baked effect needs a \"file\"");
+        return nullptr;
+    }
+    uint32_t startMs = params["start_ms"] | 0;
+    bool loop = params["loop"] | false;
+    bool applyBrightness = params["brightness"] | true;
+
+    LOG_DEBUG("EffectFactory: Creating baked show effect - file: " + file +
+              ", start: " + String(startMs) + " ms");
+
+    return std::unique_ptr<BakedShowEffect>(new BakedShowEffect(generateEffectId(), file, startMs, loop, applyBrightness));
+}
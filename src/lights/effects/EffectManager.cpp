@@ -1,5 +1,7 @@
 #include "EffectManager.h"
 #include "freertos/LogManager.h"
+#include "../LEDGeometry.h"
+#include <string.h>
 
 EffectManager::EffectManager() : nextEffectId(1) {
     LOG_DEBUG("EffectManager: Initializing");
@@ -10,13 +12,71 @@ EffectManager::~EffectManager() {
     removeAllEffects();
 }
 
+EffectManager::PreparedEffect::~PreparedEffect() {
+    reset();
+}
+
+void EffectManager::PreparedEffect::reset() {
+    effect.reset();
+    free(cachePrev);
+    free(cacheCurr);
+    cachePrev = cacheCurr = nullptr;
+    cacheSize = 0;
+}
+
 void EffectManager::addEffect(std::unique_ptr<Effect> effect, Light* output, int numLEDs) {
+    PreparedEffect prepared;
+    if (prepareEffect(std::move(effect), output, numLEDs, prepared)) {
+        addPreparedEffect(prepared);
+    }
+}
+
+bool EffectManager::prepareEffect(std::unique_ptr<Effect> effect, Light* output, int numLEDs, PreparedEffect& out,
+                                  bool privateOutput) {
+    out.reset();
     if (!effect) {
+        LOG_ERROR("EffectManager: Cannot add null effect");
+        return false;
+    }
+    
+    // Effects with a preferred update rate render into their own cache, which
+    // is composited into the output every frame
+    Light* effectOutput = output;
+    const bool decimate = effect->getPreferredUpdateHz() > 0.0f;
+    if (decimate || privateOutput) {
+        int size = std::max(numLEDs, g_ledGeometry.bufferSize);
+        // Without a preferred rate there is nothing to interpolate from
+        Light* prev = decimate ? AllocateLightBuffer(size) : nullptr;
+        Light* curr = AllocateLightBuffer(size);
+        if (curr && (prev || !decimate)) {
+            out.cachePrev = prev;
+            out.cacheCurr = curr;
+            out.cacheSize = size;
+            effectOutput = curr;
+        } else {
+            free(prev);
+            free(curr);
+            if (privateOutput) {
+                LOG_WARNF_COMPONENT("EffectManager", "No memory for effect %d private output", effect->getId());
+                return false;
+            }
+            LOG_WARNF_COMPONENT("EffectManager", "No memory for effect %d output cache - running at full rate", effect->getId());
+        }
+    }
+
+    // Initialize the effect with output buffer and numLEDs before adding
+    effect->initialize(effectOutput, numLEDs);
+    out.effect = std::move(effect);
+    return true;
+}
+
+void EffectManager::addPreparedEffect(PreparedEffect& prepared) {
+    if (!prepared.isValid()) {
         LOG_ERROR("EffectManager: Cannot add null effect");
         return;
     }
     
-    int effectId = effect->getId();
+    int effectId = prepared.effect->getId();
     LOG_DEBUG("EffectManager: Adding effect with ID " + String(effectId));
     
     // Check if effect with same ID already exists
@@ -25,10 +85,30 @@ void EffectManager::addEffect(std::unique_ptr<Effect> effect, Light* output, int
         removeEffect(effectId);
     }
     
-    // Initialize the effect with output buffer and numLEDs before adding
-    effect->initialize(output, numLEDs);
-    effect->start();
-    activeEffects.push_back(std::move(effect));
+    if (prepared.cacheCurr) {
+        DecimatedOutput d;
+        d.effectId = effectId;
+        d.size = prepared.cacheSize;
+        d.prev = prepared.cachePrev;
+        d.curr = prepared.cacheCurr;
+        const float hz = prepared.effect->getPreferredUpdateHz();
+        d.stepInterval = hz > 0.0f ? 1.0f / hz : 0.0f;
+        d.pendingDt = d.stepInterval;  // Step on the first frame
+        d.windowStartMs = millis();
+        d.stats.effectId = effectId;
+        d.stats.preferredHz = prepared.effect->getPreferredUpdateHz();
+        decimated.push_back(d);
+        // The cache now belongs to decimated
+        prepared.cachePrev = prepared.cacheCurr = nullptr;
+        prepared.cacheSize = 0;
+        if (d.stepInterval > 0.0f) {
+            LOG_DEBUGF_COMPONENT("EffectManager", "Effect %d runs at %.1f Hz (%s)", effectId,
+                d.stats.preferredHz, prepared.effect->getInterpolatesOutput() ? "interpolated" : "held");
+        }
+    }
+
+    prepared.effect->start();
+    activeEffects.push_back(std::move(prepared.effect));
     LOG_DEBUG("EffectManager: Effect added, total active effects: " + String(activeEffects.size()));
 }
 
@@ -43,6 +123,7 @@ void EffectManager::removeEffect(int effectId) {
     if (it != activeEffects.end()) {
         (*it)->stop();
         activeEffects.erase(it);
+        releaseDecimated(effectId);
         LOG_DEBUG("EffectManager: Effect removed, total active effects: " + String(activeEffects.size()));
     } else {
         LOG_WARN("EffectManager: Effect with ID " + String(effectId) + " not found");
@@ -56,6 +137,11 @@ void EffectManager::removeAllEffects() {
         effect->stop();
     }
     activeEffects.clear();
+    for (auto& d : decimated) {
+        free(d.prev);
+        free(d.curr);
+    }
+    decimated.clear();
     
     LOG_DEBUG("EffectManager: All effects removed");
 }
@@ -63,8 +149,30 @@ void EffectManager::removeAllEffects() {
 void EffectManager::update(float dt) {
     // Update all active effects
     for (auto& effect : activeEffects) {
-        if (effect->getIsActive()) {
+        if (!effect->getIsActive()) {
+            continue;
+        }
+        DecimatedOutput* d = findDecimated(effect->getId());
+        if (!d) {
             effect->update(dt);
+            continue;
+        }
+
+        // Decimated: only step once a full interval has accumulated, with the
+        // accumulated dt so the effect's timing is unchanged
+        d->pendingDt += dt;
+        d->stepped = d->pendingDt >= d->stepInterval;
+        if (d->stepped) {
+            d->stepStartMicros = micros();
+            // The effect writes into the buffer it was initialized with (curr),
+            // so keep the previous step by copy rather than swapping pointers
+            d->hasPrev = d->prev && d->stats.totalUpdates > 0;
+            if (d->prev) {
+                memcpy(d->prev, d->curr, sizeof(Light) * d->size);
+            }
+            memset(d->curr, 0, sizeof(Light) * d->size);
+            effect->update(d->pendingDt);
+            d->pendingDt = 0.0f;
         }
     }
     
@@ -77,12 +185,108 @@ void EffectManager::render(Light* output) {
     static int debugCounter = 0;
     if (debugCounter++ % 100 == 0) {
         LOG_DEBUGF_COMPONENT("EffectManager", "Rendering %d active effects", activeEffects.size());
+        for (const auto& d : decimated) {
+            LOG_DEBUGF_COMPONENT("EffectManager", "Effect %d: %.1f/%.1f Hz, saved %u us/s",
+                d.effectId, d.stats.actualUpdateHz, d.stats.preferredHz, d.stats.savedMicrosPerSec);
+        }
     }
     
     // Render all active effects (blending)
     for (auto& effect : activeEffects) {
-        if (effect->getIsActive()) {
+        if (!effect->getIsActive()) {
+            continue;
+        }
+        DecimatedOutput* d = findDecimated(effect->getId());
+        if (!d) {
             effect->render(output);
+            continue;
+        }
+
+        uint32_t frameStart = micros();
+        if (d->stepped) {
+            effect->render(d->curr);
+            uint32_t stepMicros = micros() - d->stepStartMicros;
+            d->avgStepMicros += 0.1f * ((float) stepMicros - d->avgStepMicros);
+            d->stats.totalUpdates++;
+            d->windowUpdates++;
+            frameStart = micros();
+        }
+        compositeDecimated(*d, output, effect->getInterpolatesOutput(), effect->getOutputBlend());
+        if (!d->stepped) {
+            uint32_t compositeMicros = micros() - frameStart;
+            d->stats.totalHeldFrames++;
+            if (d->avgStepMicros > compositeMicros) {
+                d->windowSavedMicros += (uint32_t) d->avgStepMicros - compositeMicros;
+            }
+        }
+        d->stepped = false;
+
+        uint32_t now = millis();
+        if (now - d->windowStartMs >= 1000) {
+            float seconds = (now - d->windowStartMs) * 0.001f;
+            d->stats.actualUpdateHz = d->windowUpdates / seconds;
+            d->stats.savedMicrosPerSec = (uint32_t) (d->windowSavedMicros / seconds);
+            d->windowUpdates = 0;
+            d->windowSavedMicros = 0;
+            d->windowStartMs = now;
+        }
+    }
+}
+
+static inline void blendPixel(Light& out, const Light& value, Effect::OutputBlend blend) {
+    switch (blend) {
+        case Effect::OutputBlend::Replace:
+            out = value;
+            break;
+        case Effect::OutputBlend::ReplaceLit:
+            if (value.r | value.g | value.b) out = value;
+            break;
+        case Effect::OutputBlend::Add:
+            out += value;
+            break;
+    }
+}
+
+void EffectManager::compositeDecimated(DecimatedOutput& d, Light* output, bool interpolate, Effect::OutputBlend blend) {
+    // Hold writes the last step as-is; interpolation also holds until there are two steps
+    if (!interpolate || !d.hasPrev) {
+        for (int i = 0; i < d.size; i++) {
+            blendPixel(output[i], d.curr[i], blend);
+        }
+        return;
+    }
+    float t = d.pendingDt / d.stepInterval;
+    uint8_t frac = t >= 1.0f ? 255 : (uint8_t) (t * 255.0f);
+    for (int i = 0; i < d.size; i++) {
+        blendPixel(output[i], d.prev[i].lerp8(d.curr[i], frac), blend);
+    }
+}
+
+std::vector<EffectManager::DecimationStats> EffectManager::getDecimationStats() const {
+    std::vector<DecimationStats> result;
+    result.reserve(decimated.size());
+    for (const auto& d : decimated) {
+        result.push_back(d.stats);
+    }
+    return result;
+}
+
+EffectManager::DecimatedOutput* EffectManager::findDecimated(int effectId) {
+    for (auto& d : decimated) {
+        if (d.effectId == effectId) {
+            return &d;
+        }
+    }
+    return nullptr;
+}
+
+void EffectManager::releaseDecimated(int effectId) {
+    for (auto it = decimated.begin(); it != decimated.end(); ++it) {
+        if (it->effectId == effectId) {
+            free(it->prev);
+            free(it->curr);
+            decimated.erase(it);
+            return;
         }
     }
 }
@@ -139,6 +343,12 @@ void EffectManager::stopEffect(int effectId) {
 }
 
 void EffectManager::cleanupFinishedEffects() {
+    for (auto& effect : activeEffects) {
+        if (effect->isFinished()) {
+            releaseDecimated(effect->getId());
+        }
+    }
+
     auto it = std::remove_if(activeEffects.begin(), activeEffects.end(),
         [](const std::unique_ptr<Effect>& effect) {
             return effect->isFinished();
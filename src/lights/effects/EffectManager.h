@@ -22,8 +22,34 @@ public:
     EffectManager();
     ~EffectManager();
     
+    /**
+     * An effect that has already been built, given its output cache and
+     * initialized (see prepareEffect), so adding it is just a move. Anything
+     * still held when it is reset or destroyed is freed.
+     */
+    struct PreparedEffect {
+        std::unique_ptr<Effect> effect;
+        Light* cachePrev = nullptr;
+        Light* cacheCurr = nullptr;
+        int cacheSize = 0;
+
+        PreparedEffect() = default;
+        PreparedEffect(const PreparedEffect&) = delete;
+        PreparedEffect& operator=(const PreparedEffect&) = delete;
+        ~PreparedEffect();
+        void reset();
+        bool isValid() const { return effect != nullptr; }
+    };
+
     // Effect management
     void addEffect(std::unique_ptr<Effect> effect, Light* output, int numLEDs);
+    // Split addEffect: do the allocation and initialize() now, start it later.
+    // With privateOutput the effect gets its own output buffer even without a
+    // preferred rate, so preparing it never writes into output (a live frame);
+    // it is then composited every frame. Fails if that buffer can't be allocated.
+    bool prepareEffect(std::unique_ptr<Effect> effect, Light* output, int numLEDs, PreparedEffect& out,
+                       bool privateOutput = false);
+    void addPreparedEffect(PreparedEffect& prepared);
     void removeEffect(int effectId);
     void removeAllEffects();
     
@@ -42,12 +68,55 @@ public:
     void pauseEffect(int effectId);
     void resumeEffect(int effectId);
     void stopEffect(int effectId);
+
+    /**
+     * Per-effect update-rate counters for effects with a preferred update rate.
+     * actualUpdateHz and savedMicrosPerSec are refreshed once per second.
+     */
+    struct DecimationStats {
+        int effectId = 0;
+        float preferredHz = 0.0f;
+        float actualUpdateHz = 0.0f;
+        uint32_t savedMicrosPerSec = 0;  // update+render time not spent, minus compositing
+        uint32_t totalUpdates = 0;
+        uint32_t totalHeldFrames = 0;
+    };
+    std::vector<DecimationStats> getDecimationStats() const;
     
 private:
+    /**
+     * Output cache for an effect that runs below the frame rate. The effect
+     * renders into curr on its own steps; prev keeps the step before so the
+     * frames in between can be interpolated (or just hold curr). An effect
+     * prepared with a private output has a stepInterval of 0 (steps every
+     * frame) and no prev.
+     */
+    struct DecimatedOutput {
+        int effectId = 0;
+        Light* prev = nullptr;
+        Light* curr = nullptr;
+        int size = 0;
+        float stepInterval = 0.0f;
+        float pendingDt = 0.0f;
+        bool stepped = false;
+        bool hasPrev = false;
+        uint32_t stepStartMicros = 0;
+        float avgStepMicros = 0.0f;
+        // Counters for the current 1 s window
+        uint32_t windowStartMs = 0;
+        uint32_t windowUpdates = 0;
+        uint32_t windowSavedMicros = 0;
+        DecimationStats stats;
+    };
+
     std::vector<std::unique_ptr<Effect>> activeEffects;
+    std::vector<DecimatedOutput> decimated;
     int nextEffectId;
     
     // Helper methods
     void cleanupFinishedEffects();
     int generateEffectId();
+    DecimatedOutput* findDecimated(int effectId);
+    void releaseDecimated(int effectId);
+    void compositeDecimated(DecimatedOutput& d, Light* output, bool interpolate, Effect::OutputBlend blend);
 };
@@ -1,7 +1,9 @@
 #include "PointPlayerEffect.h"
 
 PointPlayerEffect::PointPlayerEffect(int id, const PointPlayerEffectConfig& config)
-    : Effect(id), config_(config) {}
+    : Effect(id), config_(config) {
+    setOutputBlend(OutputBlend::ReplaceLit);  // Sparse points, if run decimated
+}
 
 void PointPlayerEffect::initialize(Light* output, int numLEDs) {
     outputBuffer_ = output;
@@ -1,9 +1,12 @@
 #include "PulsePlayerEffect.h"
 #include "freertos/LogManager.h"
+#include "../ShowClock.h"
 #include <ArduinoJson.h>
 #include <FastLED.h>
 
-PulsePlayerEffect::PulsePlayerEffect(int id) : Effect(id) {}
+PulsePlayerEffect::PulsePlayerEffect(int id) : Effect(id) {
+    setOutputBlend(OutputBlend::ReplaceLit);  // Sparse pulses, if run decimated
+}
 
 
 void PulsePlayerEffect::update(float dt) {
@@ -12,9 +15,10 @@ void PulsePlayerEffect::update(float dt) {
     for (auto &pulsePlayer : pulsePlayers) {
         pulsePlayer.update(dt);
     }
-    if (millis() >= nextPulsePlayerSpawnTime) {
+    if (ShowClock::nowMs() >= nextPulsePlayerSpawnTime) {
+        if (dirtyRanges) applyParamSlots();
         spawnPulsePlayer();
-        nextPulsePlayerSpawnTime = millis() + pulseTimeBetweenSpawnsRange.random() * 1000.0f;
+        nextPulsePlayerSpawnTime = ShowClock::nowMs() + pulseTimeBetweenSpawnsRange.random() * 1000.0f;
     }
 }
 
@@ -64,6 +68,65 @@ bool PulsePlayerEffect::updateParams(const JsonObject& params) {
     return true;
 }
 
+static const char* const PARAM_SLOT_NAMES[] = {
+    "pw_min", "pw_max", "ps_min", "ps_max", "tbs_min", "tbs_max", "hi_min", "hi_max"
+};
+
+int PulsePlayerEffect::findParam(const char* name) const {
+    for (int i = 0; i < NUM_PARAM_SLOTS; i++) {
+        if (strcmp(name, PARAM_SLOT_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+void PulsePlayerEffect::setParam(int slot, float value) {
+    if (slot < 0 || slot >= NUM_PARAM_SLOTS || paramSlots[slot] == value) return;
+    paramSlots[slot] = value;
+    dirtyRanges |= (uint8_t) (1 << (slot / 2));
+}
+
+void PulsePlayerEffect::applyParamSlots() {
+    const uint8_t dirty = dirtyRanges;
+    // The setters swap min/max and write back into paramSlots
+    if (dirty & 1) setPulseWidthRange((int) paramSlots[0], (int) paramSlots[1]);
+    if (dirty & 2) setPulseSpeedRange(paramSlots[2], paramSlots[3]);
+    if (dirty & 4) setPulseTimeBetweenSpawnsRange(paramSlots[4], paramSlots[5]);
+    if (dirty & 8) setPulseHiColorHueRange((int) paramSlots[6], (int) paramSlots[7]);
+    dirtyRanges = 0;
+}
+
+void PulsePlayerEffect::setPulseWidthRange(int minimum, int maximum) {
+    if (minimum > maximum) { int t = minimum; minimum = maximum; maximum = t; }
+    pulseWidthRange = RandomIntInRange(minimum, maximum);
+    paramSlots[0] = (float) minimum;
+    paramSlots[1] = (float) maximum;
+    dirtyRanges &= (uint8_t) ~1;
+}
+
+void PulsePlayerEffect::setPulseSpeedRange(float minimum, float maximum) {
+    if (minimum > maximum) { float t = minimum; minimum = maximum; maximum = t; }
+    pulseSpeedRange = RandomFloatInRange(minimum, maximum);
+    paramSlots[2] = minimum;
+    paramSlots[3] = maximum;
+    dirtyRanges &= (uint8_t) ~2;
+}
+
+void PulsePlayerEffect::setPulseTimeBetweenSpawnsRange(float minimum, float maximum) {
+    if (minimum > maximum) { float t = minimum; minimum = maximum; maximum = t; }
+    pulseTimeBetweenSpawnsRange = RandomFloatInRange(minimum, maximum);
+    paramSlots[4] = minimum;
+    paramSlots[5] = maximum;
+    dirtyRanges &= (uint8_t) ~4;
+}
+
+void PulsePlayerEffect::setPulseHiColorHueRange(int minimum, int maximum) {
+    if (minimum > maximum) { int t = minimum; minimum = maximum; maximum = t; }
+    pulseHiColorHueRange = RandomIntInRange(minimum, maximum);
+    paramSlots[6] = (float) minimum;
+    paramSlots[7] = (float) maximum;
+    dirtyRanges &= (uint8_t) ~8;
+}
+
 void PulsePlayerEffect::initializePulsePlayers() {
     // Init members
     // pulsePlayer.init(output[0], 16, 16, Light(255, 255, 255), Light(0, 0, 0), 8, 32.0f, 1.0f, true);
@@ -95,7 +158,7 @@ void PulsePlayerEffect::initializePulsePlayers() {
             false
         );
     }
-    nextPulsePlayerSpawnTime = millis() + pulseTimeBetweenSpawnsRange.random() * 1000.0f;
+    nextPulsePlayerSpawnTime = ShowClock::nowMs() + pulseTimeBetweenSpawnsRange.random() * 1000.0f;
     isInitialized = true;
 }
 
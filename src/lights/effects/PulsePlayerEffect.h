@@ -25,15 +25,25 @@ public:
     void render(Light *output) override;
     bool isFinished() const override;
     bool updateParams(const JsonObject& params) override;
+    // Slots are pw_min, pw_max, ps_min, ps_max, tbs_min, tbs_max, hi_min, hi_max
+    int findParam(const char* name) const override;
+    void setParam(int slot, float value) override;
     void spawnPulsePlayer();
 
-    void setPulseWidthRange(int minimum, int maximum) { pulseWidthRange = RandomIntInRange(minimum, maximum); }
-    void setPulseSpeedRange(float minimum, float maximum) { pulseSpeedRange = RandomFloatInRange(minimum, maximum); }
-    void setPulseTimeBetweenSpawnsRange(float minimum, float maximum) { pulseTimeBetweenSpawnsRange = RandomFloatInRange(minimum, maximum); }
-    void setPulseHiColorHueRange(int minimum, int maximum) { pulseHiColorHueRange = RandomIntInRange(minimum, maximum); }
+    void setPulseWidthRange(int minimum, int maximum);
+    void setPulseSpeedRange(float minimum, float maximum);
+    void setPulseTimeBetweenSpawnsRange(float minimum, float maximum);
+    void setPulseHiColorHueRange(int minimum, int maximum);
 
 private:
     static constexpr size_t MAX_PULSE_PLAYERS = 40;
+    static constexpr int NUM_PARAM_SLOTS = 8;
+
+    // Rebuilding a range reseeds a generator, so automated slots are only
+    // applied when the next pulse spawns
+    void applyParamSlots();
+    float paramSlots[NUM_PARAM_SLOTS] = {5.0f, 16.0f, 16.0f, 92.0f, 0.5f, 6.0f, 0.0f, 360.0f};
+    uint8_t dirtyRanges = 0;  // Bit per min/max pair
     Light *outputArr = nullptr;
     int _numLEDs = 0;
     std::array<PulsePlayer, MAX_PULSE_PLAYERS> pulsePlayers;
@@ -1,9 +1,12 @@
 #include "RainEffect.h"
 #include "freertos/LogManager.h"
+#include "../LEDGeometry.h"
+#include "../PixelMap.h"
 
 RainEffect::RainEffect(int id)
     : Effect(id)
 {
+    setOutputBlend(OutputBlend::ReplaceLit);  // Sparse rings, if run decimated
     isInitialized = false;
 }
 
@@ -13,8 +16,13 @@ void RainEffect::initialize(Light* output, int numLEDs)
     outputBuffer = output;
     
     LOG_DEBUGF_COMPONENT("RainEffect", "Initializing RingPlayers with output buffer and %d LEDs", numLEDs);
+    const bool useMap = g_pixelMap.isCustomLayout();
     for (auto &rp : ringPlayers) {
-        rp.initToGrid(output, 32, 32);
+        if (useMap) {
+            rp.initToMap(output, &g_pixelMap);
+        } else {
+            rp.initToGrid(output, g_ledGeometry.rows, g_ledGeometry.cols);
+        }
     }
     isInitialized = true;
     LOG_DEBUGF_COMPONENT("RainEffect", "RingPlayers initialized");
@@ -1,10 +1,13 @@
 #include "RainbowEffect.h"
 #include "freertos/LogManager.h"
+#include <FastLED.h>
 
-RainbowEffect::RainbowEffect(int id, float speed, bool reverseDirection, float duration)
+RainbowEffect::RainbowEffect(int id, float speed, bool reverseDirection, float duration, PixelMap::Field field)
     : Effect(id), rainbowPlayer(nullptr, 0, 0, 0, speed, reverseDirection),
-    speed(speed), reverseDirection(reverseDirection), duration(duration), elapsed(0.0f)
+    speed(speed), reverseDirection(reverseDirection), duration(duration), elapsed(0.0f), pendingDt(0.0f), field(field)
 {
+    // Hue drifts slowly; 30 Hz with interpolation is indistinguishable from full rate
+    setPreferredUpdateRate(30.0f, true);
 
     hasDuration = (duration > 0.0f);
     isInitialized = false;
@@ -17,6 +20,7 @@ void RainbowEffect::update(float dt)
     if (!isActive) return;
 
     elapsed += dt;
+    pendingDt += dt;
 
     // Debug logging every 100 updates
     static int debugCounter = 0;
@@ -39,6 +43,10 @@ void RainbowEffect::initialize(Light* output, int numLEDs)
     rainbowPlayer.setSpeed(speed);
     rainbowPlayer.setDirection(reverseDirection);
     rainbowPlayer.setEnabled(true);
+    if (field != PixelMap::Field::Strip) {
+        fieldTable = g_pixelMap.field(field);
+        fieldSize = fieldTable ? g_pixelMap.size() : 0;
+    }
     isInitialized = true;
     LOG_DEBUG_COMPONENT("Effects", "RainbowEffect: RainbowPlayer initialized");
 }
@@ -54,8 +62,33 @@ void RainbowEffect::render(Light *output)
         return;
     }
 
-    // Update the RainbowPlayer (this is where the actual rainbow logic happens)
-    rainbowPlayer.update(0.033f); // Use fixed 30fps for rainbow updates
+    if (fieldTable) {
+        renderField(pendingDt * RAINBOW_TIME_SCALE);
+        pendingDt = 0.0f;
+        return;
+    }
+
+    // Update the RainbowPlayer (this is where the actual rainbow logic happens).
+    // It was tuned for a fixed 0.033 s step per 16 ms LED frame; keep that speed
+    // but advance by real elapsed time so decimated updates stay in step.
+    rainbowPlayer.update(pendingDt * RAINBOW_TIME_SCALE);
+    pendingDt = 0.0f;
+}
+
+void RainbowEffect::renderField(float dt)
+{
+    // Same hue rate as RainbowPlayer; one full hue cycle across the field
+    fieldHue += speed * 255.0f * dt;
+    fieldHue = fmodf(fieldHue, 256.0f);
+    const int count = numLEDs < fieldSize ? numLEDs : fieldSize;
+    for (int i = 0; i < count; i++)
+    {
+        const float position = reverseDirection ? 1.0f - fieldTable[i] : fieldTable[i];
+        CRGB rgbColor = CHSV((uint8_t) (fieldHue + position * 255.0f), 255, 255);
+        outputBuffer[i].r = rgbColor.r;
+        outputBuffer[i].g = rgbColor.g;
+        outputBuffer[i].b = rgbColor.b;
+    }
 }
 
 bool RainbowEffect::isFinished() const
@@ -65,6 +98,16 @@ bool RainbowEffect::isFinished() const
     return elapsed >= duration;
 }
 
+int RainbowEffect::findParam(const char* name) const
+{
+    return strcmp(name, "speed") == 0 ? 0 : -1;
+}
+
+void RainbowEffect::setParam(int slot, float value)
+{
+    if (slot == 0) setSpeed(value);
+}
+
 void RainbowEffect::setSpeed(float newSpeed)
 {
     speed = newSpeed;
@@ -2,15 +2,19 @@
 
 #include "Effect.h"
 #include "../RainbowPlayer.h"
+#include "../PixelMap.h"
 
 /**
  * Rainbow effect that wraps the existing RainbowPlayer
  * 
- * Simple wrapper that uses RainbowPlayer internally
+ * Simple wrapper that uses RainbowPlayer internally. With a PixelMap field
+ * other than strip (x, y, radius, angle) the hue sweeps across that field of
+ * the layout instead, e.g. around a ring with "angle".
  */
 class RainbowEffect : public Effect {
 public:
-    RainbowEffect(int id, float speed = 1.0f, bool reverseDirection = false, float duration = -1.0f);
+    RainbowEffect(int id, float speed = 1.0f, bool reverseDirection = false, float duration = -1.0f,
+                  PixelMap::Field field = PixelMap::Field::Strip);
     ~RainbowEffect() = default;
     
     // Effect interface
@@ -18,6 +22,8 @@ public:
     void initialize(Light* output, int numLEDs) override;
     void render(Light* output) override;
     bool isFinished() const override;
+    int findParam(const char* name) const override;
+    void setParam(int slot, float value) override;
     
     // Rainbow-specific controls
     void setSpeed(float speed);
@@ -32,6 +38,15 @@ private:
     bool reverseDirection;
     float duration;
     float elapsed;
+    float pendingDt;  // Time since the last render, consumed by rainbowPlayer
     bool hasDuration;
+    PixelMap::Field field;
+    const float* fieldTable = nullptr;  // Set for fields other than Strip
+    int fieldSize = 0;
+    float fieldHue = 0.0f;
+
+    void renderField(float dt);
+
+    static constexpr float RAINBOW_TIME_SCALE = 0.033f / 0.016f;
     bool isInitialized;
 };
@@ -9,7 +9,11 @@ TwinklingEffect::TwinklingEffect(int id, int numLEDs, int startLED, int endLED)
     , _numLEDs(numLEDs)
     , _startLED(startLED)
     , _endLED(endLED)
-{}
+{
+    // Slow fades: simulate at 30 Hz and interpolate the frames in between
+    setPreferredUpdateRate(30.0f, true);
+    setOutputBlend(OutputBlend::ReplaceLit);  // Only the stars; the rest shows through
+}
 
 bool TwinklingEffect::isFinished() const
 {
@@ -134,6 +138,18 @@ void TwinklingEffect::init()
 }
 
 void TwinklingEffect::spawnWithChance(float dt)
+{
+    // _starChance is per LED frame; roll once per frame covered by dt so the
+    // spawn rate doesn't drop when the effect is updated at a decimated rate
+    int rolls = (int) (dt / SPAWN_FRAME_DT + 0.5f);
+    if (rolls < 1) rolls = 1;
+    for (int roll = 0; roll < rolls; roll++)
+    {
+        spawnOneWithChance();
+    }
+}
+
+void TwinklingEffect::spawnOneWithChance()
 {
     // Try to spawn new stars (only if we have room and chance allows)
     if (_activeStarCount < MAX_STARS && random(0, 1000) / 1000.0f < _starChance)
@@ -145,7 +161,7 @@ void TwinklingEffect::spawnWithChance(float dt)
             if (!_stars[i].isActive)
             {
                 // Pick a random LED in our range
-                int rangeSize = _numLEDs - _startLED + 1;
+                int rangeSize = _endLED - _startLED + 1;
                 int randomLED = _startLED + random(0, rangeSize);
 
                 // Create new star
@@ -16,6 +16,7 @@ public:
 
 private:
     static const int MAX_STARS = 40;  // Maximum number of active stars at once
+    static constexpr float SPAWN_FRAME_DT = 0.016f;  // LED frame that _starChance applies to
 
     // Fixed-size arrays for star data
     struct Star {
@@ -66,6 +67,7 @@ public:
 private:
     Light generateStarColor();  // Helper function to generate HSV-based star colors
     void spawnWithChance(float dt);     // Spawn stars based on random chance
+    void spawnOneWithChance();          // One spawn roll at _starChance
     void spawnWithTimer(float dt);      // Spawn stars based on timer intervals
     bool _useTimerSpawn = false;        // Whether to use timer-based spawning
 };
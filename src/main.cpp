@@ -27,6 +27,8 @@
 #include "DeviceState.h"
 #include "hal/ble/BLEManager.h"
 #include "PatternManager.h"
+#include "lights/PixelMap.h"
+#include "lights/ChoreographyManager.h"
 #include "UserPreferences.h"
 #include "controllers/BrightnessController.h"
 #include "controllers/SpeedController.h"
@@ -49,6 +51,7 @@
 #include "freertos/WiFiManager.h"
 #include "freertos/SystemMonitorTask.h"
 #include "freertos/TaskManager.h"
+#include "freertos/PreferencesWriterTask.h"
 #if PLATFORM_CROW_PANEL
 #include "freertos/LVGLDisplayTask.h"
 #include "lvgl/lvglui.h"
@@ -596,13 +599,85 @@ void SerialAwarePowerLimiting()
 #endif
 }
 
+#if SUPPORTS_LEDS
+/**
+ * Read numLEDs and the optional "grid": {"rows", "cols"} block from settings,
+ * allocate the frame buffers for that geometry and initialize FastLED.
+ */
+void SetupLEDGeometry()
+{
+	int numLEDs = NUM_LEDS;
+	int rows = 0;
+	int cols = 0;
+	if (settingsLoaded)
+	{
+		if (settings._doc.containsKey("numLEDs"))
+		{
+			numLEDs = settings._doc["numLEDs"].as<int>();
+		}
+		if (settings._doc.containsKey("grid"))
+		{
+			JsonObject gridObj = settings._doc["grid"];
+			rows = gridObj["rows"] | 0;
+			cols = gridObj["cols"] | 0;
+		}
+	}
+
+	LEDGeometry geometry = MakeLEDGeometry(numLEDs, rows, cols);
+	if (!AllocateLEDBuffers(geometry))
+	{
+		// Fall back to the compile-time default rather than running without buffers
+		LOG_ERRORF_COMPONENT("Startup", "Could not allocate %d LEDs, falling back to %d", numLEDs, NUM_LEDS);
+		geometry = MakeLEDGeometry(NUM_LEDS, DIMS_PANELS, DIMS_PANELS);
+		AllocateLEDBuffers(geometry);
+	}
+
+	LOG_DEBUGF_COMPONENT("Startup", "LED geometry: %d LEDs, %dx%d grid",
+		g_ledGeometry.numLEDs, g_ledGeometry.rows, g_ledGeometry.cols);
+	LEDUpdateTask::initializeLEDs(g_ledGeometry.numLEDs);
+
+	// Fixture layout for spatial effects; a dense grid unless the SD card has one
+	if (!g_pixelMap.loadFromFile(PixelMap::DEFAULT_PATH, g_ledGeometry.bufferSize))
+	{
+		g_pixelMap.buildGrid(g_ledGeometry.rows, g_ledGeometry.cols);
+	}
+}
+#endif
+
+#if SUPPORTS_LEDS
+/**
+ * Read the optional "choreography": {"ringVoices", "pulseVoices", "stealPolicy"}
+ * block that sizes the choreography voice pools. Must run before Pattern_Setup.
+ */
+void SetupChoreographyVoices()
+{
+	if (!settingsLoaded || !settings._doc.containsKey("choreography"))
+	{
+		return;
+	}
+	JsonObject choreoObj = settings._doc["choreography"];
+	g_choreoVoiceConfig.ringVoices = constrain(choreoObj["ringVoices"] | g_choreoVoiceConfig.ringVoices, 1, 64);
+	g_choreoVoiceConfig.pulseVoices = constrain(choreoObj["pulseVoices"] | g_choreoVoiceConfig.pulseVoices, 1, 64);
+	g_choreoVoiceConfig.stealPolicy = VoiceAllocator::policyFromName(
+		choreoObj["stealPolicy"] | (const char *) nullptr, g_choreoVoiceConfig.stealPolicy);
+	g_choreoCostModel.frameBudgetUs = choreoObj["frameBudgetUs"] | g_choreoCostModel.frameBudgetUs;
+	g_choreoCostModel.baseFrameUs = choreoObj["baseFrameUs"] | g_choreoCostModel.baseFrameUs;
+	LOG_DEBUGF_COMPONENT("Startup", "Choreography voices: %d rings, %d pulses, steal %s",
+		g_choreoVoiceConfig.ringVoices, g_choreoVoiceConfig.pulseVoices,
+		VoiceAllocator::policyName(g_choreoVoiceConfig.stealPolicy));
+}
+#endif
+
 void OnShutdown()
 {
 	isShuttingDown = true;
 #if SUPPORTS_LEDS
-	for (int i = 0; i < NUM_LEDS; i++)
+	if (leds)
 	{
-		leds[i] = CRGB::Black;
+		for (int i = 0; i < g_ledGeometry.numLEDs; i++)
+		{
+			leds[i] = CRGB::Black;
+		}
 	}
 	FastLED.setBrightness(0);
 	FastLED.clear();
@@ -648,10 +723,7 @@ void setup()
 	Serial.begin(115200);
 	wait_for_serial();
 
-#if SUPPORTS_LEDS
-	// Initialize LEDs early (black them out)
-	LEDUpdateTask::initializeLEDs();
-#else
+#if !SUPPORTS_LEDS
 	// LEDs not supported on this platform
 	LOG_INFO_COMPONENT("Startup", "LED support disabled for this platform");
 #endif
@@ -688,6 +760,11 @@ void setup()
 
 #if SUPPORTS_SD_CARD
 	LogManager::getInstance().initialize();
+	if (g_sdCardAvailable)
+	{
+		// Log lines reach the card from a low-priority task, in 4 KB blocks
+		TaskManager::getInstance().createLogWriterTask();
+	}
 
 	// Configure log filtering (optional - can be enabled/disabled)
 	// Uncomment the line below to show only WiFiManager logs:
@@ -751,6 +828,13 @@ void setup()
 
 #endif
 
+#if SUPPORTS_LEDS
+	// LED count and grid come from settings, so buffers and FastLED are set up
+	// only once settings are loaded (falls back to NUM_LEDS without settings)
+	SetupLEDGeometry();
+	SetupChoreographyVoices();
+#endif
+
 	auto &taskMgr = TaskManager::getInstance();
 
 
@@ -882,9 +966,20 @@ void setup()
 
 
 #if SUPPORTS_PREFERENCES
+	const unsigned long prefsLoadStart = micros();
 	prefsManager.begin();
-	prefsManager.load(deviceState);
+	const bool prefsFromBlob = prefsManager.load(deviceState);
 	prefsManager.end();
+	LOG_INFOF_COMPONENT("Startup", "Preferences loaded in %lu us (%s)",
+		micros() - prefsLoadStart, prefsFromBlob ? "state blob" : "legacy keys, migrated");
+	// From here SaveUserPreferences is write-behind: no flash I/O on the calling task
+	if (taskMgr.createPreferencesWriterTask())
+	{
+		if (auto *prefsWriter = taskMgr.getPreferencesWriterTask())
+		{
+			prefsWriter->setSavedState(deviceState);
+		}
+	}
 	ApplyFromUserPreferences(deviceState, skipBrightnessFromUserSettings);
 	encoderBrightness = deviceState.brightness;
 	// Load WiFi credentials and attempt connection
@@ -940,27 +1035,15 @@ void setup()
 	if (taskMgr.createLEDTask(16))
 	{  // 60 FPS
 #if SUPPORTS_LEDS
-		int numConfiguredLEDs = NUM_LEDS;
-		if (settingsLoaded && settings._doc.containsKey("numLEDs"))
+		int numConfiguredLEDs = g_ledGeometry.numLEDs;
+		LOG_DEBUGF_COMPONENT("Startup", "Setting numConfiguredLEDs to %d", numConfiguredLEDs);
+		if (auto *ledTask = taskMgr.getLEDTask())
 		{
-			numConfiguredLEDs = settings._doc["numLEDs"].as<int>();
-			LOG_DEBUGF_COMPONENT("Startup", "Setting numConfiguredLEDs to %d", numConfiguredLEDs);
-			if (auto *ledTask = taskMgr.getLEDTask())
-			{
-				ledTask->setNumConfiguredLEDs(numConfiguredLEDs);
-			}
-			if (g_ledManager)
-			{
-				g_ledManager->setNumConfiguredLEDs(numConfiguredLEDs);
-			}
+			ledTask->setNumConfiguredLEDs(numConfiguredLEDs);
 		}
-		else
+		if (g_ledManager)
 		{
-			LOG_DEBUGF_COMPONENT("Startup", "No numLEDs found in settings, using default of %d", numConfiguredLEDs);
-			if (g_ledManager)
-			{
-				g_ledManager->setNumConfiguredLEDs(numConfiguredLEDs);
-			}
+			g_ledManager->setNumConfiguredLEDs(numConfiguredLEDs);
 		}
 #endif
 	}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * LogBlockBuffer - Log lines gathered into one block for a single write
+ *
+ * Lines are formatted straight into the free space at the end of the block;
+ * a line that does not fit is not added, and the caller writes the block
+ * out and tries again on an empty one. Writing whole blocks turns many tiny
+ * FAT appends into one sector-friendly write.
+ */
+template<size_t Size>
+class LogBlockBuffer {
+public:
+    static constexpr size_t SIZE = Size;
+
+    /**
+     * Append one formatted line; 0 if it does not fit (nothing added).
+     * A line longer than a whole block is cut to fit an empty one.
+     */
+    size_t appendf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        const size_t room = Size - _used;
+        va_list args;
+        va_start(args, format);
+        const int written = vsnprintf(_data + _used, room, format, args);
+        va_end(args);
+        if (written < 0) {
+            return 0;
+        }
+        if ((size_t) written >= room) {
+            if (_used > 0) {
+                return 0;  // Write the block out and try again
+            }
+            _data[Size - 2] = '\n';  // Cut: keep lines whole in the file
+            _used = Size - 1;
+            return _used;
+        }
+        _used += written;
+        return (size_t) written;
+    }
+
+    const char* data() const { return _data; }
+    size_t size() const { return _used; }
+    bool empty() const { return _used == 0; }
+    void clear() { _used = 0; }
+
+private:
+    char _data[Size];  // vsnprintf needs room for its '\0'
+    size_t _used = 0;
+};
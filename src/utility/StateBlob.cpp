@@ -0,0 +1,147 @@
+#include "StateBlob.h"
+#include <string.h>
+
+uint32_t StateBlob::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    // Bitwise CRC-32 (IEEE, reflected): the blob is a few hundred bytes read
+    // once at boot, not worth a 1 KB table
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+const char* StateBlob::statusName(StateBlobStatus status) {
+    switch (status) {
+        case StateBlobStatus::Ok: return "ok";
+        case StateBlobStatus::Empty: return "empty";
+        case StateBlobStatus::BadMagic: return "bad magic";
+        case StateBlobStatus::Truncated: return "truncated";
+        case StateBlobStatus::BadCrc: return "bad crc";
+    }
+    return "?";
+}
+
+static void writeU16(uint8_t* out, uint16_t value) {
+    memcpy(out, &value, sizeof(value));
+}
+
+static void writeU32(uint8_t* out, uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+}
+
+static uint16_t readU16(const uint8_t* in) {
+    uint16_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static uint32_t readU32(const uint8_t* in) {
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+StateBlobWriter::StateBlobWriter(uint8_t* buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity), _length(StateBlob::HEADER_SIZE), _overflow(false) {}
+
+void StateBlobWriter::put(uint8_t tag, const void* data, size_t length) {
+    if (length > 0xFFFF) {
+        _overflow = true;
+        return;
+    }
+    const size_t end = _length + StateBlob::FIELD_HEADER_SIZE + length;
+    if (_buffer) {
+        if (end > _capacity) {
+            _overflow = true;
+            return;
+        }
+        _buffer[_length] = tag;
+        writeU16(_buffer + _length + 1, (uint16_t) length);
+        if (length > 0) {
+            memcpy(_buffer + _length + StateBlob::FIELD_HEADER_SIZE, data, length);
+        }
+    }
+    _length = end;
+}
+
+size_t StateBlobWriter::finish(uint16_t version) {
+    const size_t payloadLength = _length - StateBlob::HEADER_SIZE;
+    if (_overflow || payloadLength > 0xFFFF) {
+        return 0;
+    }
+    if (_buffer) {
+        if (_capacity < StateBlob::HEADER_SIZE) {
+            return 0;
+        }
+        writeU32(_buffer, StateBlob::MAGIC);
+        writeU16(_buffer + 4, version);
+        writeU16(_buffer + 6, (uint16_t) payloadLength);
+        writeU32(_buffer + 8, StateBlob::crc32(_buffer + StateBlob::HEADER_SIZE, payloadLength));
+    }
+    return _length;
+}
+
+StateBlobStatus StateBlobReader::open(const uint8_t* data, size_t length) {
+    _payload = nullptr;
+    _payloadLength = 0;
+    _offset = 0;
+    _version = 0;
+    if (!data || length == 0) {
+        return StateBlobStatus::Empty;
+    }
+    if (length < StateBlob::HEADER_SIZE) {
+        return StateBlobStatus::Truncated;
+    }
+    if (readU32(data) != StateBlob::MAGIC) {
+        return StateBlobStatus::BadMagic;
+    }
+    const size_t payloadLength = readU16(data + 6);
+    if (StateBlob::HEADER_SIZE + payloadLength > length) {
+        return StateBlobStatus::Truncated;
+    }
+    const uint8_t* payload = data + StateBlob::HEADER_SIZE;
+    if (StateBlob::crc32(payload, payloadLength) != readU32(data + 8)) {
+        return StateBlobStatus::BadCrc;
+    }
+    _payload = payload;
+    _payloadLength = payloadLength;
+    _version = readU16(data + 4);
+    return StateBlobStatus::Ok;
+}
+
+bool StateBlobReader::next(uint8_t& tag, const uint8_t*& data, uint16_t& length) {
+    if (!_payload || _offset + StateBlob::FIELD_HEADER_SIZE > _payloadLength) {
+        return false;
+    }
+    const uint16_t fieldLength = readU16(_payload + _offset + 1);
+    if (_offset + StateBlob::FIELD_HEADER_SIZE + fieldLength > _payloadLength) {
+        return false;
+    }
+    tag = _payload[_offset];
+    data = _payload + _offset + StateBlob::FIELD_HEADER_SIZE;
+    length = fieldLength;
+    _offset += StateBlob::FIELD_HEADER_SIZE + fieldLength;
+    return true;
+}
+
+bool StateBlobReader::readU8(const uint8_t* data, uint16_t length, uint8_t& out) {
+    if (length != sizeof(out)) return false;
+    out = data[0];
+    return true;
+}
+
+bool StateBlobReader::readI32(const uint8_t* data, uint16_t length, int32_t& out) {
+    if (length != sizeof(out)) return false;
+    memcpy(&out, data, sizeof(out));
+    return true;
+}
+
+bool StateBlobReader::readF32(const uint8_t* data, uint16_t length, float& out) {
+    if (length != sizeof(out)) return false;
+    memcpy(&out, data, sizeof(out));
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * StateBlob - Versioned, CRC-checked binary record for persisted state
+ *
+ * Layout (little-endian, as on the ESP32):
+ *   magic u32 | version u16 | payload length u16 | crc32 of payload u32 | payload
+ * The payload is a list of fields, each tag u8 | length u16 | bytes. Readers
+ * skip tags they do not know and keep defaults for tags that are missing, so
+ * adding a field needs no version bump; bump VERSION only when the meaning
+ * of an existing field changes, and migrate on load.
+ */
+
+enum class StateBlobStatus : uint8_t {
+    Ok,
+    Empty,      // No bytes
+    BadMagic,   // Not a state blob
+    Truncated,  // Shorter than its header says
+    BadCrc      // Payload corrupted
+};
+
+class StateBlob {
+public:
+    static const uint32_t MAGIC = 0x53524453;  // "SRDS"
+    static const uint16_t VERSION = 1;
+    static const size_t HEADER_SIZE = 12;
+    static const size_t FIELD_HEADER_SIZE = 3;
+
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+    static const char* statusName(StateBlobStatus status);
+};
+
+/**
+ * Builds a blob in a caller-owned buffer. With a null buffer it only counts,
+ * so size() after finish() is the buffer size needed.
+ */
+class StateBlobWriter {
+public:
+    StateBlobWriter(uint8_t* buffer, size_t capacity);
+
+    void put(uint8_t tag, const void* data, size_t length);
+    void putU8(uint8_t tag, uint8_t value) { put(tag, &value, sizeof(value)); }
+    void putI32(uint8_t tag, int32_t value) { put(tag, &value, sizeof(value)); }
+    void putF32(uint8_t tag, float value) { put(tag, &value, sizeof(value)); }
+    void putString(uint8_t tag, const char* value, size_t length) { put(tag, value, length); }
+
+    /**
+     * Writes the header. Returns the blob size, or 0 if it did not fit.
+     */
+    size_t finish(uint16_t version = StateBlob::VERSION);
+
+    size_t size() const { return _length; }
+    bool overflowed() const { return _overflow; }
+
+private:
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _length;
+    bool _overflow;
+};
+
+/**
+ * Checks a blob and walks its fields. Field data points into the blob.
+ */
+class StateBlobReader {
+public:
+    StateBlobStatus open(const uint8_t* data, size_t length);
+
+    uint16_t version() const { return _version; }
+
+    /**
+     * Next field; false at the end (or on a malformed field)
+     */
+    bool next(uint8_t& tag, const uint8_t*& data, uint16_t& length);
+
+    // Field decoders: false (out unchanged) if the length is wrong
+    static bool readU8(const uint8_t* data, uint16_t length, uint8_t& out);
+    static bool readI32(const uint8_t* data, uint16_t length, int32_t& out);
+    static bool readF32(const uint8_t* data, uint16_t length, float& out);
+
+private:
+    const uint8_t* _payload = nullptr;
+    size_t _payloadLength = 0;
+    size_t _offset = 0;
+    uint16_t _version = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * WriteBehind - When to flush state that changes in bursts
+ *
+ * markDirty() on every change; due() becomes true once nothing has changed
+ * for quietMs, or maxDelayMs after the first unsaved change so a state that
+ * never settles (effect cycling, a slider held down) is still saved. One
+ * flush then covers the whole burst.
+ *
+ * Times are millis(); unsigned differences keep it correct across rollover.
+ */
+class WriteBehind {
+public:
+    WriteBehind(uint32_t quietMs = 2000, uint32_t maxDelayMs = 10000)
+        : _quietMs(quietMs), _maxDelayMs(maxDelayMs) {}
+
+    void markDirty(uint32_t nowMs) {
+        if (!_dirty) {
+            _dirty = true;
+            _firstChangeMs = nowMs;
+        }
+        _lastChangeMs = nowMs;
+        _changes++;
+    }
+
+    bool due(uint32_t nowMs) const {
+        if (!_dirty) return false;
+        return nowMs - _lastChangeMs >= _quietMs || nowMs - _firstChangeMs >= _maxDelayMs;
+    }
+
+    // Call after taking the snapshot to write; changes after this start a new burst
+    void flushed() {
+        _dirty = false;
+        _flushes++;
+    }
+
+    bool dirty() const { return _dirty; }
+    uint32_t changes() const { return _changes; }
+    uint32_t flushes() const { return _flushes; }
+
+private:
+    uint32_t _quietMs;
+    uint32_t _maxDelayMs;
+    bool _dirty = false;
+    uint32_t _firstChangeMs = 0;
+    uint32_t _lastChangeMs = 0;
+    uint32_t _changes = 0;
+    uint32_t _flushes = 0;
+};
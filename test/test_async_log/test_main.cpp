@@ -0,0 +1,286 @@
+#include "unity.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../../src/freertos/LogQueue.h"
+#include "../../src/utility/LogBlockBuffer.h"
+
+/**
+ * Asynchronous log writer tests
+ *
+ * Checks the queue's drop and overflow counters and the block buffer, runs
+ * several producers against one writer thread into a real file, and
+ * compares what a log call costs the caller when it appends the file
+ * itself (open, write, close per message, as LogManager did) with pushing
+ * into the queue for a writer that writes 4 KB blocks.
+ *
+ * Run with: pio test -e native -f test_async_log
+ */
+
+// Same layout as LogMessage, without Arduino.h
+struct Record {
+    uint8_t level = 1;
+    uint32_t timestamp = 0;
+    char component[32] = {};
+    char message[128] = {};
+};
+
+typedef LogQueue<Record, 64> Queue;  // LogManager's AsyncLogQueue size
+
+static const char* LOG_PATH = "/tmp/test_async_log.log";
+
+static void makeRecord(Record& record, uint32_t n) {
+    record.timestamp = n;
+    strncpy(record.component, "LEDManager", sizeof(record.component) - 1);
+    snprintf(record.message, sizeof(record.message), "Frame %lu took %d us (%d over budget)", (unsigned long) n, 9000 + (int) (n % 700), (int) (n % 3));
+}
+
+static size_t appendRecord(LogBlockBuffer<4096>& block, const Record& r) {
+    return block.appendf("[%lu] [%s] %s: %s\n", (unsigned long) r.timestamp, r.component, "INFO", r.message);
+}
+
+// The writer task's loop: drain, fill blocks, write full ones, flush now and then
+struct Writer {
+    Queue& queue;
+    FILE* file;
+    LogBlockBuffer<4096> block;
+    uint32_t lines = 0;
+    uint32_t blocks = 0;
+    uint32_t dropNotes = 0;
+
+    void write() {
+        if (block.empty()) return;
+        fwrite(block.data(), 1, block.size(), file);
+        blocks++;
+        block.clear();
+    }
+    void append(const Record& r) {
+        if (appendRecord(block, r) == 0) {
+            write();
+            appendRecord(block, r);
+        }
+        lines++;
+    }
+    bool service() {
+        if (queue.takeDropped() > 0) dropNotes++;
+        Record r;
+        bool any = false;
+        while (queue.pop(r)) {
+            append(r);
+            any = true;
+        }
+        return any;
+    }
+};
+
+static size_t countLines(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    size_t lines = 0;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        if (c == '\n') lines++;
+    }
+    fclose(f);
+    return lines;
+}
+
+void setUp(void) {
+    remove(LOG_PATH);
+}
+void tearDown(void) {}
+
+void test_drop_and_overflow_counters(void) {
+    Queue queue;
+    Record r;
+    for (uint32_t i = 0; i < Queue::capacity(); i++) {
+        makeRecord(r, i);
+        TEST_ASSERT_TRUE(queue.push(r));
+    }
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FALSE(queue.push(r));
+    }
+    LogQueueStats stats = queue.getStats();
+    TEST_ASSERT_EQUAL_UINT32(64, stats.queued);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overflows);  // One run of drops
+    TEST_ASSERT_EQUAL_UINT32(3, queue.takeDropped());
+    TEST_ASSERT_EQUAL_UINT32(0, queue.takeDropped());
+
+    Record out;
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(0, out.timestamp);
+    TEST_ASSERT_TRUE(queue.push(r));
+    TEST_ASSERT_FALSE(queue.push(r));
+    stats = queue.getStats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.overflows);
+}
+
+void test_block_buffer(void) {
+    LogBlockBuffer<64> block;
+    TEST_ASSERT_TRUE(block.empty());
+    TEST_ASSERT_EQUAL_UINT32(14, block.appendf("[%d] hello\n", 12345));
+    TEST_ASSERT_EQUAL_UINT32(14, block.appendf("[%d] world\n", 67890));
+    TEST_ASSERT_EQUAL_UINT32(28, block.size());
+    // Does not fit: nothing added, the earlier lines are intact
+    TEST_ASSERT_EQUAL_UINT32(0, block.appendf("%s\n", "a line much too long to fit in what is left of the block"));
+    TEST_ASSERT_EQUAL_UINT32(28, block.size());
+    TEST_ASSERT_TRUE(memcmp(block.data(), "[12345] hello\n[67890] world\n", 28) == 0);
+    block.clear();
+    // Longer than a whole block: cut, still ends the line
+    char longLine[100];
+    memset(longLine, 'x', sizeof(longLine) - 1);
+    longLine[sizeof(longLine) - 1] = '\0';
+    TEST_ASSERT_EQUAL_UINT32(63, block.appendf("%s\n", longLine));
+    TEST_ASSERT_EQUAL_INT('\n', block.data()[62]);
+}
+
+void test_producers_to_file(void) {
+    const int PRODUCERS = 4;
+    const uint32_t PER_PRODUCER = 20000;
+    Queue queue;
+    FILE* file = fopen(LOG_PATH, "a");
+    TEST_ASSERT_NOT_NULL(file);
+    Writer writer{queue, file};
+
+    std::atomic<int> running{PRODUCERS};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&, p]() {
+            Record r;
+            for (uint32_t i = 0; i < PER_PRODUCER; i++) {
+                makeRecord(r, p * PER_PRODUCER + i);
+                queue.push(r);
+                if ((i & 63) == 0) std::this_thread::yield();
+            }
+            running--;
+        });
+    }
+    while (running.load() > 0 || !queue.empty()) {
+        if (!writer.service()) std::this_thread::yield();
+    }
+    for (auto& t : producers) t.join();
+    writer.service();
+    writer.write();
+    fclose(file);
+
+    const LogQueueStats stats = queue.getStats();
+    TEST_ASSERT_EQUAL_UINT32(PRODUCERS * PER_PRODUCER, stats.queued + stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(stats.queued, writer.lines);
+    TEST_ASSERT_EQUAL_UINT32(writer.lines, countLines(LOG_PATH));
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d producers: %lu written in %lu blocks, %lu dropped in %lu overflows",
+        PRODUCERS, (unsigned long) writer.lines, (unsigned long) writer.blocks,
+        (unsigned long) stats.dropped, (unsigned long) stats.overflows);
+    TEST_MESSAGE(msg);
+}
+
+struct Latency {
+    double callsPerSecond;
+    double meanUs;
+    double p99Us;
+    double maxUs;
+};
+
+static Latency summarize(std::vector<double>& samples, double totalSeconds) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : samples) sum += s;
+    Latency l;
+    l.callsPerSecond = samples.size() / totalSeconds;
+    l.meanUs = sum / samples.size();
+    l.p99Us = samples[samples.size() * 99 / 100];
+    l.maxUs = samples.back();
+    return l;
+}
+
+void test_benchmark_caller_latency(void) {
+    using clock = std::chrono::steady_clock;
+    const uint32_t SYNC_CALLS = 5000;
+    const uint32_t ASYNC_CALLS = 200000;
+
+    // Before: every call formats the line and appends the file itself
+    std::vector<double> samples;
+    samples.reserve(ASYNC_CALLS);
+    Record r;
+    auto begin = clock::now();
+    for (uint32_t i = 0; i < SYNC_CALLS; i++) {
+        auto start = clock::now();
+        makeRecord(r, i);
+        char line[200];
+        snprintf(line, sizeof(line), "[%lu] [%s] %s: %s\n", (unsigned long) r.timestamp, r.component, "INFO", r.message);
+        FILE* f = fopen(LOG_PATH, "a");
+        fputs(line, f);
+        fclose(f);
+        samples.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+    }
+    const Latency sync = summarize(samples, std::chrono::duration<double>(clock::now() - begin).count());
+
+    // After: the call formats into a record and pushes it; a writer thread does the file
+    remove(LOG_PATH);
+    Queue queue;
+    FILE* file = fopen(LOG_PATH, "a");
+    Writer writer{queue, file};
+    std::atomic<bool> done{false};
+    std::thread writerThread([&]() {
+        auto lastFlush = clock::now();
+        while (!done.load() || !queue.empty()) {
+            if (!writer.service()) {
+                std::this_thread::yield();
+            }
+            if (clock::now() - lastFlush > std::chrono::seconds(1)) {
+                writer.write();
+                fflush(file);
+                lastFlush = clock::now();
+            }
+        }
+    });
+    samples.clear();
+    begin = clock::now();
+    for (uint32_t i = 0; i < ASYNC_CALLS; i++) {
+        auto start = clock::now();
+        makeRecord(r, i);
+        queue.push(r);
+        samples.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+        if ((i & 31) == 0) std::this_thread::yield();  // Callers do other work between log calls
+    }
+    const double asyncSeconds = std::chrono::duration<double>(clock::now() - begin).count();
+    done = true;
+    writerThread.join();
+    writer.service();
+    writer.write();
+    fclose(file);
+    const Latency async = summarize(samples, asyncSeconds);
+    const LogQueueStats stats = queue.getStats();
+    TEST_ASSERT_EQUAL_UINT32(stats.queued, writer.lines);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "sync append: %.0f calls/s, mean %.2f us, p99 %.2f us, max %.1f us",
+        sync.callsPerSecond, sync.meanUs, sync.p99Us, sync.maxUs);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "async queue: %.0f calls/s, mean %.2f us, p99 %.2f us, max %.1f us (%lu blocks, %lu dropped)",
+        async.callsPerSecond, async.meanUs, async.p99Us, async.maxUs,
+        (unsigned long) writer.blocks, (unsigned long) stats.dropped);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(async.meanUs < sync.meanUs);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_drop_and_overflow_counters);
+    RUN_TEST(test_block_buffer);
+    RUN_TEST(test_producers_to_file);
+    RUN_TEST(test_benchmark_caller_latency);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,154 @@
+#include "unity.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../../src/lights/BakedFrames.cpp"
+
+/**
+ * Baked frame file tests
+ *
+ * Bakes a synthetic show (a moving ring-like band over a slowly changing
+ * background) into memory, then checks sequential playback and seeking
+ * reproduce every frame exactly.
+ *
+ * Run with: pio test -e native -f test_baked_frames
+ */
+
+static const int NUM_LEDS = 1024;
+static const uint16_t FPS = 30;
+static const uint32_t NUM_FRAMES = 20 * FPS;
+
+class MemoryFile : public BakedFrameSink, public BakedFrameSource {
+public:
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+
+    bool write(const uint8_t* bytes, size_t length) override {
+        if (pos + length > data.size()) data.resize(pos + length);
+        memcpy(data.data() + pos, bytes, length);
+        pos += length;
+        return true;
+    }
+    size_t read(uint8_t* bytes, size_t length) override {
+        size_t n = pos < data.size() ? data.size() - pos : 0;
+        if (n > length) n = length;
+        memcpy(bytes, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+    bool seek(uint32_t offset) override {
+        pos = offset;
+        return true;
+    }
+};
+
+static void renderFrame(uint32_t frame, uint8_t* rgb) {
+    // Background changes once a second, a 40-LED band moves every frame
+    uint8_t bg = (uint8_t) ((frame / FPS) * 10);
+    for (int i = 0; i < NUM_LEDS; i++) {
+        rgb[i * 3] = bg;
+        rgb[i * 3 + 1] = 0;
+        rgb[i * 3 + 2] = (uint8_t) (i < 16 ? i * 7 : 0);
+    }
+    int start = (int) (frame * 3) % NUM_LEDS;
+    for (int i = 0; i < 40; i++) {
+        int n = (start + i) % NUM_LEDS;
+        rgb[n * 3] = 255;
+        rgb[n * 3 + 1] = (uint8_t) (i * 6);
+        rgb[n * 3 + 2] = 20;
+    }
+}
+
+static MemoryFile g_file;
+
+static void bake(void) {
+    g_file = MemoryFile();
+    std::vector<uint8_t> rgb(NUM_LEDS * 3);
+    BakedFrameWriter writer;
+    TEST_ASSERT_TRUE(writer.begin(&g_file, NUM_LEDS, FPS));
+    for (uint32_t f = 0; f < NUM_FRAMES; f++) {
+        renderFrame(f, rgb.data());
+        TEST_ASSERT_TRUE(writer.addFrame(rgb.data(), (uint8_t) (f % 256)));
+    }
+    TEST_ASSERT_TRUE(writer.finish());
+    TEST_ASSERT_EQUAL_UINT32(NUM_FRAMES / FPS, writer.keyframeCount());
+}
+
+void setUp(void) { bake(); }
+void tearDown(void) {}
+
+void test_sequential_playback_matches(void) {
+    BakedFrameReader reader;
+    TEST_ASSERT_TRUE(reader.open(&g_file));
+    TEST_ASSERT_EQUAL_INT(NUM_LEDS, reader.getNumLEDs());
+    TEST_ASSERT_EQUAL_UINT32(NUM_FRAMES, reader.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(NUM_FRAMES * 1000 / FPS, reader.getDurationMs());
+
+    std::vector<uint8_t> expected(NUM_LEDS * 3), decoded(NUM_LEDS * 3);
+    for (uint32_t f = 0; f < NUM_FRAMES; f++) {
+        uint8_t brightness = 0;
+        TEST_ASSERT_TRUE(reader.readFrame(decoded.data(), &brightness));
+        renderFrame(f, expected.data());
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), decoded.data(), expected.size());
+        TEST_ASSERT_EQUAL_UINT8(f % 256, brightness);
+    }
+    TEST_ASSERT_FALSE(reader.readFrame(decoded.data()));
+
+    // Raw frames would be NUM_FRAMES * NUM_LEDS * 3 bytes
+    const size_t raw = (size_t) NUM_FRAMES * NUM_LEDS * 3;
+    TEST_ASSERT_TRUE(g_file.data.size() * 10 < raw);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%u frames: %u bytes baked vs %u raw",
+        (unsigned) NUM_FRAMES, (unsigned) g_file.data.size(), (unsigned) raw);
+    TEST_MESSAGE(msg);
+}
+
+void test_seek_by_timestamp(void) {
+    BakedFrameReader reader;
+    TEST_ASSERT_TRUE(reader.open(&g_file));
+    std::vector<uint8_t> expected(NUM_LEDS * 3), decoded(NUM_LEDS * 3);
+
+    // Forward, backward, onto a keyframe and between keyframes
+    const uint32_t times[] = {12345, 2000, 2033, 19999, 0, 7777, 7800};
+    for (uint32_t t : times) {
+        TEST_ASSERT_TRUE(reader.seekMs(t, decoded.data()));
+        uint32_t frame = (uint32_t) ((uint64_t) t * FPS / 1000);
+        TEST_ASSERT_EQUAL_UINT32(frame + 1, reader.getPosition());
+        renderFrame(frame, expected.data());
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), decoded.data(), expected.size());
+    }
+
+    // Playback continues normally after a seek
+    TEST_ASSERT_TRUE(reader.readFrame(decoded.data()));
+    renderFrame(reader.getPosition() - 1, expected.data());
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), decoded.data(), expected.size());
+
+    // Past the end clamps to the last frame
+    TEST_ASSERT_TRUE(reader.seekMs(60000, decoded.data()));
+    TEST_ASSERT_EQUAL_UINT32(NUM_FRAMES, reader.getPosition());
+}
+
+void test_unfinished_bake_is_rejected(void) {
+    MemoryFile partial;
+    std::vector<uint8_t> rgb(NUM_LEDS * 3);
+    BakedFrameWriter writer;
+    writer.begin(&partial, NUM_LEDS, FPS);
+    renderFrame(0, rgb.data());
+    writer.addFrame(rgb.data(), 255);
+    // No finish(): header has no index
+    BakedFrameReader reader;
+    TEST_ASSERT_FALSE(reader.open(&partial));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sequential_playback_matches);
+    RUN_TEST(test_seek_by_timestamp);
+    RUN_TEST(test_unfinished_bake_is_rejected);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,212 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <cmath>
+#include <cstdio>
+
+#include "../../src/lights/ChoreographyTimeline.cpp"
+
+/**
+ * Beat clock tests
+ *
+ * Drives ChoreographyScheduler with a simulated frame clock (jittery 14-20 ms
+ * frames, integer ms like millis()) and checks that every beat's fire time
+ * minus its reported phase lands exactly on startMs + n * 1000 / bps, so the
+ * error never accumulates over a long show.
+ *
+ * Run with: pio test -e native -f test_choreography_beat_clock
+ */
+
+static const uint32_t SHOW_MS = 10UL * 60UL * 1000UL;
+
+// Deterministic frame jitter
+static uint32_t g_rng = 12345;
+static uint32_t nextFrameMs() {
+    g_rng = g_rng * 1103515245u + 12345u;
+    return 14 + (g_rng >> 16) % 7;
+}
+
+static ChoreoBeat makeBeat(uint32_t startMs, uint32_t endMs, float bps) {
+    ChoreoBeat beat = {};
+    beat.startMs = startMs;
+    beat.endMs = endMs;
+    beat.bps = bps;
+    beat.action.type = ChoreoActionType::FirePulse;
+    return beat;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_ten_minute_show_has_no_cumulative_drift(void) {
+    CompiledChoreography show;
+    show.beats.push_back(makeBeat(0, 0, 1.1667f));
+    show.beats.push_back(makeBeat(1500, 0, 2.0f));
+    ChoreographyScheduler scheduler;
+    scheduler.start(show);
+
+    uint32_t fired[2] = {0, 0};
+    double worstErrorMs = 0.0;
+    float worstPhaseMs = 0.0f;
+    double lastErrorMs[2] = {0.0, 0.0};
+
+    uint32_t now = 0;
+    uint32_t frameMs = 16;
+    while (now <= SHOW_MS) {
+        scheduler.pollBeats(now, (float) frameMs, [&](const ChoreoBeat& beat, float phaseSec) {
+            int idx = &beat == &show.beats[0] ? 0 : 1;
+            fired[idx]++;
+            double expected = beat.startMs + fired[idx] * (1000.0 / beat.bps);
+            double landed = now - phaseSec * 1000.0;
+            double error = fabs(landed - expected);
+            if (error > worstErrorMs) worstErrorMs = error;
+            if (fabsf(phaseSec * 1000.0f) > worstPhaseMs) worstPhaseMs = fabsf(phaseSec * 1000.0f);
+            lastErrorMs[idx] = error;
+        });
+        frameMs = nextFrameMs();
+        now += frameMs;
+    }
+
+    // Every beat fired exactly once, on time
+    uint32_t expected0 = (uint32_t) ((SHOW_MS + 10) / (1000.0 / 1.1667f));
+    uint32_t expected1 = (uint32_t) ((SHOW_MS + 10 - 1500) / 500.0);
+    TEST_ASSERT_UINT32_WITHIN(1, expected0, fired[0]);
+    TEST_ASSERT_UINT32_WITHIN(1, expected1, fired[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.skippedBeats());
+
+    // Phase-corrected beat times match the analytic clock (float phase rounding only)
+    TEST_ASSERT_TRUE(worstErrorMs < 0.05);
+    TEST_ASSERT_TRUE(lastErrorMs[0] < 0.05);
+    TEST_ASSERT_TRUE(lastErrorMs[1] < 0.05);
+    // Fired on the frame nearest the beat: never more than one frame off
+    TEST_ASSERT_TRUE(worstPhaseMs <= 20.0f);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%lu + %lu beats over 10 min, worst phase %.2f ms, worst drift %.4f ms",
+        (unsigned long) fired[0], (unsigned long) fired[1], worstPhaseMs, worstErrorMs);
+    TEST_MESSAGE(msg);
+}
+
+void test_beats_stop_at_end_time(void) {
+    CompiledChoreography show;
+    show.beats.push_back(makeBeat(1000, 3000, 2.0f));  // Beats at 1500, 2000, 2500
+    ChoreographyScheduler scheduler;
+    scheduler.start(show);
+
+    int fired = 0;
+    for (uint32_t now = 0; now <= 6000; now += 16) {
+        scheduler.pollBeats(now, 16.0f, [&](const ChoreoBeat&, float) { fired++; });
+    }
+    TEST_ASSERT_EQUAL_INT(3, fired);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.pendingBeats());
+}
+
+void test_stall_skips_instead_of_bursting(void) {
+    CompiledChoreography show;
+    show.beats.push_back(makeBeat(0, 0, 4.0f));  // Every 250 ms
+    ChoreographyScheduler scheduler;
+    scheduler.start(show);
+
+    int fired = 0;
+    float lastPhase = 0.0f;
+    auto count = [&](const ChoreoBeat&, float phaseSec) { fired++; lastPhase = phaseSec; };
+    scheduler.pollBeats(0, 16.0f, count);
+    scheduler.pollBeats(1010, 16.0f, count);  // 1 s stall covers beats 1-4
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(3, scheduler.skippedBeats());
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.010f, lastPhase);
+
+    // Back on the grid afterwards
+    scheduler.pollBeats(1245, 16.0f, count);
+    TEST_ASSERT_EQUAL_INT(2, fired);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, -0.005f, lastPhase);
+}
+
+void test_events_fire_in_time_order_once(void) {
+    CompiledChoreography show;
+    ChoreoEvent a = {}, b = {};
+    a.timeMs = 100;
+    b.timeMs = 200;
+    show.events.push_back(a);
+    show.events.push_back(b);
+    ChoreographyScheduler scheduler;
+    scheduler.start(show);
+
+    uint32_t order[2] = {0, 0};
+    int fired = 0;
+    auto record = [&](const ChoreoEvent& e) { order[fired++] = e.timeMs; };
+    scheduler.pollEvents(50, record);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    scheduler.pollEvents(250, record);
+    scheduler.pollEvents(300, record);
+    TEST_ASSERT_EQUAL_INT(2, fired);
+    TEST_ASSERT_EQUAL_UINT32(100, order[0]);
+    TEST_ASSERT_EQUAL_UINT32(200, order[1]);
+    TEST_ASSERT_TRUE(scheduler.eventsDone());
+}
+
+void test_seek_restores_state_from_checkpoint(void) {
+    CompiledChoreography show;
+    show.durationMs = 60000;
+    // change_effect at 5 s and 25 s, set_brightness at 12 s, a pulse every second
+    for (uint32_t t = 0; t < 60000; t += 1000) {
+        ChoreoEvent e = {};
+        e.timeMs = t;
+        e.action.type = ChoreoActionType::FirePulse;
+        show.events.push_back(e);
+        if (t == 5000 || t == 25000) {
+            e.action.type = ChoreoActionType::ChangeEffect;
+            show.events.push_back(e);
+        } else if (t == 12000) {
+            e.action.type = ChoreoActionType::SetBrightness;
+            e.action.setBrightness.brightness = 42;
+            show.events.push_back(e);
+        }
+    }
+    show.beats.push_back(makeBeat(0, 0, 2.0f));
+    show.beats.push_back(makeBeat(0, 20000, 1.0f));
+    show.buildCheckpoints();
+    TEST_ASSERT_EQUAL_size_t(7, show.checkpoints.size());
+
+    ChoreoSeekState state = show.stateAt(33500);
+    TEST_ASSERT_EQUAL_UINT32(30000, state.checkpointMs);
+    TEST_ASSERT_TRUE(state.replayedEvents <= 4);  // Only the events between 30 s and 33.5 s
+    TEST_ASSERT_TRUE(show.events[state.effectEvent].action.type == ChoreoActionType::ChangeEffect);
+    TEST_ASSERT_EQUAL_UINT32(25000, show.events[state.effectEvent].timeMs);
+    TEST_ASSERT_EQUAL_INT16(42, state.brightness);
+    TEST_ASSERT_EQUAL_UINT32(34000, show.events[state.eventIndex].timeMs);
+
+    state = show.stateAt(4000);
+    TEST_ASSERT_EQUAL_INT32(-1, state.effectEvent);
+    TEST_ASSERT_EQUAL_INT16(-1, state.brightness);
+
+    // Beats resume on their grid; the ended pattern stays off
+    ChoreographyScheduler scheduler;
+    scheduler.start(show);
+    scheduler.seek(33600, show.stateAt(33600).eventIndex);
+    TEST_ASSERT_EQUAL_size_t(1, scheduler.pendingBeats());
+    float firstPhase = 1.0f;
+    uint32_t firedAt = 0;
+    for (uint32_t now = 33600; now < 34200 && firedAt == 0; now += 10) {
+        scheduler.pollBeats(now, 10.0f, [&](const ChoreoBeat&, float phaseSec) {
+            firedAt = now;
+            firstPhase = phaseSec;
+        });
+    }
+    TEST_ASSERT_EQUAL_UINT32(34000, firedAt);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, firstPhase);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.skippedBeats());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ten_minute_show_has_no_cumulative_drift);
+    RUN_TEST(test_beats_stop_at_end_time);
+    RUN_TEST(test_stall_skips_instead_of_bursting);
+    RUN_TEST(test_events_fire_in_time_order_once);
+    RUN_TEST(test_seek_restores_state_from_checkpoint);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
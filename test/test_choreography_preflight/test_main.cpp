@@ -0,0 +1,188 @@
+#include "unity.h"
+#include <cstdio>
+#include <cstring>
+
+#include "../../src/lights/ChoreographyTimeline.cpp"
+#include "../../src/lights/VoiceAllocator.cpp"
+#include "../../src/lights/ChoreographyAnalyzer.cpp"
+
+/**
+ * Pre-flight analyzer tests
+ *
+ * Builds small compiled shows by hand and checks the simulated voice counts,
+ * frame costs and overloaded ranges.
+ *
+ * Run with: pio test -e native -f test_choreography_preflight
+ */
+
+static ChoreoAction ringAction(float speed, float reach) {
+    ChoreoAction action;
+    memset(&action, 0, sizeof(action));
+    action.type = ChoreoActionType::FireRing;
+    action.ring.ringSpeed = speed;
+    action.ring.ringWidth = 4.0f;
+    action.ring.fadeRadius = reach;
+    action.ring.fadeWidth = 0.0f;
+    action.ring.onePulse = true;
+    return action;
+}
+
+static ChoreoAction pulseAction(int16_t width, float speed) {
+    ChoreoAction action;
+    memset(&action, 0, sizeof(action));
+    action.type = ChoreoActionType::FirePulse;
+    action.pulse.width = width;
+    action.pulse.speed = speed;
+    return action;
+}
+
+static ChoreoCostModel testModel() {
+    ChoreoCostModel model;
+    model.rows = 32;
+    model.cols = 32;
+    model.numLEDs = 1024;
+    model.ringVoices = 15;
+    model.pulseVoices = 15;
+    model.stealPolicy = VoiceStealPolicy::Oldest;
+    return model;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_idle_show_costs_base_frame(void) {
+    CompiledChoreography show;
+    show.durationMs = 1000;
+    ChoreoCostModel model = testModel();
+    ChoreoPreflightReport report;
+    ChoreographyAnalyzer::analyze(show, model, report);
+
+    TEST_ASSERT_EQUAL_UINT32(60, report.frames);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t) model.baseFrameUs, report.worstFrameUs);
+    TEST_ASSERT_FALSE(report.overloaded());
+    TEST_ASSERT_EQUAL_UINT16(0, report.peakRings);
+}
+
+void test_ring_burst_fills_pool_and_overloads(void) {
+    CompiledChoreography show;
+    show.durationMs = 4000;
+    // 20 full-grid rings at once, 1 s to cross the grid
+    for (int i = 0; i < 20; i++) {
+        show.events.push_back(ChoreoEvent{1000, ringAction(40.0f, 40.0f)});
+    }
+    ChoreoCostModel model = testModel();
+    model.frameBudgetUs = 8333;  // 120 fps
+    ChoreoPreflightReport report;
+    ChoreographyAnalyzer::analyze(show, model, report);
+
+    TEST_ASSERT_EQUAL_UINT16(15, report.peakRings);
+    TEST_ASSERT_TRUE(report.peakRingsMs >= 1000 && report.peakRingsMs < 1020);
+    TEST_ASSERT_EQUAL_UINT32(5, report.rings.stolen);
+    TEST_ASSERT_TRUE(report.overloaded());
+    TEST_ASSERT_EQUAL_UINT32(1, (uint32_t) report.overloads.size());
+    // Cost grows with the rings until their boxes cover the grid
+    TEST_ASSERT_TRUE(report.overloads[0].startMs > 1000 && report.overloads[0].startMs < 1500);
+    TEST_ASSERT_TRUE(report.overloads[0].endMs < 2100);  // Rings have left the grid
+    TEST_ASSERT_TRUE(report.worstFrameMs >= report.overloads[0].startMs);
+    TEST_ASSERT_TRUE(report.worstFrameMs <= report.overloads[0].endMs);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "burst: worst %u us at %u ms, %u frames over",
+        (unsigned) report.worstFrameUs, (unsigned) report.worstFrameMs, (unsigned) report.overBudgetFrames);
+    TEST_MESSAGE(msg);
+}
+
+void test_pulse_beat_peak_matches_lifetime(void) {
+    CompiledChoreography show;
+    show.durationMs = 10000;
+    // Two pulses a second, each takes ~1 s to cross 1024 LEDs
+    show.beats.push_back(ChoreoBeat{0, 8000, 2.0f, pulseAction(16, 1024.0f)});
+    ChoreoCostModel model = testModel();
+    ChoreoPreflightReport report;
+    ChoreographyAnalyzer::analyze(show, model, report);
+
+    TEST_ASSERT_TRUE(report.peakPulses >= 2 && report.peakPulses <= 3);
+    TEST_ASSERT_EQUAL_UINT32(0, report.pulses.stolen);
+    TEST_ASSERT_FALSE(report.overloaded());
+    TEST_ASSERT_TRUE(report.averageFrameUs > (uint32_t) model.baseFrameUs);
+}
+
+void test_open_ended_show_is_bounded(void) {
+    CompiledChoreography show;  // No duration, beat never ends
+    show.beats.push_back(ChoreoBeat{500, 0, 1.0f, pulseAction(4, 2048.0f)});
+    ChoreoCostModel model = testModel();
+    ChoreoPreflightReport report;
+    ChoreographyAnalyzer::analyze(show, model, report);
+    TEST_ASSERT_EQUAL_UINT32(500 + ChoreographyAnalyzer::OPEN_END_TAIL_MS, report.analyzedMs);
+}
+
+void test_overload_ranges_are_capped(void) {
+    CompiledChoreography show;
+    show.durationMs = 60000;
+    // A heavy change_effect every second: one short overload each
+    for (uint32_t t = 0; t < 40; t++) {
+        ChoreoAction action;
+        memset(&action, 0, sizeof(action));
+        action.type = ChoreoActionType::ChangeEffect;
+        show.events.push_back(ChoreoEvent{t * 1000 + 100, action});
+    }
+    ChoreoCostModel model = testModel();
+    model.changeEffectUs = 20000.0f;
+    ChoreoPreflightReport report;
+    ChoreographyAnalyzer::analyze(show, model, report);
+
+    TEST_ASSERT_EQUAL_UINT32(40, report.overBudgetFrames);
+    TEST_ASSERT_EQUAL_UINT32(ChoreoPreflightReport::MAX_OVERLOADS, (uint32_t) report.overloads.size());
+    TEST_ASSERT_EQUAL_UINT32(40 - ChoreoPreflightReport::MAX_OVERLOADS, report.droppedOverloads);
+    TEST_ASSERT_EQUAL_UINT32(report.overloads[0].startMs, report.overloads[0].endMs);
+}
+
+void test_sliced_analysis_matches_one_pass(void) {
+    CompiledChoreography show;
+    show.durationMs = 12000;
+    for (int i = 0; i < 20; i++) {
+        show.events.push_back(ChoreoEvent{1000 + (uint32_t) i * 300, ringAction(40.0f, 40.0f)});
+    }
+    show.beats.push_back(ChoreoBeat{0, 9000, 4.0f, pulseAction(32, 700.0f)});
+    ChoreoCostModel model = testModel();
+    model.frameBudgetUs = 8333;
+    ChoreoPreflightReport whole;
+    ChoreographyAnalyzer::analyze(show, model, whole);
+
+    // As the manager runs it: a few frames per LED frame
+    ChoreographyAnalysis analysis;
+    analysis.begin(show, model);
+    int slices = 1;
+    while (analysis.step(7)) {
+        slices++;
+    }
+    TEST_ASSERT_FALSE(analysis.isRunning());
+    TEST_ASSERT_FALSE(analysis.step(7));
+    const ChoreoPreflightReport& sliced = analysis.getReport();
+    TEST_ASSERT_EQUAL_INT((int) (whole.frames + 1 + 6) / 7, slices);  // The last call only finds the end
+    TEST_ASSERT_EQUAL_UINT32(whole.frames, sliced.frames);
+    TEST_ASSERT_EQUAL_UINT32(whole.worstFrameUs, sliced.worstFrameUs);
+    TEST_ASSERT_EQUAL_UINT32(whole.worstFrameMs, sliced.worstFrameMs);
+    TEST_ASSERT_EQUAL_UINT32(whole.averageFrameUs, sliced.averageFrameUs);
+    TEST_ASSERT_EQUAL_UINT32(whole.overBudgetFrames, sliced.overBudgetFrames);
+    TEST_ASSERT_EQUAL_UINT16(whole.peakRings, sliced.peakRings);
+    TEST_ASSERT_EQUAL_UINT16(whole.peakPulses, sliced.peakPulses);
+    TEST_ASSERT_EQUAL_UINT32(whole.rings.stolen, sliced.rings.stolen);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t) whole.overloads.size(), (uint32_t) sliced.overloads.size());
+    TEST_ASSERT_EQUAL_UINT32(whole.analyzedMs, sliced.analyzedMs);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_show_costs_base_frame);
+    RUN_TEST(test_ring_burst_fills_pool_and_overloads);
+    RUN_TEST(test_pulse_beat_peak_matches_lifetime);
+    RUN_TEST(test_open_ended_show_is_bounded);
+    RUN_TEST(test_overload_ranges_are_capped);
+    RUN_TEST(test_sliced_analysis_matches_one_pass);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
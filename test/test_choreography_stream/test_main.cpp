@@ -0,0 +1,206 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../src/lights/ChoreographyTimeline.cpp"
+#include "../../src/lights/ChoreographyStream.cpp"
+
+/**
+ * Streaming loader tests
+ *
+ * Feeds shows to ChoreographyStreamLoader in small, odd-sized reads and
+ * checks the result matches compiling the whole document at once.
+ *
+ * Run with: pio test -e native -f test_choreography_stream
+ */
+
+static const char* TIMELINES[] = {
+    "default_sd_card_data/data/music/test_timeline.json",
+    "default_sd_card_data/data/music/compact/test_timeline.json",
+    "default_sd_card_data/data/music/sweater/test_timeline.json",
+};
+
+// Hands out at most chunk bytes per read, like a slow SD card or upload
+class StringSource : public ChoreoByteSource {
+public:
+    StringSource(const std::string& data, size_t chunk) : data(data), chunk(chunk) {}
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        size_t n = std::min(std::min(length, chunk), data.size() - pos);
+        memcpy(buffer, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+
+private:
+    std::string data;
+    size_t chunk;
+    size_t pos = 0;
+};
+
+static bool readFile(const char* path, std::string& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+static void streamAll(const std::string& json, size_t chunk, CompiledChoreography& show,
+                      ChoreographyStreamLoader& loader, int batch, int* steps = nullptr) {
+    loader.begin(std::unique_ptr<ChoreoByteSource>(new StringSource(json, chunk)), show);
+    int n = 0;
+    while (loader.step(show, batch)) {
+        n++;
+    }
+    if (steps) *steps = n;
+}
+
+static void assertSameAction(const ChoreoAction& a, const ChoreoAction& b) {
+    TEST_ASSERT_EQUAL_UINT8((uint8_t) a.type, (uint8_t) b.type);
+    if (a.type == ChoreoActionType::FireRing) {
+        TEST_ASSERT_EQUAL_MEMORY(&a.ring.hi, &b.ring.hi, sizeof(ChoreoColor));
+        TEST_ASSERT_EQUAL_FLOAT(a.ring.ringSpeed, b.ring.ringSpeed);
+        TEST_ASSERT_EQUAL_FLOAT(a.ring.row, b.ring.row);
+    } else if (a.type == ChoreoActionType::FirePulse) {
+        TEST_ASSERT_EQUAL_MEMORY(&a.pulse.hi, &b.pulse.hi, sizeof(ChoreoColor));
+        TEST_ASSERT_EQUAL_INT16(a.pulse.width, b.pulse.width);
+        TEST_ASSERT_EQUAL_FLOAT(a.pulse.speed, b.pulse.speed);
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_stream_matches_whole_document(void) {
+    for (const char* path : TIMELINES) {
+        std::string json;
+        if (!readFile(path, json)) {
+            TEST_IGNORE_MESSAGE("Bundled timelines not found - run from the project root");
+        }
+        DynamicJsonDocument doc(json.size() * 3);
+        TEST_ASSERT_FALSE(deserializeJson(doc, json));
+        CompiledChoreography whole;
+        ChoreographyCompiler::compile(doc.as<JsonObjectConst>(), whole);
+
+        CompiledChoreography streamed;
+        ChoreographyStreamLoader loader;
+        streamAll(json, 7, streamed, loader, 3);
+        TEST_ASSERT_FALSE_MESSAGE(loader.hasError(), loader.errorMessage());
+        ChoreographyCompiler::sortEvents(streamed, 0);
+
+        TEST_ASSERT_EQUAL_UINT32(whole.durationMs, streamed.durationMs);
+        TEST_ASSERT_EQUAL(whole.backgroundPayload >= 0, streamed.backgroundPayload >= 0);
+        TEST_ASSERT_EQUAL_size_t(whole.beats.size(), streamed.beats.size());
+        TEST_ASSERT_EQUAL_size_t(whole.events.size(), streamed.events.size());
+        for (size_t i = 0; i < whole.beats.size(); i++) {
+            TEST_ASSERT_EQUAL_UINT32(whole.beats[i].startMs, streamed.beats[i].startMs);
+            TEST_ASSERT_EQUAL_UINT32(whole.beats[i].endMs, streamed.beats[i].endMs);
+            assertSameAction(whole.beats[i].action, streamed.beats[i].action);
+        }
+        for (size_t i = 0; i < whole.events.size(); i++) {
+            TEST_ASSERT_EQUAL_UINT32(whole.events[i].timeMs, streamed.events[i].timeMs);
+            TEST_ASSERT_EQUAL_UINT8((uint8_t) whole.events[i].action.type, (uint8_t) streamed.events[i].action.type);
+        }
+    }
+}
+
+void test_large_show_streams_in_batches(void) {
+    // ~10 minutes of events, far beyond the 32 KB command document
+    const int NUM_EVENTS = 6000;
+    std::string json = "{\"t\":\"choreography\",\"note\":{\"skip\":[1,2,{\"a\":\"}]\"}]},\"events\":[";
+    char item[160];
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        snprintf(item, sizeof(item),
+            "%s{\"time\":%d,\"action\":\"fire_pulse\",\"label\":\"ignored\",\"params\":{\"hi_color\":\"rgb(%d,0,0)\"}}",
+            i ? "," : "", i * 100, i % 256);
+        json += item;
+    }
+    json += "],\"duration\":600000}";
+    TEST_ASSERT_TRUE(json.size() > 32768 * 10);
+
+    CompiledChoreography show;
+    ChoreographyStreamLoader loader;
+    loader.begin(std::unique_ptr<ChoreoByteSource>(new StringSource(json, 512)), show);
+
+    // Playback can start after the first batch
+    TEST_ASSERT_TRUE(loader.step(show, 64));
+    TEST_ASSERT_EQUAL_size_t(64, show.events.size());
+    TEST_ASSERT_TRUE(loader.bytesRead() < 32768);
+
+    int steps = 1;
+    while (loader.step(show, 8)) {
+        steps++;
+    }
+    TEST_ASSERT_FALSE_MESSAGE(loader.hasError(), loader.errorMessage());
+    TEST_ASSERT_EQUAL_size_t(NUM_EVENTS, show.events.size());
+    TEST_ASSERT_EQUAL_UINT32(600000, show.durationMs);
+    TEST_ASSERT_EQUAL_UINT32((NUM_EVENTS - 1) * 100, show.events.back().timeMs);
+    TEST_ASSERT_EQUAL_UINT8(255, show.events[255].action.pulse.hi.r);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%u bytes streamed in %d steps", (unsigned) json.size(), steps);
+    TEST_MESSAGE(msg);
+}
+
+void test_batches_merge_into_sorted_tail(void) {
+    // Out of order across batches, with ties that must keep file order
+    const uint32_t times[] = { 500, 100, 300, 300, 50, 900, 300, 200, 100, 700, 0, 400 };
+    const size_t NUM_EVENTS = sizeof(times) / sizeof(times[0]);
+    const size_t BATCH = 3;
+    std::vector<ChoreoEvent> file(NUM_EVENTS);
+    for (size_t i = 0; i < NUM_EVENTS; i++) {
+        file[i].timeMs = times[i];
+        file[i].action.type = ChoreoActionType::FirePulse;
+        file[i].action.pulse.width = (int16_t) i;  // File order
+    }
+
+    // As ChoreographyManager streams: each batch is merged into the unfired
+    // tail; the first two events fire after the first batch
+    CompiledChoreography show;
+    size_t fired = 0;
+    for (size_t added = 0; added < NUM_EVENTS; added += BATCH) {
+        show.events.insert(show.events.end(), file.begin() + added, file.begin() + added + BATCH);
+        ChoreographyCompiler::mergeEvents(show, fired, added);
+        fired = 2;
+    }
+
+    // The two that fired stay first; the rest is one stable sort
+    CompiledChoreography sorted;
+    sorted.events.assign(file.begin(), file.begin() + BATCH);
+    ChoreographyCompiler::sortEvents(sorted, 0);
+    sorted.events.insert(sorted.events.end(), file.begin() + BATCH, file.end());
+    ChoreographyCompiler::sortEvents(sorted, 2);
+    TEST_ASSERT_EQUAL_size_t(NUM_EVENTS, show.events.size());
+    for (size_t i = 0; i < NUM_EVENTS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(sorted.events[i].timeMs, show.events[i].timeMs);
+        TEST_ASSERT_EQUAL_INT16(sorted.events[i].action.pulse.width, show.events[i].action.pulse.width);
+    }
+}
+
+void test_truncated_show_reports_error(void) {
+    std::string json = "{\"events\":[{\"time\":100,\"action\":\"fire_pulse\",\"params\":{}},{\"time\":";
+    CompiledChoreography show;
+    ChoreographyStreamLoader loader;
+    streamAll(json, 16, show, loader, 4);
+    TEST_ASSERT_TRUE(loader.hasError());
+    TEST_ASSERT_EQUAL_size_t(1, show.events.size());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_matches_whole_document);
+    RUN_TEST(test_large_show_streams_in_batches);
+    RUN_TEST(test_batches_merge_into_sorted_tail);
+    RUN_TEST(test_truncated_show_reports_error);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
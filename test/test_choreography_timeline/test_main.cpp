@@ -0,0 +1,272 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "../../src/lights/ChoreographyTimeline.cpp"
+
+/**
+ * Compiled choreography benchmark
+ *
+ * Compiles the bundled test_timeline.json shows and reads every compiled beat
+ * record, counting heap allocations while doing so. For comparison it also
+ * runs the old path (DynamicJsonDocument(2048) + deserializeJson of the
+ * params string per beat).
+ *
+ * This covers the compile-time data only: the records are read by a local
+ * stand-in, not ChoreographyManager::executeAction, which needs the effect
+ * and voice players. The zero-allocation result says firing needs no JSON,
+ * not that the LED side of a beat allocates nothing.
+ *
+ * Run with: pio test -e native -f test_choreography_timeline
+ */
+
+static const char* TIMELINES[] = {
+    "default_sd_card_data/data/music/test_timeline.json",
+    "default_sd_card_data/data/music/compact/test_timeline.json",
+    "default_sd_card_data/data/music/sweater/test_timeline.json",
+};
+
+static const int FIRE_ITERATIONS = 20000;
+
+// Heap allocation counters: operator new directly, JSON documents via their allocator
+static size_t g_newCount = 0;
+static size_t g_jsonAllocCount = 0;
+
+void* operator new(size_t size) {
+    g_newCount++;
+    void* p = std::malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct CountingAllocator {
+    void* allocate(size_t n) { g_jsonAllocCount++; return std::malloc(n); }
+    void deallocate(void* p) { std::free(p); }
+    void* reallocate(void* p, size_t n) { g_jsonAllocCount++; return std::realloc(p, n); }
+};
+typedef BasicJsonDocument<CountingAllocator> CountingJsonDocument;
+
+// Stand-in for executeAction's reads of the record (the LED side is not run):
+// consume every field so the compiler can't drop the work
+static uint32_t g_sink = 0;
+
+static void fireCompiled(const ChoreoAction& action) {
+    switch (action.type) {
+        case ChoreoActionType::BrightnessPulse:
+            g_sink += action.brightnessPulse.base + action.brightnessPulse.peak + action.brightnessPulse.durationMs;
+            break;
+        case ChoreoActionType::FireRing:
+            g_sink += action.ring.hi.r + action.ring.lo.g + (uint32_t) (action.ring.ringSpeed + action.ring.fadeRadius);
+            break;
+        case ChoreoActionType::FirePulse:
+            g_sink += action.pulse.hi.b + action.pulse.width + (uint32_t) action.pulse.speed;
+            break;
+        default:
+            g_sink++;
+            break;
+    }
+}
+
+static void fireLegacy(const std::string& paramsJson) {
+    CountingJsonDocument doc(2048);
+    if (deserializeJson(doc, paramsJson)) {
+        return;
+    }
+    JsonObjectConst params = doc.as<JsonObjectConst>();
+    ChoreoColor hi;
+    ChoreographyCompiler::parseColor(params["hi_color"] | "", hi);
+    g_sink += hi.r + (params["pulse_width"] | 16) + (uint32_t) (params["ring_speed"] | 100.0f);
+}
+
+static bool readFile(const char* path, std::string& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_parse_time(void) {
+    StaticJsonDocument<256> doc;
+    deserializeJson(doc, "[\"0:10.520\", \"1:06.000\", \"45.5\", \"12\", 750, \"1:03.00\"]");
+    TEST_ASSERT_EQUAL_UINT32(10520, ChoreographyCompiler::parseTime(doc[0]));
+    TEST_ASSERT_EQUAL_UINT32(66000, ChoreographyCompiler::parseTime(doc[1]));
+    TEST_ASSERT_EQUAL_UINT32(45500, ChoreographyCompiler::parseTime(doc[2]));
+    TEST_ASSERT_EQUAL_UINT32(12000, ChoreographyCompiler::parseTime(doc[3]));
+    TEST_ASSERT_EQUAL_UINT32(750, ChoreographyCompiler::parseTime(doc[4]));
+    TEST_ASSERT_EQUAL_UINT32(63000, ChoreographyCompiler::parseTime(doc[5]));
+}
+
+void test_parse_color(void) {
+    ChoreoColor c;
+    TEST_ASSERT_TRUE(ChoreographyCompiler::parseColor("rgb(255, 0,12)", c));
+    TEST_ASSERT_EQUAL_UINT8(255, c.r);
+    TEST_ASSERT_EQUAL_UINT8(0, c.g);
+    TEST_ASSERT_EQUAL_UINT8(12, c.b);
+    TEST_ASSERT_FALSE(ChoreographyCompiler::parseColor("#ff0000", c));
+    TEST_ASSERT_EQUAL_UINT8(255, c.g);  // Falls back to white
+}
+
+void test_zero_speed_pulse_is_dropped(void) {
+    StaticJsonDocument<512> doc;
+    deserializeJson(doc,
+        "{\"events\": ["
+        "{\"time\": 100, \"action\": \"fire_pulse\", \"params\": {\"speed\": 0}},"
+        "{\"time\": 200, \"action\": \"fire_pulse\", \"params\": {\"speed\": 20, \"reverse\": true}}]}");
+    CompiledChoreography show;
+    ChoreoCompileStats stats;
+    TEST_ASSERT_TRUE(ChoreographyCompiler::compile(doc.as<JsonObjectConst>(), show, &stats));
+    TEST_ASSERT_EQUAL_INT(1, stats.badPulseSpeeds);
+    TEST_ASSERT_EQUAL_INT(0, stats.unknownActions);
+    TEST_ASSERT_EQUAL_size_t(1, show.events.size());
+    TEST_ASSERT_EQUAL_FLOAT(-20.0f, show.events[0].action.pulse.speed);
+}
+
+void test_automation_lanes(void) {
+    StaticJsonDocument<1024> doc;
+    deserializeJson(doc,
+        "{\"automation\": ["
+        "{\"param\": \"speed\", \"interp\": \"linear\", \"keys\": ["
+        "{\"time\": \"0:02\", \"value\": 3.0, \"interp\": \"step\"},"
+        "{\"time\": 0, \"value\": 1.0}, {\"time\": 1000, \"value\": 2.0}]},"
+        "{\"param\": \"hi_max\", \"keys\": [[500, 90]]},"
+        "{\"keys\": [[0, 1]]}]}");
+    CompiledChoreography show;
+    ChoreoCompileStats stats;
+    TEST_ASSERT_TRUE(ChoreographyCompiler::compile(doc.as<JsonObjectConst>(), show, &stats));
+    TEST_ASSERT_EQUAL_INT(2, stats.automationLanes);
+    TEST_ASSERT_EQUAL_INT(4, stats.automationKeys);
+    TEST_ASSERT_EQUAL_INT(1, stats.badAutomation);
+    TEST_ASSERT_EQUAL_STRING("speed", show.lanes[0].param);
+    // Keys are sorted: 0 -> 1000 linear, 1000 -> 2000 linear; a lone key holds
+    TEST_ASSERT_EQUAL_UINT32(2, show.lanes[0].segmentCount);
+    TEST_ASSERT_EQUAL_UINT32(1, show.lanes[1].segmentCount);
+
+    ChoreoAutomationSegment smooth{0, 100, 0.0f, 1.0f, ChoreoInterp::Smooth};
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, smooth.valueAt(50));
+    TEST_ASSERT_TRUE(smooth.valueAt(25) < 0.25f);
+    ChoreoAutomationSegment expo{0, 100, 1.0f, 100.0f, ChoreoInterp::Exponential};
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 10.0f, expo.valueAt(50));
+    ChoreoAutomationSegment step{0, 100, 4.0f, 8.0f, ChoreoInterp::Step};
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 4.0f, step.valueAt(99));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 8.0f, step.valueAt(100));
+
+    ChoreoAutomationPlayer player;
+    player.start(show);
+    float values[2] = {-1.0f, -1.0f};
+    int reports = 0;
+    auto record = [&](size_t lane, float value) { values[lane] = value; reports++; };
+
+    player.evaluate(250, record);
+    TEST_ASSERT_EQUAL_INT(1, reports);  // hi_max has no value before its key
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.25f, values[0]);
+    player.evaluate(1500, record);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 2.5f, values[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 90.0f, values[1]);
+    reports = 0;
+    player.evaluate(5000, record);
+    player.evaluate(6000, record);
+    TEST_ASSERT_EQUAL_INT(1, reports);  // Held at 3.0, unchanged values are not reported
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 3.0f, values[0]);
+
+    // Seeking back repositions the cursor and reports again
+    player.seek(500);
+    reports = 0;
+    player.evaluate(500, record);
+    TEST_ASSERT_EQUAL_INT(2, reports);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.5f, values[0]);
+}
+
+void test_bundled_timelines_fire_without_allocating(void) {
+    for (const char* path : TIMELINES) {
+        std::string json;
+        if (!readFile(path, json)) {
+            TEST_IGNORE_MESSAGE("Bundled timelines not found - run from the project root");
+        }
+
+        DynamicJsonDocument doc(json.size() * 3);
+        TEST_ASSERT_FALSE(deserializeJson(doc, json));
+
+        CompiledChoreography show;
+        ChoreoCompileStats stats;
+        TEST_ASSERT_TRUE(ChoreographyCompiler::compile(doc.as<JsonObjectConst>(), show, &stats));
+        TEST_ASSERT_TRUE(show.beats.size() > 0);
+        TEST_ASSERT_EQUAL_INT(0, stats.missingParamDefs);
+        TEST_ASSERT_EQUAL_INT(0, stats.badColors);
+
+        // Old path input: each beat's params re-serialized as the String it used to store
+        std::vector<std::string> legacyParams;
+        JsonObjectConst defs = doc["param_defs"].as<JsonObjectConst>();
+        for (JsonObjectConst beat : doc["beats"].as<JsonArrayConst>()) {
+            if (beat.size() == 0) continue;
+            JsonVariantConst params = beat["params"];
+            if (params.is<const char*>()) params = defs[params.as<const char*>()];
+            std::string s;
+            serializeJson(params, s);
+            legacyParams.push_back(s);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        size_t newBefore = g_newCount;
+        size_t fired = 0;
+        for (int i = 0; i < FIRE_ITERATIONS; i++) {
+            for (const ChoreoBeat& beat : show.beats) {
+                fireCompiled(beat.action);
+                fired++;
+            }
+        }
+        size_t compiledAllocs = g_newCount - newBefore;
+        double compiledSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        size_t jsonBefore = g_jsonAllocCount;
+        newBefore = g_newCount;
+        size_t legacyFired = 0;
+        for (int i = 0; i < FIRE_ITERATIONS / 10; i++) {
+            for (const std::string& params : legacyParams) {
+                fireLegacy(params);
+                legacyFired++;
+            }
+        }
+        size_t legacyAllocs = (g_jsonAllocCount - jsonBefore) + (g_newCount - newBefore);
+        double legacySec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        char msg[256];
+        snprintf(msg, sizeof(msg),
+            "%s: %d beats, %d events, %d payloads | compiled %.0f beats/s, %.3f allocs/beat | "
+            "legacy %.0f beats/s, %.2f allocs/beat",
+            path, stats.beats, stats.events, (int) show.payloads.size(),
+            fired / compiledSec, (double) compiledAllocs / fired,
+            legacyFired / legacySec, (double) legacyAllocs / legacyFired);
+        TEST_MESSAGE(msg);
+
+        TEST_ASSERT_EQUAL_UINT32(0, compiledAllocs);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_time);
+    RUN_TEST(test_parse_color);
+    RUN_TEST(test_zero_speed_pulse_is_dropped);
+    RUN_TEST(test_automation_lanes);
+    RUN_TEST(test_bundled_timelines_fire_without_allocating);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
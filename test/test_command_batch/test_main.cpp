@@ -0,0 +1,120 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <cstring>
+
+#include "../../src/freertos/SRKeyedRing.h"
+#include "../../src/lights/CommandKey.cpp"
+#include "../../src/lights/CommandBatch.cpp"
+
+/**
+ * Command batch tests
+ *
+ * Checks which arrays are accepted as a batch, which entry is reported when
+ * one is not, how tracing fields are picked, and that a queued batch is an
+ * ordered barrier: values sent after it never overtake it, and none of its
+ * commands are coalesced away.
+ *
+ * Run with: pio test -e native -f test_command_batch
+ */
+
+static StaticJsonDocument<2048> doc;
+
+static BatchCheck checkOf(const char* json, size_t* badIndex = nullptr) {
+    TEST_ASSERT_TRUE(deserializeJson(doc, json) == DeserializationError::Ok);
+    TEST_ASSERT_TRUE(CommandBatch::isBatch(doc.as<JsonVariantConst>()));
+    return CommandBatch::check(doc.as<JsonArrayConst>(), badIndex);
+}
+
+void setUp(void) {
+    doc.clear();
+}
+void tearDown(void) {}
+
+void test_is_batch(void) {
+    TEST_ASSERT_TRUE(deserializeJson(doc, "{\"t\":\"brightness\",\"brightness\":10}") == DeserializationError::Ok);
+    TEST_ASSERT_FALSE(CommandBatch::isBatch(doc.as<JsonVariantConst>()));
+    TEST_ASSERT_TRUE(deserializeJson(doc, "[{\"t\":\"speed\",\"speed\":2}]") == DeserializationError::Ok);
+    TEST_ASSERT_TRUE(CommandBatch::isBatch(doc.as<JsonVariantConst>()));
+}
+
+void test_check(void) {
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::Ok, (int) checkOf(
+        "[{\"t\":\"effect\",\"e\":{\"t\":\"rainbow\"}},{\"type\":\"brightness\",\"brightness\":80},"
+        "{\"t\":\"speed\",\"speed\":2},{\"t\":\"choreography\",\"tl\":[]}]"));
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::Empty, (int) checkOf("[]"));
+
+    size_t badIndex = 99;
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::NotACommand, (int) checkOf("[{\"t\":\"speed\",\"speed\":2},{\"speed\":2}]", &badIndex));
+    TEST_ASSERT_EQUAL_UINT32(1, badIndex);
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::NotACommand, (int) checkOf("[[{\"t\":\"speed\",\"speed\":2}]]", &badIndex));
+    TEST_ASSERT_EQUAL_UINT32(0, badIndex);
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::NotACommand, (int) checkOf("[{\"t\":\"speed\"},7]", &badIndex));
+    TEST_ASSERT_EQUAL_UINT32(1, badIndex);
+    // A misspelled type rejects the batch instead of being skipped when applied
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::UnknownType, (int) checkOf(
+        "[{\"t\":\"effect\",\"e\":{\"t\":\"rainbow\"}},{\"t\":\"brightnes\",\"brightness\":80}]", &badIndex));
+    TEST_ASSERT_EQUAL_UINT32(1, badIndex);
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::UnknownType, (int) checkOf("[{\"type\":\"reboot\"}]", &badIndex));
+    TEST_ASSERT_EQUAL_UINT32(0, badIndex);
+
+    char json[512] = "[";
+    for (size_t i = 0; i <= CommandBatch::MAX_COMMANDS; i++) {
+        strcat(json, i ? ",{\"t\":\"speed\"}" : "{\"t\":\"speed\"}");
+    }
+    strcat(json, "]");
+    TEST_ASSERT_EQUAL_INT((int) BatchCheck::TooMany, (int) checkOf(json));
+}
+
+void test_trace_fields(void) {
+    bool echo = true;
+    uint32_t id = 5;
+    checkOf("[{\"t\":\"effect_params\",\"id\":3,\"p\":{}},{\"t\":\"speed\",\"speed\":2}]");
+    CommandBatch::traceFields(doc.as<JsonArrayConst>(), echo, id);
+    TEST_ASSERT_FALSE(echo);
+    TEST_ASSERT_EQUAL_UINT32(0, id);  // An effect_params "id" is an effect, not a trace id
+
+    checkOf("[{\"t\":\"effect_params\",\"id\":3,\"p\":{}},{\"t\":\"speed\",\"trace\":true,\"id\":9},{\"t\":\"speed\",\"trace\":true,\"id\":10}]");
+    CommandBatch::traceFields(doc.as<JsonArrayConst>(), echo, id);
+    TEST_ASSERT_TRUE(echo);
+    TEST_ASSERT_EQUAL_UINT32(9, id);
+}
+
+// Stand-in for LEDManager's TestCommand: the key plus which message it was
+struct Queued {
+    uint32_t key;
+    int message;
+};
+
+// LEDManager's ring: COMMAND_RING_SIZE entries, COMMAND_KEY_SLOTS slots
+typedef SRKeyedRing<Queued, 32, 8> CommandRing;
+
+void test_batch_is_a_barrier(void) {
+    // brightness, then a batch (effect + brightness + speed), then a slider drag
+    CommandRing ring;
+    ring.push(CommandKey::BRIGHTNESS, Queued{CommandKey::BRIGHTNESS, 1});
+    ring.push(CommandKey::ORDERED, Queued{CommandKey::ORDERED, 2});  // The batch: one entry
+    for (int m = 3; m < 10; m++) {
+        ring.push(CommandKey::BRIGHTNESS, Queued{CommandKey::BRIGHTNESS, m});
+    }
+    const int expected[] = {1, 2, 9};  // Not replaced by values sent after the batch; only the newest after it
+    Queued cmd;
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(ring.pop(cmd));
+        TEST_ASSERT_EQUAL_INT(expected[i], cmd.message);
+    }
+    TEST_ASSERT_FALSE(ring.pop(cmd));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_is_batch);
+    RUN_TEST(test_check);
+    RUN_TEST(test_trace_fields);
+    RUN_TEST(test_batch_is_a_barrier);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
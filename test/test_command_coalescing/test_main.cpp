@@ -0,0 +1,274 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "../../src/freertos/SRKeyedRing.h"
+#include "../../src/lights/CommandKey.cpp"
+
+/**
+ * Command coalescing tests
+ *
+ * Drives SRKeyedRing, LEDManager's command ring, with keyed and ordered
+ * commands: it coalesces as commands are pushed, so a stalled LED task
+ * must not cost the newest value. A slider drag is replayed against the
+ * old plain depth-10 queue to count stale and rejected values.
+ *
+ * Run with: pio test -e native -f test_command_coalescing
+ */
+
+static const size_t PLAIN_QUEUE_DEPTH = 10;  // LEDManager's queue before the ring
+
+// Stand-in for LEDManager's TestCommand: the key plus the value it carries
+struct Command {
+    uint32_t key;
+    int value;
+};
+
+// LEDManager's ring: COMMAND_RING_SIZE entries, COMMAND_KEY_SLOTS slots
+typedef SRKeyedRing<Command, 32, 8> CommandRing;
+
+static std::vector<int> drain(CommandRing& ring) {
+    std::vector<int> values;
+    Command cmd;
+    while (ring.pop(cmd)) values.push_back(cmd.value);
+    return values;
+}
+
+static QueueSendResult send(CommandRing& ring, uint32_t key, int value) {
+    return ring.push(key, Command{key, value});
+}
+
+static uint32_t keyOf(const char* json) {
+    StaticJsonDocument<256> doc;
+    TEST_ASSERT_TRUE(deserializeJson(doc, json) == DeserializationError::Ok);
+    return CommandKey::of(doc.as<JsonObjectConst>());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_keys(void) {
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::BRIGHTNESS, keyOf("{\"t\":\"brightness\",\"brightness\":10}"));
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::BRIGHTNESS, keyOf("{\"type\":\"brightness\",\"brightness\":10}"));
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::SPEED, keyOf("{\"t\":\"speed\",\"speed\":2.5}"));
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::EFFECT_PARAMS | 3, keyOf("{\"t\":\"effect_params\",\"id\":3,\"p\":{}}"));
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::EFFECT_PARAMS | CommandKey::PRIMARY_EFFECT, keyOf("{\"t\":\"effect_params\",\"p\":{}}"));
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::ORDERED, keyOf("{\"t\":\"effect\",\"e\":{\"t\":\"rainbow\"}}"));
+    TEST_ASSERT_EQUAL_UINT32(CommandKey::ORDERED, keyOf("{\"brightness\":10}"));
+}
+
+void test_keys_coalesce_independently(void) {
+    CommandRing ring;
+    send(ring, CommandKey::BRIGHTNESS, 1);
+    send(ring, CommandKey::SPEED, 2);
+    send(ring, CommandKey::EFFECT_PARAMS | 1, 3);
+    send(ring, CommandKey::EFFECT_PARAMS | 2, 4);
+    TEST_ASSERT_TRUE(send(ring, CommandKey::BRIGHTNESS, 5) == QueueSendResult::Coalesced);
+    TEST_ASSERT_TRUE(send(ring, CommandKey::EFFECT_PARAMS | 1, 6) == QueueSendResult::Coalesced);
+    std::vector<int> values = drain(ring);
+    TEST_ASSERT_EQUAL_INT(4, (int) values.size());
+    TEST_ASSERT_EQUAL_INT(5, values[0]);
+    TEST_ASSERT_EQUAL_INT(6, values[2]);
+}
+
+void test_slider_drag_against_plain_queue(void) {
+    // 4 slider moves per frame for 60 frames. The LED task drains once a
+    // frame, except for a 3-frame stall (an effect build, an SD read) every 15.
+    const int FRAMES = 60;
+    const int MOVES_PER_FRAME = 4;
+    std::deque<Command> plain;
+    CommandRing coalesced;
+    int plainApplied = 0, plainRejected = 0, coalescedApplied = 0;
+    int lastPlain = -1, lastCoalesced = -1;
+    int value = 0;
+
+    for (int frame = 0; frame <= FRAMES; frame++) {
+        if (frame < FRAMES) {
+            for (int m = 0; m < MOVES_PER_FRAME; m++, value++) {
+                if (plain.size() < PLAIN_QUEUE_DEPTH) plain.push_back(Command{CommandKey::BRIGHTNESS, value});
+                else plainRejected++;
+                TEST_ASSERT_TRUE(send(coalesced, CommandKey::BRIGHTNESS, value) != QueueSendResult::Full);
+            }
+            if (frame % 15 >= 12) continue;  // Stalled
+        }
+        for (; !plain.empty(); plain.pop_front(), plainApplied++) lastPlain = plain.front().value;
+        for (int applied : drain(coalesced)) {
+            lastCoalesced = applied;
+            coalescedApplied++;
+        }
+        TEST_ASSERT_EQUAL_INT(value - 1, lastCoalesced);
+    }
+    TEST_ASSERT_TRUE(coalescedApplied <= FRAMES);
+    TEST_ASSERT_TRUE(plainRejected > 0);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d moves: plain applied %d, rejected %d, final value %s; coalesced applied %d, final value kept",
+        value, plainApplied, plainRejected, lastPlain == value - 1 ? "kept" : "lost", coalescedApplied);
+    TEST_MESSAGE(msg);
+}
+
+void test_keyed_ring_coalesces_on_push(void) {
+    CommandRing ring;
+    int coalesced = 0;
+    for (int v = 0; v < 50; v++) {
+        if (send(ring, CommandKey::BRIGHTNESS, v) == QueueSendResult::Coalesced) coalesced++;
+    }
+    TEST_ASSERT_EQUAL_INT(49, coalesced);
+    TEST_ASSERT_EQUAL_INT(1, (int) ring.size());
+    std::vector<int> values = drain(ring);
+    TEST_ASSERT_EQUAL_INT(1, (int) values.size());
+    TEST_ASSERT_EQUAL_INT(49, values[0]);
+
+    // The slot is free again once taken
+    TEST_ASSERT_TRUE(send(ring, CommandKey::BRIGHTNESS, 50) == QueueSendResult::Queued);
+    TEST_ASSERT_EQUAL_INT(50, drain(ring)[0]);
+}
+
+void test_keyed_ring_ordered_commands_are_barriers(void) {
+    CommandRing ring;
+    send(ring, CommandKey::BRIGHTNESS, 10);
+    send(ring, CommandKey::ORDERED, 0);  // Effect change
+    TEST_ASSERT_TRUE(send(ring, CommandKey::BRIGHTNESS, 20) == QueueSendResult::Queued);
+    TEST_ASSERT_TRUE(send(ring, CommandKey::BRIGHTNESS, 30) == QueueSendResult::Coalesced);
+    TEST_ASSERT_TRUE(send(ring, CommandKey::SPEED, 40) == QueueSendResult::Queued);
+    TEST_ASSERT_TRUE(send(ring, CommandKey::ORDERED, 1) == QueueSendResult::Queued);
+
+    const int expected[] = {10, 0, 30, 40, 1};
+    std::vector<int> values = drain(ring);
+    TEST_ASSERT_EQUAL_INT(5, (int) values.size());
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_INT(expected[i], values[i]);
+    }
+}
+
+void test_keyed_ring_full_keeps_newest_value(void) {
+    // The LED task is stalled and the ring fills up
+    CommandRing ring;
+    TEST_ASSERT_TRUE(send(ring, CommandKey::BRIGHTNESS, 1) == QueueSendResult::Queued);
+    for (int i = 0; i < 30; i++) {
+        TEST_ASSERT_TRUE(send(ring, CommandKey::ORDERED, 0) == QueueSendResult::Queued);
+    }
+    for (int v = 100; v < 200; v++) {
+        TEST_ASSERT_TRUE(send(ring, CommandKey::EFFECT_PARAMS | 1, v) != QueueSendResult::Full);
+    }
+    TEST_ASSERT_EQUAL_INT(32, (int) ring.size());
+    TEST_ASSERT_TRUE(send(ring, CommandKey::ORDERED, 0) == QueueSendResult::Full);
+    // A value for a key with nothing pending has no room...
+    TEST_ASSERT_TRUE(send(ring, CommandKey::SPEED, 5) == QueueSendResult::Full);
+    // ...but a newer value for a pending key is never the one refused
+    TEST_ASSERT_TRUE(send(ring, CommandKey::EFFECT_PARAMS | 1, 999) == QueueSendResult::Coalesced);
+
+    std::vector<int> values = drain(ring);
+    TEST_ASSERT_EQUAL_INT(32, (int) values.size());
+    TEST_ASSERT_EQUAL_INT(1, values.front());
+    TEST_ASSERT_EQUAL_INT(999, values.back());
+}
+
+void test_keyed_ring_out_of_slots(void) {
+    // With every slot taken a keyed value goes through whole, as an ordered
+    // command, and a later value for a parked key must not overtake it
+    SRKeyedRing<Command, 8, 2> ring;
+    Command cmd;
+    TEST_ASSERT_TRUE(ring.push(1, Command{1, 10}) == QueueSendResult::Queued);
+    TEST_ASSERT_TRUE(ring.push(2, Command{2, 20}) == QueueSendResult::Queued);
+    TEST_ASSERT_TRUE(ring.push(3, Command{3, 30}) == QueueSendResult::Queued);
+    TEST_ASSERT_TRUE(ring.push(1, Command{1, 11}) == QueueSendResult::Queued);
+
+    const int expected[] = {10, 20, 30, 11};
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(cmd));
+        TEST_ASSERT_EQUAL_INT(expected[i], cmd.value);
+    }
+    TEST_ASSERT_FALSE(ring.pop(cmd));
+}
+
+void test_keyed_ring_concurrent_producers(void) {
+    // Each producer drags its own slider while sending ordered commands; the
+    // consumer must see every slider rise, end on its last value, and get
+    // every ordered command in order
+    const int PRODUCERS = 4;
+    const int VALUES = 100000;
+    CommandRing ring;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&ring, p]() {
+            for (int v = 0; v < VALUES; v++) {
+                while (ring.push(CommandKey::EFFECT_PARAMS | p, Command{CommandKey::EFFECT_PARAMS | (uint32_t) p, v}) ==
+                       QueueSendResult::Full) {
+                    std::this_thread::yield();
+                }
+                if (v % 1000 == 0) {
+                    while (ring.push(CommandKey::ORDERED, Command{CommandKey::ORDERED, p * VALUES + v}) ==
+                           QueueSendResult::Full) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        });
+    }
+
+    int lastValue[PRODUCERS], lastOrdered[PRODUCERS];
+    for (int p = 0; p < PRODUCERS; p++) {
+        lastValue[p] = -1;
+        lastOrdered[p] = -1;
+    }
+    int applied = 0;
+    bool ordered = true;
+    bool rising = true;
+    auto consume = [&]() {
+        Command cmd;
+        while (ring.pop(cmd)) {
+            applied++;
+            if (cmd.key == CommandKey::ORDERED) {
+                const int p = cmd.value / VALUES;
+                // Sent after value v, so the slider has reached v at least
+                ordered = ordered && cmd.value > lastOrdered[p] && lastValue[p] >= cmd.value % VALUES;
+                lastOrdered[p] = cmd.value;
+            } else {
+                const int p = cmd.key & 0xFF;
+                rising = rising && cmd.value > lastValue[p];
+                lastValue[p] = cmd.value;
+            }
+        }
+    };
+    bool done = false;
+    while (!done) {
+        consume();
+        done = true;
+        for (int p = 0; p < PRODUCERS; p++) {
+            done = done && lastValue[p] == VALUES - 1;
+        }
+    }
+    for (std::thread& producer : producers) producer.join();
+    consume();
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_TRUE(rising);
+    for (int p = 0; p < PRODUCERS; p++) {
+        TEST_ASSERT_EQUAL_INT(VALUES - 1, lastValue[p]);
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%d values from %d producers applied as %d commands",
+        PRODUCERS * VALUES, PRODUCERS, applied);
+    TEST_MESSAGE(msg);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_keys);
+    RUN_TEST(test_keys_coalesce_independently);
+    RUN_TEST(test_slider_drag_against_plain_queue);
+    RUN_TEST(test_keyed_ring_coalesces_on_push);
+    RUN_TEST(test_keyed_ring_ordered_commands_are_barriers);
+    RUN_TEST(test_keyed_ring_full_keeps_newest_value);
+    RUN_TEST(test_keyed_ring_out_of_slots);
+    RUN_TEST(test_keyed_ring_concurrent_producers);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
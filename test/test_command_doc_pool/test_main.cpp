@@ -0,0 +1,198 @@
+#include "unity.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+
+#include "../../src/hal/network/CommandCodec.cpp"
+#include "../../src/hal/network/CommandDocPool.cpp"
+
+/**
+ * Command document pool tests
+ *
+ * Checks slots are reused once the consumer drops its reference, that big
+ * commands and a full pool fall back to one-off documents, and that a queued
+ * document arrives as the same object the transport parsed into.
+ *
+ * The flood test replays a WebSocket burst of brightness commands through
+ * the old parse-and-copy path and through the pool, counting heap
+ * allocations and timing both.
+ *
+ * Run with: pio test -e native -f test_command_doc_pool
+ */
+
+#if defined(__GLIBC__)
+// Count every heap allocation; operator new and ArduinoJson both end up here
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+static size_t g_allocations = 0;
+extern "C" void* malloc(size_t n) { g_allocations++; return __libc_malloc(n); }
+extern "C" void* calloc(size_t n, size_t m) { g_allocations++; return __libc_calloc(n, m); }
+extern "C" void* realloc(void* p, size_t n) { g_allocations++; return __libc_realloc(p, n); }
+#define COUNTS_ALLOCATIONS 1
+#else
+static size_t g_allocations = 0;
+#define COUNTS_ALLOCATIONS 0
+#endif
+
+// Stand-in for LEDManager's TestCommand queue
+struct QueuedCommand {
+    std::shared_ptr<DynamicJsonDocument> doc;
+    uint32_t timestamp;
+};
+
+static const char BRIGHTNESS[] = "{\"t\":\"brightness\",\"brightness\":42}";
+static const int FLOOD = 20000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_slots_are_reused_after_release(void) {
+    CommandDocPool pool(2, 2048);
+    std::shared_ptr<DynamicJsonDocument> a = pool.acquire(40);
+    std::shared_ptr<DynamicJsonDocument> b = pool.acquire(40);
+    TEST_ASSERT_TRUE(a && b && a != b);
+    TEST_ASSERT_EQUAL_INT(2, (int) pool.inUse());
+
+    DynamicJsonDocument* first = a.get();
+    a.reset();
+    TEST_ASSERT_EQUAL_INT(1, (int) pool.inUse());
+    std::shared_ptr<DynamicJsonDocument> c = pool.acquire(40);
+    TEST_ASSERT_TRUE(c.get() == first);
+
+    const CommandDocPoolStats& stats = pool.getStats();
+    TEST_ASSERT_EQUAL_UINT32(3, stats.acquired);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.exhausted);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.peakInUse);
+}
+
+void test_full_pool_and_oversize_fall_back(void) {
+    CommandDocPool pool(2, 2048);
+    std::shared_ptr<DynamicJsonDocument> a = pool.acquire(40);
+    std::shared_ptr<DynamicJsonDocument> b = pool.acquire(40);
+
+    // Every slot is still queued: a one-off document, not one of the slots
+    std::shared_ptr<DynamicJsonDocument> spill = pool.acquire(40);
+    TEST_ASSERT_TRUE(spill && spill != a && spill != b);
+    TEST_ASSERT_EQUAL_UINT32(1, pool.getStats().exhausted);
+
+    // 3x 2000 bytes does not fit a 2 KB slot; sized like HandleJSONCommand always did
+    a.reset();
+    std::shared_ptr<DynamicJsonDocument> big = pool.acquire(2000);
+    TEST_ASSERT_TRUE(big != nullptr);
+    TEST_ASSERT_EQUAL_INT(6000, (int) big->capacity());
+    TEST_ASSERT_EQUAL_UINT32(1, pool.getStats().oversize);
+    TEST_ASSERT_EQUAL_INT(1, (int) pool.inUse());
+
+    TEST_ASSERT_EQUAL_INT(2048, (int) CommandDocPool::docSizeFor(10));
+    TEST_ASSERT_EQUAL_INT(32768, (int) CommandDocPool::docSizeFor(100000));
+}
+
+void test_queued_document_is_not_copied(void) {
+    CommandDocPool pool(2, 2048);
+    std::deque<QueuedCommand> queue;
+
+    DeserializationError error;
+    std::shared_ptr<DynamicJsonDocument> doc = pool.parse(BRIGHTNESS, strlen(BRIGHTNESS), error);
+    TEST_ASSERT_TRUE(doc != nullptr);
+    DynamicJsonDocument* parsed = doc.get();
+
+    QueuedCommand cmd;
+    cmd.doc = std::move(doc);
+    cmd.timestamp = 0;
+    queue.push_back(std::move(cmd));
+    TEST_ASSERT_EQUAL_INT(1, (int) pool.inUse());
+
+    QueuedCommand received = std::move(queue.front());
+    queue.pop_front();
+    TEST_ASSERT_TRUE(received.doc.get() == parsed);
+    TEST_ASSERT_EQUAL_INT(42, (*received.doc)["brightness"].as<int>());
+
+    received.doc.reset();
+    TEST_ASSERT_EQUAL_INT(0, (int) pool.inUse());
+}
+
+void test_parse_error_returns_slot(void) {
+    CommandDocPool pool(1, 2048);
+    DeserializationError error;
+    const char bad[] = "{\"t\":\"brightness\",";
+    TEST_ASSERT_TRUE(pool.parse(bad, strlen(bad), error) == nullptr);
+    TEST_ASSERT_TRUE(error != DeserializationError::Ok);
+    TEST_ASSERT_EQUAL_UINT32(1, pool.getStats().parseErrors);
+    TEST_ASSERT_EQUAL_INT(0, (int) pool.inUse());
+}
+
+// What processMessage + HandleJSONCommand used to do per command
+static bool legacyCommand(const char* json, size_t length) {
+    std::shared_ptr<DynamicJsonDocument> doc = std::make_shared<DynamicJsonDocument>(1024);
+    if (deserializeJson(*doc, json, length)) return false;
+    DynamicJsonDocument rewrapped(64);
+    rewrapped["type"] = "brightness";
+    rewrapped["brightness"] = (*doc)["brightness"].as<int>();
+
+    const size_t docSize = CommandDocPool::docSizeFor(length);
+    DynamicJsonDocument parsed(docSize);
+    if (deserializeJson(parsed, json, length)) return false;
+    std::shared_ptr<DynamicJsonDocument> queued = std::make_shared<DynamicJsonDocument>(docSize);
+    *queued = parsed;
+    return (*queued)["brightness"].as<int>() == rewrapped["brightness"].as<int>();
+}
+
+static bool pooledCommand(CommandDocPool& pool, const char* json, size_t length) {
+    DeserializationError error;
+    std::shared_ptr<DynamicJsonDocument> doc = pool.parse(json, length, error);
+    if (!doc) return false;
+    QueuedCommand cmd;
+    cmd.doc = std::move(doc);
+    return (*cmd.doc)["brightness"].as<int>() == 42;
+}
+
+void test_brightness_flood(void) {
+    CommandDocPool pool;
+    const size_t length = strlen(BRIGHTNESS);
+    pooledCommand(pool, BRIGHTNESS, length);  // Warm up
+
+    size_t before = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FLOOD; i++) {
+        TEST_ASSERT_TRUE(legacyCommand(BRIGHTNESS, length));
+    }
+    const double legacyUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    const size_t legacyAllocs = g_allocations - before;
+
+    before = g_allocations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FLOOD; i++) {
+        TEST_ASSERT_TRUE(pooledCommand(pool, BRIGHTNESS, length));
+    }
+    const double pooledUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    const size_t pooledAllocs = g_allocations - before;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d brightness commands: legacy %.2f allocs/cmd %.0f cmd/s, pooled %.2f allocs/cmd %.0f cmd/s",
+        FLOOD, (double) legacyAllocs / FLOOD, FLOOD / (legacyUs / 1e6),
+        (double) pooledAllocs / FLOOD, FLOOD / (pooledUs / 1e6));
+    TEST_MESSAGE(msg);
+
+    if (COUNTS_ALLOCATIONS) {
+        TEST_ASSERT_TRUE(legacyAllocs >= (size_t) FLOOD * 2);  // At least the two make_shared calls
+        TEST_ASSERT_EQUAL_UINT32(0, (uint32_t) pooledAllocs);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, pool.getStats().exhausted);
+    TEST_ASSERT_EQUAL_INT(0, (int) pool.inUse());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_slots_are_reused_after_release);
+    RUN_TEST(test_full_pool_and_oversize_fall_back);
+    RUN_TEST(test_queued_document_is_not_copied);
+    RUN_TEST(test_parse_error_returns_slot);
+    RUN_TEST(test_brightness_flood);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
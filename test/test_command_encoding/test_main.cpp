@@ -0,0 +1,140 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../src/hal/network/CommandCodec.cpp"
+
+/**
+ * Command encoding benchmark
+ *
+ * Encodes an effect, a brightness and a choreography command as JSON text
+ * and as MessagePack, checks both decode to the same document, and reports
+ * bytes on the wire and decode time for each.
+ *
+ * Run with: pio test -e native -f test_command_encoding
+ */
+
+static const char* EFFECT =
+    "{\"t\":\"effect\",\"e\":{\"t\":\"rainbow\",\"p\":{\"speed\":1.5,\"reverse\":false,"
+    "\"brightness\":200,\"colors\":[[255,0,94],[0,120,255],[255,255,255]]}}}";
+static const char* BRIGHTNESS = "{\"t\":\"brightness\",\"brightness\":128}";
+static const char* CHOREOGRAPHY_FILE = "default_sd_card_data/data/music/compact/test_timeline.json";
+
+static const int DECODE_ITERATIONS = 2000;
+
+static bool readFile(const char* path, std::string& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// Minified JSON and MessagePack of the same command
+static void encodeBoth(const std::string& source, std::string& json, std::vector<uint8_t>& msgpack) {
+    DynamicJsonDocument doc(32768);
+    TEST_ASSERT_TRUE(deserializeJson(doc, source) == DeserializationError::Ok);
+    json.clear();
+    serializeJson(doc, json);
+    msgpack.resize(CommandCodec::measure(doc.as<JsonVariantConst>(), CommandEncoding::MsgPack));
+    TEST_ASSERT_EQUAL_INT((int) msgpack.size(),
+        (int) CommandCodec::encode(doc.as<JsonVariantConst>(), CommandEncoding::MsgPack, msgpack.data(), msgpack.size()));
+}
+
+static double decodeUs(const uint8_t* data, size_t length, CommandEncoding encoding) {
+    DynamicJsonDocument doc(CommandCodec::docSizeFor(length, encoding) * 2);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < DECODE_ITERATIONS; i++) {
+        TEST_ASSERT_TRUE(CommandCodec::decode(doc, data, length, encoding) == DeserializationError::Ok);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / DECODE_ITERATIONS;
+}
+
+static void compare(const char* name, const std::string& source) {
+    std::string json;
+    std::vector<uint8_t> msgpack;
+    encodeBoth(source, json, msgpack);
+    const uint8_t* text = (const uint8_t*) json.data();
+
+    TEST_ASSERT_TRUE(CommandCodec::detect(text, json.size()) == CommandEncoding::Json);
+    TEST_ASSERT_TRUE(CommandCodec::detect(msgpack.data(), msgpack.size()) == CommandEncoding::MsgPack);
+
+    // Both decode to the same command
+    DynamicJsonDocument doc(32768);
+    TEST_ASSERT_TRUE(CommandCodec::decode(doc, msgpack.data(), msgpack.size(), CommandEncoding::MsgPack) == DeserializationError::Ok);
+    std::string roundTrip;
+    serializeJson(doc, roundTrip);
+    TEST_ASSERT_TRUE(roundTrip == json);
+    TEST_ASSERT_TRUE(msgpack.size() < json.size());
+
+    const double jsonUs = decodeUs(text, json.size(), CommandEncoding::Json);
+    const double msgpackUs = decodeUs(msgpack.data(), msgpack.size(), CommandEncoding::MsgPack);
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%-12s json %5u bytes %7.2f us | msgpack %5u bytes %7.2f us",
+        name, (unsigned) json.size(), jsonUs, (unsigned) msgpack.size(), msgpackUs);
+    TEST_MESSAGE(msg);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_detect_and_names(void) {
+    const uint8_t json[] = {' ', '{', '}'};
+    const uint8_t fixmap[] = {0x81, 0xA1, 't'};
+    const uint8_t map16[] = {0xDE, 0x00, 0x01};
+    const uint8_t fixarray[] = {0x92, 0x80, 0x80};
+    TEST_ASSERT_TRUE(CommandCodec::detect(json, sizeof(json)) == CommandEncoding::Json);
+    TEST_ASSERT_TRUE(CommandCodec::detect(fixmap, sizeof(fixmap)) == CommandEncoding::MsgPack);
+    TEST_ASSERT_TRUE(CommandCodec::detect(map16, sizeof(map16)) == CommandEncoding::MsgPack);
+    TEST_ASSERT_TRUE(CommandCodec::detect(fixarray, sizeof(fixarray)) == CommandEncoding::MsgPack);
+    TEST_ASSERT_TRUE(CommandCodec::detect(nullptr, 0) == CommandEncoding::Json);
+
+    CommandEncoding encoding = CommandEncoding::Json;
+    TEST_ASSERT_TRUE(CommandCodec::encodingFromName(CommandCodec::encodingName(CommandEncoding::MsgPack), encoding));
+    TEST_ASSERT_TRUE(encoding == CommandEncoding::MsgPack);
+    TEST_ASSERT_FALSE(CommandCodec::encodingFromName("cbor", encoding));
+    TEST_ASSERT_TRUE(encoding == CommandEncoding::MsgPack);
+}
+
+void test_encode_rejects_small_buffer(void) {
+    StaticJsonDocument<128> doc;
+    doc["t"] = "brightness";
+    doc["brightness"] = 128;
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL_INT(0, (int) CommandCodec::encode(doc.as<JsonVariantConst>(), CommandEncoding::MsgPack, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_INT(0, (int) CommandCodec::encode(doc.as<JsonVariantConst>(), CommandEncoding::Json, out, sizeof(out)));
+}
+
+void test_effect_command(void) {
+    compare("effect", EFFECT);
+}
+
+void test_brightness_command(void) {
+    compare("brightness", BRIGHTNESS);
+}
+
+void test_choreography_command(void) {
+    std::string show;
+    TEST_ASSERT_TRUE(readFile(CHOREOGRAPHY_FILE, show));
+    compare("choreography", show);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_detect_and_names);
+    RUN_TEST(test_encode_rejects_small_buffer);
+    RUN_TEST(test_effect_command);
+    RUN_TEST(test_brightness_command);
+    RUN_TEST(test_choreography_command);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
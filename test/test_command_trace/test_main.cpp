@@ -0,0 +1,168 @@
+#include "unity.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Host stand-in for Arduino's micros(), used by SR_TRACE_STAMP
+static uint32_t micros() {
+    using namespace std::chrono;
+    return (uint32_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#include "../../src/hal/network/CommandTrace.cpp"
+
+/**
+ * Command latency tracing tests
+ *
+ * Checks the histogram buckets and percentiles, the rolling window, the
+ * per-command echo and report formats, and measures what the hop stamps
+ * cost with tracing off and on.
+ *
+ * Run with: pio test -e native -f test_command_trace
+ */
+
+static CommandTrace makeTrace(uint32_t start, const uint32_t (&segments)[5]) {
+    CommandTrace trace;
+    uint32_t t = start;
+    trace.stamp(TraceHop::Received, t);
+    for (size_t hop = 1; hop < CommandTrace::HOPS; hop++) {
+        t += segments[hop - 1];
+        trace.stamp((TraceHop) hop, t);
+    }
+    return trace;
+}
+
+void setUp(void) {
+    g_commandTracer.setEnabled(false);
+    g_commandTracer.reset();
+}
+void tearDown(void) {}
+
+void test_buckets(void) {
+    TEST_ASSERT_EQUAL_INT(0, (int) LatencyHistogram::bucketFor(0));
+    TEST_ASSERT_EQUAL_INT(0, (int) LatencyHistogram::bucketFor(1));
+    TEST_ASSERT_EQUAL_INT(1, (int) LatencyHistogram::bucketFor(2));
+    TEST_ASSERT_EQUAL_INT(1, (int) LatencyHistogram::bucketFor(3));
+    TEST_ASSERT_EQUAL_INT(10, (int) LatencyHistogram::bucketFor(1024));
+    TEST_ASSERT_EQUAL_INT((int) LatencyHistogram::BUCKETS - 1, (int) LatencyHistogram::bucketFor(UINT32_MAX));
+    // Every value is within its bucket's bound
+    for (uint32_t us = 1; us < 100000; us = us * 3 + 1) {
+        TEST_ASSERT_TRUE(us <= LatencyHistogram::bucketUpperBound(LatencyHistogram::bucketFor(us)));
+    }
+}
+
+void test_percentiles(void) {
+    LatencyHistogram h;
+    TEST_ASSERT_EQUAL_UINT32(0, h.percentile(50));
+    for (int i = 0; i < 90; i++) h.record(100);     // bucket [64, 127]
+    for (int i = 0; i < 10; i++) h.record(20000);   // bucket [16384, 32767]
+    TEST_ASSERT_EQUAL_UINT32(100, h.count());
+    TEST_ASSERT_EQUAL_UINT32(127, h.percentile(50));
+    TEST_ASSERT_EQUAL_UINT32(127, h.percentile(90));
+    // Capped at the largest value seen
+    TEST_ASSERT_EQUAL_UINT32(20000, h.percentile(99));
+    TEST_ASSERT_EQUAL_UINT32(20000, h.max());
+}
+
+void test_segments_and_total(void) {
+    const uint32_t segments[5] = {40, 10, 9000, 30, 7000};
+    g_commandTracer.record(makeTrace(1000, segments), 0);
+    for (size_t s = 0; s < 5; s++) {
+        const LatencyHistogram h = g_commandTracer.histogram(s);
+        TEST_ASSERT_EQUAL_UINT32(1, h.count());
+        TEST_ASSERT_EQUAL_UINT32(segments[s], h.max());
+    }
+    TEST_ASSERT_EQUAL_UINT32(16080, g_commandTracer.histogram(CommandTracer::TOTAL).max());
+
+    // A command that skipped the transport (no receive/parse stamps) still
+    // contributes the hops it has
+    CommandTrace partial;
+    partial.stamp(TraceHop::Enqueued, 5000);
+    partial.stamp(TraceHop::Dequeued, 6000);
+    partial.stamp(TraceHop::Applied, 6100);
+    partial.stamp(TraceHop::Shown, 9000);
+    g_commandTracer.record(partial, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, g_commandTracer.histogram(0).count());
+    TEST_ASSERT_EQUAL_UINT32(2, g_commandTracer.histogram(2).count());
+    TEST_ASSERT_EQUAL_UINT32(2, g_commandTracer.histogram(CommandTracer::TOTAL).count());
+}
+
+void test_rolling_window(void) {
+    CommandTracer tracer(1000);
+    const uint32_t slow[5] = {1, 1, 50000, 1, 1};
+    const uint32_t fast[5] = {1, 1, 100, 1, 1};
+    tracer.record(makeTrace(10, slow), 0);
+    tracer.record(makeTrace(10, fast), 1500);  // Rolls: slow is now the previous window
+    TEST_ASSERT_EQUAL_UINT32(2, tracer.histogram(2).count());
+    tracer.record(makeTrace(10, fast), 2600);  // Rolls again: slow drops out
+    TEST_ASSERT_EQUAL_UINT32(2, tracer.histogram(2).count());
+    TEST_ASSERT_EQUAL_UINT32(100, tracer.histogram(2).max());
+}
+
+void test_echo_format(void) {
+    const uint32_t segments[5] = {45, 12, 9000, 30, 7100};
+    CommandTrace trace = makeTrace(500, segments);
+    trace.id = 7;
+    char out[192];
+    TEST_ASSERT_TRUE(CommandTracer::formatTrace(trace, out, sizeof(out)) > 0);
+    TEST_ASSERT_TRUE(strcmp(out,
+        "{\"t\":\"trace\",\"id\":7,\"us\":{\"parse\":45,\"queue\":12,\"wait\":9000,\"apply\":30,\"show\":7100,\"total\":16187}}") == 0);
+
+    char small[16];
+    TEST_ASSERT_EQUAL_INT(0, (int) CommandTracer::formatTrace(trace, small, sizeof(small)));
+    TEST_ASSERT_EQUAL_INT(0, (int) strlen(small));
+}
+
+void test_report_format(void) {
+    const uint32_t segments[5] = {45, 12, 9000, 30, 7100};
+    g_commandTracer.setEnabled(true);
+    g_commandTracer.record(makeTrace(500, segments), 0);
+    char out[640];
+    const size_t length = g_commandTracer.formatReport(out, sizeof(out));
+    TEST_ASSERT_TRUE(length > 0 && length < sizeof(out));
+    TEST_ASSERT_TRUE(strncmp(out, "{\"t\":\"latency\",\"enabled\":true,\"count\":1,\"us\":{\"parse\":{", 55) == 0);
+    TEST_ASSERT_TRUE(strstr(out, "\"total\":{\"p50\":16187,\"p90\":16187,\"p99\":16187,\"max\":16187}}}") != nullptr);
+}
+
+void test_stamp_cost(void) {
+    // What each hop pays: one relaxed load and a branch when off
+    const int ITERATIONS = 2000000;
+    CommandTrace trace;
+    volatile uint32_t sink = 0;
+
+    auto run = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) {
+            SR_TRACE_STAMP(trace, TraceHop::Dequeued);
+            sink = sink + trace.stamps[(size_t) TraceHop::Dequeued];
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+    };
+
+    g_commandTracer.setEnabled(false);
+    const double offNs = run();
+    TEST_ASSERT_FALSE(trace.has(TraceHop::Dequeued));
+    g_commandTracer.setEnabled(true);
+    const double onNs = run();
+    TEST_ASSERT_TRUE(trace.has(TraceHop::Dequeued));
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "stamp cost per hop: off %.2f ns, on %.2f ns", offNs, onNs);
+    TEST_MESSAGE(msg);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_segments_and_total);
+    RUN_TEST(test_rolling_window);
+    RUN_TEST(test_echo_format);
+    RUN_TEST(test_report_format);
+    RUN_TEST(test_stamp_cost);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,312 @@
+#include "unity.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// As a release environment would set them in build_flags
+#define SR_LOG_MIN_LEVEL 1
+#define SR_LOG_COMPONENT_LEVELS {"Noisy", 3}, {"WiFiManager", 0}
+
+#include "../../src/freertos/LogFilter.h"
+
+/**
+ * Log filter tests
+ *
+ * Checks the compile-time floor (global and per component), component
+ * interning and its pointer cache, the runtime level and component
+ * bitmasks, and compares what a filtered-out debug call costs with
+ * LogManager's old path, which formatted the message and then compared
+ * strings against the filter lists.
+ *
+ * Run with: pio test -e native -f test_log_filter
+ */
+
+static_assert(!LogLevels::compiledIn(LogLevel::DEBUG, ""), "below the global floor");
+static_assert(LogLevels::compiledIn(LogLevel::INFO, "LEDManager"), "at the global floor");
+static_assert(!LogLevels::compiledIn(LogLevel::WARN, "Noisy"), "component floor raised");
+static_assert(LogLevels::compiledIn(LogLevel::ERROR, "Noisy"), "component floor raised");
+static_assert(LogLevels::compiledIn(LogLevel::DEBUG, "WiFiManager"), "component floor lowered");
+static_assert(!LogLevels::compiledIn(LogLevel::DEBUG, "WiFiManagerX"), "whole names only");
+
+static LogFilter filter;
+static int written = 0;
+static int argumentsEvaluated = 0;
+
+static int countArgument() {
+    argumentsEvaluated++;
+    return argumentsEvaluated;
+}
+
+// LogManager's SR_LOG_COMPONENTF, writing into a buffer instead of Serial
+#define TEST_LOGF(level, comp, fmt, ...) do { \
+    if constexpr (LogLevels::compiledIn(level, comp)) { \
+        static const uint8_t _logComponentId = LogComponents::intern(comp); \
+        if (filter.allows(level, _logComponentId)) { \
+            char _buffer[128]; \
+            snprintf(_buffer, sizeof(_buffer), fmt, ##__VA_ARGS__); \
+            written++; \
+        } \
+    } \
+} while (0)
+
+void setUp(void) {
+    filter.setComponentFiltering(false);
+    filter.clearComponents();
+    filter.setLevels(LogFilter::ALL_LEVELS);
+    written = 0;
+    argumentsEvaluated = 0;
+}
+void tearDown(void) {}
+
+void test_compiled_out_calls_skip_their_arguments(void) {
+    TEST_LOGF(LogLevel::DEBUG, "LEDManager", "frame %d", countArgument());
+    TEST_LOGF(LogLevel::WARN, "Noisy", "value %d", countArgument());
+    TEST_ASSERT_EQUAL_INT(0, written);
+    TEST_ASSERT_EQUAL_INT(0, argumentsEvaluated);
+
+    TEST_LOGF(LogLevel::INFO, "LEDManager", "frame %d", countArgument());
+    TEST_LOGF(LogLevel::DEBUG, "WiFiManager", "rssi %d", countArgument());
+    TEST_ASSERT_EQUAL_INT(2, written);
+    TEST_ASSERT_EQUAL_INT(2, argumentsEvaluated);
+}
+
+void test_filtered_calls_skip_their_arguments(void) {
+    filter.setComponentFiltering(true);
+    filter.allowComponent(LogComponents::intern("WiFiManager"));
+    TEST_LOGF(LogLevel::INFO, "LEDManager", "frame %d", countArgument());
+    TEST_ASSERT_EQUAL_INT(0, written);
+    TEST_LOGF(LogLevel::INFO, "WiFiManager", "connected %d", countArgument());
+    TEST_ASSERT_EQUAL_INT(1, written);
+    // The arguments are inside the check too
+    TEST_ASSERT_EQUAL_INT(1, argumentsEvaluated);
+}
+
+void test_intern(void) {
+    const uint8_t led = LogComponents::intern("LEDManager");
+    const uint8_t wifi = LogComponents::intern("WiFiManager");
+    TEST_ASSERT_TRUE(led != LogComponents::NONE);
+    TEST_ASSERT_TRUE(led != wifi);
+    TEST_ASSERT_EQUAL_UINT8(led, LogComponents::intern("LEDManager"));
+    TEST_ASSERT_EQUAL_STRING("LEDManager", LogComponents::name(led));
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::NONE, LogComponents::intern(""));
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::NONE, LogComponents::intern(nullptr));
+
+    // Cut to 31 characters, as LogMessage::component
+    const uint8_t longName = LogComponents::intern("AComponentNameLongerThanThirtyOneChars");
+    TEST_ASSERT_EQUAL_UINT8(longName, LogComponents::intern("AComponentNameLongerThanThirtyOn"));
+    TEST_ASSERT_EQUAL_UINT32(31, strlen(LogComponents::name(longName)));
+}
+
+void test_component_and_level_masks(void) {
+    const uint8_t led = LogComponents::intern("LEDManager");
+    const uint8_t wifi = LogComponents::intern("WiFiManager");
+    TEST_ASSERT_TRUE(filter.allows(LogLevel::DEBUG, led));
+
+    filter.allowComponent(wifi);
+    filter.setComponentFiltering(true);
+    TEST_ASSERT_FALSE(filter.allows(LogLevel::ERROR, led));
+    TEST_ASSERT_TRUE(filter.allows(LogLevel::DEBUG, wifi));
+    TEST_ASSERT_FALSE(filter.allows(LogLevel::INFO, LogComponents::NONE));
+
+    filter.setLevels(LogFilter::levelBit(LogLevel::WARN) | LogFilter::levelBit(LogLevel::ERROR));
+    TEST_ASSERT_FALSE(filter.allows(LogLevel::INFO, wifi));
+    TEST_ASSERT_TRUE(filter.allows(LogLevel::WARN, wifi));
+
+    filter.disallowComponent(wifi);
+    TEST_ASSERT_FALSE(filter.allows(LogLevel::ERROR, wifi));
+
+    // Ids in the upper mask word
+    filter.allowComponent(LogComponents::MAX_COMPONENTS - 1);
+    TEST_ASSERT_TRUE(filter.allows(LogLevel::ERROR, LogComponents::MAX_COMPONENTS - 1));
+    TEST_ASSERT_FALSE(filter.allows(LogLevel::ERROR, 32));
+}
+
+void test_concurrent_intern(void) {
+    const int THREADS = 4;
+    const char* names[] = { "Alpha", "Bravo", "Charlie", "Delta", "Echo", "Foxtrot" };
+    uint8_t ids[THREADS][6];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 6; i++) {
+                ids[t][i] = LogComponents::intern(names[(i + t) % 6]);
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (int t = 0; t < THREADS; t++) {
+        for (int i = 0; i < 6; i++) {
+            TEST_ASSERT_EQUAL_UINT8(LogComponents::intern(names[(i + t) % 6]), ids[t][i]);
+        }
+    }
+}
+
+void test_intern_cached(void) {
+    const char* led = "LEDManager";
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::intern(led), LogComponents::internCached(led));
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::intern(led), LogComponents::internCached(led));
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::NONE, LogComponents::internCached(""));
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::NONE, LogComponents::internCached(nullptr));
+
+    // Same pointer, new contents (a reused String buffer): the cached id is not trusted
+    char buffer[32];
+    strcpy(buffer, "Startup");
+    const uint8_t startup = LogComponents::internCached(buffer);
+    strcpy(buffer, "EffectFactory");
+    const uint8_t factory = LogComponents::internCached(buffer);
+    TEST_ASSERT_TRUE(startup != factory);
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::intern("Startup"), startup);
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::intern("EffectFactory"), factory);
+}
+
+void test_benchmark_intern_cached(void) {
+    // LogManager's named methods looked their component up on every call;
+    // the name interned last is the longest scan
+    using clock = std::chrono::steady_clock;
+    const uint32_t CALLS = 500000;
+    char name[16];
+    for (int i = 0; i < 40; i++) {
+        snprintf(name, sizeof(name), "Bench%d", i);
+        LogComponents::intern(name);
+    }
+    static const char* component = "BenchLast";
+    const uint8_t id = LogComponents::intern(component);
+    volatile uint8_t sink = 0;
+
+    auto begin = clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        sink = LogComponents::intern(component);
+    }
+    const double internNs = std::chrono::duration<double, std::nano>(clock::now() - begin).count() / CALLS;
+
+    begin = clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        sink = LogComponents::internCached(component);
+    }
+    const double cachedNs = std::chrono::duration<double, std::nano>(clock::now() - begin).count() / CALLS;
+    TEST_ASSERT_EQUAL_UINT8(id, sink);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "component lookup with %u names: intern %.1f ns, internCached %.1f ns",
+        (unsigned) LogComponents::count(), internNs, cachedNs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(cachedNs < internNs);
+}
+
+// What LogManager did for every call: format first, then compare strings
+static std::vector<std::string> oldComponents = { "Main", "Startup", "LEDManager", "PatternManager",
+    "ChoreographyManager", "WiFiManager", "WebSocketServer", "EffectFactory" };
+static std::vector<std::string> oldLevels;
+
+static bool oldShouldLog(const char* component, const char* level) {
+    bool componentAllowed = false;
+    for (const std::string& allowed : oldComponents) {
+        if (strcmp(component, allowed.c_str()) == 0) {
+            componentAllowed = true;
+            break;
+        }
+    }
+    if (!componentAllowed) {
+        return false;
+    }
+    if (!oldLevels.empty()) {
+        bool levelAllowed = false;
+        for (const std::string& allowed : oldLevels) {
+            if (strcmp(level, allowed.c_str()) == 0) {
+                levelAllowed = true;
+                break;
+            }
+        }
+        return levelAllowed;
+    }
+    return true;
+}
+
+static void __attribute__((noinline)) oldDebugComponentPrintf(const char* component, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    char message[128];
+    strncpy(message, buffer, sizeof(message) - 1);
+    if (oldShouldLog(component, "DEBUG")) {
+        written++;
+    }
+}
+
+static void __attribute__((noinline)) newDebugCall(uint32_t frame, int us) {
+    static const uint8_t id = LogComponents::intern("HardwareInput");
+    if (filter.allows(LogLevel::DEBUG, id)) {
+        char message[128];
+        snprintf(message, sizeof(message), "Frame %lu took %d us", (unsigned long) frame, us);
+        written++;
+    }
+}
+
+void test_benchmark_filtered_debug_call(void) {
+    using clock = std::chrono::steady_clock;
+    const uint32_t CALLS = 500000;
+    // main.cpp's filter: a component outside it, as most debug lines are
+    filter.setComponentFiltering(true);
+    for (const std::string& name : oldComponents) {
+        filter.allowComponent(LogComponents::intern(name.c_str()));
+    }
+
+    auto begin = clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        oldDebugComponentPrintf("HardwareInput", "Frame %lu took %d us", (unsigned long) i, 9000 + (int) (i % 700));
+    }
+    const double oldNs = std::chrono::duration<double, std::nano>(clock::now() - begin).count() / CALLS;
+
+    begin = clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        newDebugCall(i, 9000 + (int) (i % 700));
+    }
+    const double newNs = std::chrono::duration<double, std::nano>(clock::now() - begin).count() / CALLS;
+    TEST_ASSERT_EQUAL_INT(0, written);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "filtered debug call: format then strcmp %.1f ns, id bit test %.1f ns (%.0fx)",
+        oldNs, newNs, oldNs / newNs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(newNs < oldNs);
+}
+
+// Last: fills the global table
+void test_full_table_shares_last_id(void) {
+    char name[16];
+    uint8_t last = 0;
+    for (size_t i = 0; i < LogComponents::MAX_COMPONENTS + 4; i++) {
+        snprintf(name, sizeof(name), "Filler%u", (unsigned) i);
+        last = LogComponents::intern(name);
+    }
+    TEST_ASSERT_EQUAL_UINT32(LogComponents::MAX_COMPONENTS, LogComponents::count());
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::MAX_COMPONENTS - 1, last);
+    TEST_ASSERT_EQUAL_UINT8(LogComponents::MAX_COMPONENTS - 1, LogComponents::intern("OneMore"));
+    // Names interned before the table filled keep their ids
+    TEST_ASSERT_EQUAL_STRING("LEDManager", LogComponents::name(LogComponents::intern("LEDManager")));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_compiled_out_calls_skip_their_arguments);
+    RUN_TEST(test_filtered_calls_skip_their_arguments);
+    RUN_TEST(test_intern);
+    RUN_TEST(test_component_and_level_masks);
+    RUN_TEST(test_concurrent_intern);
+    RUN_TEST(test_intern_cached);
+    RUN_TEST(test_benchmark_intern_cached);
+    RUN_TEST(test_benchmark_filtered_debug_call);
+    RUN_TEST(test_full_table_shares_last_id);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,222 @@
+#include "unity.h"
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../../src/hal/network/PacketAssembler.cpp"
+
+/**
+ * Multi-part command reassembly tests
+ *
+ * Splits a command into parts and feeds them in order, shuffled, doubled,
+ * too slowly, too large and from two senders at once, checking the result
+ * is the original text and that the envelope is read from real fragments.
+ *
+ * Run with: pio test -e native -f test_packet_assembler
+ */
+
+static const char* COMMAND =
+    "{\"t\":\"choreography\",\"tl\":[{\"at\":0,\"fx\":\"rainbow\"},{\"at\":2000,\"fx\":\"twinkle\"},"
+    "{\"at\":4000,\"fx\":\"pulse\",\"p\":{\"speed\":3}},{\"at\":6000,\"fx\":\"fire\"}]}";
+
+static std::string parts[16];
+static size_t partCount = 0;
+
+// Split COMMAND into parts of at most size bytes
+static void split(size_t size) {
+    const std::string command(COMMAND);
+    partCount = 0;
+    for (size_t offset = 0; offset < command.size(); offset += size) {
+        parts[partCount++] = command.substr(offset, size);
+    }
+}
+
+static PacketFragment fragment(size_t index, bool withTotal = true, uint32_t id = 0) {
+    PacketFragment f;
+    f.transferId = id;
+    f.sequence = (uint16_t) (index + 1);
+    f.total = withTotal ? (uint16_t) partCount : 0;
+    f.end = index + 1 == partCount;
+    f.payload = parts[index].c_str();
+    f.payloadLength = parts[index].size();
+    return f;
+}
+
+static void assertAssembled(const PacketAssembler& assembler) {
+    TEST_ASSERT_EQUAL_UINT32(strlen(COMMAND), assembler.length());
+    TEST_ASSERT_TRUE(memcmp(assembler.data(), COMMAND, strlen(COMMAND)) == 0);
+}
+
+void setUp(void) {
+    split(30);
+}
+void tearDown(void) {}
+
+void test_in_order(void) {
+    PacketAssembler assembler;
+    for (size_t i = 0; i + 1 < partCount; i++) {
+        TEST_ASSERT_EQUAL_INT((int) FragmentResult::Accepted, (int) assembler.accept(1, fragment(i), 0));
+        TEST_ASSERT_EQUAL_UINT32(0, assembler.length());
+    }
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) assembler.accept(1, fragment(partCount - 1), 0));
+    assertAssembled(assembler);
+    TEST_ASSERT_EQUAL_UINT32(0, assembler.getStats().reordered);
+}
+
+void test_total_from_end_marker(void) {
+    PacketAssembler assembler;
+    for (size_t i = 0; i + 1 < partCount; i++) {
+        assembler.accept(0, fragment(i, false), 0);
+    }
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) assembler.accept(0, fragment(partCount - 1, false), 0));
+    assertAssembled(assembler);
+}
+
+void test_out_of_order(void) {
+    const size_t orders[][5] = {{4, 3, 2, 1, 0}, {2, 0, 4, 1, 3}, {4, 0, 1, 2, 3}, {1, 0, 3, 2, 4}};
+    TEST_ASSERT_EQUAL_UINT32(5, partCount);
+    for (const auto& order : orders) {
+        PacketAssembler assembler;
+        FragmentResult result = FragmentResult::Invalid;
+        // Without _n, the part count is only known once the end part is in
+        for (size_t i = 0; i < 5; i++) {
+            result = assembler.accept(0, fragment(order[i], false), 0);
+        }
+        TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) result);
+        assertAssembled(assembler);
+        TEST_ASSERT_EQUAL_UINT32(1, assembler.getStats().reordered);
+    }
+}
+
+void test_duplicates(void) {
+    PacketAssembler assembler;
+    assembler.accept(0, fragment(0), 0);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Duplicate, (int) assembler.accept(0, fragment(0), 0));
+    assembler.accept(0, fragment(2), 0);
+    assembler.accept(0, fragment(1), 0);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Duplicate, (int) assembler.accept(0, fragment(2), 0));
+    assembler.accept(0, fragment(3), 0);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) assembler.accept(0, fragment(4), 0));
+    assertAssembled(assembler);
+    TEST_ASSERT_EQUAL_UINT32(2, assembler.getStats().duplicates);
+}
+
+void test_timeout(void) {
+    PacketAssembler assembler(PacketAssembler::DEFAULT_CAPACITY, 1000);
+    assembler.accept(0, fragment(0), 0);
+    assembler.accept(0, fragment(1), 900);
+    TEST_ASSERT_FALSE(assembler.expire(1800));  // Idle time counts from the last part
+    TEST_ASSERT_TRUE(assembler.expire(1900));
+    TEST_ASSERT_FALSE(assembler.inProgress());
+    TEST_ASSERT_EQUAL_UINT32(1, assembler.getStats().timedOut);
+
+    // A late part starts over rather than completing a stale transfer
+    assembler.accept(0, fragment(2), 5000);
+    assembler.accept(0, fragment(3), 5000);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Accepted, (int) assembler.accept(0, fragment(4), 5000));
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Accepted, (int) assembler.accept(0, fragment(0), 7000));
+    TEST_ASSERT_EQUAL_UINT32(2, assembler.getStats().timedOut);
+}
+
+void test_overflow(void) {
+    PacketAssembler assembler(70);
+    assembler.accept(0, fragment(0), 0);
+    assembler.accept(0, fragment(1), 0);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Overflow, (int) assembler.accept(0, fragment(2), 0));
+    TEST_ASSERT_FALSE(assembler.inProgress());
+
+    // Sequence or count beyond the part table
+    PacketFragment f = fragment(0);
+    f.sequence = PacketAssembler::MAX_FRAGMENTS + 1;
+    f.total = 0;
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Invalid, (int) assembler.accept(0, f, 0));
+    f = fragment(0);
+    f.sequence = 7;  // Beyond its own _n
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Invalid, (int) assembler.accept(0, f, 0));
+}
+
+void test_part_past_known_total(void) {
+    // _n=3 from the first part; a part 5 without _n must not count toward it
+    split(60);
+    TEST_ASSERT_EQUAL_UINT32(3, partCount);
+    PacketAssembler assembler;
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Accepted, (int) assembler.accept(0, fragment(0), 0));
+    PacketFragment f = fragment(1, false);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Accepted, (int) assembler.accept(0, f, 0));
+    f.sequence = 5;
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Invalid, (int) assembler.accept(0, f, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, assembler.length());
+    TEST_ASSERT_TRUE(assembler.inProgress());
+
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) assembler.accept(0, fragment(2, false), 0));
+    assertAssembled(assembler);
+}
+
+void test_busy_and_new_transfer(void) {
+    PacketAssembler assembler;
+    assembler.accept(1, fragment(0, true, 10), 0);
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Busy, (int) assembler.accept(2, fragment(0, true, 20), 0));
+    TEST_ASSERT_EQUAL_INT(1, assembler.source());
+
+    // Same sender, new _id: the old transfer is abandoned
+    assembler.accept(1, fragment(1, true, 10), 0);
+    assembler.accept(1, fragment(0, true, 11), 0);
+    TEST_ASSERT_EQUAL_UINT32(1, assembler.getStats().abandoned);
+    FragmentResult result = FragmentResult::Invalid;
+    for (size_t i = 1; i < partCount; i++) {
+        result = assembler.accept(1, fragment(i, true, 11), 0);
+    }
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) result);
+    assertAssembled(assembler);
+
+    // Once complete, anyone may start the next transfer
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Accepted, (int) assembler.accept(2, fragment(0), 0));
+    TEST_ASSERT_EQUAL_INT(2, assembler.source());
+}
+
+void test_single_part(void) {
+    split(1000);
+    TEST_ASSERT_EQUAL_UINT32(1, partCount);
+    PacketAssembler assembler;
+    TEST_ASSERT_EQUAL_INT((int) FragmentResult::Complete, (int) assembler.accept(0, fragment(0, false), 0));
+    assertAssembled(assembler);
+}
+
+void test_read_fragment(void) {
+    StaticJsonDocument<256> doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"_s\":2,\"_n\":3,\"_id\":42,\"_e\":false,\"_p\":\"tl\\\":[\"}"));
+    TEST_ASSERT_TRUE(PacketAssembler::isFragment(doc.as<JsonObjectConst>()));
+    PacketFragment f;
+    TEST_ASSERT_TRUE(PacketAssembler::readFragment(doc.as<JsonObjectConst>(), f));
+    TEST_ASSERT_EQUAL_UINT32(42, f.transferId);
+    TEST_ASSERT_EQUAL_INT(2, f.sequence);
+    TEST_ASSERT_EQUAL_INT(3, f.total);
+    TEST_ASSERT_FALSE(f.end);
+    TEST_ASSERT_EQUAL_UINT32(5, f.payloadLength);
+    TEST_ASSERT_TRUE(strcmp(f.payload, "tl\":[") == 0);
+
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"t\":\"effect\"}"));
+    TEST_ASSERT_FALSE(PacketAssembler::isFragment(doc.as<JsonObjectConst>()));
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"_s\":0,\"_p\":\"x\"}"));
+    TEST_ASSERT_FALSE(PacketAssembler::readFragment(doc.as<JsonObjectConst>(), f));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_in_order);
+    RUN_TEST(test_total_from_end_marker);
+    RUN_TEST(test_out_of_order);
+    RUN_TEST(test_duplicates);
+    RUN_TEST(test_timeout);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_part_past_known_total);
+    RUN_TEST(test_busy_and_new_transfer);
+    RUN_TEST(test_single_part);
+    RUN_TEST(test_read_fragment);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,265 @@
+#include "unity.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../src/freertos/SRRing.h"
+
+/**
+ * SRRing stress tests and benchmark
+ *
+ * Hammers SRSpscRing and SRMpscRing from real threads and checks nothing is
+ * lost, duplicated or reordered, then times them against a mutex-guarded
+ * deque - what SRSmartQueue does on the device - for throughput and
+ * per-item latency.
+ *
+ * Run with: pio test -e native -f test_sr_ring
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t RING_SIZE = 32;  // LEDManager::COMMAND_RING_SIZE
+static const uint32_t STRESS_ITEMS = 1000000;
+static const int PRODUCERS = 4;
+static const uint32_t BENCH_ITEMS = 200000;
+
+// Producer id in the top byte, sequence number below
+static uint32_t tag(int producer, uint32_t sequence) {
+    return ((uint32_t) producer << 24) | sequence;
+}
+
+// Host equivalent of SRSmartQueue: std::deque behind a mutex, bounded
+template<typename T>
+class MutexQueue {
+public:
+    explicit MutexQueue(size_t maxLength) : _maxLength(maxLength) {}
+
+    bool push(T&& item) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_items.size() >= _maxLength) return false;
+        _items.push_back(std::move(item));
+        return true;
+    }
+
+    bool pop(T& out) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_items.empty()) return false;
+        out = std::move(_items.front());
+        _items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex _mutex;
+    std::deque<T> _items;
+    size_t _maxLength;
+};
+
+struct Timed {
+    uint32_t value;
+    Clock::time_point sent;
+};
+
+struct BenchResult {
+    double itemsPerSecond;
+    double p50Ns;
+    double p99Ns;
+};
+
+// Producers push timestamped items as fast as the queue takes them; one
+// consumer pops and records how long each item waited
+template<typename Queue>
+static BenchResult bench(Queue& queue, int producers) {
+    const uint32_t perProducer = BENCH_ITEMS / producers;
+    std::vector<double> latencies;
+    latencies.reserve(perProducer * producers);
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, perProducer]() {
+            for (uint32_t i = 0; i < perProducer; i++) {
+                Timed item{tag(p, i), Clock::now()};
+                while (!queue.push(std::move(item))) {
+                    std::this_thread::yield();
+                    item.sent = Clock::now();
+                }
+            }
+        });
+    }
+    Timed item;
+    while (latencies.size() < (size_t) perProducer * producers) {
+        if (queue.pop(item)) {
+            latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - item.sent).count());
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& t : threads) t.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    BenchResult result;
+    result.itemsPerSecond = latencies.size() / seconds;
+    result.p50Ns = latencies[latencies.size() / 2];
+    result.p99Ns = latencies[latencies.size() * 99 / 100];
+    return result;
+}
+
+static void report(const char* name, const BenchResult& ring, const BenchResult& mutex) {
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%-5s ring %6.2f M/s p50 %7.0f ns p99 %8.0f ns | mutex %6.2f M/s p50 %7.0f ns p99 %8.0f ns",
+        name, ring.itemsPerSecond / 1e6, ring.p50Ns, ring.p99Ns,
+        mutex.itemsPerSecond / 1e6, mutex.p50Ns, mutex.p99Ns);
+    TEST_MESSAGE(msg);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_full_and_empty(void) {
+    SRSpscRing<int, 4> spsc;
+    SRMpscRing<int, 4> mpsc;
+    int out = -1;
+    TEST_ASSERT_FALSE(spsc.pop(out));
+    TEST_ASSERT_FALSE(mpsc.pop(out));
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(spsc.push(i));
+        TEST_ASSERT_TRUE(mpsc.push(i));
+    }
+    TEST_ASSERT_FALSE(spsc.push(4));
+    TEST_ASSERT_FALSE(mpsc.push(4));
+    TEST_ASSERT_EQUAL_INT(4, (int) spsc.size());
+    TEST_ASSERT_EQUAL_INT(4, (int) mpsc.size());
+
+    // Wraps around after a pop
+    TEST_ASSERT_TRUE(spsc.pop(out));
+    TEST_ASSERT_EQUAL_INT(0, out);
+    TEST_ASSERT_TRUE(mpsc.pop(out));
+    TEST_ASSERT_EQUAL_INT(0, out);
+    TEST_ASSERT_TRUE(spsc.push(4));
+    TEST_ASSERT_TRUE(mpsc.push(4));
+    for (int i = 1; i <= 4; i++) {
+        TEST_ASSERT_TRUE(spsc.pop(out));
+        TEST_ASSERT_EQUAL_INT(i, out);
+        TEST_ASSERT_TRUE(mpsc.pop(out));
+        TEST_ASSERT_EQUAL_INT(i, out);
+    }
+    TEST_ASSERT_TRUE(spsc.empty());
+    TEST_ASSERT_TRUE(mpsc.empty());
+}
+
+void test_move_only_items(void) {
+    SRMpscRing<std::unique_ptr<int>, 4> ring;
+    std::unique_ptr<int> item(new int(42));
+    TEST_ASSERT_TRUE(ring.push(std::move(item)));
+    TEST_ASSERT_TRUE(item == nullptr);
+
+    // A refused push leaves the item with the caller
+    for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(ring.push(std::unique_ptr<int>(new int(i))));
+    std::unique_ptr<int> extra(new int(7));
+    TEST_ASSERT_FALSE(ring.push(std::move(extra)));
+    TEST_ASSERT_TRUE(extra != nullptr);
+
+    std::unique_ptr<int> out;
+    TEST_ASSERT_TRUE(ring.pop(out));
+    TEST_ASSERT_EQUAL_INT(42, *out);
+}
+
+void test_pop_releases_slot(void) {
+    // A popped shared_ptr must not stay alive in the ring (pooled command
+    // documents are only reusable once the last reference goes)
+    SRMpscRing<std::shared_ptr<int>, 4> ring;
+    std::shared_ptr<int> doc = std::make_shared<int>(1);
+    TEST_ASSERT_TRUE(ring.push(doc));
+    TEST_ASSERT_EQUAL_INT(2, (int) doc.use_count());
+    std::shared_ptr<int> out;
+    TEST_ASSERT_TRUE(ring.pop(out));
+    out.reset();
+    TEST_ASSERT_EQUAL_INT(1, (int) doc.use_count());
+}
+
+void test_spsc_stress(void) {
+    static SRSpscRing<uint32_t, RING_SIZE> ring;
+    std::thread producer([]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            while (!ring.push(i)) std::this_thread::yield();
+        }
+    });
+    uint32_t expected = 0, value = 0;
+    bool ordered = true;
+    while (expected < STRESS_ITEMS) {
+        if (ring.pop(value)) {
+            ordered = ordered && value == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_mpsc_stress(void) {
+    static SRMpscRing<uint32_t, RING_SIZE> ring;
+    const uint32_t perProducer = STRESS_ITEMS / PRODUCERS;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([p, perProducer]() {
+            for (uint32_t i = 0; i < perProducer; i++) {
+                while (!ring.push(tag(p, i))) std::this_thread::yield();
+            }
+        });
+    }
+    // Each producer's items arrive in its own order, none lost or repeated
+    uint32_t next[PRODUCERS] = {};
+    uint32_t received = 0, value = 0;
+    bool ordered = true;
+    while (received < perProducer * PRODUCERS) {
+        if (ring.pop(value)) {
+            const int p = value >> 24;
+            ordered = ordered && p < PRODUCERS && (value & 0xFFFFFF) == next[p];
+            if (p < PRODUCERS) next[p]++;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : producers) t.join();
+    TEST_ASSERT_TRUE(ordered);
+    for (int p = 0; p < PRODUCERS; p++) {
+        TEST_ASSERT_EQUAL_UINT32(perProducer, next[p]);
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_benchmark_against_mutex_queue(void) {
+    static SRSpscRing<Timed, RING_SIZE> spsc;
+    static SRMpscRing<Timed, RING_SIZE> mpsc;
+    MutexQueue<Timed> single(RING_SIZE), multi(RING_SIZE);
+
+    report("spsc", bench(spsc, 1), bench(single, 1));
+    report("mpsc", bench(mpsc, PRODUCERS), bench(multi, PRODUCERS));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_and_empty);
+    RUN_TEST(test_move_only_items);
+    RUN_TEST(test_pop_releases_slot);
+    RUN_TEST(test_spsc_stress);
+    RUN_TEST(test_mpsc_stress);
+    RUN_TEST(test_benchmark_against_mutex_queue);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
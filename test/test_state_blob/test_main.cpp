@@ -0,0 +1,163 @@
+#include "unity.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../src/utility/StateBlob.cpp"
+
+/**
+ * StateBlob tests
+ *
+ * Round-trips the persisted-state record PreferencesManager writes, and
+ * checks that damaged, truncated and foreign blobs are rejected (so the
+ * device falls back to the legacy keys) and that fields added or removed
+ * between firmware versions are tolerated.
+ *
+ * Run with: pio test -e native -f test_state_blob
+ */
+
+enum : uint8_t { TAG_BRIGHTNESS = 1, TAG_SPEED = 5, TAG_FLAG = 6, TAG_EFFECT = 10, TAG_FUTURE = 200 };
+
+static std::vector<uint8_t> build(bool withFuture) {
+    const char* effect = "{\"t\":\"rainbow\",\"p\":{\"speed\":1.5}}";
+    // Counting pass, then the real one - as PreferencesManager::encode does
+    std::vector<uint8_t> out;
+    for (int pass = 0; pass < 2; pass++) {
+        StateBlobWriter writer(pass == 0 ? nullptr : out.data(), out.size());
+        writer.putI32(TAG_BRIGHTNESS, 200);
+        writer.putF32(TAG_SPEED, 1.25f);
+        writer.putU8(TAG_FLAG, 1);
+        if (withFuture) writer.putI32(TAG_FUTURE, 7);
+        writer.putString(TAG_EFFECT, effect, strlen(effect));
+        const size_t size = writer.finish();
+        TEST_ASSERT_TRUE(size > 0);
+        out.resize(size);
+    }
+    return out;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_crc32_check_value(void) {
+    const char* check = "123456789";
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926u, StateBlob::crc32((const uint8_t*) check, 9));
+    // Incremental matches one shot
+    const uint32_t part = StateBlob::crc32((const uint8_t*) check, 4);
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926u, StateBlob::crc32((const uint8_t*) check + 4, 5, part));
+}
+
+void test_round_trip(void) {
+    std::vector<uint8_t> blob = build(false);
+    StateBlobReader reader;
+    TEST_ASSERT_TRUE(reader.open(blob.data(), blob.size()) == StateBlobStatus::Ok);
+    TEST_ASSERT_EQUAL_INT(StateBlob::VERSION, reader.version());
+
+    int32_t brightness = 0;
+    float speed = 0;
+    uint8_t flag = 0;
+    std::string effect;
+    uint8_t tag;
+    const uint8_t* data;
+    uint16_t length;
+    int fields = 0;
+    while (reader.next(tag, data, length)) {
+        fields++;
+        if (tag == TAG_BRIGHTNESS) TEST_ASSERT_TRUE(StateBlobReader::readI32(data, length, brightness));
+        if (tag == TAG_SPEED) TEST_ASSERT_TRUE(StateBlobReader::readF32(data, length, speed));
+        if (tag == TAG_FLAG) TEST_ASSERT_TRUE(StateBlobReader::readU8(data, length, flag));
+        if (tag == TAG_EFFECT) effect.assign((const char*) data, length);
+    }
+    TEST_ASSERT_EQUAL_INT(4, fields);
+    TEST_ASSERT_EQUAL_INT(200, brightness);
+    TEST_ASSERT_TRUE(speed == 1.25f);
+    TEST_ASSERT_EQUAL_INT(1, flag);
+    TEST_ASSERT_TRUE(effect == "{\"t\":\"rainbow\",\"p\":{\"speed\":1.5}}");
+}
+
+void test_counting_pass_matches(void) {
+    StateBlobWriter counter(nullptr, 0);
+    counter.putI32(TAG_BRIGHTNESS, 1);
+    counter.putString(TAG_EFFECT, "abc", 3);
+    TEST_ASSERT_EQUAL_INT((int) (StateBlob::HEADER_SIZE + 2 * StateBlob::FIELD_HEADER_SIZE + 4 + 3), (int) counter.finish());
+}
+
+void test_overflow_fails(void) {
+    uint8_t small[20];
+    StateBlobWriter writer(small, sizeof(small));
+    writer.putI32(TAG_BRIGHTNESS, 1);
+    writer.putString(TAG_EFFECT, "too long for the buffer", 23);
+    TEST_ASSERT_TRUE(writer.overflowed());
+    TEST_ASSERT_EQUAL_INT(0, (int) writer.finish());
+}
+
+void test_rejects_damaged_blobs(void) {
+    std::vector<uint8_t> blob = build(false);
+    StateBlobReader reader;
+    TEST_ASSERT_TRUE(reader.open(nullptr, 0) == StateBlobStatus::Empty);
+    TEST_ASSERT_TRUE(reader.open(blob.data(), 8) == StateBlobStatus::Truncated);
+    TEST_ASSERT_TRUE(reader.open(blob.data(), blob.size() - 1) == StateBlobStatus::Truncated);
+
+    // A single flipped bit anywhere in the payload
+    for (size_t i = StateBlob::HEADER_SIZE; i < blob.size(); i++) {
+        std::vector<uint8_t> damaged = blob;
+        damaged[i] ^= 0x10;
+        TEST_ASSERT_TRUE(reader.open(damaged.data(), damaged.size()) == StateBlobStatus::BadCrc);
+    }
+
+    std::vector<uint8_t> foreign = blob;
+    foreign[0] ^= 0xFF;
+    TEST_ASSERT_TRUE(reader.open(foreign.data(), foreign.size()) == StateBlobStatus::BadMagic);
+
+    // A failed open leaves no fields to read
+    uint8_t tag;
+    const uint8_t* data;
+    uint16_t length;
+    TEST_ASSERT_FALSE(reader.next(tag, data, length));
+}
+
+void test_unknown_fields_are_skipped(void) {
+    // Written by newer firmware with an extra field; older firmware still
+    // finds every field it knows
+    std::vector<uint8_t> blob = build(true);
+    StateBlobReader reader;
+    TEST_ASSERT_TRUE(reader.open(blob.data(), blob.size()) == StateBlobStatus::Ok);
+    uint8_t tag;
+    const uint8_t* data;
+    uint16_t length;
+    int known = 0;
+    while (reader.next(tag, data, length)) {
+        if (tag != TAG_FUTURE) known++;
+    }
+    TEST_ASSERT_EQUAL_INT(4, known);
+}
+
+void test_wrong_field_length_keeps_default(void) {
+    const uint8_t two[2] = {1, 2};
+    int32_t i32 = 42;
+    float f32 = 1.0f;
+    uint8_t u8 = 3;
+    TEST_ASSERT_FALSE(StateBlobReader::readI32(two, sizeof(two), i32));
+    TEST_ASSERT_FALSE(StateBlobReader::readF32(two, sizeof(two), f32));
+    TEST_ASSERT_FALSE(StateBlobReader::readU8(two, sizeof(two), u8));
+    TEST_ASSERT_EQUAL_INT(42, i32);
+    TEST_ASSERT_TRUE(f32 == 1.0f);
+    TEST_ASSERT_EQUAL_INT(3, u8);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_check_value);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_counting_pass_matches);
+    RUN_TEST(test_overflow_fails);
+    RUN_TEST(test_rejects_damaged_blobs);
+    RUN_TEST(test_unknown_fields_are_skipped);
+    RUN_TEST(test_wrong_field_length_keeps_default);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
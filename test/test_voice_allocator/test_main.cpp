@@ -0,0 +1,89 @@
+#include "unity.h"
+
+#include "../../src/lights/VoiceAllocator.cpp"
+
+/**
+ * Voice allocator tests
+ *
+ * Checks the free list hands out and takes back voices, and that each steal
+ * policy picks the expected victim once the pool is full.
+ *
+ * Run with: pio test -e native -f test_voice_allocator
+ */
+
+static float noScore(int) { return 0.0f; }
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_free_list_reuses_released_voices(void) {
+    VoiceAllocator voices;
+    voices.init(3, VoiceStealPolicy::None);
+    TEST_ASSERT_EQUAL_INT(0, voices.allocate(0, noScore));
+    TEST_ASSERT_EQUAL_INT(1, voices.allocate(0, noScore));
+    TEST_ASSERT_EQUAL_INT(2, voices.allocate(0, noScore));
+    TEST_ASSERT_EQUAL_INT(-1, voices.allocate(0, noScore));
+
+    voices.release(1);
+    voices.release(1);  // Double release is ignored
+    TEST_ASSERT_EQUAL_INT(2, voices.activeCount());
+    TEST_ASSERT_EQUAL_INT(1, voices.allocate(0, noScore));
+
+    const VoiceStats& stats = voices.getStats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.allocated);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.stolen);
+    TEST_ASSERT_EQUAL_UINT16(3, stats.peakActive);
+}
+
+void test_oldest_policy_steals_longest_running(void) {
+    VoiceAllocator voices;
+    voices.init(3, VoiceStealPolicy::Oldest);
+    voices.allocate(100, noScore);
+    voices.allocate(50, noScore);
+    voices.allocate(200, noScore);
+    TEST_ASSERT_EQUAL_INT(1, voices.allocate(300, noScore));
+    // Voice 1 restarted at 300, so voice 0 is now the oldest
+    TEST_ASSERT_EQUAL_INT(0, voices.allocate(310, noScore));
+    TEST_ASSERT_EQUAL_UINT32(2, voices.getStats().stolen);
+    TEST_ASSERT_EQUAL_UINT32(0, voices.getStats().dropped);
+}
+
+void test_scored_policy_steals_highest_score(void) {
+    const float scores[] = {-0.8f, -0.1f, -0.5f};  // Negated loudness: voice 1 is quietest
+    VoiceAllocator voices;
+    voices.init(3, VoiceStealPolicy::Quietest);
+    for (int i = 0; i < 3; i++) {
+        voices.allocate(0, noScore);
+    }
+    TEST_ASSERT_EQUAL_INT(1, voices.allocate(10, [&](int i) { return scores[i]; }));
+    TEST_ASSERT_EQUAL_UINT32(1, voices.getStats().stolen);
+
+    voices.resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, voices.getStats().stolen);
+    TEST_ASSERT_EQUAL_UINT16(3, voices.getStats().peakActive);
+}
+
+void test_policy_names_round_trip(void) {
+    const VoiceStealPolicy policies[] = {
+        VoiceStealPolicy::None, VoiceStealPolicy::Oldest,
+        VoiceStealPolicy::Quietest, VoiceStealPolicy::FurthestOffGrid
+    };
+    for (VoiceStealPolicy policy : policies) {
+        TEST_ASSERT_TRUE(VoiceAllocator::policyFromName(VoiceAllocator::policyName(policy)) == policy);
+    }
+    TEST_ASSERT_TRUE(VoiceAllocator::policyFromName("bogus", VoiceStealPolicy::None) == VoiceStealPolicy::None);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_free_list_reuses_released_voices);
+    RUN_TEST(test_oldest_policy_steals_longest_running);
+    RUN_TEST(test_scored_policy_steals_highest_score);
+    RUN_TEST(test_policy_names_round_trip);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
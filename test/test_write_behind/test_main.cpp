@@ -0,0 +1,112 @@
+#include "unity.h"
+#include <cstdio>
+
+#include "../../src/utility/WriteBehind.h"
+
+/**
+ * Write-behind timing tests
+ *
+ * Checks when PreferencesWriterTask flushes a burst of DeviceState changes,
+ * and replays effect cycling to count flash writes landing on LED frames
+ * with synchronous saves and with write-behind.
+ *
+ * Run with: pio test -e native -f test_write_behind
+ */
+
+static const uint32_t QUIET_MS = 2000;      // PreferencesWriterTask defaults
+static const uint32_t MAX_DELAY_MS = 10000;
+static const uint32_t POLL_MS = 100;        // PreferencesWriterTask::POLL_INTERVAL_MS
+static const uint32_t FRAME_MS = 16;        // LEDUpdateTask interval
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_flushes_after_quiet_period(void) {
+    WriteBehind timer(QUIET_MS, MAX_DELAY_MS);
+    TEST_ASSERT_FALSE(timer.due(0));
+    timer.markDirty(1000);
+    TEST_ASSERT_TRUE(timer.dirty());
+    TEST_ASSERT_FALSE(timer.due(1000 + QUIET_MS - 1));
+    TEST_ASSERT_TRUE(timer.due(1000 + QUIET_MS));
+    timer.flushed();
+    TEST_ASSERT_FALSE(timer.dirty());
+    TEST_ASSERT_FALSE(timer.due(1000 + QUIET_MS * 2));
+}
+
+void test_each_change_restarts_quiet_period(void) {
+    WriteBehind timer(QUIET_MS, MAX_DELAY_MS);
+    for (uint32_t t = 0; t <= 3000; t += 300) {
+        timer.markDirty(t);
+        TEST_ASSERT_FALSE(timer.due(t + QUIET_MS - 1));
+    }
+    TEST_ASSERT_TRUE(timer.due(3000 + QUIET_MS));
+    TEST_ASSERT_EQUAL_UINT32(11, timer.changes());
+}
+
+void test_max_delay_bounds_unsaved_time(void) {
+    // Never quiet: a change every 500 ms still gets saved every MAX_DELAY_MS
+    WriteBehind timer(QUIET_MS, MAX_DELAY_MS);
+    uint32_t lastFlush = 0;
+    for (uint32_t t = 0; t < 30000; t += POLL_MS) {
+        if (t % 500 == 0) timer.markDirty(t);
+        if (timer.due(t)) {
+            TEST_ASSERT_TRUE(t - lastFlush <= MAX_DELAY_MS + 500);
+            lastFlush = t;
+            timer.flushed();
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, timer.flushes());
+}
+
+void test_millis_rollover(void) {
+    WriteBehind timer(QUIET_MS, MAX_DELAY_MS);
+    const uint32_t start = 0xFFFFFFFFu - 500;
+    timer.markDirty(start);
+    TEST_ASSERT_FALSE(timer.due(start + 1000));
+    TEST_ASSERT_TRUE(timer.due(start + QUIET_MS));
+}
+
+void test_effect_cycling_flash_writes(void) {
+    // Next-effect every 400 ms for a minute, then the user stops. Synchronous
+    // saves write flash from the LED task on every change; write-behind
+    // writes from the writer task once the cycling settles (or every
+    // MAX_DELAY_MS while it does not).
+    const uint32_t CYCLE_MS = 400;
+    const uint32_t DURATION_MS = 60000;
+    WriteBehind timer(QUIET_MS, MAX_DELAY_MS);
+    uint32_t syncWritesOnFrames = 0, changes = 0;
+    uint32_t nextChange = 0;
+
+    for (uint32_t t = 0; t < DURATION_MS + QUIET_MS + POLL_MS; t += FRAME_MS) {
+        if (t < DURATION_MS && t >= nextChange) {
+            changes++;
+            syncWritesOnFrames++;  // Old path: SaveUserPreferences inside handleEffectCommand
+            timer.markDirty(t);
+            nextChange += CYCLE_MS;
+        }
+        if (t % POLL_MS < FRAME_MS && timer.due(t)) {
+            timer.flushed();
+        }
+    }
+    TEST_ASSERT_FALSE(timer.dirty());
+    TEST_ASSERT_TRUE(timer.flushes() <= DURATION_MS / MAX_DELAY_MS + 1);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%lu effect changes: synchronous %lu flash writes on LED frames | write-behind %lu writes, 0 on LED frames",
+        (unsigned long) changes, (unsigned long) syncWritesOnFrames, (unsigned long) timer.flushes());
+    TEST_MESSAGE(msg);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_flushes_after_quiet_period);
+    RUN_TEST(test_each_change_restarts_quiet_period);
+    RUN_TEST(test_max_delay_bounds_unsaved_time);
+    RUN_TEST(test_millis_rollover);
+    RUN_TEST(test_effect_cycling_flash_writes);
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
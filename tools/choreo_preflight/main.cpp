@@ -0,0 +1,106 @@
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "lights/ChoreographyTimeline.h"
+#include "lights/ChoreographyStream.h"
+#include "lights/ChoreographyAnalyzer.h"
+
+/**
+ * choreo_preflight - run the device's pre-flight cost analysis on a host
+ *
+ *   pio run -e choreo_preflight
+ *   .pio/build/choreo_preflight/program show.json [options]
+ *
+ * The show is streamed and compiled exactly as ChoreographyManager does for
+ * "file" shows, then analyzed with the same cost model. Prints the report
+ * as JSON (the device's command response) and exits with 2 when any frame
+ * goes over budget, so it can gate a show in a script.
+ */
+
+class FileSource : public ChoreoByteSource {
+public:
+    explicit FileSource(FILE* f) : file(f) {}
+    ~FileSource() override { fclose(file); }
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        return fread(buffer, 1, length, file);
+    }
+
+private:
+    FILE* file;
+};
+
+static void usage() {
+    fprintf(stderr,
+        "usage: choreo_preflight <show.json> [--rows N] [--cols N] [--leds N]\n"
+        "                        [--fps F] [--budget-us U] [--base-us U]\n"
+        "                        [--rings N] [--pulses N] [--steal none|oldest|quietest|furthest_off_grid]\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    ChoreoCostModel model;
+    bool ledsSet = false;
+    for (int i = 2; i < argc; i++) {
+        const char* opt = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (strcmp(opt, "--rows") == 0) model.rows = atoi(value);
+        else if (strcmp(opt, "--cols") == 0) model.cols = atoi(value);
+        else if (strcmp(opt, "--leds") == 0) { model.numLEDs = atoi(value); ledsSet = true; }
+        else if (strcmp(opt, "--fps") == 0) {
+            float fps = (float) atof(value);
+            if (fps <= 0.0f) fps = 60.0f;
+            model.frameMs = 1000.0f / fps;
+            model.frameBudgetUs = (uint32_t) (1000000.0f / fps);
+        }
+        else if (strcmp(opt, "--budget-us") == 0) model.frameBudgetUs = (uint32_t) atol(value);
+        else if (strcmp(opt, "--base-us") == 0) model.baseFrameUs = (float) atof(value);
+        else if (strcmp(opt, "--rings") == 0) model.ringVoices = atoi(value);
+        else if (strcmp(opt, "--pulses") == 0) model.pulseVoices = atoi(value);
+        else if (strcmp(opt, "--steal") == 0) model.stealPolicy = VoiceAllocator::policyFromName(value, model.stealPolicy);
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (!ledsSet) model.numLEDs = model.rows * model.cols;
+
+    FILE* file = fopen(argv[1], "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    CompiledChoreography show;
+    ChoreographyStreamLoader loader;
+    ChoreoCompileStats stats;
+    loader.begin(std::unique_ptr<ChoreoByteSource>(new FileSource(file)), show);
+    while (loader.step(show, 256, &stats)) {
+    }
+    if (loader.hasError()) {
+        fprintf(stderr, "%s: %s after %u bytes\n", argv[1], loader.errorMessage(), (unsigned) loader.bytesRead());
+        return 1;
+    }
+    ChoreographyCompiler::sortEvents(show, 0);
+
+    ChoreoPreflightReport report;
+    ChoreographyAnalyzer::analyze(show, model, report);
+
+    DynamicJsonDocument doc(4096);
+    ChoreographyAnalyzer::toJson(report, model, doc.to<JsonObject>());
+    doc["beats"] = stats.beats;
+    doc["events"] = stats.events;
+    std::string out;
+    serializeJsonPretty(doc, out);
+    printf("%s\n", out.c_str());
+    return report.overloaded() ? 2 : 0;
+}